@@ -0,0 +1,152 @@
+# -*- perl -*-
+########################################################################
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+#
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License.
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+########################################################################
+
+package BGZF;
+
+use strict;
+use Tracer;
+use Compress::Raw::Zlib;
+
+=head1 Blocked Gzip Files
+
+This package reads blocked gzip (BGZF) files (the format is described in
+C<bgzf.h>), such as contigs and translations files compressed with
+C<sims_bgzf>. The indexers record a position in such a file as a virtual
+seek, the file offset of the compressed block times 65536 plus the offset
+in its uncompressed data, and a read decompresses only the blocks that
+hold the data asked for.
+
+    open($fh, "<", $file);
+    if (BGZF::is_bgzf($fh)) {
+        my $data = BGZF::read_at($fh, $vseek, $len);
+        my ($block, $next) = BGZF::read_from($fh, $vseek);
+    }
+
+=cut
+
+#
+
+my $HEADER_LEN = 18;
+my $FOOTER_LEN = 8;
+
+=head2 Public Methods
+
+=head3 is_bgzf
+
+    my $flag = BGZF::is_bgzf($fh);
+
+Return TRUE if an open file starts with a BGZF block header.
+
+=cut
+
+sub is_bgzf {
+    my ($fh) = @_;
+    my $hdr = _read($fh, 0, $HEADER_LEN);
+    return length($hdr) == $HEADER_LEN && _block_size($hdr) ? 1 : 0;
+}
+
+=head3 read_from
+
+    my ($data, $next) = BGZF::read_from($fh, $vseek);
+
+Return the uncompressed data from a virtual seek to the end of its block,
+and the virtual seek of the next block. The data are empty at the end of
+the file.
+
+=cut
+
+sub read_from {
+    my ($fh, $vseek) = @_;
+    my $coff = int($vseek / 65536);
+    my $uoff = $vseek % 65536;
+    while (1) {
+        my ($data, $bsize) = _inflate_at($fh, $coff);
+        return ('', $coff * 65536) unless $bsize;
+        $coff += $bsize;
+        if ($uoff < length($data)) {
+            return (substr($data, $uoff), $coff * 65536);
+        }
+        $uoff -= length($data);
+    }
+}
+
+=head3 read_at
+
+    my $data = BGZF::read_at($fh, $vseek, $len);
+
+Return C<$len> bytes of uncompressed data from a virtual seek, or fewer at
+the end of the file.
+
+=cut
+
+sub read_at {
+    my ($fh, $vseek, $len) = @_;
+    my $retVal = '';
+    while (length($retVal) < $len) {
+        my ($data, $next) = read_from($fh, $vseek);
+        last if $data eq '';
+        $retVal .= $data;
+        $vseek = $next;
+    }
+    return substr($retVal, 0, $len);
+}
+
+# Size of the block whose header is in $hdr, or 0 if it is not BGZF.
+sub _block_size {
+    my ($hdr) = @_;
+    my ($id1, $id2, $cm, $flg, $xlen, $si1, $si2, $slen, $bsize) = unpack("C C C C x6 v C C v v", $hdr);
+    return 0 unless $id1 == 0x1f && $id2 == 0x8b && $cm == 8 && ($flg & 4) && $xlen == 6 &&
+                    $si1 == ord('B') && $si2 == ord('C') && $slen == 2;
+    return $bsize + 1;
+}
+
+# Decompress the block at file offset $coff. Returns its data and its
+# compressed size, or an empty list at the end of the file.
+sub _inflate_at {
+    my ($fh, $coff) = @_;
+    my $hdr = _read($fh, $coff, $HEADER_LEN);
+    return () if $hdr eq '';
+    my $bsize = _block_size($hdr) || Confess("Bad blocked gzip header at $coff");
+    my $block = _read($fh, $coff + $HEADER_LEN, $bsize - $HEADER_LEN);
+    length($block) == $bsize - $HEADER_LEN || Confess("Truncated blocked gzip block at $coff");
+    my ($crc, $isize) = unpack("V V", substr($block, -$FOOTER_LEN));
+    my $data = '';
+    if ($isize) {
+        my $zip = substr($block, 0, -$FOOTER_LEN);
+        my ($inf) = Compress::Raw::Zlib::Inflate->new(-WindowBits => -MAX_WBITS(), -Bufsize => 65536);
+        my $status = $inf->inflate($zip, $data);
+        ($status == Z_STREAM_END && length($data) == $isize && Compress::Raw::Zlib::crc32($data) == $crc)
+            || Confess("Bad blocked gzip block at $coff");
+    }
+    return ($data, $bsize);
+}
+
+# Read up to $len bytes at offset $off of a file.
+sub _read {
+    my ($fh, $off, $len) = @_;
+    my $retVal = '';
+    sysseek($fh, $off, 0) || Confess("Seek failed in blocked gzip file");
+    while (length($retVal) < $len) {
+        my $n = sysread($fh, $retVal, $len - length($retVal), length($retVal));
+        Confess("Read failed in blocked gzip file") unless defined $n;
+        last unless $n;
+    }
+    return $retVal;
+}
+
+1;
@@ -0,0 +1,237 @@
+# -*- perl -*-
+########################################################################
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+#
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License.
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+########################################################################
+
+package Contig2Bit;
+
+use strict;
+use Tracer;
+
+=head1 2-Bit Contig Files
+
+This package reads the 2-bit packed contig files written by
+C<index_contig_files -2> (the format is described in C<contig_2bit.h>). A
+genome's file holds the sequence of each of its contigs in 2 bits per base,
+with lists of the runs of other characters (N and the like) and of lower
+case, so a region of a contig can be read back exactly with a seek and a read
+of a quarter of its length in bytes, instead of reading and stripping the
+FASTA text.
+
+    my $c2b = Contig2Bit->new("$FIG_Config::organisms/$genome/contigs.2bit");
+    my $dna = $c2b->get_dna($contig, $start, $len, '-');
+
+or, for the file in a genome directory of the organisms directory,
+
+    my $dna = Contig2Bit::get_dna($genome, $contig, $start, $len, $strand);
+
+The same reads are available from C with C<contig_2bit.c>, and from the
+command line with C<get_dna_2bit>.
+
+=cut
+
+#
+
+my $HEADER_LEN = 48;
+my $ENTRY_LEN  = 32;
+
+# Each packed byte as its 4 bases.
+my @DECODE = map { my $b = $_; join('', map { substr('TCAG', ($b >> (6 - 2 * $_)) & 3, 1) } 0 .. 3) } 0 .. 255;
+
+# Files opened by get_dna, by genome.
+my %GENOME_FILE;
+
+=head2 Public Methods
+
+=head3 new
+
+    my $c2b = Contig2Bit->new($file);
+
+Open a 2-bit contig file. Returns C<undef> if the file cannot be opened, and
+confesses if it is not a 2-bit contig file. The index of the contigs is read
+when the file is opened.
+
+=cut
+
+sub new {
+    my ($class, $file) = @_;
+    my $fh;
+    open($fh, "<", $file) || return undef;
+    binmode($fh);
+    my $hdr = _read($fh, 0, $HEADER_LEN);
+    my ($magic, $version, undef, $ncontig, $index_off, $names_off, $size) =
+        unpack("a8 V V Q< Q< Q< Q<", $hdr);
+    ($magic eq 'FIG2BIT1' && $version == 1 && $size == -s $fh)
+        || Confess("$file is not a 2-bit contig file");
+    my $index = _read($fh, $index_off, $ENTRY_LEN * $ncontig);
+    my $names = _read($fh, $names_off, $size - $names_off);
+    my %contigs;
+    for (my $i = 0; $i < $ncontig; $i++) {
+        my ($name_off, $name_len, $rec_off, $nbase) =
+            unpack("Q< Q< Q< Q<", substr($index, $ENTRY_LEN * $i, $ENTRY_LEN));
+        $contigs{substr($names, $name_off, $name_len)} = [$rec_off, $nbase];
+    }
+    my $retVal = { file => $file, fh => $fh, contigs => \%contigs };
+    return bless $retVal, $class;
+}
+
+=head3 contigs
+
+    my @contigs = $c2b->contigs();
+
+Return the ids of the contigs in the file, sorted.
+
+=cut
+
+sub contigs {
+    my ($self) = @_;
+    return sort keys %{$self->{contigs}};
+}
+
+=head3 contig_length
+
+    my $len = $c2b->contig_length($contig);
+
+Return the length of a contig, or C<undef> if it is not in the file.
+
+=cut
+
+sub contig_length {
+    my ($self, $contig) = @_;
+    my $entry = $self->{contigs}->{$contig};
+    return $entry ? $entry->[1] : undef;
+}
+
+=head3 get_dna
+
+    my $dna = $c2b->get_dna($contig, $start, $len, $strand);
+
+Return C<$len> bases of a contig from C<$start> (1 based), or fewer at the
+end of the contig. With C<$strand> C<->, the bases are reverse complemented.
+Returns C<undef> if the contig is not in the file.
+
+Called as a function, with a genome id in place of the object, reads the
+C<contigs.2bit> file of the genome in the organisms directory, which is kept
+open for later calls.
+
+=cut
+
+sub get_dna {
+    my ($self, $contig, $start, $len, $strand) = @_;
+    if (! ref $self) {
+        my $genome = $self;
+        $self = $GENOME_FILE{$genome} ||=
+            Contig2Bit->new("$FIG_Config::organisms/$genome/contigs.2bit");
+        return undef unless $self;
+    }
+    my $entry = $self->{contigs}->{$contig};
+    return undef unless $entry;
+    my ($rec_off, $nbase) = @$entry;
+    my $s = ($start && $start > 1) ? $start - 1 : 0;
+    return '' if $s >= $nbase || ! $len || $len <= 0;
+    my $end = ($len > $nbase - $s) ? $nbase : $s + $len;
+    my $fh = $self->{fh};
+    # Locate the lists and the packed bases of the record.
+    my (undef, $nexc, $nmask) = unpack("Q< Q< Q<", _read($fh, $rec_off, 24));
+    my $exc_off = $rec_off + 24;
+    my $chr_off = $exc_off + 16 * $nexc;
+    my $mask_off = $chr_off + (($nexc + 7) & ~7);
+    my $packed_off = $mask_off + 16 * $nmask;
+    # Decode the bytes that hold the region.
+    my $first = $s >> 2;
+    my $bytes = _read($fh, $packed_off + $first, (($end - 1) >> 2) - $first + 1);
+    my $retVal = substr(join('', @DECODE[unpack("C*", $bytes)]), $s & 3, $end - $s);
+    # Put in the exceptions, and lower case the masked runs.
+    for my $run (_runs($fh, $exc_off, $nexc, $s, $end)) {
+        my ($i, $a, $b) = @$run;
+        substr($retVal, $a - $s, $b - $a) = _read($fh, $chr_off + $i, 1) x ($b - $a);
+    }
+    for my $run (_runs($fh, $mask_off, $nmask, $s, $end)) {
+        my (undef, $a, $b) = @$run;
+        substr($retVal, $a - $s, $b - $a) = lc substr($retVal, $a - $s, $b - $a);
+    }
+    if ($strand && $strand eq '-') {
+        $retVal = reverse $retVal;
+        $retVal =~ tr/ACGTUMRWSYKVHDBNacgtumrwsykvhdbn/TGCAAKYWSRMBDHVNtgcaakywsrmbdhvn/;
+    }
+    return $retVal;
+}
+
+=head3 close
+
+    $c2b->close();
+
+Close the file.
+
+=cut
+
+sub close {
+    my ($self) = @_;
+    CORE::close($self->{fh}) if $self->{fh};
+    $self->{fh} = undef;
+}
+
+=head2 Internal Methods
+
+=head3 _runs
+
+    my @runs = _runs($fh, $off, $n, $s, $end);
+
+Return the runs of the list of C<$n> runs at C<$off> that overlap positions
+C<$s> to C<$end> (0 based, end exclusive), as C<[$i, $a, $b]>, where C<$i>
+is the number of the run, and C<$a> to C<$b> is its overlap with the region.
+The runs are sorted and do not overlap, so the first is found by a binary
+search.
+
+=cut
+
+sub _runs {
+    my ($fh, $off, $n, $s, $end) = @_;
+    my ($lo, $hi) = (0, $n);
+    while ($lo < $hi) {
+        my $mid = int(($lo + $hi) / 2);
+        my ($start, $len) = unpack("Q< Q<", _read($fh, $off + 16 * $mid, 16));
+        if ($start + $len <= $s) {
+            $lo = $mid + 1;
+        } else {
+            $hi = $mid;
+        }
+    }
+    my @retVal;
+    for (my $i = $lo; $i < $n; $i++) {
+        my ($start, $len) = unpack("Q< Q<", _read($fh, $off + 16 * $i, 16));
+        last if $start >= $end;
+        my $a = ($start > $s) ? $start : $s;
+        my $b = ($start + $len < $end) ? $start + $len : $end;
+        push @retVal, [$i, $a, $b];
+    }
+    return @retVal;
+}
+
+# Read $len bytes at offset $off of a file.
+sub _read {
+    my ($fh, $off, $len) = @_;
+    my $retVal = '';
+    return $retVal unless $len;
+    sysseek($fh, $off, 0) || Confess("Seek failed in 2-bit contig file");
+    while (length($retVal) < $len) {
+        my $n = sysread($fh, $retVal, $len - length($retVal), length($retVal));
+        Confess("Short read in 2-bit contig file") unless $n;
+    }
+    return $retVal;
+}
+
+1;
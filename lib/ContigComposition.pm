@@ -0,0 +1,194 @@
+# -*- perl -*-
+########################################################################
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+#
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License.
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+########################################################################
+
+package ContigComposition;
+
+use strict;
+use Tracer;
+
+=head1 Contig Composition Files
+
+This package reads the windowed base composition files written by
+C<index_contig_files -c> (the format is described in C<contig_comp.h>). For
+each fixed window of each contig of a genome (1000 bases, unless indexed
+with C<-w>), the file has the counts of A, C, G, T (or U), N, and other
+characters, so GC content, N runs and other composition tracks are read
+without reading the contigs.
+
+    my $comp = ContigComposition->new("$FIG_Config::organisms/$genome/composition");
+    for my $w ($comp->windows($contig)) {
+        my ($start, $len, $a, $c, $g, $t, $n, $other) = @$w;
+        ...
+    }
+
+C<load_contig_composition> loads the files into the C<contig_composition>
+table.
+
+=cut
+
+#
+
+my $HEADER_LEN = 48;
+my $ENTRY_LEN  = 32;
+
+=head2 Public Methods
+
+=head3 new
+
+    my $comp = ContigComposition->new($file);
+
+Open a composition file. Returns C<undef> if the file cannot be opened, and
+confesses if it is not a composition file. The index of the contigs is read
+when the file is opened.
+
+=cut
+
+sub new {
+    my ($class, $file) = @_;
+    my $fh;
+    open($fh, "<", $file) || return undef;
+    binmode($fh);
+    my $hdr = _read($fh, 0, $HEADER_LEN);
+    my ($magic, $version, $window, $ncontig, $index_off, $names_off, $size) =
+        unpack("a8 V V Q< Q< Q< Q<", $hdr);
+    ($magic eq 'FIGCOMP1' && $version == 1 && $window > 0 && $size == -s $fh)
+        || Confess("$file is not a contig composition file");
+    my $index = _read($fh, $index_off, $ENTRY_LEN * $ncontig);
+    my $names = _read($fh, $names_off, $size - $names_off);
+    my %contigs;
+    for (my $i = 0; $i < $ncontig; $i++) {
+        my ($name_off, $name_len, $rec_off, $nbase) =
+            unpack("Q< Q< Q< Q<", substr($index, $ENTRY_LEN * $i, $ENTRY_LEN));
+        $contigs{substr($names, $name_off, $name_len)} = [$rec_off, $nbase];
+    }
+    my $retVal = { file => $file, fh => $fh, window => $window, contigs => \%contigs };
+    return bless $retVal, $class;
+}
+
+=head3 window
+
+    my $window = $comp->window();
+
+Return the number of bases in a window.
+
+=cut
+
+sub window {
+    my ($self) = @_;
+    return $self->{window};
+}
+
+=head3 contigs
+
+    my @contigs = $comp->contigs();
+
+Return the ids of the contigs in the file, sorted.
+
+=cut
+
+sub contigs {
+    my ($self) = @_;
+    return sort keys %{$self->{contigs}};
+}
+
+=head3 contig_length
+
+    my $len = $comp->contig_length($contig);
+
+Return the length of a contig, or C<undef> if it is not in the file.
+
+=cut
+
+sub contig_length {
+    my ($self, $contig) = @_;
+    my $entry = $self->{contigs}->{$contig};
+    return $entry ? $entry->[1] : undef;
+}
+
+=head3 windows
+
+    my @windows = $comp->windows($contig);
+
+Return the windows of a contig, in order, as C<[$start, $len, $a, $c, $g,
+$t, $n, $other]>, where C<$start> is the first base of the window (0 based)
+and C<$len> its length (the last window may be short). Returns an empty
+list if the contig is not in the file.
+
+=cut
+
+sub windows {
+    my ($self, $contig) = @_;
+    my $entry = $self->{contigs}->{$contig};
+    return () unless $entry;
+    my ($rec_off, $nbase) = @$entry;
+    my $window = $self->{window};
+    my (undef, $nwin) = unpack("Q< Q<", _read($self->{fh}, $rec_off, 16));
+    my @counts = unpack("v*", _read($self->{fh}, $rec_off + 16, 12 * $nwin));
+    my @retVal;
+    for (my $i = 0; $i < $nwin; $i++) {
+        my $start = $i * $window;
+        my $len = ($nbase - $start < $window) ? $nbase - $start : $window;
+        push @retVal, [$start, $len, @counts[6 * $i .. 6 * $i + 5]];
+    }
+    return @retVal;
+}
+
+=head3 gc_content
+
+    my @gc = $comp->gc_content($contig);
+
+Return the GC fraction of each window of a contig, of the bases that are
+A, C, G or T (C<undef> for a window with none).
+
+=cut
+
+sub gc_content {
+    my ($self, $contig) = @_;
+    return map { my (undef, undef, $a, $c, $g, $t) = @$_;
+                 ($a + $c + $g + $t) ? ($c + $g) / ($a + $c + $g + $t) : undef
+               } $self->windows($contig);
+}
+
+=head3 close
+
+    $comp->close();
+
+Close the file.
+
+=cut
+
+sub close {
+    my ($self) = @_;
+    CORE::close($self->{fh}) if $self->{fh};
+    $self->{fh} = undef;
+}
+
+# Read $len bytes at offset $off of a file.
+sub _read {
+    my ($fh, $off, $len) = @_;
+    my $retVal = '';
+    return $retVal unless $len;
+    sysseek($fh, $off, 0) || Confess("Seek failed in contig composition file");
+    while (length($retVal) < $len) {
+        my $n = sysread($fh, $retVal, $len - length($retVal), length($retVal));
+        Confess("Short read in contig composition file") unless $n;
+    }
+    return $retVal;
+}
+
+1;
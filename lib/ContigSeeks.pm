@@ -0,0 +1,182 @@
+# -*- perl -*-
+########################################################################
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+#
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License.
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+########################################################################
+
+package ContigSeeks;
+
+use strict;
+use Tracer;
+use BGZF;
+
+=head1 Contig Seeks
+
+This package finds nucleotides in the contigs files of the organisms
+directory, from the tables written by C<index_contigs>. A contig whose
+sequence lines are all the same length has a row in C<contig_geometry>
+with the offset of its first nucleotide, and the nucleotides and bytes per
+line (as in a samtools faidx index), so the seek of any nucleotide is
+computed, and a region is read with one seek and one read. Other contigs
+have a row in C<contig_seeks> every index interval, and are read forward
+from the nearest one. A contigs file may be blocked gzip, with virtual
+seeks (see L<BGZF>); its contigs are all read from the index points.
+
+    my $seeks = ContigSeeks->new($fig);
+    my ($file, $seek) = $seeks->locate($genome, $contig, $n);
+    my $dna = $seeks->get_dna($genome, $contig, $start, $len);
+
+=cut
+
+#
+
+# Bytes read at a time from an index point.
+my $CHUNK = 65536;
+
+=head2 Public Methods
+
+=head3 new
+
+    my $seeks = ContigSeeks->new($fig);
+
+Create a finder on the database of a FIG object. The geometry of each
+contig is cached when it is first used.
+
+=cut
+
+sub new {
+    my ($class, $fig) = @_;
+    my $retVal = { fig => $fig, dbh => $fig->db_handle, geometry => {} };
+    return bless $retVal, $class;
+}
+
+=head3 geometry
+
+    my $geom = $seeks->geometry($genome, $contig);
+
+Return the line geometry of a contig, as C<[$len, $fileno, $seek,
+$linebases, $linewidth]>, or C<undef> if its lines are irregular (or it is
+not indexed).
+
+=cut
+
+sub geometry {
+    my ($self, $genome, $contig) = @_;
+    my $key = "$genome\t$contig";
+    if (! exists $self->{geometry}->{$key}) {
+        my $rows = $self->{dbh}->SQL("SELECT len, fileno, seek, linebases, linewidth FROM contig_geometry " .
+                                     "WHERE ( genome = ? ) AND ( contig = ? )", undef, $genome, $contig);
+        $self->{geometry}->{$key} = ($rows && @$rows) ? $rows->[0] : undef;
+    }
+    return $self->{geometry}->{$key};
+}
+
+=head3 locate
+
+    my ($file, $seek, $startN) = $seeks->locate($genome, $contig, $n);
+
+Return the contigs file holding nucleotide C<$n> (0 based) of a contig, and
+the seek of nucleotide C<$startN>. For a contig with regular lines,
+C<$startN> is C<$n>; otherwise it is the index point at or before C<$n>, and
+the caller reads forward C<$n - $startN> nucleotides. Returns an empty list
+if the contig is not indexed.
+
+=cut
+
+sub locate {
+    my ($self, $genome, $contig, $n) = @_;
+    my $geom = $self->geometry($genome, $contig);
+    if ($geom) {
+        my (undef, $fileno, $seek, $linebases, $linewidth) = @$geom;
+        return ($self->{fig}->N2file($fileno),
+                $seek + int($n / $linebases) * $linewidth + $n % $linebases, $n);
+    }
+    my $rows = $self->{dbh}->SQL("SELECT startN, fileno, seek FROM contig_seeks " .
+                                 "WHERE ( genome = ? ) AND ( contig = ? ) AND ( indexpt <= ? ) " .
+                                 "ORDER BY indexpt DESC LIMIT 1", undef, $genome, $contig, $n);
+    return () unless $rows && @$rows;
+    my ($startN, $fileno, $seek) = @{$rows->[0]};
+    return ($self->{fig}->N2file($fileno), $seek, $startN);
+}
+
+=head3 get_dna
+
+    my $dna = $seeks->get_dna($genome, $contig, $start, $len);
+
+Return C<$len> nucleotides of a contig from C<$start> (1 based), or fewer at
+the end of the contig, or C<undef> if the contig is not indexed or its file
+cannot be read.
+
+=cut
+
+sub get_dna {
+    my ($self, $genome, $contig, $start, $len) = @_;
+    my $n = ($start && $start > 1) ? $start - 1 : 0;
+    return '' unless $len && $len > 0;
+    my ($file, $seek, $startN) = $self->locate($genome, $contig, $n);
+    return undef unless defined $file;
+    my $fh;
+    open($fh, "<", $file) || return undef;
+    my $bgzf = BGZF::is_bgzf($fh);
+    my $geom = $bgzf ? undef : $self->geometry($genome, $contig);
+    my $retVal;
+    if ($geom) {
+        # The region is the bytes from the seek of its first nucleotide to
+        # that of its last, less line ends.
+        my ($clen, undef, $off, $linebases, $linewidth) = @$geom;
+        return '' if $n >= $clen;
+        my $last = ($n + $len > $clen) ? $clen - 1 : $n + $len - 1;
+        my $end = $off + int($last / $linebases) * $linewidth + $last % $linebases;
+        $retVal = _read($fh, $seek, $end + 1 - $seek);
+        $retVal =~ tr/\r\n//d;
+    } else {
+        # Read forward from the index point, skipping white space, to the
+        # end of the region or of the contig.
+        my $skip = $n - $startN;
+        $retVal = '';
+        my $buf;
+        while (length($retVal) < $skip + $len) {
+            if ($bgzf) {
+                ($buf, $seek) = BGZF::read_from($fh, $seek);
+            } else {
+                $buf = _read($fh, $seek, $CHUNK);
+                $seek += length($buf);
+            }
+            last if $buf eq '';
+            my $more = ($buf =~ s/\n>.*//s) || ($buf =~ s/^>.*//s);
+            $buf =~ s/\s+//g;
+            $retVal .= $buf;
+            last if $more;
+        }
+        $retVal = (length($retVal) > $skip) ? substr($retVal, $skip, $len) : '';
+    }
+    close($fh);
+    return $retVal;
+}
+
+# Read up to $len bytes at offset $off of a file.
+sub _read {
+    my ($fh, $off, $len) = @_;
+    my $retVal = '';
+    sysseek($fh, $off, 0) || Confess("Seek failed in contigs file");
+    while (length($retVal) < $len) {
+        my $n = sysread($fh, $retVal, $len - length($retVal), length($retVal));
+        Confess("Read failed in contigs file") unless defined $n;
+        last unless $n;
+    }
+    return $retVal;
+}
+
+1;
@@ -0,0 +1,208 @@
+# -*- perl -*-
+########################################################################
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+#
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License.
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+########################################################################
+
+package SimsSeekIndex;
+
+use strict;
+use Tracer;
+
+=head1 Binary Sims Seek Index
+
+This package reads the binary seek index written by C<index_sims_file -b>
+(the format is described in C<sims_seek_index.h>). The index holds the same
+rows as the C<sim_seeks> table, sorted by id, so the seeks of an id can be
+found with a binary search of the file instead of a database query.
+
+Only the pieces of the file needed for a lookup are read: the header, two
+offsets per probe of the block table, one front coded block of ids, and the
+entries of the id.
+
+    my $ssi = SimsSeekIndex->new("$FIG_Config::data/Sims/seeks.ssi");
+    for my $seek ($ssi->lookup($peg)) {
+        my ($fileN, $seek, $len) = @$seek;
+        ...
+    }
+
+=cut
+
+#
+
+my $HEADER_LEN = 72;
+
+=head2 Public Methods
+
+=head3 new
+
+    my $ssi = SimsSeekIndex->new($file);
+
+Open a seek index. Returns C<undef> if the file cannot be opened, and
+confesses if it is not a seek index.
+
+=cut
+
+sub new {
+    my ($class, $file) = @_;
+    my $fh;
+    open($fh, "<", $file) || return undef;
+    binmode($fh);
+    my $hdr = _read($fh, 0, $HEADER_LEN);
+    my ($magic, $version, $block, $nid, $nentry, $nblock,
+        $block_off, $pool_off, $first_off, $entry_off) = unpack("a8 V V Q< Q< Q< Q< Q< Q< Q<", $hdr);
+    ($magic eq 'FIGSSI01' && $version == 1 && $block > 0)
+        || Confess("$file is not a sims seek index");
+    my $retVal = { file => $file, fh => $fh, block => $block, nid => $nid,
+                   nentry => $nentry, nblock => $nblock, block_off => $block_off,
+                   pool_off => $pool_off, first_off => $first_off,
+                   entry_off => $entry_off };
+    return bless $retVal, $class;
+}
+
+=head3 count
+
+    my $n = $ssi->count();
+
+Return the number of distinct ids in the index.
+
+=cut
+
+sub count {
+    my ($self) = @_;
+    return $self->{nid};
+}
+
+=head3 lookup
+
+    my @seeks = $ssi->lookup($id);
+
+Return the seeks of an id, as a list of C<[$fileN, $seek, $len]> triples in
+the order they were indexed. The list is empty if the id is not in the index.
+
+=cut
+
+sub lookup {
+    my ($self, $id) = @_;
+    my $nid = $self->{nid};
+    return () unless $nid;
+    my $fh = $self->{fh};
+    # Find the last block whose first id is not past the id.
+    my ($lo, $hi) = (0, $self->{nblock});
+    while ($hi - $lo > 1) {
+        my $mid = int(($lo + $hi) / 2);
+        my ($first) = $self->_block_ids($mid, 1);
+        if ($first le $id) {
+            $lo = $mid;
+        } else {
+            $hi = $mid;
+        }
+    }
+    # Scan the ids of that block.
+    my @ids = $self->_block_ids($lo);
+    my $i;
+    for (my $j = 0; $j < @ids; $j++) {
+        last if $ids[$j] gt $id;
+        if ($ids[$j] eq $id) {
+            $i = $lo * $self->{block} + $j;
+            last;
+        }
+    }
+    return () unless defined $i;
+    # Read the entries of the id.
+    my ($first, $next) = unpack("Q< Q<", _read($fh, $self->{first_off} + 8 * $i, 16));
+    my $data = _read($fh, $self->{entry_off} + 16 * $first, 16 * ($next - $first));
+    my @retVal;
+    for (my $k = 0; $k < $next - $first; $k++) {
+        my ($fileN, $len, $seek) = unpack("V V Q<", substr($data, 16 * $k, 16));
+        push @retVal, [$fileN, $seek, $len];
+    }
+    return @retVal;
+}
+
+=head3 close
+
+    $ssi->close();
+
+Close the index file.
+
+=cut
+
+sub close {
+    my ($self) = @_;
+    CORE::close($self->{fh}) if $self->{fh};
+    $self->{fh} = undef;
+}
+
+=head2 Internal Methods
+
+=head3 _block_ids
+
+    my @ids = $ssi->_block_ids($b, $max);
+
+Decode the front coded ids of block C<$b>, stopping after C<$max> ids if
+C<$max> is given.
+
+=cut
+
+sub _block_ids {
+    my ($self, $b, $max) = @_;
+    my $fh = $self->{fh};
+    my ($start, $end) = unpack("Q< Q<", _read($fh, $self->{block_off} + 8 * $b, 16));
+    my $pool = _read($fh, $self->{pool_off} + $start, $end - $start);
+    my $n = $self->{nid} - $b * $self->{block};
+    $n = $self->{block} if $n > $self->{block};
+    $n = $max if $max && $max < $n;
+    my ($p, $prev, @retVal) = (0, '');
+    for (my $i = 0; $i < $n; $i++) {
+        my $shared = 0;
+        ($shared, $p) = _varint($pool, $p) if $i;
+        my $rest;
+        ($rest, $p) = _varint($pool, $p);
+        $prev = substr($prev, 0, $shared) . substr($pool, $p, $rest);
+        $p += $rest;
+        push @retVal, $prev;
+    }
+    return @retVal;
+}
+
+# Decode a varint at position $p of a string; returns the value and the
+# position after it.
+sub _varint {
+    my ($str, $p) = @_;
+    my ($v, $shift) = (0, 0);
+    while (1) {
+        my $c = ord(substr($str, $p++, 1));
+        $v |= ($c & 0x7F) << $shift;
+        last unless $c & 0x80;
+        $shift += 7;
+    }
+    return ($v, $p);
+}
+
+# Read $len bytes at offset $off of a file.
+sub _read {
+    my ($fh, $off, $len) = @_;
+    my $retVal = '';
+    return $retVal unless $len;
+    sysseek($fh, $off, 0) || Confess("Seek failed in sims seek index");
+    while (length($retVal) < $len) {
+        my $n = sysread($fh, $retVal, $len - length($retVal), length($retVal));
+        Confess("Short read in sims seek index") unless $n;
+    }
+    return $retVal;
+}
+
+1;
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ * 
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License. 
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  bgzf.c
+ *
+ *  Blocked gzip reading and writing with zlib.  See bgzf.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "bgzf.h"
+
+/*  The empty block that ends a BGZF file  */
+
+const unsigned char bgzf_eof[28] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00,
+    0x42, 0x43, 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00
+};
+
+static uint32_t get_u32( const unsigned char *p ) {
+    return (uint32_t) p[0] | ( (uint32_t) p[1] << 8 ) | ( (uint32_t) p[2] << 16 ) | ( (uint32_t) p[3] << 24 );
+}
+
+static void put_u32( unsigned char *p, uint32_t v ) {
+    p[0] = v & 0xFF;  p[1] = ( v >> 8 ) & 0xFF;  p[2] = ( v >> 16 ) & 0xFF;  p[3] = v >> 24;
+}
+
+
+int bgzf_is_bgzf( const unsigned char *p, size_t n ) {
+    return ( n >= BGZF_HEADER ) && ( p[0] == 0x1f ) && ( p[1] == 0x8b ) && ( p[2] == 8 )
+                                && ( p[3] & 4 )  /* FEXTRA */
+                                && ( p[10] == 6 ) && ( p[11] == 0 )
+                                && ( p[12] == 'B' ) && ( p[13] == 'C' )
+                                && ( p[14] == 2 ) && ( p[15] == 0 );
+}
+
+
+long bgzf_block_size( const unsigned char *p, size_t n ) {
+    if ( ! bgzf_is_bgzf( p, n ) ) return -1;
+    return (long) ( p[16] | ( p[17] << 8 ) ) + 1;
+}
+
+
+long bgzf_inflate_block( const unsigned char *block, size_t bsize, char *out ) {
+    z_stream  zs;
+    uint32_t  isize;
+    int       status;
+
+    if ( bsize < BGZF_HEADER + BGZF_FOOTER ) return -1;
+    isize = get_u32( block + bsize - 4 );
+    if ( isize > BGZF_MAXBLOCK ) return -1;
+    if ( isize == 0 ) return 0;
+
+    memset( &zs, 0, sizeof( zs ) );
+    if ( inflateInit2( &zs, -15 ) != Z_OK ) return -1;
+    zs.next_in   = (Bytef *) block + BGZF_HEADER;
+    zs.avail_in  = bsize - BGZF_HEADER - BGZF_FOOTER;
+    zs.next_out  = (Bytef *) out;
+    zs.avail_out = BGZF_MAXBLOCK;
+    status = inflate( &zs, Z_FINISH );
+    inflateEnd( &zs );
+
+    if ( ( status != Z_STREAM_END ) || ( zs.total_out != isize ) ) return -1;
+    if ( crc32( crc32( 0L, Z_NULL, 0 ), (Bytef *) out, isize ) != get_u32( block + bsize - 8 ) ) return -1;
+    return (long) isize;
+}
+
+
+long bgzf_deflate_block( const char *data, size_t len, unsigned char *out, int level ) {
+    z_stream  zs;
+    size_t    bsize;
+    int       status;
+
+    if ( len > BGZF_DATA ) return -1;
+    memcpy( out, bgzf_eof, BGZF_HEADER );
+
+    memset( &zs, 0, sizeof( zs ) );
+    if ( deflateInit2( &zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK ) return -1;
+    zs.next_in   = (Bytef *) data;
+    zs.avail_in  = len;
+    zs.next_out  = out + BGZF_HEADER;
+    zs.avail_out = BGZF_MAXBLOCK - BGZF_HEADER - BGZF_FOOTER;
+    status = deflate( &zs, Z_FINISH );
+    deflateEnd( &zs );
+    if ( status != Z_STREAM_END ) return -1;
+
+    bsize = BGZF_HEADER + zs.total_out + BGZF_FOOTER;
+    out[16] = ( bsize - 1 ) & 0xFF;
+    out[17] = ( bsize - 1 ) >> 8;
+    put_u32( out + bsize - 8, crc32( crc32( 0L, Z_NULL, 0 ), (const Bytef *) data, len ) );
+    put_u32( out + bsize - 4, (uint32_t) len );
+    return (long) bsize;
+}
+
+
+int bgzf_read_at( int fd, uint64_t vseek, char *buf, size_t len ) {
+    unsigned char *block;
+    char          *data;
+    off_t          coffset;
+    size_t         uoffset, n;
+    long           bsize, ulen;
+    int            status = -1;
+
+    block = (unsigned char *) malloc( BGZF_MAXBLOCK );
+    data  = (char *) malloc( BGZF_MAXBLOCK );
+    if ( ! block || ! data ) goto done;
+
+    coffset = (off_t) BGZF_COFFSET( vseek );
+    uoffset = BGZF_UOFFSET( vseek );
+    while ( len ) {
+        if ( pread( fd, block, BGZF_HEADER, coffset ) != BGZF_HEADER ) goto done;
+        if ( ( bsize = bgzf_block_size( block, BGZF_HEADER ) ) < BGZF_HEADER + BGZF_FOOTER ) goto done;
+        if ( pread( fd, block + BGZF_HEADER, bsize - BGZF_HEADER, coffset + BGZF_HEADER ) != bsize - BGZF_HEADER ) goto done;
+        if ( ( ulen = bgzf_inflate_block( block, bsize, data ) ) < 0 ) goto done;
+        if ( ulen == 0 ) goto done;                 /*  end of file  */
+
+        if ( uoffset < (size_t) ulen ) {
+            n = ulen - uoffset;
+            if ( n > len ) n = len;
+            memcpy( buf, data + uoffset, n );
+            buf += n;
+            len -= n;
+        }
+        uoffset  = ( uoffset > (size_t) ulen ) ? uoffset - ulen : 0;
+        coffset += bsize;
+    }
+    status = 0;
+
+done:
+    free( block );
+    free( data );
+    return status;
+}
+
+
+int bgzf_stream_init( bgzf_stream_t *s, int fd, uint64_t coffset ) {
+    s->fd      = fd;
+    s->coffset = coffset;
+    s->block   = (unsigned char *) malloc( BGZF_MAXBLOCK );
+    return s->block ? 0 : -1;
+}
+
+
+void bgzf_stream_free( bgzf_stream_t *s ) {
+    free( s->block );
+    s->block = NULL;
+}
+
+
+long bgzf_stream_next( bgzf_stream_t *s, char *out, uint64_t *coffset ) {
+    ssize_t  got;
+    long     bsize, ulen;
+
+    do {
+        got = pread( s->fd, s->block, BGZF_HEADER, (off_t) s->coffset );
+        if ( got == 0 ) return 0;
+        if ( got != BGZF_HEADER ) return -1;
+        if ( ( bsize = bgzf_block_size( s->block, BGZF_HEADER ) ) < BGZF_HEADER + BGZF_FOOTER ) return -1;
+        if ( pread( s->fd, s->block + BGZF_HEADER, bsize - BGZF_HEADER, (off_t) ( s->coffset + BGZF_HEADER ) )
+                != bsize - BGZF_HEADER ) return -1;
+        if ( ( ulen = bgzf_inflate_block( s->block, bsize, out ) ) < 0 ) return -1;
+        *coffset    = s->coffset;
+        s->coffset += bsize;
+    } while ( ulen == 0 );
+
+    return ulen;
+}
+
+
+int bgzf_compress( FILE *in, FILE *out, int level ) {
+    unsigned char *block;
+    char          *data;
+    size_t         n;
+    long           bsize;
+    int            status = -1;
+
+    block = (unsigned char *) malloc( BGZF_MAXBLOCK );
+    data  = (char *) malloc( BGZF_DATA );
+    if ( ! block || ! data ) goto done;
+
+    while ( ( n = fread( data, 1, BGZF_DATA, in ) ) > 0 ) {
+        if ( ( bsize = bgzf_deflate_block( data, n, block, level ) ) < 0 ) goto done;
+        if ( fwrite( block, 1, bsize, out ) != (size_t) bsize ) goto done;
+    }
+    if ( ferror( in ) ) goto done;
+    if ( fwrite( bgzf_eof, 1, sizeof( bgzf_eof ), out ) != sizeof( bgzf_eof ) ) goto done;
+    status = 0;
+
+done:
+    free( block );
+    free( data );
+    return status;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ * 
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License. 
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  bgzf.h
+ *
+ *  Blocked gzip (BGZF, as used by samtools and tabix): a gzip file made of
+ *  independent gzip members of at most 64 kB each, so that any block can be
+ *  decompressed on its own.  Each member has an extra field "BC" that gives
+ *  its compressed size, and the file ends with an empty member.  A BGZF
+ *  file is still a valid gzip file.
+ *
+ *  A position in the uncompressed data is given by a virtual seek:
+ *
+ *      ( file offset of the block << 16 ) | offset in the uncompressed block
+ */
+
+#ifndef BGZF_H
+#define BGZF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define  BGZF_HEADER     18         /*  bytes of gzip header in a block  */
+#define  BGZF_FOOTER      8         /*  CRC32 and ISIZE  */
+#define  BGZF_MAXBLOCK   65536      /*  largest compressed or uncompressed block  */
+#define  BGZF_DATA       65280      /*  uncompressed bytes put in one block  */
+
+#define  BGZF_VSEEK( coffset, uoffset )  ( ( (uint64_t) (coffset) << 16 ) | (uint64_t) (uoffset) )
+#define  BGZF_COFFSET( vseek )           ( (uint64_t) (vseek) >> 16 )
+#define  BGZF_UOFFSET( vseek )           ( (unsigned) ( (vseek) & 0xFFFF ) )
+
+extern const unsigned char bgzf_eof[28];
+
+/*  Does the data start with a BGZF block header?  */
+
+int   bgzf_is_bgzf( const unsigned char *p, size_t n );
+
+/*  Size of the (compressed) block starting at p, or -1 if the header is
+ *  not complete in n bytes or is not BGZF.
+ */
+
+long  bgzf_block_size( const unsigned char *p, size_t n );
+
+/*  Decompress a whole block to out (BGZF_MAXBLOCK bytes).  Returns the
+ *  uncompressed length, or -1 on error (including a CRC mismatch).
+ */
+
+long  bgzf_inflate_block( const unsigned char *block, size_t bsize, char *out );
+
+/*  Compress up to BGZF_DATA bytes to one block in out (BGZF_MAXBLOCK
+ *  bytes).  Returns the block size, or -1 on error.
+ */
+
+long  bgzf_deflate_block( const char *data, size_t len, unsigned char *out, int level );
+
+/*  Read len bytes of uncompressed data starting at a virtual seek of an
+ *  open BGZF file.  Returns 0 on success.
+ */
+
+int   bgzf_read_at( int fd, uint64_t vseek, char *buf, size_t len );
+
+/*  Read a BGZF file a block at a time, from file offset coffset.  */
+
+typedef struct {
+    int             fd;
+    uint64_t        coffset;    /*  file offset of the next block  */
+    unsigned char  *block;
+} bgzf_stream_t;
+
+int   bgzf_stream_init( bgzf_stream_t *s, int fd, uint64_t coffset );
+void  bgzf_stream_free( bgzf_stream_t *s );
+
+/*  Decompress the next block that is not empty to out (BGZF_MAXBLOCK
+ *  bytes), and set *coffset to its file offset.  Returns the uncompressed
+ *  length, 0 at the end of the file, or -1 on error.
+ */
+
+long  bgzf_stream_next( bgzf_stream_t *s, char *out, uint64_t *coffset );
+
+/*  Compress a stream.  Returns 0 on success.  */
+
+int   bgzf_compress( FILE *in, FILE *out, int level );
+
+#endif
@@ -0,0 +1,882 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  compute_bbhs.c
+ *
+ *  Usage:  compute_bbhs  [ options ]  file_list  < SimSeeks  > BBHs
+ *  or      compute_bbhs  [ options ]  -b SeekIndex  file_list  > BBHs
+ *  or      compute_bbhs  -v   (to return version number on standard output)
+ *
+ *  Options:  -j nthreads  -p max_psc  -o BBHDir  -g Genome ...  -r SubjectIndex
+ *
+ *  Find the bidirectional best hits between the pegs of different genomes.
+ *  The sims are read by seek, as in sims_filter: SimSeeks has the rows of the
+ *  sim_seeks table,
+ *
+ *     SeqID \t FileNumber \t Seek \t Length
+ *
+ *  or with -b they are taken from a binary seek index (sims_seek_index.h).
+ *  file_list gives the sims file of each file number, as for index_sims_file:
+ *
+ *     FileNumber \t FileName \n
+ *
+ *  For each query peg and each other genome, the best hit is the subject
+ *  peg of that genome with the lowest psc (then the highest bsc, then the
+ *  id that sorts first).  Two pegs are a BBH when each is the best hit of the other
+ *  in its genome.  Only ids of the form fig|Genome.peg.N are used, and hits
+ *  with a psc above max_psc are ignored.  A BBH is written as
+ *
+ *     Peg1 \t Peg2 \t Psc \t Nsc
+ *
+ *  where Psc is the psc of the hit of Peg1 to Peg2, and Nsc its bsc divided
+ *  by the length of Peg1 (or the bsc, if the length is not in the sims).
+ *  The lines of each genome are sorted by peg number of Peg1, then by Peg2.
+ *
+ *  Blocks of sims are read and reduced to best hits on nthreads threads
+ *  (default, or 0, is one per online processor).  Peg and genome ids are interned
+ *  as integers, and the best hits are kept in a hash keyed by query peg and
+ *  subject genome, in which both directions are joined at the end.
+ *
+ *  With -o, the BBHs of each genome are written to BBHDir/Genome (the files
+ *  read by load_bbhs and load_bbhs_btree) instead of stdout.  Each file is
+ *  written to a temporary file and renamed.  make_bbhs runs compute_bbhs on
+ *  the sims of a SEED.
+ *
+ *  With -g (which may be repeated), only the BBHs involving the given
+ *  genomes are computed, as when their sims have changed.  A BBH of two
+ *  other genomes depends only on the sims between them, so the rest are
+ *  kept.  Only blocks of queries in the given genomes, and hits into them,
+ *  are used.  With -r, the hits into the given genomes are found in the
+ *  subject index (index_sims_file -r) rather than by reading every block.
+ *  With -o, the files of the given genomes are rewritten, and of the other
+ *  genomes, only the files that had or now have a BBH with one of the given
+ *  genomes; in those, the lines of BBHs with the given genomes are replaced.
+ *
+ *  Compile with:  cc -O compute_bbhs.c sims_reader.c sims_seek_index.c bgzf.c -o compute_bbhs -lpthread -lz
+ */
+
+#define  VERSION  "1.00"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sims_reader.h"
+#include "sims_seek_index.h"
+
+#define  INPLEN   ( 16*1024)    /* seek line or BBH line length */
+#define  BATCH    (      64)    /* blocks taken by a worker at a time */
+
+typedef unsigned long long u_long_long;
+
+/*  A block of sims to be read  */
+
+typedef struct {
+    uint32_t    fileN;
+    uint32_t    len;
+    uint64_t    seek;
+} block_t;
+
+/*  Interned strings: peg ids and genome ids  */
+
+typedef struct {
+    char       *text;       /* the strings, NUL terminated */
+    size_t      text_len;
+    size_t      text_size;
+    size_t     *off;        /* offset of string i in text */
+    uint32_t    n;
+    uint32_t    max;
+    uint32_t   *slot;       /* hash table of string number + 1 */
+    uint32_t    nslot;
+} strtab_t;
+
+#define  STR( tab, i )  ( (tab)->text + (tab)->off[i] )
+
+/*  Best hits, by query peg and subject genome  */
+
+typedef struct {
+    uint64_t   *key;        /* query peg << 32 | subject genome, + 1 */
+    uint32_t   *subj;
+    double     *psc;
+    float      *bsc;
+    float      *nsc;
+    size_t      n;
+    size_t      size;       /* a power of 2 */
+} best_t;
+
+/*  A best hit found in a block  */
+
+typedef struct {
+    const char *q;          /* query id */
+    int         qlen;
+    const char *s;          /* subject id */
+    int         slen;
+    const char *sg;         /* subject genome */
+    int         sglen;
+    double      psc;
+    float       bsc;
+    float       nsc;
+} hit_t;
+
+/*  A line of a BBH file  */
+
+typedef struct {
+    char       *line;
+    const char *g2;         /* genome of peg2, in line */
+    int         g2len;
+    uint32_t    n1;         /* peg numbers */
+    uint32_t    n2;
+} bbh_line_t;
+
+int   read_seeks( FILE *fp, ssi_index_t *ssi, ssi_index_t *subjects );
+void  add_block( uint32_t fileN, uint64_t seek, uint32_t len );
+void *bbh_worker( void *arg );
+int   block_hits( sims_set_t *set, hit_t **hits, size_t *maxhit );
+int   cmp_hits( const void *a, const void *b );
+int   better( double psc1, float bsc1, const char *s1, double psc2, float bsc2, const char *s2 );
+void  add_hits( hit_t *hits, int nhit );
+int   peg_genome( const char *id, int len, const char **genome, int *glen, uint32_t *num );
+int   changed_genome( const char *id, int len );
+uint32_t intern( strtab_t *tab, const char *s, int len, int add );
+uint32_t peg_id( const char *id, int len );
+uint32_t hash_str( const char *s, int len );
+int   best_find( uint64_t key, size_t *slot );
+void  best_grow( void );
+int   write_bbhs( const char *dir );
+int   cmp_genomes( const void *a, const void *b );
+int   read_old_bbhs( const char *dir, uint32_t g, bbh_line_t **lines, size_t *nline, size_t *maxline, char *touch );
+void  add_line( bbh_line_t **lines, size_t *nline, size_t *maxline, char *line );
+int   cmp_lines( const void *a, const void *b );
+int   write_genome( const char *dir, uint32_t g, bbh_line_t *lines, size_t nline );
+void *xrealloc( void *ptr, size_t n );
+void  usage( char *prog );
+
+block_t        *blocks = NULL;      /* the work */
+size_t          nblock = 0, maxblock = 0, next_block = 0;
+pthread_mutex_t block_lock = PTHREAD_MUTEX_INITIALIZER;
+
+strtab_t        pegs;               /* peg ids */
+uint32_t       *peg_g = NULL;       /* genome of each peg */
+uint32_t        peg_max = 0;
+strtab_t        genomes;            /* genome ids; those given with -g first */
+strtab_t        changed;            /* genome ids given with -g; fixed once the threads start */
+int             nchanged = 0;
+best_t          best;
+pthread_mutex_t best_lock = PTHREAD_MUTEX_INITIALIZER;
+
+char           *file_list = NULL;
+sims_cutoff_t   cut = SIMS_NO_CUTOFF;
+int             status = 0;
+
+
+int main( int argc, char **argv ) {
+    ssi_index_t  *ssi, *subjects;
+    pthread_t    *threads;
+    char         *index_file, *subject_file, *dir, **changed_ids;
+    int           nthreads, nstarted, i;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    nthreads     = 0;
+    index_file   = NULL;
+    subject_file = NULL;
+    dir          = NULL;
+    changed_ids  = (char **) xrealloc( NULL, argc * sizeof( char * ) );
+    while ( ( argc >= 3 ) && ( argv[1][0] == '-' ) ) {
+        if ( strcmp( argv[1], "-j" ) == 0 ) {
+            if ( sscanf( argv[2], "%d", &nthreads ) != 1 || nthreads < 0 ) usage( argv[0] );
+            if ( nthreads == 0 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+            if ( nthreads < 1 ) nthreads = 1;
+        }
+        else if ( strcmp( argv[1], "-p" ) == 0 ) cut.max_psc = atof( argv[2] );
+        else if ( strcmp( argv[1], "-b" ) == 0 ) index_file   = argv[2];
+        else if ( strcmp( argv[1], "-r" ) == 0 ) subject_file = argv[2];
+        else if ( strcmp( argv[1], "-o" ) == 0 ) dir          = argv[2];
+        else if ( strcmp( argv[1], "-g" ) == 0 ) changed_ids[nchanged++] = argv[2];
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( ( argc != 2 ) || ( subject_file && ! nchanged ) ) usage( argv[0] );
+    file_list = argv[1];
+
+    if ( nthreads < 1 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthreads < 1 ) nthreads = 1;
+
+    /* The workers look up the changed genomes without a lock, so they get a
+     * table of their own, which peg_id() does not grow.
+     */
+
+    for ( i = 0; i < nchanged; i++ ) {
+        intern( &changed, changed_ids[i], strlen( changed_ids[i] ), 1 );
+        intern( &genomes, changed_ids[i], strlen( changed_ids[i] ), 1 );
+    }
+    nchanged = changed.n;
+    free( changed_ids );
+
+    ssi = subjects = NULL;
+    if ( index_file && ! ( ssi = ssi_open( index_file ) ) ) {
+        fprintf( stderr, "compute_bbhs: could not open seek index %s\n", index_file );
+        return 1;
+    }
+    if ( subject_file && ! ( subjects = ssi_open( subject_file ) ) ) {
+        fprintf( stderr, "compute_bbhs: could not open subject index %s\n", subject_file );
+        return 1;
+    }
+    if ( read_seeks( ssi ? NULL : stdin, ssi, subjects ) ) {
+        fprintf( stderr, "compute_bbhs: failed to read the sims seeks\n" );
+        return 1;
+    }
+
+    /* Best hits of the blocks, on the worker threads */
+
+    threads = (pthread_t *) xrealloc( NULL, nthreads * sizeof( pthread_t ) );
+    for ( nstarted = 0; nstarted < nthreads; nstarted++ ) {
+        if ( pthread_create( threads + nstarted, NULL, bbh_worker, NULL ) ) break;
+    }
+    if ( ! nstarted ) bbh_worker( NULL );
+    for ( i = 0; i < nstarted; i++ ) pthread_join( threads[i], NULL );
+    free( threads );
+
+    if ( ssi ) ssi_close( ssi );
+    if ( subjects ) ssi_close( subjects );
+    if ( status ) {
+        fprintf( stderr, "compute_bbhs: failed to read the sims\n" );
+        return 1;
+    }
+
+    if ( write_bbhs( dir ) ) {
+        fprintf( stderr, "compute_bbhs: failed to write the BBHs\n" );
+        return 1;
+    }
+    return 0;
+}
+
+
+/*  Collect the blocks to be read: all of the seeks, or with -g, the seeks
+ *  of queries in the changed genomes, and with -r, the lines of hits into
+ *  them from the subject index.  Returns 0 on success.
+ */
+
+int read_seeks( FILE *fp, ssi_index_t *ssi, ssi_index_t *subjects ) {
+    const ssi_entry_t *entries;
+    char               inpbuf[INPLEN], idbuf[SSI_IDLEN+1], *id, *bptr;
+    unsigned long      fileN, len;
+    u_long_long        seek;
+    uint64_t           i, nid;
+    long               n, k;
+    int                idlen, all;
+
+    /* Without a subject index, hits into changed genomes can be anywhere */
+
+    all = ! nchanged || ! subjects;
+
+    if ( ssi ) {
+        nid = ssi_nid( ssi );
+        for ( i = 0; i < nid; i++ ) {
+            n = ssi_get( ssi, i, idbuf, &entries );
+            if ( ! all && ! changed_genome( idbuf, strlen( idbuf ) ) ) continue;
+            for ( k = 0; k < n; k++ ) add_block( entries[k].fileN, entries[k].seek, entries[k].len );
+        }
+    }
+    else {
+        while ( fgets( inpbuf, INPLEN, fp ) ) {
+            id = inpbuf;
+            for ( bptr = inpbuf; *bptr && ( *bptr != '\t' ); bptr++ ) ;
+            if ( ! *bptr ) continue;
+            idlen = bptr - id;
+            if ( sscanf( bptr + 1, "%lu\t%llu\t%lu", &fileN, &seek, &len ) != 3 ) continue;
+            if ( ! all && ! changed_genome( id, idlen ) ) continue;
+            add_block( (uint32_t) fileN, (uint64_t) seek, (uint32_t) len );
+        }
+        if ( ferror( fp ) ) return 1;
+    }
+
+    if ( ! all ) {
+        nid = ssi_nid( subjects );
+        for ( i = 0; i < nid; i++ ) {
+            n = ssi_get( subjects, i, idbuf, &entries );
+            if ( ! changed_genome( idbuf, strlen( idbuf ) ) ) continue;
+            for ( k = 0; k < n; k++ ) add_block( entries[k].fileN, entries[k].seek, entries[k].len );
+        }
+    }
+    return 0;
+}
+
+
+void add_block( uint32_t fileN, uint64_t seek, uint32_t len ) {
+    if ( nblock >= maxblock ) {
+        maxblock = maxblock ? 2 * maxblock : 64 * 1024;
+        blocks = (block_t *) xrealloc( blocks, maxblock * sizeof( block_t ) );
+    }
+    blocks[nblock].fileN = fileN;
+    blocks[nblock].seek  = seek;
+    blocks[nblock].len   = len;
+    nblock++;
+}
+
+
+/*  Read batches of blocks, reduce each to its best hit per query and
+ *  subject genome, and add those to the best hits.
+ */
+
+void *bbh_worker( void *arg ) {
+    sims_reader_t *reader;
+    sims_set_t     set;
+    hit_t         *hits;
+    size_t         i, end, maxhit;
+    int            nhit;
+
+    (void) arg;
+    if ( ! ( reader = sims_reader_new() ) || sims_reader_read_list( reader, file_list ) ) {
+        fprintf( stderr, "compute_bbhs: could not read file list %s\n", file_list );
+        pthread_mutex_lock( &best_lock );
+        status = 1;
+        pthread_mutex_unlock( &best_lock );
+        sims_reader_free( reader );
+        return NULL;
+    }
+    sims_set_init( &set );
+    hits   = NULL;
+    maxhit = 0;
+
+    while ( 1 ) {
+        pthread_mutex_lock( &block_lock );
+        i = next_block;
+        end = ( nblock - i > BATCH ) ? i + BATCH : nblock;
+        next_block = end;
+        pthread_mutex_unlock( &block_lock );
+        if ( i >= end ) break;
+
+        for ( ; i < end; i++ ) {
+            sims_set_clear( &set );
+            if ( sims_read( reader, blocks[i].fileN, blocks[i].seek, blocks[i].len, &cut, &set ) < 0 ) {
+                fprintf( stderr, "compute_bbhs: could not read %u bytes at %llu of file %u\n",
+                         (unsigned) blocks[i].len, (u_long_long) blocks[i].seek, (unsigned) blocks[i].fileN );
+                pthread_mutex_lock( &best_lock );
+                status = 1;
+                pthread_mutex_unlock( &best_lock );
+                continue;
+            }
+            if ( ( nhit = block_hits( &set, &hits, &maxhit ) ) ) {
+                pthread_mutex_lock( &best_lock );
+                add_hits( hits, nhit );
+                pthread_mutex_unlock( &best_lock );
+            }
+        }
+    }
+
+    if ( hits ) free( hits );
+    sims_set_free( &set );
+    sims_reader_free( reader );
+    return NULL;
+}
+
+
+/*  The best hit of each query in the set to each other genome.  Returns the
+ *  number of hits.
+ */
+
+int block_hits( sims_set_t *set, hit_t **hits, size_t *maxhit ) {
+    hit_t      *h;
+    const char *qg;
+    size_t      i, n;
+    uint32_t    num;
+    int         qglen, k;
+
+    n = 0;
+    for ( i = 0; i < set->n; i++ ) {
+        if ( n >= *maxhit ) {
+            *maxhit = *maxhit ? 2 * *maxhit : 1024;
+            *hits = (hit_t *) xrealloc( *hits, *maxhit * sizeof( hit_t ) );
+        }
+        h = *hits + n;
+        h->q    = SIMS_ID1( set, i );
+        h->qlen = set->id1_len[i];
+        h->s    = SIMS_ID2( set, i );
+        h->slen = set->id2_len[i];
+        if ( ! peg_genome( h->q, h->qlen, &qg, &qglen, &num ) ) continue;
+        if ( ! peg_genome( h->s, h->slen, &( h->sg ), &( h->sglen ), &num ) ) continue;
+        if ( ( qglen == h->sglen ) && ( memcmp( qg, h->sg, qglen ) == 0 ) ) continue;
+        if ( nchanged && ! changed_genome( h->q, h->qlen ) && ! changed_genome( h->s, h->slen ) ) continue;
+        h->psc = set->psc[i];
+        h->bsc = set->bsc[i];
+        h->nsc = set->ln1[i] ? set->bsc[i] / set->ln1[i] : set->bsc[i];
+        n++;
+    }
+    if ( n < 2 ) return (int) n;
+
+    /* Sort by query, subject genome, then best first, and keep the first of each */
+
+    qsort( *hits, n, sizeof( hit_t ), cmp_hits );
+    h = *hits;
+    for ( i = 1, k = 0; i < n; i++ ) {
+        if ( ( h[i].qlen == h[k].qlen ) && ( h[i].sglen == h[k].sglen )
+          && ( memcmp( h[i].q, h[k].q, h[k].qlen ) == 0 )
+          && ( memcmp( h[i].sg, h[k].sg, h[k].sglen ) == 0 ) ) continue;
+        h[++k] = h[i];
+    }
+    return k + 1;
+}
+
+
+int cmp_hits( const void *a, const void *b ) {
+    const hit_t *h1 = (const hit_t *) a;
+    const hit_t *h2 = (const hit_t *) b;
+    int          c;
+
+    if ( ( c = memcmp( h1->q, h2->q, ( h1->qlen < h2->qlen ) ? h1->qlen : h2->qlen ) ) ) return c;
+    if ( h1->qlen != h2->qlen ) return h1->qlen - h2->qlen;
+    if ( ( c = memcmp( h1->sg, h2->sg, ( h1->sglen < h2->sglen ) ? h1->sglen : h2->sglen ) ) ) return c;
+    if ( h1->sglen != h2->sglen ) return h1->sglen - h2->sglen;
+    if ( h1->psc != h2->psc ) return ( h1->psc < h2->psc ) ? -1 : 1;
+    if ( h1->bsc != h2->bsc ) return ( h1->bsc > h2->bsc ) ? -1 : 1;
+    if ( ( c = memcmp( h1->s, h2->s, ( h1->slen < h2->slen ) ? h1->slen : h2->slen ) ) ) return c;
+    return h1->slen - h2->slen;
+}
+
+
+/*  Is hit 1 better than hit 2?  The order does not depend on the order in
+ *  which blocks are read.
+ */
+
+int better( double psc1, float bsc1, const char *s1, double psc2, float bsc2, const char *s2 ) {
+    if ( psc1 != psc2 ) return psc1 < psc2;
+    if ( bsc1 != bsc2 ) return bsc1 > bsc2;
+    return strcmp( s1, s2 ) < 0;
+}
+
+
+/*  Add the best hits of a block (called with best_lock held)  */
+
+void add_hits( hit_t *hits, int nhit ) {
+    hit_t    *h;
+    uint64_t  key;
+    uint32_t  q, s, g;
+    size_t    slot;
+    int       i;
+
+    for ( i = 0; i < nhit; i++ ) {
+        h = hits + i;
+        q = peg_id( h->q, h->qlen );
+        s = peg_id( h->s, h->slen );
+        g = peg_g[s];
+        key = ( ( (uint64_t) q << 32 ) | g ) + 1;
+        if ( best_find( key, &slot ) ) {
+            if ( ! better( h->psc, h->bsc, STR( &pegs, s ),
+                           best.psc[slot], best.bsc[slot], STR( &pegs, best.subj[slot] ) ) ) continue;
+        }
+        else {
+            best.key[slot] = key;
+            best.n++;
+        }
+        best.subj[slot] = s;
+        best.psc[slot]  = h->psc;
+        best.bsc[slot]  = h->bsc;
+        best.nsc[slot]  = h->nsc;
+        if ( 2 * best.n > best.size ) best_grow();
+    }
+}
+
+
+/*  Split fig|Genome.peg.N.  Returns 1 if the id is a peg.  */
+
+int peg_genome( const char *id, int len, const char **genome, int *glen, uint32_t *num ) {
+    const char *p, *end;
+    uint32_t    n;
+
+    if ( ( len < 10 ) || ( memcmp( id, "fig|", 4 ) != 0 ) ) return 0;
+    end = id + len;
+    for ( p = id + 4; ( p + 5 < end ) && ( memcmp( p, ".peg.", 5 ) != 0 ); p++ ) ;
+    if ( p + 5 >= end || p == id + 4 ) return 0;
+    *genome = id + 4;
+    *glen   = p - ( id + 4 );
+    for ( p += 5, n = 0; ( p < end ) && ( *p >= '0' ) && ( *p <= '9' ); p++ ) n = 10 * n + ( *p - '0' );
+    if ( p != end ) return 0;
+    *num = n;
+    return 1;
+}
+
+
+/*  Is the id a peg of a genome given with -g?  */
+
+int changed_genome( const char *id, int len ) {
+    const char *g;
+    uint32_t    num;
+    int         glen;
+
+    if ( ! peg_genome( id, len, &g, &glen, &num ) ) return 0;
+    return intern( &changed, g, glen, 0 ) < changed.n;
+}
+
+
+/*  The number of a string, adding it if add is set.  Returns tab->n if it
+ *  is not there and not added.
+ */
+
+uint32_t intern( strtab_t *tab, const char *s, int len, int add ) {
+    uint32_t h, i, j, *slot, nslot;
+
+    if ( tab->nslot ) {
+        for ( h = hash_str( s, len ) & ( tab->nslot - 1 ); tab->slot[h]; h = ( h + 1 ) & ( tab->nslot - 1 ) ) {
+            i = tab->slot[h] - 1;
+            if ( ( strncmp( STR( tab, i ), s, len ) == 0 ) && ( STR( tab, i )[len] == '\0' ) ) return i;
+        }
+    }
+    if ( ! add ) return tab->n;
+
+    if ( 2 * ( tab->n + 1 ) > tab->nslot ) {
+        nslot = tab->nslot ? 2 * tab->nslot : 1024;
+        slot = (uint32_t *) xrealloc( NULL, nslot * sizeof( uint32_t ) );
+        memset( slot, 0, nslot * sizeof( uint32_t ) );
+        for ( i = 0; i < tab->n; i++ ) {
+            for ( j = hash_str( STR( tab, i ), strlen( STR( tab, i ) ) ) & ( nslot - 1 ); slot[j]; j = ( j + 1 ) & ( nslot - 1 ) ) ;
+            slot[j] = i + 1;
+        }
+        if ( tab->slot ) free( tab->slot );
+        tab->slot  = slot;
+        tab->nslot = nslot;
+    }
+    if ( tab->n >= tab->max ) {
+        tab->max = tab->max ? 2 * tab->max : 1024;
+        tab->off = (size_t *) xrealloc( tab->off, tab->max * sizeof( size_t ) );
+    }
+    if ( tab->text_len + len + 1 > tab->text_size ) {
+        tab->text_size = 2 * ( tab->text_len + len + 1 ) + 64 * 1024;
+        tab->text = (char *) xrealloc( tab->text, tab->text_size );
+    }
+    memcpy( tab->text + tab->text_len, s, len );
+    tab->text[tab->text_len + len] = '\0';
+    tab->off[tab->n] = tab->text_len;
+    tab->text_len += len + 1;
+
+    for ( h = hash_str( s, len ) & ( tab->nslot - 1 ); tab->slot[h]; h = ( h + 1 ) & ( tab->nslot - 1 ) ) ;
+    tab->slot[h] = tab->n + 1;
+    return tab->n++;
+}
+
+
+/*  The number of a peg, noting the genome of a new one  */
+
+uint32_t peg_id( const char *id, int len ) {
+    const char *g;
+    uint32_t    i, n, num;
+    int         glen;
+
+    n = pegs.n;
+    i = intern( &pegs, id, len, 1 );
+    if ( pegs.n > n ) {
+        if ( i >= peg_max ) {
+            peg_max = pegs.max;
+            peg_g = (uint32_t *) xrealloc( peg_g, peg_max * sizeof( uint32_t ) );
+        }
+        peg_genome( id, len, &g, &glen, &num );
+        peg_g[i] = intern( &genomes, g, glen, 1 );
+    }
+    return i;
+}
+
+
+/*  FNV-1a  */
+
+uint32_t hash_str( const char *s, int len ) {
+    uint32_t h = 2166136261u;
+    int      i;
+
+    for ( i = 0; i < len; i++ ) h = ( h ^ (unsigned char) s[i] ) * 16777619u;
+    return h;
+}
+
+
+/*  Find the slot of a key in the best hits.  Returns 1 if it is there, or
+ *  0 with slot set to where it goes.
+ */
+
+int best_find( uint64_t key, size_t *slot ) {
+    size_t h;
+
+    if ( ! best.size ) best_grow();
+    h = (size_t) ( ( key * 0x9E3779B97F4A7C15ULL ) >> 20 ) & ( best.size - 1 );
+    while ( best.key[h] ) {
+        if ( best.key[h] == key ) {
+            *slot = h;
+            return 1;
+        }
+        h = ( h + 1 ) & ( best.size - 1 );
+    }
+    *slot = h;
+    return 0;
+}
+
+
+void best_grow( void ) {
+    best_t  old = best;
+    size_t  i, slot;
+
+    best.size = old.size ? 2 * old.size : 64 * 1024;
+    best.n    = 0;
+    best.key  = (uint64_t *) xrealloc( NULL, best.size * sizeof( uint64_t ) );
+    best.subj = (uint32_t *) xrealloc( NULL, best.size * sizeof( uint32_t ) );
+    best.psc  = (double *)   xrealloc( NULL, best.size * sizeof( double ) );
+    best.bsc  = (float *)    xrealloc( NULL, best.size * sizeof( float ) );
+    best.nsc  = (float *)    xrealloc( NULL, best.size * sizeof( float ) );
+    memset( best.key, 0, best.size * sizeof( uint64_t ) );
+
+    for ( i = 0; i < old.size; i++ ) {
+        if ( ! old.key[i] ) continue;
+        best_find( old.key[i], &slot );
+        best.key[slot]  = old.key[i];
+        best.subj[slot] = old.subj[i];
+        best.psc[slot]  = old.psc[i];
+        best.bsc[slot]  = old.bsc[i];
+        best.nsc[slot]  = old.nsc[i];
+        best.n++;
+    }
+    if ( old.size ) {
+        free( old.key );
+        free( old.subj );
+        free( old.psc );
+        free( old.bsc );
+        free( old.nsc );
+    }
+}
+
+
+/*  Join the best hits in both directions, and write the BBHs of each genome
+ *  to stdout or to files in dir.  Returns 0 on success.
+ */
+
+int write_bbhs( const char *dir ) {
+    bbh_line_t **lines;
+    size_t      *nline, *maxline, i, slot;
+    char         outbuf[INPLEN], *touch;
+    uint32_t     q, s, g1, ng, *order;
+    int          fail = 0;
+
+    ng      = genomes.n;
+    lines   = (bbh_line_t **) xrealloc( NULL, ( ng + 1 ) * sizeof( bbh_line_t * ) );
+    nline   = (size_t *) xrealloc( NULL, ( ng + 1 ) * sizeof( size_t ) );
+    maxline = (size_t *) xrealloc( NULL, ( ng + 1 ) * sizeof( size_t ) );
+    touch   = (char *) xrealloc( NULL, ng + 1 );
+    memset( lines,   0, ( ng + 1 ) * sizeof( bbh_line_t * ) );
+    memset( nline,   0, ( ng + 1 ) * sizeof( size_t ) );
+    memset( maxline, 0, ( ng + 1 ) * sizeof( size_t ) );
+    memset( touch,   0, ng + 1 );
+
+    for ( i = 0; i < best.size; i++ ) {
+        if ( ! best.key[i] ) continue;
+        q  = (uint32_t) ( ( best.key[i] - 1 ) >> 32 );
+        s  = best.subj[i];
+        g1 = peg_g[q];
+        if ( ! best_find( ( ( (uint64_t) s << 32 ) | g1 ) + 1, &slot ) || ( best.subj[slot] != q ) ) continue;
+        if ( nchanged && ( g1 >= (uint32_t) nchanged ) && ( peg_g[s] >= (uint32_t) nchanged ) ) continue;
+        snprintf( outbuf, INPLEN, "%s\t%s\t%.3g\t%.4g\n", STR( &pegs, q ), STR( &pegs, s ), best.psc[i], best.nsc[i] );
+        add_line( lines + g1, nline + g1, maxline + g1, strdup( outbuf ) );
+        touch[g1] = 1;
+    }
+
+    /* With -g, the other genomes that had a BBH with a changed genome keep
+     * the rest of their lines.
+     */
+
+    if ( nchanged && dir ) {
+        for ( g1 = 0; g1 < (uint32_t) nchanged; g1++ ) {
+            if ( read_old_bbhs( dir, g1, NULL, NULL, NULL, touch ) ) fail = 1;
+        }
+        for ( g1 = nchanged; g1 < genomes.n; g1++ ) {
+            if ( ! touch[g1] ) continue;
+            if ( read_old_bbhs( dir, g1, lines + g1, nline + g1, maxline + g1, NULL ) ) fail = 1;
+        }
+    }
+
+    /* Genomes in order of their ids */
+
+    order = (uint32_t *) xrealloc( NULL, ( ng + 1 ) * sizeof( uint32_t ) );
+    for ( g1 = 0; g1 < ng; g1++ ) order[g1] = g1;
+    qsort( order, ng, sizeof( uint32_t ), cmp_genomes );
+
+    for ( i = 0; ( i < ng ) && ! fail; i++ ) {
+        g1 = order[i];
+        if ( nchanged && ( g1 >= (uint32_t) nchanged ) && ! touch[g1] ) continue;
+        qsort( lines[g1], nline[g1], sizeof( bbh_line_t ), cmp_lines );
+        if ( write_genome( dir, g1, lines[g1], nline[g1] ) ) fail = 1;
+    }
+
+    for ( g1 = 0; g1 < ng; g1++ ) {
+        for ( i = 0; i < nline[g1]; i++ ) free( lines[g1][i].line );
+        if ( lines[g1] ) free( lines[g1] );
+    }
+    free( order );
+    free( lines );
+    free( nline );
+    free( maxline );
+    free( touch );
+    return fail;
+}
+
+
+int cmp_genomes( const void *a, const void *b ) {
+    return strcmp( STR( &genomes, *(const uint32_t *) a ), STR( &genomes, *(const uint32_t *) b ) );
+}
+
+
+/*  Read the BBH file of genome g in dir.  With lines, keep the lines whose
+ *  second peg is not in a changed genome; with touch, mark the genomes of
+ *  the second pegs.  A missing file has no lines.  Returns 0 on success.
+ */
+
+int read_old_bbhs( const char *dir, uint32_t g, bbh_line_t **lines, size_t *nline, size_t *maxline, char *touch ) {
+    FILE       *fp;
+    char        path[INPLEN], inpbuf[INPLEN], *p2, *end;
+    const char *g2;
+    uint32_t    num, i;
+    int         g2len;
+
+    snprintf( path, INPLEN, "%s/%s", dir, STR( &genomes, g ) );
+    if ( ! ( fp = fopen( path, "r" ) ) ) return 0;
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+        if ( ! ( p2 = strchr( inpbuf, '\t' ) ) ) continue;
+        p2++;
+        for ( end = p2; *end && ( *end != '\t' ) && ( *end != '\n' ); end++ ) ;
+        if ( ! peg_genome( p2, end - p2, &g2, &g2len, &num ) ) continue;
+        i = intern( &genomes, g2, g2len, 0 );
+        if ( touch ) {
+            if ( i < genomes.n ) touch[i] = 1;
+        }
+        else if ( ( i >= genomes.n ) || ( i >= (uint32_t) nchanged ) ) {
+            add_line( lines, nline, maxline, strdup( inpbuf ) );
+        }
+    }
+    i = ferror( fp );
+    fclose( fp );
+    return i;
+}
+
+
+/*  Add a line, with its sort key  */
+
+void add_line( bbh_line_t **lines, size_t *nline, size_t *maxline, char *line ) {
+    bbh_line_t *l;
+    const char *g, *p2, *end;
+    int         glen;
+    uint32_t    num;
+
+    if ( ! line ) {
+        fprintf( stderr, "compute_bbhs: out of memory\n" );
+        exit( 1 );
+    }
+    if ( *nline >= *maxline ) {
+        *maxline = *maxline ? 2 * *maxline : 1024;
+        *lines = (bbh_line_t *) xrealloc( *lines, *maxline * sizeof( bbh_line_t ) );
+    }
+    l = *lines + ( *nline )++;
+    l->line  = line;
+    l->n1    = l->n2 = 0;
+    l->g2    = line;
+    l->g2len = 0;
+    for ( end = line; *end && ( *end != '\t' ); end++ ) ;
+    if ( peg_genome( line, end - line, &g, &glen, &num ) ) l->n1 = num;
+    if ( ! *end ) return;
+    for ( p2 = end + 1, end = p2; *end && ( *end != '\t' ) && ( *end != '\n' ); end++ ) ;
+    if ( peg_genome( p2, end - p2, &g, &glen, &num ) ) {
+        l->g2    = g;
+        l->g2len = glen;
+        l->n2    = num;
+    }
+}
+
+
+/*  By peg number of peg1, then peg2 (by genome, then peg number)  */
+
+int cmp_lines( const void *a, const void *b ) {
+    const bbh_line_t *l1 = (const bbh_line_t *) a;
+    const bbh_line_t *l2 = (const bbh_line_t *) b;
+    int               c;
+
+    if ( l1->n1 != l2->n1 ) return ( l1->n1 < l2->n1 ) ? -1 : 1;
+    if ( ( c = memcmp( l1->g2, l2->g2, ( l1->g2len < l2->g2len ) ? l1->g2len : l2->g2len ) ) ) return c;
+    if ( l1->g2len != l2->g2len ) return l1->g2len - l2->g2len;
+    if ( l1->n2 != l2->n2 ) return ( l1->n2 < l2->n2 ) ? -1 : 1;
+    return strcmp( l1->line, l2->line );
+}
+
+
+/*  Write the lines of a genome to stdout, or to dir/Genome  */
+
+int write_genome( const char *dir, uint32_t g, bbh_line_t *lines, size_t nline ) {
+    FILE   *fp;
+    char    path[INPLEN], tmp[INPLEN+16];
+    size_t  i;
+    int     fd, fail;
+
+    if ( ! dir ) {
+        for ( i = 0; i < nline; i++ ) fputs( lines[i].line, stdout );
+        return ferror( stdout );
+    }
+
+    snprintf( path, INPLEN, "%s/%s", dir, STR( &genomes, g ) );
+    snprintf( tmp, INPLEN+16, "%s.tmp.XXXXXX", path );
+    if ( ( fd = mkstemp( tmp ) ) < 0 ) return 1;
+    if ( ! ( fp = fdopen( fd, "w" ) ) ) {
+        close( fd );
+        unlink( tmp );
+        return 1;
+    }
+    for ( i = 0; i < nline; i++ ) fputs( lines[i].line, fp );
+    fail = ferror( fp );
+    fchmod( fd, 0664 );
+    if ( fclose( fp ) || fail || rename( tmp, path ) ) {
+        unlink( tmp );
+        return 1;
+    }
+    return 0;
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "compute_bbhs: out of memory\n" );
+        exit( 1 );
+    }
+    return ptr;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ options ]  file_list  < SimSeeks  > BBHs\n"
+             "or     %s  [ options ]  -b SeekIndex  file_list  > BBHs\n"
+             "or     %s  -v    (writes the version to stdout)\n"
+             "\n"
+             "Options:\n"
+             "    -j nthreads        read sims on nthreads threads (0 or D = number of processors)\n"
+             "    -p max_psc         ignore hits with a higher psc\n"
+             "    -o BBHDir          write BBHDir/Genome files instead of stdout\n"
+             "    -g Genome          only BBHs with Genome (may be repeated)\n"
+             "    -r SubjectIndex    with -g, find hits into the genomes in SubjectIndex\n",
+             prog, prog, prog
+           );
+    exit( 0 );
+}
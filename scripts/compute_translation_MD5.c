@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2003-2008 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  compute_translation_MD5.c
+ *
+ *  Usage:  compute_translation_MD5 [ -j nthreads ] max_ids max_id_len < file_list > id_gid_and_md5
+ *  or      compute_translation_MD5 -v   (to return version number on standard output)
+ *
+ *  file_list contains one or more lines of form:
+ *
+ *      GenomeID \t FileName \n
+ *
+ *  Each file of translations (fasta) gets records of form:
+ *
+ *      SeqId \t GenomeID \t MD5 \n
+ *
+ *  for the protein_sequence_MD5 table, where MD5 is the hex MD5 of the
+ *  sequence, upper cased, without white space.  As in the perl of
+ *  index_translations_MD5, sequences of fewer than 5 residues are skipped,
+ *  and the last of sequences with the same id in a file is kept.  The
+ *  records of a file are sorted by SeqId.
+ *
+ *  The files are read with translation_reader.c, as in
+ *  index_translation_files: the id ends at white space or at the fifth
+ *  vertical bar, and is truncated to max_id_len characters.  A file with
+ *  more than max_ids sequences is an error; the records of the other files
+ *  are still written, but the exit status is 1.
+ *
+ *  A translations file compressed to blocked gzip (see bgzf.h) is read a
+ *  block at a time.
+ *
+ *  With -j, the files are computed on nthreads threads (0 is one per online
+ *  processor) by the job pool of job_pool.c, as in index_contig_files.
+ *
+ *  Compile with:
+ *
+ *      cc -O compute_translation_MD5.c translation_reader.c job_pool.c bgzf.c md5.c -o compute_translation_MD5 -lpthread -lz
+ *
+ *  Version History:
+ *
+ *      1.00: First version.
+ *      1.01: Read the files with translation_reader.c, which is shared with
+ *            index_translation_files.
+ */
+
+#define  VERSION  "1.01"
+
+#include <stdio.h>
+#include <stdlib.h>  /*  exit(), qsort()  */
+#include <string.h>  /*  strcmp()  */
+#include <fcntl.h>   /*  O_RDONLY  */
+#include <unistd.h>  /*  close(), sysconf() */
+
+#include "translation_reader.h"
+#include "job_pool.h"
+
+#define  INPLEN    ( 64*1024)
+
+/*  A sequence of the file, with its id at key in the file's keys  */
+
+typedef struct {
+    char          *id;
+    size_t         key;
+    int            order;
+    unsigned char  digest[16];
+} seq_t;
+
+/*  Buffers of a thread that reads files  */
+
+typedef struct {
+    tr_file_t      file;
+    tr_md5_t      *md5;
+    outbuf_t       keys;
+    seq_t         *seqs;
+    int            maxseq;
+} reader_t;
+
+/*  One line of the file list; its records and messages are collected in
+ *  out and err.
+ */
+
+typedef struct {
+    char      *gid;
+    char      *file_name;
+    outbuf_t   out;
+    outbuf_t   err;
+    int        nseq;
+} job_t;
+
+/*  The state of the file being read  */
+
+typedef struct {
+    job_t          *job;
+    reader_t       *rd;
+    int             nseq;
+} file_t;
+
+/*  Function prototypes:  */
+
+int  md5_files( job_t *jobs, int njob, int nthreads );
+
+void *begin_md5( void *arg );
+
+int  run_md5( void *arg, void *state, int i );
+
+void write_md5( void *arg, int i );
+
+void end_md5( void *arg, void *state );
+
+int  md5_job( job_t *job, reader_t *rd );
+
+int  md5_file( file_t *f );
+
+int  begin_seq( file_t *f, const char *id, int idlen );
+
+void end_seq( file_t *f );
+
+int  report_seqs( file_t *f );
+
+int  cmp_seq( const void *a, const void *b );
+
+int  split_line( char *line, char **gid, char **file_name );
+
+reader_t *new_reader( void );
+
+void free_reader( reader_t *rd );
+
+void *xrealloc( void *ptr, size_t n );
+
+void usage( char *prog );
+
+
+char  inpbuf[INPLEN];
+int   max_ids, max_id_len;
+
+
+int main ( int argc, char **argv ) {
+    int       nthreads, njob, maxjob, nseq, nf, status;
+    char     *gid, *file_name;
+    job_t    *jobs, job;
+    reader_t *rd;
+
+    /* -v flag returns version */
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    nthreads = 1;
+    if ( ( argc >= 3 ) && ( strcmp( argv[1], "-j" ) == 0 ) ) {
+        if ( sscanf( argv[2], "%d", &nthreads ) != 1 || nthreads < 0 ) usage( argv[0] );
+        if ( nthreads == 0 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+        if ( nthreads < 1 ) nthreads = 1;
+        argc -= 2;
+        argv += 2;
+    }
+
+    if ( ( argc != 3 ) || ( ( max_ids    = atoi( argv[1] ) ) < 1 )
+                       || ( ( max_id_len = atoi( argv[2] ) ) < 1 )
+       ) usage( argv[0] );
+    if ( max_id_len >= INPLEN ) max_id_len = INPLEN - 1;
+
+    /*  On one thread, each file is read as it comes from the list, and its
+     *  records are written as they are found.
+     */
+
+    if ( nthreads == 1 ) {
+        rd = new_reader();
+        memset( &job, 0, sizeof( job ) );
+        job.out.fp = stdout;
+        job.err.fp = stderr;
+        nseq = nf = status = 0;
+        while ( fgets( inpbuf, INPLEN,  stdin ) ) {
+            if ( split_line( inpbuf, &job.gid, &job.file_name ) ) continue;
+            if ( md5_job( &job, rd ) < 0 ) status = 1;
+            out_flush( &job.out );
+            out_flush( &job.err );
+            nseq += job.nseq;
+            nf++;
+        }
+        fprintf( stderr, "compute_translation_MD5 computed %d MD5s in %d files\n", nseq, nf );
+        free( job.out.data );
+        free( job.err.data );
+        free_reader( rd );
+        fflush( stdout );
+        return ( status || ferror( stdout ) ) ? 1 : 0;
+    }
+
+    /*  Otherwise, the list is read, and the files are computed on a pool
+     *  of threads, with the records of each file written in list order.
+     */
+
+    jobs   = NULL;
+    njob   = 0;
+    maxjob = 0;
+    while ( fgets( inpbuf, INPLEN,  stdin ) ) {
+        if ( split_line( inpbuf, &gid, &file_name ) ) continue;
+        if ( njob >= maxjob ) {
+            maxjob = maxjob ? 2 * maxjob : 1024;
+            jobs = (job_t *) xrealloc( jobs, maxjob * sizeof( job_t ) );
+        }
+        memset( jobs + njob, 0, sizeof( job_t ) );
+        jobs[njob].gid       = strdup( gid );
+        jobs[njob].file_name = strdup( file_name );
+        if ( ! jobs[njob].gid || ! jobs[njob].file_name ) {
+            fprintf( stderr, "compute_translation_MD5: out of memory\n" );
+            exit( 1 );
+        }
+        njob++;
+    }
+
+    return md5_files( jobs, njob, nthreads );
+}
+
+
+/*  Split a line of the file list in place.  Returns nonzero if it does
+ *  not have two fields.
+ */
+
+int split_line( char *line, char **gid, char **file_name ) {
+    char          *bptr;
+    unsigned int   c;
+
+    bptr = line;
+    *gid = line;
+
+    /*  Find the end of the genome id */
+
+    while ( ( c = *bptr ) && ( c != '\t' ) ) bptr++;
+    if ( ! c ) return 1;
+    *bptr++ = '\0';     /* convert tab to end-of-string */
+    *file_name = bptr;  /* next character is start of file name */
+
+    /*  Find the end of the file name (strip the newline and anything after
+     *  another tab)
+     */
+
+    while ( ( c = *bptr ) && ( c != '\t' ) && ( c != '\n' ) && ( c != '\r' ) ) bptr++;
+    *bptr = '\0';       /* convert terminator to end-of-string */
+
+    return **file_name ? 0 : 1;
+}
+
+
+/*  Compute the files on a pool of threads, writing the records of each
+ *  file in list order.
+ */
+
+int md5_files( job_t *jobs, int njob, int nthreads ) {
+    jp_jobs_t  pool;
+    int        i, nseq, status;
+
+    if ( ! njob ) return 0;
+
+    pool.njob  = njob;
+    pool.arg   = jobs;
+    pool.begin = begin_md5;
+    pool.run   = run_md5;
+    pool.write = write_md5;
+    pool.end   = end_md5;
+    status = jp_run( &pool, nthreads );
+
+    nseq = 0;
+    for ( i = 0; i < njob; i++ ) nseq += jobs[i].nseq;
+    fprintf( stderr, "compute_translation_MD5 computed %d MD5s in %d files\n", nseq, njob );
+
+    free( jobs );
+    fflush( stdout );
+    return ( status || ferror( stdout ) ) ? 1 : 0;
+}
+
+
+void *begin_md5( void *arg ) {
+    (void) arg;
+    return new_reader();
+}
+
+
+int run_md5( void *arg, void *state, int i ) {
+    return md5_job( (job_t *) arg + i, (reader_t *) state ) < 0;
+}
+
+
+void write_md5( void *arg, int i ) {
+    job_t  *job = (job_t *) arg + i;
+
+    if ( job->out.len ) fwrite( job->out.data, 1, job->out.len, stdout );
+    if ( job->err.len ) fwrite( job->err.data, 1, job->err.len, stderr );
+    free( job->out.data );
+    free( job->err.data );
+    free( job->gid );
+    free( job->file_name );
+}
+
+
+void end_md5( void *arg, void *state ) {
+    (void) arg;
+    free_reader( (reader_t *) state );
+}
+
+
+/*  Open the file of a job, and read it.  Returns -1 if the file had too
+ *  many sequences; a file that cannot be opened or read, or a damaged
+ *  blocked gzip file, is reported, but its records (if any) are kept.
+ */
+
+int md5_job( job_t *job, reader_t *rd ) {
+    file_t  f;
+    int     fd, status;
+
+    job->nseq = 0;
+    if ( ( fd = open( job->file_name, O_RDONLY, 0 ) ) < 0 ) {
+        out_printf( &job->err, "ERROR: Failed to open translations file: %s\n", job->file_name );
+        return 0;
+    }
+    if ( tr_open( &rd->file, fd, 0 ) ) {
+        fprintf( stderr, "compute_translation_MD5: out of memory\n" );
+        exit( 1 );
+    }
+
+    f.job  = job;
+    f.rd   = rd;
+    f.nseq = 0;
+    rd->keys.len = 0;
+
+    status = md5_file( &f );
+    if ( rd->file.status == TR_NOMEM ) {
+        fprintf( stderr, "compute_translation_MD5: out of memory\n" );
+        exit( 1 );
+    }
+    if ( rd->file.status == TR_BADREAD ) {
+        out_printf( &job->err, rd->file.bgzf ? "ERROR: Bad blocked gzip translations file: %s\n"
+                                             : "ERROR: Failed to read translations file: %s\n",
+                    job->file_name
+                  );
+    }
+    tr_close( &rd->file );
+    (void) close( fd );
+
+    if ( status < 0 ) return status;
+    job->nseq = report_seqs( &f );
+    return 0;
+}
+
+
+/*  Read the sequences of a file.  Returns 0 at the end of the file, or -1
+ *  if there are more than max_ids sequences.
+ */
+
+int md5_file( file_t *f ) {
+    tr_file_t            *tf = &f->rd->file;
+    const unsigned char  *data;
+    char                  idbuf[ INPLEN ];
+    long                  n;
+    int                   idlen, truncated;
+
+    while ( ( idlen = tr_next_id( tf, idbuf, max_id_len, &truncated ) ) >= 0 ) {
+        if ( truncated ) {
+            out_printf( &f->job->err, "WARNING: Truncating id to %d characters: %s\n", max_id_len, idbuf );
+        }
+        if ( ! idlen ) {
+            out_printf( &f->job->err, "WARNING:  Null sequence identifier skipped in %s\n", f->job->file_name );
+            continue;
+        }
+
+        if ( begin_seq( f, idbuf, idlen ) ) return -1;
+        while ( ( n = tr_next_seq( tf, &data ) ) > 0 ) tr_md5_add( f->rd->md5, data, n );
+        end_seq( f );
+    }
+
+    return 0;
+}
+
+
+/*  Start a sequence, saving its id in the keys of the reader.  Returns
+ *  nonzero if the file has too many sequences.
+ */
+
+int begin_seq( file_t *f, const char *id, int idlen ) {
+    reader_t  *rd = f->rd;
+    seq_t     *seq;
+
+    if ( f->nseq >= max_ids ) {
+        out_printf( &f->job->err, "ERROR: Maximum number of ids (%d) reached in %s\n", max_ids, f->job->file_name );
+        return 1;
+    }
+    if ( f->nseq >= rd->maxseq ) {
+        rd->maxseq = rd->maxseq ? 2 * rd->maxseq : 4096;
+        rd->seqs = (seq_t *) xrealloc( rd->seqs, rd->maxseq * sizeof( seq_t ) );
+    }
+
+    seq = rd->seqs + f->nseq;
+    seq->key   = rd->keys.len;
+    seq->order = f->nseq;
+    out_reserve( &rd->keys, idlen + 1 );
+    memcpy( rd->keys.data + rd->keys.len, id, idlen );
+    rd->keys.len += idlen;
+    rd->keys.data[ rd->keys.len++ ] = '\0';
+
+    tr_md5_begin( rd->md5 );
+    return 0;
+}
+
+
+/*  Finish the MD5 of the current sequence, or drop it if it is short  */
+
+void end_seq( file_t *f ) {
+    reader_t  *rd  = f->rd;
+    seq_t     *seq = rd->seqs + f->nseq;
+
+    if ( ! tr_md5_end( rd->md5, seq->digest ) ) {
+        rd->keys.len = seq->key;
+        return;
+    }
+    f->nseq++;
+}
+
+
+/*  Write the sequences of the file sorted by id, keeping the last of
+ *  repeated ids.  Returns the number written.
+ */
+
+int report_seqs( file_t *f ) {
+    reader_t  *rd = f->rd;
+    seq_t     *seq;
+    char       hex[33];
+    int        i, n;
+
+    for ( i = 0; i < f->nseq; i++ ) rd->seqs[i].id = rd->keys.data + rd->seqs[i].key;
+    qsort( rd->seqs, f->nseq, sizeof( seq_t ), cmp_seq );
+
+    n = 0;
+    for ( i = 0; i < f->nseq; i++ ) {
+        seq = rd->seqs + i;
+        if ( ( i + 1 < f->nseq ) && ! strcmp( seq->id, seq[1].id ) ) continue;
+        tr_md5_hex( seq->digest, hex );
+        out_printf( &f->job->out, "%s\t%s\t%s\n", seq->id, f->job->gid, hex );
+        n++;
+    }
+
+    return n;
+}
+
+
+int cmp_seq( const void *a, const void *b ) {
+    const seq_t *sa = (const seq_t *) a;
+    const seq_t *sb = (const seq_t *) b;
+    int          c;
+
+    if ( ( c = strcmp( sa->id, sb->id ) ) ) return c;
+    return sa->order - sb->order;
+}
+
+
+reader_t *new_reader( void ) {
+    reader_t *rd = (reader_t *) xrealloc( NULL, sizeof( reader_t ) );
+    if ( ! ( rd->md5 = tr_md5_new( 0 ) ) ) {
+        fprintf( stderr, "compute_translation_MD5: out of memory\n" );
+        exit( 1 );
+    }
+    memset( &rd->keys, 0, sizeof( rd->keys ) );
+    rd->seqs   = NULL;
+    rd->maxseq = 0;
+    return rd;
+}
+
+
+void free_reader( reader_t *rd ) {
+    tr_md5_free( rd->md5 );
+    free( rd->keys.data );
+    free( rd->seqs );
+    free( rd );
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "compute_translation_MD5: out of memory\n" );
+        exit( 1 );
+    }
+    return ptr;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage:  %s [ -j nthreads ] max_ids max_id_len < file_list > id_gid_and_md5\n"
+             "or      %s -v   (to return version number on standard output)\n",
+             prog, prog
+           );
+    exit(0);
+}
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  condense_sims.c
+ *
+ *  Usage:  condense_sims  [ -j nthreads ]  [ -l Leftover ]  GenomeMap  [ SimsFile ... ]  > LoadFile
+ *  or      condense_sims  -v   (to return version number on standard output)
+ *
+ *  Convert condensed sims, lines of tab separated fields:
+ *
+ *     Peg1 \t Peg2 \t Rest...
+ *
+ *  to rows of the condensed_sims table, with each peg replaced by the
+ *  genome number and peg number given by FIG::map_peg_to_ids:
+ *
+ *     G1 \t P1 \t G2 \t P2 \t Rest...
+ *
+ *  GenomeMap gives the number of each genome, as lines of form:
+ *
+ *     Genome \t GenomeNumber \n
+ *
+ *  A peg is fig|Genome.peg.N, and its peg number is N.  Lines in which
+ *  either id is not a peg of a genome in the map are written unchanged to
+ *  Leftover (or dropped, without -l), for the caller to map some other way.
+ *
+ *  The sims files (default standard in) are read in chunks of CHUNKLEN
+ *  bytes, cut at newlines, which are converted on nthreads threads (default,
+ *  or 0, is one per online processor) and written in order.  LoadFile may be a
+ *  FIFO read by the database loader.
+ *
+ *  Compile with:  cc -O condense_sims.c -o condense_sims -lpthread
+ */
+
+#define  VERSION  "1.00"
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>   /*  O_RDONLY  */
+#include <unistd.h>
+#include <pthread.h>
+
+#ifndef CHUNKLEN
+#define  CHUNKLEN  ( 8*1024*1024)   /* bytes of input per chunk */
+#endif
+#define  INPLEN    (   16*1024)     /* genome map line length */
+
+/*  A chunk of input, converted on a worker thread  */
+
+typedef struct {
+    char      *data;
+    size_t     len;
+    size_t     size;
+    char      *out;         /* converted lines */
+    size_t     out_len;
+    size_t     out_size;
+    char      *left;        /* lines that could not be converted */
+    size_t     left_len;
+    size_t     left_size;
+    pthread_t  thread;
+    int        busy;
+} chunk_t;
+
+int   read_genome_map( const char *path );
+int   genome_number( const char *g, int len );
+uint32_t hash_str( const char *s, int len );
+int   condense_fd( int fd, chunk_t *chunks, int nthreads, FILE *out, FILE *left );
+int   fill_chunk( int fd, chunk_t *c, char **carry, size_t *ncarry, int *eof );
+void *condense_worker( void *arg );
+char *split_peg( const char *id, const char *end, const char **genome, int *glen );
+char *put_int( char *p, int v );
+void  reserve( char **buf, size_t *size, size_t len, size_t n );
+void *xrealloc( void *ptr, size_t n );
+void  usage( char *prog );
+
+/*  Genome map, as an open addressing hash  */
+
+char  **gnames = NULL;
+int    *gnums  = NULL;
+size_t  gslots = 0;
+
+
+int main( int argc, char **argv ) {
+    chunk_t  *chunks;
+    FILE     *left;
+    char     *left_file;
+    int       nthreads, fd, i, status;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    nthreads  = 0;
+    left_file = NULL;
+    while ( ( argc >= 3 ) && ( argv[1][0] == '-' ) ) {
+        if ( strcmp( argv[1], "-j" ) == 0 ) {
+            if ( sscanf( argv[2], "%d", &nthreads ) != 1 || nthreads < 0 ) usage( argv[0] );
+            if ( nthreads == 0 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+            if ( nthreads < 1 ) nthreads = 1;
+        }
+        else if ( strcmp( argv[1], "-l" ) == 0 ) left_file = argv[2];
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( argc < 2 ) usage( argv[0] );
+
+    if ( nthreads < 1 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthreads < 1 ) nthreads = 1;
+
+    if ( read_genome_map( argv[1] ) ) {
+        fprintf( stderr, "condense_sims: could not read genome map %s\n", argv[1] );
+        return 1;
+    }
+
+    left = NULL;
+    if ( left_file && ! ( left = fopen( left_file, "w" ) ) ) {
+        fprintf( stderr, "condense_sims: could not write %s\n", left_file );
+        return 1;
+    }
+
+    chunks = (chunk_t *) xrealloc( NULL, nthreads * sizeof( chunk_t ) );
+    memset( chunks, 0, nthreads * sizeof( chunk_t ) );
+
+    status = 0;
+    if ( argc == 2 ) status = condense_fd( 0, chunks, nthreads, stdout, left );
+    for ( i = 2; ( i < argc ) && ! status; i++ ) {
+        if ( ( fd = open( argv[i], O_RDONLY ) ) < 0 ) {
+            fprintf( stderr, "condense_sims: could not open %s\n", argv[i] );
+            status = 1;
+            break;
+        }
+        status = condense_fd( fd, chunks, nthreads, stdout, left );
+        close( fd );
+        if ( status ) fprintf( stderr, "condense_sims: failed on %s\n", argv[i] );
+    }
+
+    if ( fflush( stdout ) || ferror( stdout ) ) status = 1;
+    if ( left && fclose( left ) ) status = 1;
+    return status;
+}
+
+
+/*  Read "Genome \t GenomeNumber" lines  */
+
+int read_genome_map( const char *path ) {
+    FILE   *fp;
+    char    inpbuf[INPLEN], *tab;
+    size_t  n, nmap, h, i;
+    int     num;
+
+    if ( ! ( fp = fopen( path, "r" ) ) ) return 1;
+    nmap = 0;
+    while ( fgets( inpbuf, INPLEN, fp ) ) nmap++;
+    rewind( fp );
+
+    for ( gslots = 1024; gslots < 2 * nmap; gslots *= 2 ) ;
+    gnames = (char **) xrealloc( NULL, gslots * sizeof( char * ) );
+    gnums  = (int *) xrealloc( NULL, gslots * sizeof( int ) );
+    memset( gnames, 0, gslots * sizeof( char * ) );
+
+    for ( i = 0; ( i < nmap ) && fgets( inpbuf, INPLEN, fp ); i++ ) {
+        if ( ! ( tab = strchr( inpbuf, '\t' ) ) ) continue;
+        *tab = '\0';
+        num = atoi( tab + 1 );
+        n = tab - inpbuf;
+        for ( h = hash_str( inpbuf, n ) & ( gslots - 1 ); gnames[h]; h = ( h + 1 ) & ( gslots - 1 ) ) {
+            if ( strcmp( gnames[h], inpbuf ) == 0 ) break;
+        }
+        if ( ! gnames[h] && ! ( gnames[h] = strdup( inpbuf ) ) ) {
+            fclose( fp );
+            return 1;
+        }
+        gnums[h] = num;
+    }
+    i = ferror( fp );
+    fclose( fp );
+    return i ? 1 : 0;
+}
+
+
+/*  The number of a genome, or -1 if it is not in the map  */
+
+int genome_number( const char *g, int len ) {
+    size_t h;
+
+    for ( h = hash_str( g, len ) & ( gslots - 1 ); gnames[h]; h = ( h + 1 ) & ( gslots - 1 ) ) {
+        if ( ( strncmp( gnames[h], g, len ) == 0 ) && ( gnames[h][len] == '\0' ) ) return gnums[h];
+    }
+    return -1;
+}
+
+
+/*  FNV-1a  */
+
+uint32_t hash_str( const char *s, int len ) {
+    uint32_t h = 2166136261u;
+    int      i;
+
+    for ( i = 0; i < len; i++ ) h = ( h ^ (unsigned char) s[i] ) * 16777619u;
+    return h;
+}
+
+
+/*  Convert one input.  Up to nthreads chunks are read, converted in
+ *  parallel, and written in order.  Returns 0 on success.
+ */
+
+int condense_fd( int fd, chunk_t *chunks, int nthreads, FILE *out, FILE *left ) {
+    chunk_t *c;
+    char    *carry;
+    size_t   ncarry;
+    int      eof, n, i, status;
+
+    carry  = NULL;
+    ncarry = 0;
+    eof    = 0;
+    status = 0;
+
+    while ( ! eof && ! status ) {
+        for ( n = 0; ( n < nthreads ) && ! eof; n++ ) {
+            c = chunks + n;
+            if ( fill_chunk( fd, c, &carry, &ncarry, &eof ) ) {
+                status = 1;
+                break;
+            }
+            if ( ! c->len ) break;
+            c->busy = ( n + 1 < nthreads ) && ! eof
+                   && ( pthread_create( &( c->thread ), NULL, condense_worker, c ) == 0 );
+            if ( ! c->busy ) condense_worker( c );
+        }
+
+        for ( i = 0; i < n; i++ ) {
+            c = chunks + i;
+            if ( c->busy ) pthread_join( c->thread, NULL );
+            c->busy = 0;
+            if ( status ) continue;
+            if ( fwrite( c->out, 1, c->out_len, out ) != c->out_len ) status = 1;
+            if ( left && c->left_len && ( fwrite( c->left, 1, c->left_len, left ) != c->left_len ) ) status = 1;
+        }
+    }
+
+    if ( carry ) free( carry );
+    return status;
+}
+
+
+/*  Fill a chunk with the partial line left from the last one, and whole
+ *  lines of input up to CHUNKLEN bytes (more if a line is longer).  The
+ *  partial line at the end is moved to carry.  Returns 0 on success.
+ */
+
+int fill_chunk( int fd, chunk_t *c, char **carry, size_t *ncarry, int *eof ) {
+    ssize_t  n;
+    size_t   len;
+
+    if ( c->size < CHUNKLEN + 1 ) {
+        c->size = CHUNKLEN + 1;
+        c->data = (char *) xrealloc( c->data, c->size );
+    }
+    if ( *ncarry ) memcpy( c->data, *carry, *ncarry );
+    c->len  = *ncarry;
+    *ncarry = 0;
+
+    while ( 1 ) {
+        while ( ! *eof && ( c->len < c->size - 1 ) ) {
+            n = read( fd, c->data + c->len, c->size - 1 - c->len );
+            if ( n < 0 ) return 1;
+            if ( n == 0 ) *eof = 1;
+            c->len += n;
+        }
+        if ( *eof ) {
+            if ( c->len && ( c->data[c->len-1] != '\n' ) ) c->data[c->len++] = '\n';
+            return 0;
+        }
+        for ( len = c->len; ( len > 0 ) && ( c->data[len-1] != '\n' ); len-- ) ;
+        if ( len ) break;
+
+        /* A line longer than the chunk */
+
+        c->size *= 2;
+        c->data = (char *) xrealloc( c->data, c->size );
+    }
+
+    *ncarry = c->len - len;
+    *carry  = (char *) xrealloc( *carry, *ncarry + 1 );
+    memcpy( *carry, c->data + len, *ncarry );
+    c->len = len;
+    return 0;
+}
+
+
+/*  Convert the lines of a chunk  */
+
+void *condense_worker( void *arg ) {
+    chunk_t    *c = (chunk_t *) arg;
+    const char *line, *end, *nl, *t1, *t2, *g, *n1, *n2;
+    char       *p;
+    int         glen, g1, g2;
+
+    c->out_len  = 0;
+    c->left_len = 0;
+    end = c->data + c->len;
+    for ( line = c->data; line < end; line = nl + 1 ) {
+        nl = (const char *) memchr( line, '\n', end - line );
+        g1 = g2 = -1;
+        n1 = n2 = NULL;
+        if ( ( t1 = (const char *) memchr( line, '\t', nl - line ) )
+          && ( t2 = (const char *) memchr( t1 + 1, '\t', nl - t1 - 1 ) ) ) {
+            if ( ( n1 = split_peg( line, t1, &g, &glen ) ) ) g1 = genome_number( g, glen );
+            if ( ( n2 = split_peg( t1 + 1, t2, &g, &glen ) ) ) g2 = genome_number( g, glen );
+        }
+
+        if ( ( g1 < 0 ) || ( g2 < 0 ) ) {
+            reserve( &( c->left ), &( c->left_size ), c->left_len, nl + 1 - line );
+            memcpy( c->left + c->left_len, line, nl + 1 - line );
+            c->left_len += nl + 1 - line;
+            continue;
+        }
+
+        /* G1 \t P1 \t G2 \t P2 \t Rest */
+
+        reserve( &( c->out ), &( c->out_size ), c->out_len, 24 + ( t1 - n1 ) + ( t2 - n2 ) + ( nl - t2 ) );
+        p = put_int( c->out + c->out_len, g1 );
+        *p++ = '\t';
+        memcpy( p, n1, t1 - n1 );
+        p += t1 - n1;
+        *p++ = '\t';
+        p = put_int( p, g2 );
+        *p++ = '\t';
+        memcpy( p, n2, nl + 1 - n2 );
+        p += nl + 1 - n2;
+        c->out_len = p - c->out;
+    }
+    return NULL;
+}
+
+
+/*  Split fig|Genome.peg.N, from id to end.  Returns a pointer to N, and
+ *  sets genome and glen, or returns NULL if the id is not a peg.
+ */
+
+char *split_peg( const char *id, const char *end, const char **genome, int *glen ) {
+    const char *p, *n;
+
+    if ( ( end - id < 10 ) || ( memcmp( id, "fig|", 4 ) != 0 ) ) return NULL;
+    for ( p = end - 1; ( p > id + 4 ) && ( *p >= '0' ) && ( *p <= '9' ); p-- ) ;
+    n = p + 1;
+    if ( ( n == end ) || ( p - 4 <= id + 4 ) || ( memcmp( p - 4, ".peg.", 5 ) != 0 ) ) return NULL;
+    *genome = id + 4;
+    *glen   = ( p - 4 ) - ( id + 4 );
+    return (char *) n;
+}
+
+
+char *put_int( char *p, int v ) {
+    char  tmp[16];
+    int   n = 0;
+
+    if ( v < 0 ) { *p++ = '-'; v = -v; }
+    do { tmp[n++] = '0' + v % 10; v /= 10; } while ( v );
+    while ( n ) *p++ = tmp[--n];
+    return p;
+}
+
+
+/*  Make room for n more bytes after len in a buffer  */
+
+void reserve( char **buf, size_t *size, size_t len, size_t n ) {
+    if ( len + n <= *size ) return;
+    *size = 2 * ( len + n ) + 64 * 1024;
+    *buf  = (char *) xrealloc( *buf, *size );
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "condense_sims: out of memory\n" );
+        exit( 1 );
+    }
+    return ptr;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ -j nthreads ]  [ -l Leftover ]  GenomeMap  [ SimsFile ... ]  > LoadFile\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog
+           );
+    exit( 0 );
+}
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  contig_2bit.c
+ *
+ *  Packing, writing and reading of the 2-bit contig files described in
+ *  contig_2bit.h.  There is no main(); link with the program:
+ *
+ *      cc -O get_dna_2bit.c contig_2bit.c -o get_dna_2bit
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "contig_2bit.h"
+
+struct c2b_writer {
+    char         *path;
+    char         *tmp;
+    FILE         *fp;
+    uint64_t      off;
+    c2b_entry_t  *entries;
+    size_t        nentry;
+    size_t        maxentry;
+    char         *names;
+    size_t        names_len;
+    size_t        names_size;
+    int           error;
+};
+
+struct c2b_file {
+    unsigned char       *map;
+    size_t               size;
+    const c2b_header_t  *hdr;
+    const c2b_entry_t   *index;
+    const char          *names;
+};
+
+/*  2-bit codes of the characters, with 4 for an exception  */
+
+static unsigned char  code[256];
+static char           decode4[256][4];
+static unsigned char  complement[256];
+static int            tables_ready = 0;
+
+static void   init_tables( void );
+static int    grow( void **ptr, size_t *max, size_t n, size_t size );
+static const c2b_entry_t *find_entry( c2b_file_t *f, const char *name );
+static int    cmp_entries( const void *a, const void *b );
+static const char *sort_names = NULL;    /*  for cmp_entries()  */
+
+#define  PAD8(n)  ( ( (n) + 7 ) & ~(uint64_t) 7 )
+
+
+static void init_tables( void ) {
+    static const char *pairs = "ATTAUACGGCRYYRKMMKBVVBDHHDSSWWNN";
+    int  b, i;
+
+    if ( tables_ready ) return;
+    for ( b = 0; b < 256; b++ ) {
+        code[b] = 4;
+        complement[b] = b;
+        for ( i = 0; i < 4; i++ ) decode4[b][i] = "TCAG"[ ( b >> ( 6 - 2 * i ) ) & 3 ];
+    }
+    code['T'] = code['t'] = 0;
+    code['C'] = code['c'] = 1;
+    code['A'] = code['a'] = 2;
+    code['G'] = code['g'] = 3;
+    for ( i = 0; pairs[i]; i += 2 ) {
+        complement[ (unsigned char) pairs[i] ]          = pairs[i+1];
+        complement[ (unsigned char) pairs[i] | 0x20 ]   = pairs[i+1] | 0x20;
+    }
+    tables_ready = 1;
+}
+
+
+/*============================================================================
+ *  Packing
+ *==========================================================================*/
+
+void c2b_contig_init( c2b_contig_t *c ) {
+    memset( c, 0, sizeof( *c ) );
+    init_tables();
+}
+
+
+void c2b_contig_reset( c2b_contig_t *c ) {
+    c->nbase = 0;
+    c->nexc  = 0;
+    c->nmask = 0;
+}
+
+
+void c2b_contig_free( c2b_contig_t *c ) {
+    free( c->packed );
+    free( c->exc );
+    free( c->exc_chr );
+    free( c->mask );
+    memset( c, 0, sizeof( *c ) );
+}
+
+
+int c2b_contig_add( c2b_contig_t *c, const unsigned char *p, size_t n ) {
+    unsigned char  ch, up, k;
+    uint64_t       pos;
+    size_t         i, max;
+
+    if ( grow( (void **) &(c->packed), &(c->packed_size), ( c->nbase + n + 3 ) / 4, 1 ) ) return 1;
+
+    for ( i = 0, pos = c->nbase; i < n; i++, pos++ ) {
+        ch = p[i];
+        if ( ( pos & 3 ) == 0 ) c->packed[ pos >> 2 ] = 0;
+        if ( ( k = code[ch] ) < 4 ) {
+            c->packed[ pos >> 2 ] |= k << ( 6 - 2 * ( pos & 3 ) );
+        }
+        else {
+            up = ( ch >= 'a' && ch <= 'z' ) ? ch & ~0x20 : ch;
+            if ( c->nexc && ( c->exc_chr[ c->nexc - 1 ] == up )
+                         && ( c->exc[ c->nexc - 1 ].start + c->exc[ c->nexc - 1 ].len == pos )
+               ) {
+                c->exc[ c->nexc - 1 ].len++;
+            }
+            else {
+                max = c->maxexc;
+                if ( grow( (void **) &(c->exc), &(c->maxexc), c->nexc + 1, sizeof( c2b_run_t ) ) ) return 1;
+                if ( ( c->maxexc != max )
+                  && ! ( c->exc_chr = (unsigned char *) realloc( c->exc_chr, c->maxexc ) )
+                   ) return 1;
+                c->exc[ c->nexc ].start = pos;
+                c->exc[ c->nexc ].len   = 1;
+                c->exc_chr[ c->nexc++ ] = up;
+            }
+        }
+        if ( ch >= 'a' && ch <= 'z' ) {
+            if ( c->nmask && ( c->mask[ c->nmask - 1 ].start + c->mask[ c->nmask - 1 ].len == pos ) ) {
+                c->mask[ c->nmask - 1 ].len++;
+            }
+            else {
+                if ( grow( (void **) &(c->mask), &(c->maxmask), c->nmask + 1, sizeof( c2b_run_t ) ) ) return 1;
+                c->mask[ c->nmask ].start = pos;
+                c->mask[ c->nmask++ ].len = 1;
+            }
+        }
+    }
+    c->nbase = pos;
+
+    return 0;
+}
+
+
+size_t c2b_record_size( const c2b_contig_t *c ) {
+    return 3 * sizeof( uint64_t )
+         + c->nexc * sizeof( c2b_run_t ) + PAD8( c->nexc )
+         + c->nmask * sizeof( c2b_run_t )
+         + PAD8( ( c->nbase + 3 ) / 4 );
+}
+
+
+/*  rec must hold c2b_record_size() bytes  */
+
+void c2b_record( const c2b_contig_t *c, unsigned char *rec ) {
+    uint64_t  v[3];
+    size_t    n;
+
+    memset( rec, 0, c2b_record_size( c ) );
+    v[0] = c->nbase;
+    v[1] = c->nexc;
+    v[2] = c->nmask;
+    memcpy( rec, v, sizeof( v ) );
+    rec += sizeof( v );
+    n = c->nexc * sizeof( c2b_run_t );
+    if ( n ) memcpy( rec, c->exc, n );
+    rec += n;
+    if ( c->nexc ) memcpy( rec, c->exc_chr, c->nexc );
+    rec += PAD8( c->nexc );
+    n = c->nmask * sizeof( c2b_run_t );
+    if ( n ) memcpy( rec, c->mask, n );
+    rec += n;
+    if ( c->nbase ) memcpy( rec, c->packed, ( c->nbase + 3 ) / 4 );
+}
+
+
+/*============================================================================
+ *  Writing
+ *==========================================================================*/
+
+c2b_writer_t *c2b_writer( const char *path ) {
+    c2b_writer_t  *w;
+    c2b_header_t   hdr;
+
+    if ( ! ( w = (c2b_writer_t *) calloc( 1, sizeof( c2b_writer_t ) ) ) ) return NULL;
+    if ( ( w->path = strdup( path ) ) && ( w->tmp = (char *) malloc( strlen( path ) + 8 ) ) ) {
+        sprintf( w->tmp, "%s.new", path );
+        w->fp = fopen( w->tmp, "w" );
+    }
+    memset( &hdr, 0, sizeof( hdr ) );
+    if ( ! w->fp || ( fwrite( &hdr, sizeof( hdr ), 1, w->fp ) != 1 ) ) {
+        c2b_writer_abort( w );
+        return NULL;
+    }
+    w->off = sizeof( hdr );
+    return w;
+}
+
+
+int c2b_write_record( c2b_writer_t *w, const char *name, size_t name_len,
+                      const unsigned char *rec, size_t len
+                    ) {
+    c2b_entry_t  *e;
+    uint64_t      nbase;
+
+    if ( ! w || w->error ) return -1;
+
+    if ( grow( (void **) &(w->entries), &(w->maxentry), w->nentry + 1, sizeof( c2b_entry_t ) )
+      || grow( (void **) &(w->names), &(w->names_size), w->names_len + name_len, 1 )
+       ) {
+        w->error = 1;
+        return -1;
+    }
+
+    memcpy( &nbase, rec, sizeof( nbase ) );
+    e = w->entries + w->nentry++;
+    e->name_off = w->names_len;
+    e->name_len = name_len;
+    e->rec_off  = w->off;
+    e->nbase    = nbase;
+    memcpy( w->names + w->names_len, name, name_len );
+    w->names_len += name_len;
+
+    if ( fwrite( rec, 1, len, w->fp ) != len ) {
+        w->error = 1;
+        return -1;
+    }
+    while ( len & 7 ) {
+        putc( 0, w->fp );
+        len++;
+    }
+    w->off += len;
+    return 0;
+}
+
+
+int c2b_writer_finish( c2b_writer_t *w ) {
+    c2b_header_t  hdr;
+    size_t        i, n;
+    int           status;
+
+    if ( ! w ) return -1;
+    status = w->error ? -1 : 0;
+
+    if ( ! status ) {
+
+        /*  Sort by name, then by offset, and keep the first of each name  */
+
+        sort_names = w->names;
+        qsort( w->entries, w->nentry, sizeof( c2b_entry_t ), cmp_entries );
+        for ( i = n = 0; i < w->nentry; i++ ) {
+            if ( n && ( w->entries[i].name_len == w->entries[n-1].name_len )
+                   && ! memcmp( w->names + w->entries[i].name_off,
+                                w->names + w->entries[n-1].name_off, w->entries[i].name_len )
+               ) continue;
+            w->entries[n++] = w->entries[i];
+        }
+
+        memset( &hdr, 0, sizeof( hdr ) );
+        memcpy( hdr.magic, C2B_MAGIC, 8 );
+        hdr.version   = C2B_VERSION;
+        hdr.ncontig   = n;
+        hdr.index_off = w->off;
+        hdr.names_off = hdr.index_off + n * sizeof( c2b_entry_t );
+        hdr.size      = hdr.names_off + w->names_len;
+
+        if ( ( fwrite( w->entries, sizeof( c2b_entry_t ), n, w->fp ) != n )
+          || ( fwrite( w->names, 1, w->names_len, w->fp ) != w->names_len )
+          || fseeko( w->fp, 0, SEEK_SET )
+          || ( fwrite( &hdr, sizeof( hdr ), 1, w->fp ) != 1 )
+           ) status = -1;
+    }
+
+    if ( fclose( w->fp ) ) status = -1;
+    w->fp = NULL;
+    if ( status || rename( w->tmp, w->path ) ) {
+        unlink( w->tmp );
+        status = -1;
+    }
+
+    c2b_writer_abort( w );
+    return status;
+}
+
+
+/*  Free a writer, and remove its temporary file, if it is still open  */
+
+void c2b_writer_abort( c2b_writer_t *w ) {
+    if ( ! w ) return;
+    if ( w->fp ) {
+        fclose( w->fp );
+        unlink( w->tmp );
+    }
+    free( w->entries );
+    free( w->names );
+    free( w->tmp );
+    free( w->path );
+    free( w );
+}
+
+
+static int cmp_entries( const void *a, const void *b ) {
+    const c2b_entry_t *ea = (const c2b_entry_t *) a;
+    const c2b_entry_t *eb = (const c2b_entry_t *) b;
+    size_t             n;
+    int                c;
+
+    n = ( ea->name_len < eb->name_len ) ? ea->name_len : eb->name_len;
+    if ( ( c = memcmp( sort_names + ea->name_off, sort_names + eb->name_off, n ) ) ) return c;
+    if ( ea->name_len != eb->name_len ) return ( ea->name_len < eb->name_len ) ? -1 : 1;
+    return ( ea->rec_off < eb->rec_off ) ? -1 : ( ea->rec_off > eb->rec_off );
+}
+
+
+/*============================================================================
+ *  Reading
+ *==========================================================================*/
+
+c2b_file_t *c2b_open( const char *path ) {
+    c2b_file_t          *f;
+    const c2b_header_t  *hdr;
+    struct stat          st;
+    int                  fd;
+
+    init_tables();
+    if ( ( fd = open( path, O_RDONLY, 0 ) ) < 0 ) return NULL;
+    if ( ( fstat( fd, &st ) != 0 ) || ( st.st_size < (off_t) sizeof( c2b_header_t ) ) ) {
+        close( fd );
+        return NULL;
+    }
+    if ( ! ( f = (c2b_file_t *) calloc( 1, sizeof( c2b_file_t ) ) ) ) {
+        close( fd );
+        return NULL;
+    }
+    f->size = st.st_size;
+    f->map  = (unsigned char *) mmap( NULL, f->size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( f->map == (unsigned char *) MAP_FAILED ) {
+        free( f );
+        return NULL;
+    }
+
+    hdr = f->hdr = (const c2b_header_t *) f->map;
+    if ( memcmp( hdr->magic, C2B_MAGIC, 8 ) || ( hdr->version != C2B_VERSION )
+                                            || ( hdr->size != f->size )
+                                            || ( hdr->names_off != hdr->index_off + hdr->ncontig * sizeof( c2b_entry_t ) )
+                                            || ( hdr->names_off > f->size )
+       ) {
+        fprintf( stderr, "%s is not a 2-bit contig file\n", path );
+        c2b_close( f );
+        return NULL;
+    }
+    f->index = (const c2b_entry_t *) ( f->map + hdr->index_off );
+    f->names = (const char *) f->map + hdr->names_off;
+
+    return f;
+}
+
+
+void c2b_close( c2b_file_t *f ) {
+    if ( ! f ) return;
+    if ( f->map ) munmap( f->map, f->size );
+    free( f );
+}
+
+
+uint64_t c2b_ncontig( c2b_file_t *f ) {
+    return f ? f->hdr->ncontig : 0;
+}
+
+
+const char *c2b_name( c2b_file_t *f, uint64_t i, size_t *len, uint64_t *nbase ) {
+    if ( ! f || i >= f->hdr->ncontig ) return NULL;
+    if ( len   ) *len   = f->index[i].name_len;
+    if ( nbase ) *nbase = f->index[i].nbase;
+    return f->names + f->index[i].name_off;
+}
+
+
+int64_t c2b_length( c2b_file_t *f, const char *name ) {
+    const c2b_entry_t *e = find_entry( f, name );
+    return e ? (int64_t) e->nbase : -1;
+}
+
+
+int64_t c2b_get_dna( c2b_file_t *f, const char *name, uint64_t start, uint64_t len,
+                     int strand, char *buf
+                   ) {
+    const c2b_entry_t   *e;
+    const unsigned char *rec, *chr, *packed;
+    const c2b_run_t     *exc, *mask;
+    uint64_t             nexc, nmask, s, end, pos, i, lo, hi, mid, a, b;
+    char                 t;
+
+    if ( ! ( e = find_entry( f, name ) ) ) return -1;
+    if ( start < 1 ) start = 1;
+    if ( start > e->nbase || ! len ) {
+        buf[0] = '\0';
+        return 0;
+    }
+    s   = start - 1;
+    end = ( len > e->nbase - s ) ? e->nbase : s + len;
+
+    rec    = f->map + e->rec_off;
+    nexc   = ( (const uint64_t *) rec )[1];
+    nmask  = ( (const uint64_t *) rec )[2];
+    exc    = (const c2b_run_t *) ( rec + 3 * sizeof( uint64_t ) );
+    chr    = (const unsigned char *) ( exc + nexc );
+    mask   = (const c2b_run_t *) ( chr + PAD8( nexc ) );
+    packed = (const unsigned char *) ( mask + nmask );
+
+    /*  Bases, a byte at a time where the region covers whole bytes  */
+
+    pos = s;
+    i   = 0;
+    while ( ( pos < end ) && ( pos & 3 ) ) {
+        buf[i++] = decode4[ packed[ pos >> 2 ] ][ pos & 3 ];
+        pos++;
+    }
+    while ( pos + 4 <= end ) {
+        memcpy( buf + i, decode4[ packed[ pos >> 2 ] ], 4 );
+        i += 4;
+        pos += 4;
+    }
+    while ( pos < end ) {
+        buf[i++] = decode4[ packed[ pos >> 2 ] ][ pos & 3 ];
+        pos++;
+    }
+    buf[i] = '\0';
+
+    /*  Exceptions and masks that overlap the region.  Runs are sorted,
+     *  and do not overlap, so the first is found by a binary search.
+     */
+
+    lo = 0; hi = nexc;
+    while ( lo < hi ) {
+        mid = ( lo + hi ) / 2;
+        if ( exc[mid].start + exc[mid].len <= s ) lo = mid + 1;
+        else                                      hi = mid;
+    }
+    for ( ; ( lo < nexc ) && ( exc[lo].start < end ); lo++ ) {
+        a = ( exc[lo].start > s ) ? exc[lo].start : s;
+        b = ( exc[lo].start + exc[lo].len < end ) ? exc[lo].start + exc[lo].len : end;
+        memset( buf + ( a - s ), chr[lo], b - a );
+    }
+
+    lo = 0; hi = nmask;
+    while ( lo < hi ) {
+        mid = ( lo + hi ) / 2;
+        if ( mask[mid].start + mask[mid].len <= s ) lo = mid + 1;
+        else                                        hi = mid;
+    }
+    for ( ; ( lo < nmask ) && ( mask[lo].start < end ); lo++ ) {
+        a = ( mask[lo].start > s ) ? mask[lo].start : s;
+        b = ( mask[lo].start + mask[lo].len < end ) ? mask[lo].start + mask[lo].len : end;
+        for ( ; a < b; a++ ) buf[ a - s ] |= 0x20;
+    }
+
+    if ( strand == '-' ) {
+        for ( a = 0, b = i; a < b; a++ ) {
+            t = complement[ (unsigned char) buf[a] ];
+            buf[a] = complement[ (unsigned char) buf[--b] ];
+            buf[b] = t;
+        }
+    }
+
+    return (int64_t) i;
+}
+
+
+static const c2b_entry_t *find_entry( c2b_file_t *f, const char *name ) {
+    const c2b_entry_t  *e;
+    uint64_t            lo, hi, mid;
+    size_t              len, n;
+    int                 c;
+
+    if ( ! f ) return NULL;
+    len = strlen( name );
+    lo = 0;
+    hi = f->hdr->ncontig;
+    while ( lo < hi ) {
+        mid = ( lo + hi ) / 2;
+        e = f->index + mid;
+        n = ( e->name_len < len ) ? e->name_len : len;
+        c = memcmp( f->names + e->name_off, name, n );
+        if ( ! c ) c = ( e->name_len < len ) ? -1 : ( e->name_len > len );
+        if ( ! c ) return e;
+        if ( c < 0 ) lo = mid + 1;
+        else         hi = mid;
+    }
+    return NULL;
+}
+
+
+/*============================================================================
+ *  Utilities
+ *==========================================================================*/
+
+/*  Make room for n items of size bytes in *ptr, which holds *max  */
+
+static int grow( void **ptr, size_t *max, size_t n, size_t size ) {
+    size_t  m;
+    void   *p;
+
+    if ( n <= *max ) return 0;
+    m = *max ? 2 * *max : 1024;
+    while ( m < n ) m *= 2;
+    if ( ! ( p = realloc( *ptr, m * size ) ) ) return 1;
+    *ptr = p;
+    *max = m;
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  contig_2bit.h
+ *
+ *  A 2-bit packed file of the contigs of a genome, in the spirit of the
+ *  UCSC .2bit format, for random access to contig sequence.  Each base is
+ *  packed in 2 bits (T = 0, C = 1, A = 2, G = 3, first base in the high
+ *  bits of a byte).  Anything else (N and the other IUPAC codes, or any
+ *  character that is not white space) is packed as T, and recorded in a
+ *  list of exception runs with its upper case character.  Lower case
+ *  (soft masked) stretches are recorded in a list of mask runs.  So the
+ *  sequence read back is exactly the sequence in the contig file.
+ *
+ *  All integers are little endian.  The file layout is:
+ *
+ *      header          c2b_header_t
+ *      records         one per contig, each 8 byte aligned:
+ *                          uint64  nbase
+ *                          uint64  nexc
+ *                          uint64  nmask
+ *                          nexc  x { uint64 start, uint64 len }   (0 based)
+ *                          nexc  characters, padded to 8 bytes
+ *                          nmask x { uint64 start, uint64 len }
+ *                          ( nbase + 3 ) / 4 bytes of packed bases
+ *      index           ncontig c2b_entry_t, sorted by name
+ *      names           the contig names, without separators
+ *
+ *  index_contig_files -2 writes these files, and Contig2Bit.pm reads them.
+ */
+
+#ifndef CONTIG_2BIT_H
+#define CONTIG_2BIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define  C2B_MAGIC    "FIG2BIT1"
+#define  C2B_VERSION  1
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  reserved;
+    uint64_t  ncontig;
+    uint64_t  index_off;
+    uint64_t  names_off;
+    uint64_t  size;         /*  of the whole file  */
+} c2b_header_t;
+
+typedef struct {
+    uint64_t  name_off;     /*  in the names section  */
+    uint64_t  name_len;
+    uint64_t  rec_off;      /*  in the file  */
+    uint64_t  nbase;
+} c2b_entry_t;
+
+typedef struct {
+    uint64_t  start;
+    uint64_t  len;
+} c2b_run_t;
+
+/*  A contig being packed  */
+
+typedef struct {
+    uint64_t        nbase;
+    unsigned char  *packed;
+    size_t          packed_size;
+    c2b_run_t      *exc;
+    unsigned char  *exc_chr;
+    size_t          nexc;
+    size_t          maxexc;
+    c2b_run_t      *mask;
+    size_t          nmask;
+    size_t          maxmask;
+} c2b_contig_t;
+
+typedef struct c2b_writer c2b_writer_t;
+typedef struct c2b_file   c2b_file_t;
+
+/*  Packing.  c2b_contig_add() takes characters of the sequence, without
+ *  white space; c2b_record_size() and c2b_record() give the contig as a
+ *  record of the file.  Functions that allocate return nonzero when out
+ *  of memory.
+ */
+
+void    c2b_contig_init( c2b_contig_t *c );
+void    c2b_contig_reset( c2b_contig_t *c );
+void    c2b_contig_free( c2b_contig_t *c );
+int     c2b_contig_add( c2b_contig_t *c, const unsigned char *p, size_t n );
+size_t  c2b_record_size( const c2b_contig_t *c );
+void    c2b_record( const c2b_contig_t *c, unsigned char *rec );
+
+/*  Writing a file from records.  The file is written under a temporary
+ *  name, and renamed to path by c2b_writer_finish(), which returns 0 on
+ *  success, and frees the writer.  Only the first record of a name is
+ *  indexed.
+ */
+
+c2b_writer_t *c2b_writer( const char *path );
+int     c2b_write_record( c2b_writer_t *w, const char *name, size_t name_len,
+                          const unsigned char *rec, size_t len );
+int     c2b_writer_finish( c2b_writer_t *w );
+void    c2b_writer_abort( c2b_writer_t *w );
+
+/*  Reading.  c2b_name() gives the name (not NUL terminated), and length,
+ *  of contig i in order of name.  Positions are 1 based.  c2b_get_dna() writes up to len bases
+ *  of the contig from start (fewer at the end of the contig) to buf, which
+ *  must hold len + 1 characters, followed by a NUL.  With strand '-', the
+ *  bases are reverse complemented.  It returns the number of bases, or -1
+ *  if there is no such contig.
+ */
+
+c2b_file_t *c2b_open( const char *path );
+void        c2b_close( c2b_file_t *f );
+uint64_t    c2b_ncontig( c2b_file_t *f );
+const char *c2b_name( c2b_file_t *f, uint64_t i, size_t *len, uint64_t *nbase );
+int64_t     c2b_length( c2b_file_t *f, const char *name );
+int64_t     c2b_get_dna( c2b_file_t *f, const char *name, uint64_t start, uint64_t len,
+                         int strand, char *buf );
+
+#endif
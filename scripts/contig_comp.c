@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  contig_comp.c
+ *
+ *  Windowed base composition files of the contigs of a genome; see
+ *  contig_comp.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "contig_comp.h"
+
+#define  PAD8( n )  ( ( (size_t) (n) + 7 ) & ~(size_t) 7 )
+
+struct comp_writer {
+    char          *path;
+    char          *tmp;
+    FILE          *fp;
+    uint32_t       window;
+    uint64_t       off;
+    comp_entry_t  *entries;
+    size_t         nentry;
+    size_t         maxentry;
+    char          *names;
+    size_t         names_len;
+    size_t         names_size;
+    int            error;
+};
+
+/*  The count of each character: A C G T N other = 0 .. 5  */
+
+static unsigned char  count_of[256];
+static int            tables_ready = 0;
+
+static void   init_tables( void );
+static int    grow( void **ptr, size_t *max, size_t n, size_t size );
+static int    cmp_entries( const void *a, const void *b );
+static const char *sort_names = NULL;    /*  for cmp_entries()  */
+
+
+static void init_tables( void ) {
+    static const char *bases = "ACGTUN";
+    static const unsigned char  counts[] = { 0, 1, 2, 3, 3, 4 };
+    int  b;
+
+    if ( tables_ready ) return;
+    for ( b = 0; b < 256; b++ ) count_of[b] = 5;
+    for ( b = 0; bases[b]; b++ ) {
+        count_of[ (unsigned char) bases[b] ]        = counts[b];
+        count_of[ (unsigned char) bases[b] | 0x20 ] = counts[b];
+    }
+    tables_ready = 1;
+}
+
+
+/*============================================================================
+ *  Counting
+ *==========================================================================*/
+
+void comp_contig_init( comp_contig_t *c, uint32_t window ) {
+    memset( c, 0, sizeof( *c ) );
+    c->window = window;
+    init_tables();
+}
+
+
+void comp_contig_reset( comp_contig_t *c ) {
+    c->nbase = 0;
+}
+
+
+void comp_contig_free( comp_contig_t *c ) {
+    free( c->counts );
+    c->counts = NULL;
+    c->maxwin = 0;
+    c->nbase  = 0;
+}
+
+
+int comp_contig_add( comp_contig_t *c, const unsigned char *p, size_t n ) {
+    uint16_t  *w;
+    uint64_t   nwin;
+    size_t     k, i, in_win;
+
+    nwin = ( c->nbase + n + c->window - 1 ) / c->window;
+    if ( grow( (void **) &(c->counts), &(c->maxwin), COMP_NCOUNT * nwin, sizeof( uint16_t ) ) ) return 1;
+
+    while ( n ) {
+        in_win = c->nbase % c->window;
+        w = c->counts + COMP_NCOUNT * ( c->nbase / c->window );
+        if ( in_win == 0 ) memset( w, 0, COMP_NCOUNT * sizeof( uint16_t ) );
+        k = c->window - in_win;
+        if ( k > n ) k = n;
+        for ( i = 0; i < k; i++ ) w[ count_of[ p[i] ] ]++;
+        c->nbase += k;
+        p += k;
+        n -= k;
+    }
+    return 0;
+}
+
+
+size_t comp_record_size( const comp_contig_t *c ) {
+    uint64_t  nwin = ( c->nbase + c->window - 1 ) / c->window;
+
+    return 2 * sizeof( uint64_t ) + PAD8( COMP_NCOUNT * sizeof( uint16_t ) * nwin );
+}
+
+
+/*  rec must hold comp_record_size() bytes  */
+
+void comp_record( const comp_contig_t *c, unsigned char *rec ) {
+    uint64_t  v[2];
+
+    memset( rec, 0, comp_record_size( c ) );
+    v[0] = c->nbase;
+    v[1] = ( c->nbase + c->window - 1 ) / c->window;
+    memcpy( rec, v, sizeof( v ) );
+    if ( v[1] ) memcpy( rec + sizeof( v ), c->counts, COMP_NCOUNT * sizeof( uint16_t ) * v[1] );
+}
+
+
+/*============================================================================
+ *  Writing
+ *==========================================================================*/
+
+comp_writer_t *comp_writer( const char *path, uint32_t window ) {
+    comp_writer_t  *w;
+    comp_header_t   hdr;
+
+    if ( ! ( w = (comp_writer_t *) calloc( 1, sizeof( comp_writer_t ) ) ) ) return NULL;
+    if ( ( w->path = strdup( path ) ) && ( w->tmp = (char *) malloc( strlen( path ) + 8 ) ) ) {
+        sprintf( w->tmp, "%s.new", path );
+        w->fp = fopen( w->tmp, "w" );
+    }
+    memset( &hdr, 0, sizeof( hdr ) );
+    if ( ! w->fp || ( fwrite( &hdr, sizeof( hdr ), 1, w->fp ) != 1 ) ) {
+        comp_writer_abort( w );
+        return NULL;
+    }
+    w->window = window;
+    w->off    = sizeof( hdr );
+    return w;
+}
+
+
+int comp_write_record( comp_writer_t *w, const char *name, size_t name_len,
+                       const unsigned char *rec, size_t len
+                     ) {
+    comp_entry_t  *e;
+    uint64_t       nbase;
+
+    if ( ! w || w->error ) return -1;
+
+    if ( grow( (void **) &(w->entries), &(w->maxentry), w->nentry + 1, sizeof( comp_entry_t ) )
+      || grow( (void **) &(w->names), &(w->names_size), w->names_len + name_len, 1 )
+       ) {
+        w->error = 1;
+        return -1;
+    }
+
+    memcpy( &nbase, rec, sizeof( nbase ) );
+    e = w->entries + w->nentry++;
+    e->name_off = w->names_len;
+    e->name_len = name_len;
+    e->rec_off  = w->off;
+    e->nbase    = nbase;
+    memcpy( w->names + w->names_len, name, name_len );
+    w->names_len += name_len;
+
+    if ( fwrite( rec, 1, len, w->fp ) != len ) {
+        w->error = 1;
+        return -1;
+    }
+    while ( len & 7 ) {
+        putc( 0, w->fp );
+        len++;
+    }
+    w->off += len;
+    return 0;
+}
+
+
+int comp_writer_finish( comp_writer_t *w ) {
+    comp_header_t  hdr;
+    size_t         i, n;
+    int            status;
+
+    if ( ! w ) return -1;
+    status = w->error ? -1 : 0;
+
+    if ( ! status ) {
+
+        /*  Sort by name, then by offset, and keep the first of each name  */
+
+        sort_names = w->names;
+        qsort( w->entries, w->nentry, sizeof( comp_entry_t ), cmp_entries );
+        for ( i = n = 0; i < w->nentry; i++ ) {
+            if ( n && ( w->entries[i].name_len == w->entries[n-1].name_len )
+                   && ! memcmp( w->names + w->entries[i].name_off,
+                                w->names + w->entries[n-1].name_off, w->entries[i].name_len )
+               ) continue;
+            w->entries[n++] = w->entries[i];
+        }
+
+        memset( &hdr, 0, sizeof( hdr ) );
+        memcpy( hdr.magic, COMP_MAGIC, 8 );
+        hdr.version   = COMP_VERSION;
+        hdr.window    = w->window;
+        hdr.ncontig   = n;
+        hdr.index_off = w->off;
+        hdr.names_off = hdr.index_off + n * sizeof( comp_entry_t );
+        hdr.size      = hdr.names_off + w->names_len;
+
+        if ( ( fwrite( w->entries, sizeof( comp_entry_t ), n, w->fp ) != n )
+          || ( fwrite( w->names, 1, w->names_len, w->fp ) != w->names_len )
+          || fseeko( w->fp, 0, SEEK_SET )
+          || ( fwrite( &hdr, sizeof( hdr ), 1, w->fp ) != 1 )
+           ) status = -1;
+    }
+
+    if ( fclose( w->fp ) ) status = -1;
+    w->fp = NULL;
+    if ( status || rename( w->tmp, w->path ) ) {
+        unlink( w->tmp );
+        status = -1;
+    }
+
+    comp_writer_abort( w );
+    return status;
+}
+
+
+/*  Free a writer, and remove its temporary file, if it is still open  */
+
+void comp_writer_abort( comp_writer_t *w ) {
+    if ( ! w ) return;
+    if ( w->fp ) {
+        fclose( w->fp );
+        unlink( w->tmp );
+    }
+    free( w->entries );
+    free( w->names );
+    free( w->tmp );
+    free( w->path );
+    free( w );
+}
+
+
+static int cmp_entries( const void *a, const void *b ) {
+    const comp_entry_t *ea = (const comp_entry_t *) a;
+    const comp_entry_t *eb = (const comp_entry_t *) b;
+    size_t              n;
+    int                 c;
+
+    n = ( ea->name_len < eb->name_len ) ? ea->name_len : eb->name_len;
+    if ( ( c = memcmp( sort_names + ea->name_off, sort_names + eb->name_off, n ) ) ) return c;
+    if ( ea->name_len != eb->name_len ) return ( ea->name_len < eb->name_len ) ? -1 : 1;
+    return ( ea->rec_off < eb->rec_off ) ? -1 : ( ea->rec_off > eb->rec_off );
+}
+
+
+/*============================================================================
+ *  Utilities
+ *==========================================================================*/
+
+/*  Make room for n items of size bytes in *ptr, which holds *max  */
+
+static int grow( void **ptr, size_t *max, size_t n, size_t size ) {
+    size_t  m;
+    void   *p;
+
+    if ( n <= *max ) return 0;
+    m = *max ? 2 * *max : 1024;
+    while ( m < n ) m *= 2;
+    if ( ! ( p = realloc( *ptr, m * size ) ) ) return 1;
+    *ptr = p;
+    *max = m;
+    return 0;
+}
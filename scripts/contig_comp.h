@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  contig_comp.h
+ *
+ *  A file of the base composition of the contigs of a genome in fixed
+ *  windows, for GC content, N runs and the like without reading the
+ *  contigs.  For each window of each contig (the last may be short), the
+ *  counts of A, C, G, T (or U), N, and anything else that is not white
+ *  space, in either case, are kept as 16 bit integers, so a window is at
+ *  most 65535 bases.
+ *
+ *  All integers are little endian.  The file layout is:
+ *
+ *      header          comp_header_t
+ *      records         one per contig, each 8 byte aligned:
+ *                          uint64  nbase
+ *                          uint64  nwin       ( nbase + window - 1 ) / window
+ *                          nwin x 6 uint16    A C G T N other, of each window
+ *      index           ncontig comp_entry_t, sorted by name
+ *      names           the contig names, without separators
+ *
+ *  index_contig_files -c writes these files, ContigComposition.pm reads
+ *  them, and load_contig_composition loads them into contig_composition.
+ */
+
+#ifndef CONTIG_COMP_H
+#define CONTIG_COMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define  COMP_MAGIC    "FIGCOMP1"
+#define  COMP_VERSION  1
+#define  COMP_NCOUNT   6
+#define  COMP_MAX_WINDOW  65535
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  window;       /*  bases per window  */
+    uint64_t  ncontig;
+    uint64_t  index_off;
+    uint64_t  names_off;
+    uint64_t  size;         /*  of the whole file  */
+} comp_header_t;
+
+typedef struct {
+    uint64_t  name_off;     /*  in the names section  */
+    uint64_t  name_len;
+    uint64_t  rec_off;      /*  in the file  */
+    uint64_t  nbase;
+} comp_entry_t;
+
+/*  A contig being counted  */
+
+typedef struct {
+    uint32_t   window;
+    uint64_t   nbase;
+    uint16_t  *counts;      /*  COMP_NCOUNT per window  */
+    size_t     maxwin;
+} comp_contig_t;
+
+typedef struct comp_writer comp_writer_t;
+
+/*  Counting.  comp_contig_add() takes characters of the sequence, without
+ *  white space; comp_record_size() and comp_record() give the contig as a
+ *  record of the file.  Functions that allocate return nonzero when out
+ *  of memory.
+ */
+
+void    comp_contig_init( comp_contig_t *c, uint32_t window );
+void    comp_contig_reset( comp_contig_t *c );
+void    comp_contig_free( comp_contig_t *c );
+int     comp_contig_add( comp_contig_t *c, const unsigned char *p, size_t n );
+size_t  comp_record_size( const comp_contig_t *c );
+void    comp_record( const comp_contig_t *c, unsigned char *rec );
+
+/*  Writing a file from records, as for contig_2bit.h.  The file is written
+ *  under a temporary name, and renamed to path by comp_writer_finish(),
+ *  which returns 0 on success, and frees the writer.  Only the first
+ *  record of a name is indexed.
+ */
+
+comp_writer_t *comp_writer( const char *path, uint32_t window );
+int     comp_write_record( comp_writer_t *w, const char *name, size_t name_len,
+                           const unsigned char *rec, size_t len );
+int     comp_writer_finish( comp_writer_t *w );
+void    comp_writer_abort( comp_writer_t *w );
+
+#endif
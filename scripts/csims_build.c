@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  csims_build.c
+ *
+ *  Usage:  csims_build  [ -m megabytes ]  Store  [ LoadFile ... ]
+ *  or      csims_build  -v   (to return version number on standard output)
+ *
+ *  Build a columnar store of condensed sims (see csims_store.h) from rows
+ *  of the condensed_sims table, as written by condense_sims:
+ *
+ *     G1 \t P1 \t G2 \t P2 \t Iden \t Psc \t ParaN \n
+ *
+ *  read from the load files (default standard in).  Lines that do not have
+ *  seven numeric fields are skipped, and counted on standard error.  Up to
+ *  megabytes (default 1024) of rows are sorted in memory, and the rest are
+ *  spilled to temporary files beside the store.  The store replaces any
+ *  existing one only when it is complete.  For example:
+ *
+ *      condense_sims GenomeMap SimsFile ... | csims_build condensed_sims.css
+ *
+ *  Compile with:  cc -O csims_build.c csims_store.c -o csims_build
+ */
+
+#define  VERSION  "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csims_store.h"
+
+#define  LINELEN  ( 64*1024)    /* longest line read */
+
+int   read_rows( FILE *fp, css_builder_t *b, long *nbad );
+int   parse_row( char *line, css_row_t *row );
+void  usage( char *prog );
+
+
+int main( int argc, char **argv ) {
+    css_builder_t *b;
+    FILE          *fp;
+    long           nbad, mb;
+    int            i, status;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    mb = 1024;
+    while ( ( argc >= 3 ) && ( argv[1][0] == '-' ) ) {
+        if ( strcmp( argv[1], "-m" ) == 0 ) {
+            if ( ( mb = atol( argv[2] ) ) < 1 ) usage( argv[0] );
+        }
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( argc < 2 ) usage( argv[0] );
+
+    if ( ! ( b = css_builder( argv[1], (size_t) mb << 20 ) ) ) {
+        fprintf( stderr, "csims_build: out of memory\n" );
+        return 1;
+    }
+
+    status = 0;
+    nbad   = 0;
+    if ( argc == 2 ) {
+        status = read_rows( stdin, b, &nbad );
+    }
+    else {
+        for ( i = 2; i < argc && ! status; i++ ) {
+            if ( ! ( fp = fopen( argv[i], "r" ) ) ) {
+                fprintf( stderr, "csims_build: could not open %s\n", argv[i] );
+                status = 1;
+                break;
+            }
+            status = read_rows( fp, b, &nbad );
+            fclose( fp );
+        }
+    }
+
+    if ( nbad ) fprintf( stderr, "csims_build: skipped %ld lines that are not condensed sims\n", nbad );
+
+    if ( status ) {
+        css_finish( b );    /*  fails, and leaves any old store  */
+        fprintf( stderr, "csims_build: failed reading rows\n" );
+        return 1;
+    }
+    if ( css_finish( b ) ) {
+        fprintf( stderr, "csims_build: could not write %s\n", argv[1] );
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int read_rows( FILE *fp, css_builder_t *b, long *nbad ) {
+    static char  line[LINELEN];
+    css_row_t    row;
+
+    while ( fgets( line, LINELEN, fp ) ) {
+        if ( ! parse_row( line, &row ) ) {
+            ( *nbad )++;
+            continue;
+        }
+        if ( css_add( b, &row ) ) return 1;
+    }
+    return ferror( fp ) ? 1 : 0;
+}
+
+
+/*  Fields are separated by tabs; anything after ParaN is ignored  */
+
+int parse_row( char *line, css_row_t *row ) {
+    char  *p, *end;
+    long   v[4];
+    int    i;
+
+    p = line;
+    for ( i = 0; i < 4; i++ ) {
+        v[i] = strtol( p, &end, 10 );
+        if ( ( end == p ) || ( *end != '\t' ) ) return 0;
+        p = end + 1;
+    }
+    row->g1 = (int32_t) v[0];
+    row->p1 = (int32_t) v[1];
+    row->g2 = (int32_t) v[2];
+    row->p2 = (int32_t) v[3];
+
+    row->iden = (float) strtod( p, &end );
+    if ( ( end == p ) || ( *end != '\t' ) ) return 0;
+    p = end + 1;
+
+    row->psc = strtod( p, &end );
+    if ( ( end == p ) || ( *end != '\t' ) ) return 0;
+    p = end + 1;
+
+    row->paraN = (int32_t) strtol( p, &end, 10 );
+    if ( ( end == p ) || ( *end && ( *end != '\t' ) && ( *end != '\n' ) && ( *end != '\r' ) ) ) return 0;
+
+    return 1;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ -m megabytes ]  Store  [ LoadFile ... ]\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog
+           );
+    exit( 0 );
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  csims_query.c
+ *
+ *  Usage:  csims_query  [ -g G2 | -g G2min-G2max ]  [ -i min_iden ]  [ -p max_psc ]  [ -c ]  Store  [ G1 ... ]
+ *  or      csims_query  -v   (to return version number on standard output)
+ *
+ *  Write the rows of a condensed sims store (see csims_store.h) with g1 in
+ *  the genome numbers given (default all), that pass the filters:
+ *
+ *     -g G2          g2 is G2, or in the range G2min to G2max
+ *     -i min_iden    iden >= min_iden
+ *     -p max_psc     psc <= max_psc
+ *
+ *  as rows of the condensed_sims table:
+ *
+ *     G1 \t P1 \t G2 \t P2 \t Iden \t Psc \t ParaN \n
+ *
+ *  in order of G1 (as given), G2, P1 and P2.  With -c, write only the number
+ *  of rows that pass.  The hits between two genomes are:
+ *
+ *      csims_query -g G2 Store G1
+ *
+ *  Compile with:  cc -O csims_query.c csims_store.c -o csims_query
+ */
+
+#define  VERSION  "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "csims_store.h"
+
+int   print_row( const css_row_t *row, void *arg );
+void  usage( char *prog );
+
+
+int main( int argc, char **argv ) {
+    css_filter_t  filter = CSS_ALL;
+    css_store_t  *css;
+    uint64_t      n;
+    char         *end;
+    int           count, i;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    count = 0;
+    while ( ( argc >= 2 ) && ( argv[1][0] == '-' ) ) {
+        if ( strcmp( argv[1], "-c" ) == 0 ) {
+            count = 1;
+            argc--;
+            argv++;
+            continue;
+        }
+        if ( argc < 3 ) usage( argv[0] );
+        if ( strcmp( argv[1], "-g" ) == 0 ) {
+            filter.g2_min = filter.g2_max = (int32_t) strtol( argv[2], &end, 10 );
+            if ( *end == '-' ) filter.g2_max = (int32_t) strtol( end + 1, &end, 10 );
+            if ( *end || ( filter.g2_max < filter.g2_min ) ) usage( argv[0] );
+        }
+        else if ( strcmp( argv[1], "-i" ) == 0 ) {
+            filter.min_iden = (float) strtod( argv[2], &end );
+            if ( *end ) usage( argv[0] );
+        }
+        else if ( strcmp( argv[1], "-p" ) == 0 ) {
+            filter.max_psc = strtod( argv[2], &end );
+            if ( *end ) usage( argv[0] );
+        }
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( argc < 2 ) usage( argv[0] );
+
+    if ( ! ( css = css_open( argv[1] ) ) ) {
+        fprintf( stderr, "csims_query: could not open store %s\n", argv[1] );
+        return 1;
+    }
+
+    n = 0;
+    if ( argc == 2 ) {
+        n = count ? css_count( css, -1, &filter ) : css_scan( css, -1, &filter, print_row, stdout );
+    }
+    for ( i = 2; i < argc; i++ ) {
+        n += count ? css_count( css, atoi( argv[i] ), &filter )
+                   : css_scan( css, atoi( argv[i] ), &filter, print_row, stdout );
+    }
+    if ( count ) printf( "%llu\n", (unsigned long long) n );
+
+    css_close( css );
+    if ( fflush( stdout ) || ferror( stdout ) ) {
+        fprintf( stderr, "csims_query: error writing output\n" );
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int print_row( const css_row_t *row, void *arg ) {
+    fprintf( (FILE *) arg, "%d\t%d\t%d\t%d\t%g\t%g\t%d\n",
+             row->g1, row->p1, row->g2, row->p2, row->iden, row->psc, row->paraN
+           );
+    return 0;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ -g G2 | -g G2min-G2max ]  [ -i min_iden ]  [ -p max_psc ]  [ -c ]  Store  [ G1 ... ]\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog
+           );
+    exit( 0 );
+}
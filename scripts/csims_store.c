@@ -0,0 +1,647 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  csims_store.c
+ *
+ *  Reader and builder for the columnar condensed sims store described in
+ *  csims_store.h.  There is no main(); link with the program:
+ *
+ *      cc -O csims_query.c csims_store.c -o csims_query
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if ! defined( NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) )
+#  define  USE_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+#include "csims_store.h"
+
+/*  Rows beyond the memory limit are spilled to this many buckets, by g1  */
+
+#define  NBUCKET  64
+
+struct css_store {
+    unsigned char       *map;
+    size_t               size;
+    const css_header_t  *hdr;
+    const css_zone_t    *zones;
+    const css_part_t    *parts;
+};
+
+struct css_builder {
+    char        *path;
+    size_t       memlimit;
+    css_row_t   *rows;
+    size_t       nrow;
+    size_t       maxrow;
+    FILE        *bucket[NBUCKET];
+    int          spilled;
+
+    /*  The store being written  */
+
+    FILE        *out;
+    char        *tmp;
+    uint64_t     total;
+    css_zone_t  *zones;
+    uint64_t     nblock;
+    uint64_t     maxblock;
+    css_part_t  *parts;
+    uint64_t     npart;
+    uint64_t     maxpart;
+    unsigned char *block;
+    int          error;
+};
+
+/*  The columns of a block  */
+
+typedef struct {
+    const double   *psc;
+    const int32_t  *g2;
+    const int32_t  *p1;
+    const int32_t  *p2;
+    const float    *iden;
+    const int32_t  *paraN;
+} css_cols_t;
+
+static void   block_cols( const unsigned char *blk, css_cols_t *c );
+static const css_part_t *find_part( css_store_t *css, int32_t g1 );
+static int    zone_test( const css_zone_t *z, const css_filter_t *f );
+static unsigned pass_mask( const css_cols_t *c, int i, const css_filter_t *f, int tests );
+static int    bit_count( unsigned m );
+static int    cmp_rows( const void *a, const void *b );
+static int    spill_rows( css_builder_t *b );
+static int    write_rows( css_builder_t *b, css_row_t *rows, size_t n );
+static int    write_block( css_builder_t *b, const css_row_t *rows, int n );
+static int    cmp_parts( const void *a, const void *b );
+static FILE  *temp_file( const char *path );
+
+/*  Which columns a filter tests (see zone_test)  */
+
+#define  TEST_G2    1
+#define  TEST_IDEN  2
+#define  TEST_PSC   4
+
+
+/*============================================================================
+ *  Reading
+ *==========================================================================*/
+
+css_store_t *css_open( const char *path ) {
+    css_store_t        *css;
+    const css_header_t *hdr;
+    struct stat         st;
+    int                 fd;
+
+    if ( ( fd = open( path, O_RDONLY, 0 ) ) < 0 ) return NULL;
+    if ( ( fstat( fd, &st ) != 0 ) || ( st.st_size < (off_t) sizeof( css_header_t ) ) ) {
+        close( fd );
+        return NULL;
+    }
+    if ( ! ( css = (css_store_t *) calloc( 1, sizeof( css_store_t ) ) ) ) {
+        close( fd );
+        return NULL;
+    }
+    css->size = st.st_size;
+    css->map  = (unsigned char *) mmap( NULL, css->size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( css->map == (unsigned char *) MAP_FAILED ) {
+        free( css );
+        return NULL;
+    }
+
+    hdr = css->hdr = (const css_header_t *) css->map;
+    if ( memcmp( hdr->magic, CSS_MAGIC, 8 ) || ( hdr->version != CSS_VERSION )
+                                            || ( hdr->block != CSS_BLOCK )
+                                            || ( hdr->zone_off < sizeof( css_header_t ) + hdr->nblock * CSS_BLOCK_BYTES )
+                                            || ( hdr->part_off < hdr->zone_off + hdr->nblock * sizeof( css_zone_t ) )
+                                            || ( hdr->part_off + hdr->npart * sizeof( css_part_t ) > css->size )
+       ) {
+        fprintf( stderr, "%s is not a condensed sims store\n", path );
+        css_close( css );
+        return NULL;
+    }
+
+    css->zones = (const css_zone_t *) ( css->map + hdr->zone_off );
+    css->parts = (const css_part_t *) ( css->map + hdr->part_off );
+
+    return css;
+}
+
+
+void css_close( css_store_t *css ) {
+    if ( ! css ) return;
+    if ( css->map ) munmap( css->map, css->size );
+    free( css );
+}
+
+
+uint64_t css_nrow( css_store_t *css ) {
+    return css ? css->hdr->nrow : 0;
+}
+
+
+const css_part_t *css_parts( css_store_t *css, uint64_t *npart ) {
+    if ( npart ) *npart = css ? css->hdr->npart : 0;
+    return css ? css->parts : NULL;
+}
+
+
+uint64_t css_scan( css_store_t *css, int32_t g1, const css_filter_t *filter,
+                   int (* fn)( const css_row_t *row, void *arg ), void *arg
+                 ) {
+    static const css_filter_t  all = CSS_ALL;
+    const css_part_t  *part, *last;
+    const css_zone_t  *z;
+    css_cols_t         c;
+    css_row_t          row;
+    uint64_t           b, n;
+    unsigned           m;
+    int                tests, i, j;
+
+    if ( ! css ) return 0;
+    if ( ! filter ) filter = &all;
+
+    if ( g1 >= 0 ) {
+        if ( ! ( part = find_part( css, g1 ) ) ) return 0;
+        last = part + 1;
+    }
+    else {
+        part = css->parts;
+        last = part + css->hdr->npart;
+    }
+
+    n = 0;
+    for ( ; part < last; part++ ) {
+        row.g1 = part->g1;
+        for ( b = part->first_block; b < part->first_block + part->nblock; b++ ) {
+            z = css->zones + b;
+            if ( ( tests = zone_test( z, filter ) ) < 0 ) continue;
+            block_cols( css->map + sizeof( css_header_t ) + b * CSS_BLOCK_BYTES, &c );
+            for ( i = 0; i < z->nrow; i += 4 ) {
+                m = tests ? pass_mask( &c, i, filter, tests ) : 0xF;
+                if ( z->nrow - i < 4 ) m &= ( 1u << ( z->nrow - i ) ) - 1;
+                for ( j = i; m; j++, m >>= 1 ) {
+                    if ( ! ( m & 1 ) ) continue;
+                    row.p1    = c.p1[j];
+                    row.g2    = c.g2[j];
+                    row.p2    = c.p2[j];
+                    row.iden  = c.iden[j];
+                    row.psc   = c.psc[j];
+                    row.paraN = c.paraN[j];
+                    n++;
+                    if ( fn && fn( &row, arg ) ) return n;
+                }
+            }
+        }
+    }
+
+    return n;
+}
+
+
+uint64_t css_count( css_store_t *css, int32_t g1, const css_filter_t *filter ) {
+    static const css_filter_t  all = CSS_ALL;
+    const css_part_t  *part, *last;
+    const css_zone_t  *z;
+    css_cols_t         c;
+    uint64_t           b, n;
+    unsigned           m;
+    int                tests, i;
+
+    if ( ! css ) return 0;
+    if ( ! filter ) filter = &all;
+
+    if ( g1 >= 0 ) {
+        if ( ! ( part = find_part( css, g1 ) ) ) return 0;
+        last = part + 1;
+    }
+    else {
+        part = css->parts;
+        last = part + css->hdr->npart;
+    }
+
+    n = 0;
+    for ( ; part < last; part++ ) {
+        for ( b = part->first_block; b < part->first_block + part->nblock; b++ ) {
+            z = css->zones + b;
+            if ( ( tests = zone_test( z, filter ) ) < 0 ) continue;
+            if ( ! tests ) {                /*  the whole block passes  */
+                n += z->nrow;
+                continue;
+            }
+            block_cols( css->map + sizeof( css_header_t ) + b * CSS_BLOCK_BYTES, &c );
+            for ( i = 0; i < z->nrow; i += 4 ) {
+                m = pass_mask( &c, i, filter, tests );
+                if ( z->nrow - i < 4 ) m &= ( 1u << ( z->nrow - i ) ) - 1;
+                n += bit_count( m );
+            }
+        }
+    }
+
+    return n;
+}
+
+
+static void block_cols( const unsigned char *blk, css_cols_t *c ) {
+    c->psc   = (const double *)  blk;
+    c->g2    = (const int32_t *) ( blk +  8 * CSS_BLOCK );
+    c->p1    = (const int32_t *) ( blk + 12 * CSS_BLOCK );
+    c->p2    = (const int32_t *) ( blk + 16 * CSS_BLOCK );
+    c->iden  = (const float *)   ( blk + 20 * CSS_BLOCK );
+    c->paraN = (const int32_t *) ( blk + 24 * CSS_BLOCK );
+}
+
+
+static const css_part_t *find_part( css_store_t *css, int32_t g1 ) {
+    uint64_t  lo = 0, hi = css->hdr->npart, mid;
+
+    while ( lo < hi ) {
+        mid = ( lo + hi ) / 2;
+        if ( css->parts[mid].g1 < g1 ) lo = mid + 1;
+        else                           hi = mid;
+    }
+    return ( lo < css->hdr->npart && css->parts[lo].g1 == g1 ) ? css->parts + lo : NULL;
+}
+
+
+/*  Compare a filter to the zone map of a block.  Returns -1 if no row of
+ *  the block can pass, or else the columns that must be tested (0 if every
+ *  row passes).
+ */
+
+static int zone_test( const css_zone_t *z, const css_filter_t *f ) {
+    int tests = 0;
+
+    if ( ( z->max_g2 < f->g2_min ) || ( z->min_g2 > f->g2_max )
+      || ( z->max_iden < f->min_iden )
+      || ( z->min_psc > f->max_psc )
+       ) return -1;
+
+    if ( ( z->min_g2 < f->g2_min ) || ( z->max_g2 > f->g2_max ) ) tests |= TEST_G2;
+    if ( ! ( z->min_iden >= f->min_iden ) ) tests |= TEST_IDEN;
+    if ( ! ( z->max_psc  <= f->max_psc  ) ) tests |= TEST_PSC;
+    return tests;
+}
+
+
+/*  The rows i .. i+3 that pass the tests, as bits 0 .. 3.  The columns are
+ *  allocated to a whole block, so the loads never run past them.
+ */
+
+#ifdef USE_SSE2
+
+static unsigned pass_mask( const css_cols_t *c, int i, const css_filter_t *f, int tests ) {
+    unsigned  m = 0xF;
+
+    if ( tests & TEST_G2 ) {
+        __m128i g = _mm_loadu_si128( (const __m128i *) ( c->g2 + i ) );
+        __m128i out = _mm_or_si128( _mm_cmplt_epi32( g, _mm_set1_epi32( f->g2_min ) ),
+                                    _mm_cmpgt_epi32( g, _mm_set1_epi32( f->g2_max ) ) );
+        m &= ~ (unsigned) _mm_movemask_ps( _mm_castsi128_ps( out ) );
+    }
+    if ( tests & TEST_IDEN ) {
+        m &= _mm_movemask_ps( _mm_cmpge_ps( _mm_loadu_ps( c->iden + i ), _mm_set1_ps( f->min_iden ) ) );
+    }
+    if ( tests & TEST_PSC ) {
+        __m128d max = _mm_set1_pd( f->max_psc );
+        m &= _mm_movemask_pd( _mm_cmple_pd( _mm_loadu_pd( c->psc + i     ), max ) )
+           | _mm_movemask_pd( _mm_cmple_pd( _mm_loadu_pd( c->psc + i + 2 ), max ) ) << 2;
+    }
+    return m & 0xF;
+}
+
+#else
+
+static unsigned pass_mask( const css_cols_t *c, int i, const css_filter_t *f, int tests ) {
+    unsigned  m = 0;
+    int       j;
+
+    for ( j = 3; j >= 0; j-- ) {
+        m <<= 1;
+        if ( ( tests & TEST_G2 ) && ( ( c->g2[i+j] < f->g2_min ) || ( c->g2[i+j] > f->g2_max ) ) ) continue;
+        if ( ( tests & TEST_IDEN ) && ! ( c->iden[i+j] >= f->min_iden ) ) continue;
+        if ( ( tests & TEST_PSC  ) && ! ( c->psc[i+j]  <= f->max_psc  ) ) continue;
+        m |= 1;
+    }
+    return m;
+}
+
+#endif
+
+
+static int bit_count( unsigned m ) {
+    int n = 0;
+
+    for ( ; m; m &= m - 1 ) n++;
+    return n;
+}
+
+
+/*============================================================================
+ *  Building
+ *==========================================================================*/
+
+css_builder_t *css_builder( const char *path, size_t memlimit ) {
+    css_builder_t *b;
+
+    if ( ! ( b = (css_builder_t *) calloc( 1, sizeof( css_builder_t ) ) ) ) return NULL;
+    if ( ! ( b->path = strdup( path ) ) ) {
+        free( b );
+        return NULL;
+    }
+    b->memlimit = memlimit ? memlimit : (size_t) 1 << 30;
+    return b;
+}
+
+
+int css_add( css_builder_t *b, const css_row_t *row ) {
+    if ( ! b || b->error ) return -1;
+
+    if ( b->nrow >= b->maxrow ) {
+        if ( b->nrow && ( ( b->nrow + 1 ) * sizeof( css_row_t ) > b->memlimit ) ) {
+            if ( spill_rows( b ) ) return -1;
+        }
+        if ( b->nrow >= b->maxrow ) {
+            b->maxrow = b->maxrow ? 2 * b->maxrow : 65536;
+            if ( ! ( b->rows = (css_row_t *) realloc( b->rows, b->maxrow * sizeof( css_row_t ) ) ) ) {
+                b->error = 1;
+                return -1;
+            }
+        }
+    }
+
+    b->rows[ b->nrow++ ] = *row;
+    return 0;
+}
+
+
+/*  Write the blocks, as each group of rows is sorted, then the zone maps
+ *  and partitions, and finally the header.  The store is written under a
+ *  temporary name and renamed, so readers of an old store are not
+ *  disturbed.
+ */
+
+int css_finish( css_builder_t *b ) {
+    css_header_t  hdr;
+    struct stat   st;
+    size_t        n;
+    int           status, i;
+
+    if ( ! b ) return -1;
+    status = b->error ? -1 : 0;
+
+    if ( ! status && b->spilled && b->nrow && spill_rows( b ) ) status = -1;
+
+    if ( ! status ) {
+        b->tmp   = (char *) malloc( strlen( b->path ) + 8 );
+        b->block = (unsigned char *) malloc( CSS_BLOCK_BYTES );
+        if ( b->tmp && b->block ) {
+            sprintf( b->tmp, "%s.new", b->path );
+            b->out = fopen( b->tmp, "w" );
+        }
+        if ( ! b->out ) status = -1;
+    }
+
+    if ( ! status ) {
+        memset( &hdr, 0, sizeof( hdr ) );
+        if ( fwrite( &hdr, sizeof( hdr ), 1, b->out ) != 1 ) status = -1;
+    }
+
+    if ( ! status ) {
+        if ( b->spilled ) {
+            for ( i = 0; i < NBUCKET && ! status; i++ ) {
+                if ( ! b->bucket[i] ) continue;
+                rewind( b->bucket[i] );
+                if ( fstat( fileno( b->bucket[i] ), &st ) ) { status = -1; break; }
+                n = st.st_size / sizeof( css_row_t );
+                if ( n > b->maxrow ) {
+                    free( b->rows );
+                    if ( ! ( b->rows = (css_row_t *) malloc( n * sizeof( css_row_t ) ) ) ) { status = -1; break; }
+                    b->maxrow = n;
+                }
+                if ( fread( b->rows, sizeof( css_row_t ), n, b->bucket[i] ) != n ) { status = -1; break; }
+                fclose( b->bucket[i] );
+                b->bucket[i] = NULL;
+                if ( write_rows( b, b->rows, n ) ) status = -1;
+            }
+        }
+        else if ( write_rows( b, b->rows, b->nrow ) ) {
+            status = -1;
+        }
+    }
+
+    if ( ! status ) {
+        qsort( b->parts, b->npart, sizeof( css_part_t ), cmp_parts );
+
+        memcpy( hdr.magic, CSS_MAGIC, 8 );
+        hdr.version  = CSS_VERSION;
+        hdr.block    = CSS_BLOCK;
+        hdr.nrow     = b->total;
+        hdr.nblock   = b->nblock;
+        hdr.npart    = b->npart;
+        hdr.zone_off = sizeof( hdr ) + b->nblock * CSS_BLOCK_BYTES;
+        hdr.part_off = hdr.zone_off + b->nblock * sizeof( css_zone_t );
+
+        if ( ( fwrite( b->zones, sizeof( css_zone_t ), b->nblock, b->out ) != b->nblock )
+          || ( fwrite( b->parts, sizeof( css_part_t ), b->npart,  b->out ) != b->npart  )
+          || fseeko( b->out, 0, SEEK_SET )
+          || ( fwrite( &hdr, sizeof( hdr ), 1, b->out ) != 1 )
+           ) status = -1;
+    }
+
+    if ( b->out ) {
+        if ( fclose( b->out ) ) status = -1;
+        if ( status || rename( b->tmp, b->path ) ) {
+            unlink( b->tmp );
+            status = -1;
+        }
+    }
+
+    for ( i = 0; i < NBUCKET; i++ ) if ( b->bucket[i] ) fclose( b->bucket[i] );
+    free( b->rows );
+    free( b->zones );
+    free( b->parts );
+    free( b->block );
+    free( b->tmp );
+    free( b->path );
+    free( b );
+    return status;
+}
+
+
+static int cmp_rows( const void *a, const void *b ) {
+    const css_row_t *ra = (const css_row_t *) a;
+    const css_row_t *rb = (const css_row_t *) b;
+
+    if ( ra->g1  != rb->g1  ) return ( ra->g1  < rb->g1  ) ? -1 : 1;
+    if ( ra->g2  != rb->g2  ) return ( ra->g2  < rb->g2  ) ? -1 : 1;
+    if ( ra->p1  != rb->p1  ) return ( ra->p1  < rb->p1  ) ? -1 : 1;
+    if ( ra->p2  != rb->p2  ) return ( ra->p2  < rb->p2  ) ? -1 : 1;
+    if ( ra->psc != rb->psc ) return ( ra->psc < rb->psc ) ? -1 : 1;
+    if ( ra->iden  != rb->iden  ) return ( ra->iden  > rb->iden  ) ? -1 : 1;
+    if ( ra->paraN != rb->paraN ) return ( ra->paraN < rb->paraN ) ? -1 : 1;
+    return 0;
+}
+
+
+/*  Append the rows in memory to the bucket files.  A g1 is always in the
+ *  same bucket, so each bucket is sorted and written on its own.
+ */
+
+static int spill_rows( css_builder_t *b ) {
+    css_row_t  *row;
+    int         k;
+
+    b->spilled = 1;
+    for ( row = b->rows; row < b->rows + b->nrow; row++ ) {
+        k = (uint32_t) row->g1 % NBUCKET;
+        if ( ! b->bucket[k] && ! ( b->bucket[k] = temp_file( b->path ) ) ) {
+            b->error = 1;
+            return -1;
+        }
+        if ( fwrite( row, sizeof( css_row_t ), 1, b->bucket[k] ) != 1 ) {
+            b->error = 1;
+            return -1;
+        }
+    }
+    for ( k = 0; k < NBUCKET; k++ ) {
+        if ( b->bucket[k] && fflush( b->bucket[k] ) ) {
+            b->error = 1;
+            return -1;
+        }
+    }
+    b->nrow = 0;
+    return 0;
+}
+
+
+/*  Sort rows, and write them as blocks of the partitions  */
+
+static int write_rows( css_builder_t *b, css_row_t *rows, size_t n ) {
+    css_part_t *part;
+    size_t      i, j, k;
+
+    qsort( rows, n, sizeof( css_row_t ), cmp_rows );
+
+    for ( i = 0; i < n; i = j ) {
+        for ( j = i + 1; j < n && rows[j].g1 == rows[i].g1; j++ ) {}
+
+        if ( b->npart >= b->maxpart ) {
+            b->maxpart = b->maxpart ? 2 * b->maxpart : 1024;
+            if ( ! ( b->parts = (css_part_t *) realloc( b->parts, b->maxpart * sizeof( css_part_t ) ) ) ) return -1;
+        }
+        part = b->parts + b->npart++;
+        memset( part, 0, sizeof( *part ) );
+        part->g1          = rows[i].g1;
+        part->first_block = b->nblock;
+        part->nrow        = j - i;
+
+        for ( k = i; k < j; k += CSS_BLOCK ) {
+            if ( write_block( b, rows + k, ( j - k < CSS_BLOCK ) ? (int) ( j - k ) : CSS_BLOCK ) ) return -1;
+        }
+        part->nblock = b->nblock - part->first_block;
+        b->total    += part->nrow;
+    }
+
+    return 0;
+}
+
+
+static int write_block( css_builder_t *b, const css_row_t *rows, int n ) {
+    css_zone_t  *z;
+    double      *psc;
+    int32_t     *g2, *p1, *p2, *paraN;
+    float       *iden;
+    int          i;
+
+    if ( b->nblock >= b->maxblock ) {
+        b->maxblock = b->maxblock ? 2 * b->maxblock : 1024;
+        if ( ! ( b->zones = (css_zone_t *) realloc( b->zones, b->maxblock * sizeof( css_zone_t ) ) ) ) return -1;
+    }
+    z = b->zones + b->nblock++;
+    memset( z, 0, sizeof( *z ) );
+
+    memset( b->block, 0, CSS_BLOCK_BYTES );
+    psc   = (double *)  b->block;
+    g2    = (int32_t *) ( b->block +  8 * CSS_BLOCK );
+    p1    = (int32_t *) ( b->block + 12 * CSS_BLOCK );
+    p2    = (int32_t *) ( b->block + 16 * CSS_BLOCK );
+    iden  = (float *)   ( b->block + 20 * CSS_BLOCK );
+    paraN = (int32_t *) ( b->block + 24 * CSS_BLOCK );
+
+    z->nrow     = n;
+    z->min_g2   = z->max_g2   = rows[0].g2;
+    z->min_iden = z->max_iden = rows[0].iden;
+    z->min_psc  = z->max_psc  = rows[0].psc;
+
+    for ( i = 0; i < n; i++ ) {
+        psc[i]   = rows[i].psc;
+        g2[i]    = rows[i].g2;
+        p1[i]    = rows[i].p1;
+        p2[i]    = rows[i].p2;
+        iden[i]  = rows[i].iden;
+        paraN[i] = rows[i].paraN;
+
+        if ( g2[i]   < z->min_g2   ) z->min_g2   = g2[i];
+        if ( g2[i]   > z->max_g2   ) z->max_g2   = g2[i];
+        if ( iden[i] < z->min_iden ) z->min_iden = iden[i];
+        if ( iden[i] > z->max_iden ) z->max_iden = iden[i];
+        if ( psc[i]  < z->min_psc  ) z->min_psc  = psc[i];
+        if ( psc[i]  > z->max_psc  ) z->max_psc  = psc[i];
+    }
+
+    return ( fwrite( b->block, CSS_BLOCK_BYTES, 1, b->out ) == 1 ) ? 0 : -1;
+}
+
+
+static int cmp_parts( const void *a, const void *b ) {
+    int32_t ga = ( (const css_part_t *) a )->g1;
+    int32_t gb = ( (const css_part_t *) b )->g1;
+    return ( ga < gb ) ? -1 : ( ga > gb );
+}
+
+
+/*============================================================================
+ *  Utilities
+ *==========================================================================*/
+
+/*  An unlinked temporary file in the directory of path  */
+
+static FILE *temp_file( const char *path ) {
+    char   *name;
+    FILE   *fp;
+    int     fd;
+
+    if ( ! ( name = (char *) malloc( strlen( path ) + 16 ) ) ) return NULL;
+    sprintf( name, "%s.tmp.XXXXXX", path );
+    fd = mkstemp( name );
+    if ( fd >= 0 ) unlink( name );
+    free( name );
+    if ( fd < 0 ) return NULL;
+    if ( ! ( fp = fdopen( fd, "w+" ) ) ) close( fd );
+    return fp;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  csims_store.h
+ *
+ *  A memory mapped, columnar store of the rows of the condensed_sims table
+ *  (g1, p1, g2, p2, iden, psc, paraN), for scanning the hits of a genome,
+ *  or between two genomes, without a table scan.
+ *
+ *  The rows are partitioned by g1, and sorted by g2, p1, p2 and psc within
+ *  a partition.  Each partition is stored as blocks of up to CSS_BLOCK rows,
+ *  and each block holds its columns one after another:
+ *
+ *      psc     CSS_BLOCK doubles
+ *      g2      CSS_BLOCK int32
+ *      p1      CSS_BLOCK int32
+ *      p2      CSS_BLOCK int32
+ *      iden    CSS_BLOCK floats
+ *      paraN   CSS_BLOCK int32
+ *
+ *  (unused rows of the last block of a partition are zero).  After the
+ *  blocks come a zone map of each block (the range of g2, iden and psc in
+ *  it), and a table of the partitions, sorted by g1.  Integers are little
+ *  endian, and the file layout is:
+ *
+ *      header          css_header_t
+ *      blocks          nblock blocks of CSS_BLOCK_BYTES
+ *      zone maps       nblock css_zone_t
+ *      partitions      npart css_part_t
+ *
+ *  A scan skips the blocks whose zone map rules out the filter, and tests
+ *  the columns of the rest with vector compares (SSE2, or scalar if
+ *  compiled with -DNO_SIMD).
+ */
+
+#ifndef CSIMS_STORE_H
+#define CSIMS_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define  CSS_MAGIC        "FIGCSS01"
+#define  CSS_VERSION      1
+#define  CSS_BLOCK        4096
+#define  CSS_BLOCK_BYTES  ( CSS_BLOCK * 28 )
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  block;            /*  rows per block  */
+    uint64_t  nrow;
+    uint64_t  nblock;
+    uint64_t  npart;
+    uint64_t  zone_off;         /*  file offsets of the sections  */
+    uint64_t  part_off;
+    uint64_t  reserved;
+} css_header_t;
+
+typedef struct {
+    int32_t   nrow;
+    int32_t   min_g2;
+    int32_t   max_g2;
+    float     min_iden;
+    float     max_iden;
+    int32_t   pad;
+    double    min_psc;
+    double    max_psc;
+} css_zone_t;
+
+typedef struct {
+    int32_t   g1;
+    uint32_t  pad;
+    uint64_t  first_block;
+    uint64_t  nblock;
+    uint64_t  nrow;
+} css_part_t;
+
+typedef struct {
+    int32_t   g1;
+    int32_t   p1;
+    int32_t   g2;
+    int32_t   p2;
+    float     iden;
+    int32_t   paraN;
+    double    psc;
+} css_row_t;
+
+/*  A row passes if g2 is in g2_min .. g2_max, iden >= min_iden, and
+ *  psc <= max_psc.
+ */
+
+typedef struct {
+    int32_t   g2_min;
+    int32_t   g2_max;
+    float     min_iden;
+    double    max_psc;
+} css_filter_t;
+
+#define  CSS_ALL  { INT32_MIN, INT32_MAX, -1.0e30f, 1.0e300 }
+
+typedef struct css_store   css_store_t;
+typedef struct css_builder css_builder_t;
+
+/*  Reading a store  */
+
+css_store_t  *css_open( const char *path );
+void          css_close( css_store_t *css );
+uint64_t      css_nrow( css_store_t *css );
+
+/*  The partition table, in order of g1, and its length in *npart  */
+
+const css_part_t *css_parts( css_store_t *css, uint64_t *npart );
+
+/*  Call fn on each row of partition g1 (or of all partitions, if g1 is
+ *  negative) that passes the filter, in the order stored.  The
+ *  scan stops when fn returns nonzero.  Returns the number of rows passed
+ *  to fn.
+ */
+
+uint64_t      css_scan( css_store_t *css, int32_t g1, const css_filter_t *filter,
+                        int (* fn)( const css_row_t *row, void *arg ), void *arg );
+
+/*  The number of rows that pass, without reading the rows  */
+
+uint64_t      css_count( css_store_t *css, int32_t g1, const css_filter_t *filter );
+
+/*  Building a store.  Rows may be added in any order.  Up to memlimit bytes
+ *  of rows are sorted in memory; beyond that, rows are spilled to temporary
+ *  files beside the store by g1, and each is sorted in turn.  The store is
+ *  written to a temporary file, and renamed to path by css_finish(), which
+ *  returns 0 on success, and frees the builder.
+ */
+
+css_builder_t *css_builder( const char *path, size_t memlimit );
+int            css_add( css_builder_t *b, const css_row_t *row );
+int            css_finish( css_builder_t *b );
+
+#endif
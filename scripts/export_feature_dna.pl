@@ -0,0 +1,168 @@
+# -*- perl -*-
+#
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+# 
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License. 
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+#
+
+
+#
+#  Usage: export_feature_dna [--type type] [--protein] [--fix-start] [--reverse] G1 [G2 ...] > fasta
+#
+#  Write the DNA (or with --protein, the translation) of the features of the
+#  given genomes, as FASTA, in the order of the features table (by genome and
+#  feature number).  --type limits the features to one type, such as peg.
+#  With --fix-start, a translation that starts with L or V (a GTG or TTG start)
+#  starts with M; --reverse gives the reverse complement.
+#
+#  If available, it uses the program extract_features, which reads the
+#  locations of all of the features in one batch, and each region of the
+#  contigs files once, in order, by the contig_seeks and contig_geometry
+#  tables written by index_contigs.  Otherwise each feature is read with
+#  dna_seq.
+#
+
+use strict;
+use FIG;
+use Tracer;
+use Getopt::Long;
+
+my $usage = "Usage: $0 [--type type] [--protein] [--fix-start] [--reverse] G1 [G2 ...] > fasta";
+
+my $type;
+my $protein = 0;
+my $fix_start = 0;
+my $reverse = 0;
+my $help = 0;
+
+my $rc = GetOptions("type=s" => \$type,
+		    "protein" => \$protein,
+		    "fix-start" => \$fix_start,
+		    "reverse" => \$reverse,
+		    "help" => \$help);
+
+$rc or die "$usage\n";
+
+if ($help || ! @ARGV)
+{
+    print "$usage\n";
+    exit( $help ? 0 : 1 );
+}
+
+my $fig = new FIG;
+my $dbf = $fig->db_handle;
+my $temp_dir = $FIG_Config::temp;
+my @genomes = @ARGV;
+
+#
+#  The features, in order:
+#
+
+my @features;
+foreach my $genome ( @genomes )
+{
+    my $sql = "SELECT id, genome, location FROM features WHERE ( genome = ? )";
+    my @args = ( $genome );
+    if ( $type ) {
+	$sql .= " AND ( type = ? )";
+	push @args, $type;
+    }
+    my $rows = $dbf->SQL("$sql ORDER BY idN", undef, @args);
+    push @features, grep { $_->[2] } @$rows;
+}
+Trace(scalar(@features) . " features to export.") if T(2);
+
+#
+#  See if we can find the C program to do the extraction
+#
+
+my $v;
+if (      @features
+     and  open VERSION_PIPE, "extract_features -v |"
+     and  $v = <VERSION_PIPE>
+     and  close VERSION_PIPE
+     and  chomp $v
+     and  $v >= 1
+   ) {
+    my $locfile   = "$temp_dir/export_locs.$$";
+    my $indexfile = "$temp_dir/export_index.$$";
+    my $filelist  = "$temp_dir/export_files.$$";
+
+    open( LOCS, ">$locfile" ) || Confess("Could not open $locfile");
+    print LOCS map { join("\t", @$_) . "\n" } @features;
+    close( LOCS );
+
+    #  The index rows of the genomes, and the files they refer to.
+
+    my %fileno;
+    open( INDEX, ">$indexfile" ) || Confess("Could not open $indexfile");
+    foreach my $genome ( @genomes )
+    {
+	my $seeks = $dbf->SQL("SELECT genome, contig, startN, indexpt, fileno, seek FROM contig_seeks " .
+			      "WHERE ( genome = ? )", undef, $genome);
+	my $geom = eval { $dbf->SQL("SELECT genome, contig, len, fileno, seek, linebases, linewidth " .
+				    "FROM contig_geometry WHERE ( genome = ? )", undef, $genome) } || [];
+	foreach my $row ( @$seeks, @$geom )
+	{
+	    print INDEX join("\t", @$row), "\n";
+	    $fileno{ $row->[ @$row == 6 ? 4 : 3 ] } = 1;
+	}
+    }
+    close( INDEX );
+
+    open( FILES, ">$filelist" ) || Confess("Could not open $filelist");
+    foreach my $n ( sort { $a <=> $b } keys %fileno )
+    {
+	print FILES "$n\t", $fig->N2file( $n ), "\n";
+    }
+    close( FILES );
+
+    my $opts = ( $reverse ? "-r " : "" ) . ( $protein ? "-p " : "" ) . ( $protein && $fix_start ? "-s " : "" );
+    open( SEQS, "extract_features $opts$filelist $indexfile < $locfile |" )
+	|| Confess("Could not run extract_features");
+    while ( defined( $_ = <SEQS> ) )
+    {
+	chomp;
+	my ( $id, $seq ) = split /\t/;
+	print_fasta( $id, $seq );
+    }
+    close( SEQS ) || Confess("extract_features failed");
+    unlink( $locfile, $indexfile, $filelist );
+}
+
+#
+#  We could not use extract_features, so read each feature:
+#
+
+else
+{
+    foreach my $feature ( @features )
+    {
+	my ( $id, $genome, $loc ) = @$feature;
+	my $seq = $fig->dna_seq( $genome, split( /,/, $loc ) );
+	$seq = $fig->reverse_comp( $seq ) if $reverse;
+	$seq = FIG::translate( $seq, undef, $fix_start ) if $protein;
+	print_fasta( $id, $seq );
+    }
+}
+
+
+sub print_fasta {
+    my ( $id, $seq ) = @_;
+    print ">$id\n";
+    for ( my $i = 0; $i < length( $seq ); $i += 60 )
+    {
+	print substr( $seq, $i, 60 ), "\n";
+    }
+}
@@ -0,0 +1,868 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  extract_features.c
+ *
+ *  Usage:  extract_features  [ -r ] [ -p [ -s ] ]  file_list  ContigIndex  < Locations  > Sequences
+ *  or      extract_features  -v   (to return version number on standard output)
+ *
+ *  Write the sequences of a batch of features, read from the contigs files
+ *  by the seeks of index_contig_files.  Each line of standard in is:
+ *
+ *     Id \t Genome \t Location \n
+ *
+ *  where Location is a SEED location, Contig_Beg_End[,Contig_Beg_End...]
+ *  (1 based; Beg > End is on the minus strand).  A sequence is written for
+ *  each, in input order, as:
+ *
+ *     Id \t Sequence \n
+ *
+ *  with the segments joined, and those on the minus strand reverse
+ *  complemented.  With -r the sequence is reverse complemented, and with
+ *  -p it is translated with the standard genetic code (with -s, a first
+ *  codon read as L or V is given as M).  A segment that runs off the end
+ *  of its contig is cut short; one on a contig that is not indexed is
+ *  empty, and reported on standard error.
+ *
+ *  ContigIndex has the rows of the contig_seeks and contig_geometry
+ *  tables, in any order, as written by index_contig_files -g:
+ *
+ *     Genome \t Contig \t StartN \t IndexPt \t FileNumber \t Seek \n
+ *     Genome \t Contig \t Length \t FileNumber \t Offset \t LineBases \t LineWidth \n
+ *
+ *  Other lines are skipped, but the length records of index_contig_files
+ *  output end the rows of a contig, so that, as in index_contigs, only the
+ *  first of two contigs with the same id is used.  file_list gives the
+ *  contigs file of each file number, as lines of form:
+ *
+ *     FileNumber \t FileName \n
+ *
+ *  All of the locations are read first.  The segments on each contig are
+ *  merged into regions, and the regions are read in order of file and
+ *  offset, each once: by computed offsets for a contig with a geometry
+ *  row, or forward from the nearest index point for one with irregular
+ *  lines.
+ *
+ *  A contigs file may be blocked gzip (see bgzf.h), with the virtual seeks
+ *  of index_contig_files 1.08; it is read forward from the index points a
+ *  block at a time.
+ *
+ *  Compile with:  cc -O extract_features.c bgzf.c -o extract_features -lz
+ *
+ *  Version History:
+ *
+ *      1.01: Read blocked gzip contigs files, requiring bgzf.o.
+ */
+
+#define  VERSION  "1.01"
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include "bgzf.h"
+
+#define  INPLEN     ( 64*1024)  /* longest location or index line */
+#define  CHUNK      ( 64*1024)  /* bytes read at a time from an index point (>= BGZF_MAXBLOCK) */
+#define  MERGE_GAP  ( 64*1024)  /* segments closer than this are read together */
+
+/*  Contigs, by the interned string Genome \t Contig  */
+
+typedef struct {
+    uint64_t    startN;
+    uint64_t    indexpt;
+    uint64_t    seek;
+} point_t;
+
+typedef struct {
+    int64_t     fileN;      /* -1 if not in the index */
+    int         geo;        /* has a geometry row */
+    uint64_t    len;
+    uint64_t    off;
+    uint64_t    linebases;
+    uint64_t    linewidth;
+    point_t    *pts;        /* index points, sorted by indexpt */
+    size_t      npts;
+    size_t      maxpts;
+    int         closed;     /* its length record was seen */
+    int         reported;
+} contig_t;
+
+typedef struct {
+    uint32_t    contig;
+    uint32_t    region;
+    uint64_t    lo;         /* 0 based, end exclusive */
+    uint64_t    hi;
+    int         minus;
+} seg_t;
+
+typedef struct {
+    size_t      id_off;     /* in ids */
+    size_t      first_seg;
+    size_t      nseg;
+} item_t;
+
+typedef struct {
+    uint32_t    contig;
+    uint64_t    lo;
+    uint64_t    hi;
+    uint64_t    seek;       /* where reading starts */
+    uint64_t    startN;     /* the nucleotide at seek */
+    char       *seq;        /* nucleotides lo .. lo + nseq */
+    uint64_t    nseq;
+} region_t;
+
+typedef struct {
+    unsigned long  fileN;
+    char          *name;
+} file_t;
+
+typedef struct {
+    char       *text;
+    size_t      text_len;
+    size_t      text_size;
+    size_t     *off;
+    uint32_t    n;
+    uint32_t    max;
+    uint32_t   *slot;
+    uint32_t    nslot;
+} strtab_t;
+
+#define  STR( tab, i )  ( (tab)->text + (tab)->off[i] )
+
+int   read_locations( FILE *fp );
+int   add_segment( const char *genome, int glen, const char *loc, int len );
+int   read_index( const char *path );
+int   read_file_list( const char *path );
+void  make_regions( void );
+int   read_regions( void );
+int   read_region( int fd, bgzf_stream_t *bgzf, region_t *r );
+ssize_t read_chunk( int fd, bgzf_stream_t *bgzf, uint64_t *pos, unsigned char *buf );
+void  write_items( void );
+void  append_segment( seg_t *s );
+void  reverse_complement( char *p, size_t n );
+void  translate( void );
+void  init_tables( void );
+const char *file_name( unsigned long fileN );
+uint32_t intern( strtab_t *tab, const char *s, int len, int add );
+uint32_t hash_str( const char *s, int len );
+int   cmp_segs( const void *a, const void *b );
+int   cmp_regions( const void *a, const void *b );
+int   cmp_points( const void *a, const void *b );
+int   cmp_files( const void *a, const void *b );
+void *xrealloc( void *ptr, size_t n );
+void  usage( char *prog );
+
+strtab_t        keys;               /* Genome \t Contig */
+contig_t       *contigs = NULL;
+uint32_t        maxcontig = 0;
+
+seg_t          *segs = NULL;
+size_t          nseg = 0, maxseg = 0;
+item_t         *items = NULL;
+size_t          nitem = 0, maxitem = 0;
+char           *ids = NULL;
+size_t          ids_len = 0, ids_size = 0;
+
+region_t       *regions = NULL;
+size_t          nregion = 0;
+
+file_t         *files = NULL;
+size_t          nfile = 0;
+
+char           *outbuf = NULL;      /* sequence being written */
+size_t          outlen = 0, outsize = 0;
+
+int             revcomp = 0, protein = 0, fix_start = 0;
+unsigned char   complement[256];
+signed char     base_code[256];     /* T C A G = 0 .. 3, else -1 */
+const char     *genetic_code = "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG";
+
+
+int main( int argc, char **argv ) {
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    while ( ( argc >= 2 ) && ( argv[1][0] == '-' ) ) {
+        if      ( strcmp( argv[1], "-r" ) == 0 ) revcomp   = 1;
+        else if ( strcmp( argv[1], "-p" ) == 0 ) protein   = 1;
+        else if ( strcmp( argv[1], "-s" ) == 0 ) fix_start = 1;
+        else usage( argv[0] );
+        argc--;
+        argv++;
+    }
+    if ( argc != 3 ) usage( argv[0] );
+
+    init_tables();
+
+    if ( read_locations( stdin ) ) {
+        fprintf( stderr, "extract_features: failed to read the locations\n" );
+        return 1;
+    }
+    if ( read_file_list( argv[1] ) ) {
+        fprintf( stderr, "extract_features: could not read file list %s\n", argv[1] );
+        return 1;
+    }
+    if ( read_index( argv[2] ) ) {
+        fprintf( stderr, "extract_features: could not read contig index %s\n", argv[2] );
+        return 1;
+    }
+
+    make_regions();
+    if ( read_regions() ) {
+        fprintf( stderr, "extract_features: failed to read the contigs\n" );
+        return 1;
+    }
+    write_items();
+
+    fflush( stdout );
+    return ferror( stdout ) ? 1 : 0;
+}
+
+
+/*  Read the features, and the segments of their locations  */
+
+int read_locations( FILE *fp ) {
+    char    inpbuf[INPLEN], *id, *genome, *loc, *bptr, *comma;
+    size_t  idlen;
+    int     glen;
+
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+        id = inpbuf;
+        if ( ! ( bptr = strchr( id, '\t' ) ) ) continue;
+        idlen  = bptr - id;
+        genome = bptr + 1;
+        if ( ! ( bptr = strchr( genome, '\t' ) ) ) continue;
+        glen = bptr - genome;
+        loc  = bptr + 1;
+        loc[ strcspn( loc, "\r\n" ) ] = '\0';
+
+        if ( nitem >= maxitem ) {
+            maxitem = maxitem ? 2 * maxitem : 64 * 1024;
+            items = (item_t *) xrealloc( items, maxitem * sizeof( item_t ) );
+        }
+        if ( ids_len + idlen + 1 > ids_size ) {
+            ids_size = 2 * ( ids_len + idlen + 1 ) + 64 * 1024;
+            ids = (char *) xrealloc( ids, ids_size );
+        }
+        memcpy( ids + ids_len, id, idlen );
+        ids[ ids_len + idlen ] = '\0';
+        items[nitem].id_off    = ids_len;
+        items[nitem].first_seg = nseg;
+        ids_len += idlen + 1;
+
+        while ( *loc ) {
+            comma = strchr( loc, ',' );
+            if ( add_segment( genome, glen, loc, comma ? comma - loc : (int) strlen( loc ) ) ) {
+                fprintf( stderr, "extract_features: bad location for %s: %s\n", ids + items[nitem].id_off, loc );
+            }
+            if ( ! comma ) break;
+            loc = comma + 1;
+        }
+        items[nitem].nseg = nseg - items[nitem].first_seg;
+        nitem++;
+    }
+    return ferror( fp ) ? 1 : 0;
+}
+
+
+/*  Add a segment, Contig_Beg_End.  Returns nonzero if it is not one.  */
+
+int add_segment( const char *genome, int glen, const char *loc, int len ) {
+    char          key[INPLEN];
+    const char   *u1, *u2;
+    unsigned long long  beg, end;
+    char         *e;
+    uint32_t      c, n;
+
+    for ( u2 = loc + len - 1; ( u2 > loc ) && ( *u2 != '_' ); u2-- ) ;
+    for ( u1 = u2 - 1; ( u1 > loc ) && ( *u1 != '_' ); u1-- ) ;
+    if ( ( u1 <= loc ) || ( glen + 1 + ( u1 - loc ) >= INPLEN ) ) return 1;
+    beg = strtoull( u1 + 1, &e, 10 );
+    if ( ( e != u2 ) || ! beg ) return 1;
+    end = strtoull( u2 + 1, &e, 10 );
+    if ( ( e != loc + len ) || ! end ) return 1;
+
+    memcpy( key, genome, glen );
+    key[glen] = '\t';
+    memcpy( key + glen + 1, loc, u1 - loc );
+    n = keys.n;
+    c = intern( &keys, key, glen + 1 + ( u1 - loc ), 1 );
+    if ( keys.n > n ) {
+        if ( c >= maxcontig ) {
+            maxcontig = keys.max;
+            contigs = (contig_t *) xrealloc( contigs, maxcontig * sizeof( contig_t ) );
+        }
+        memset( contigs + c, 0, sizeof( contig_t ) );
+        contigs[c].fileN = -1;
+    }
+
+    if ( nseg >= maxseg ) {
+        maxseg = maxseg ? 2 * maxseg : 64 * 1024;
+        segs = (seg_t *) xrealloc( segs, maxseg * sizeof( seg_t ) );
+    }
+    segs[nseg].contig = c;
+    segs[nseg].lo     = ( beg < end ? beg : end ) - 1;
+    segs[nseg].hi     =   beg < end ? end : beg;
+    segs[nseg].minus  =   beg > end;
+    nseg++;
+    return 0;
+}
+
+
+/*  Read the index rows of the contigs of the locations.  A contig in more
+ *  than one file is taken from the first file seen.
+ */
+
+int read_index( const char *path ) {
+    FILE     *fp;
+    char      inpbuf[INPLEN], *fld[8], *bptr;
+    contig_t *c;
+    uint32_t  i;
+    int64_t   fileN;
+    int       nf;
+
+    if ( ! ( fp = fopen( path, "r" ) ) ) return 1;
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+        fld[0] = inpbuf;
+        for ( nf = 1, bptr = inpbuf; *bptr && ( *bptr != '\n' ); bptr++ ) {
+            if ( *bptr == '\t' ) {
+                if ( nf == 8 ) break;
+                *bptr = '\0';
+                fld[nf++] = bptr + 1;
+            }
+        }
+        *bptr = '\0';
+        if ( ( nf < 5 ) || ( nf > 7 ) ) continue;
+
+        fld[0][ strlen( fld[0] ) ] = '\t';      /*  Genome \t Contig  */
+        i = intern( &keys, fld[0], strlen( fld[0] ), 0 );
+        if ( i >= keys.n ) continue;
+        c = contigs + i;
+        if ( c->closed ) continue;
+        if ( nf == 5 ) {
+            c->closed = 1;
+            continue;
+        }
+
+        fileN = strtoll( fld[ nf == 6 ? 4 : 3 ], NULL, 10 );
+        if ( c->fileN < 0 ) c->fileN = fileN;
+        else if ( c->fileN != fileN ) continue;
+
+        if ( nf == 6 ) {
+            if ( c->npts >= c->maxpts ) {
+                c->maxpts = c->maxpts ? 2 * c->maxpts : 16;
+                c->pts = (point_t *) xrealloc( c->pts, c->maxpts * sizeof( point_t ) );
+            }
+            c->pts[c->npts].startN  = strtoull( fld[2], NULL, 10 );
+            c->pts[c->npts].indexpt = strtoull( fld[3], NULL, 10 );
+            c->pts[c->npts].seek    = strtoull( fld[5], NULL, 10 );
+            c->npts++;
+        }
+        else if ( ! c->geo ) {
+            c->len       = strtoull( fld[2], NULL, 10 );
+            c->off       = strtoull( fld[4], NULL, 10 );
+            c->linebases = strtoull( fld[5], NULL, 10 );
+            c->linewidth = strtoull( fld[6], NULL, 10 );
+            c->geo       = ( c->linebases > 0 ) && ( c->linewidth > c->linebases );
+        }
+    }
+    if ( ferror( fp ) ) {
+        fclose( fp );
+        return 1;
+    }
+    fclose( fp );
+
+    for ( i = 0; i < keys.n; i++ ) {
+        if ( contigs[i].npts > 1 ) qsort( contigs[i].pts, contigs[i].npts, sizeof( point_t ), cmp_points );
+    }
+    return 0;
+}
+
+
+int read_file_list( const char *path ) {
+    FILE          *fp;
+    char           inpbuf[INPLEN], *name;
+    unsigned long  fileN;
+    size_t         maxfile = 0;
+
+    if ( ! ( fp = fopen( path, "r" ) ) ) return 1;
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+        fileN = strtoul( inpbuf, &name, 10 );
+        if ( ( name == inpbuf ) || ( *name++ != '\t' ) ) continue;
+        name[ strcspn( name, "\r\n" ) ] = '\0';
+        if ( nfile >= maxfile ) {
+            maxfile = maxfile ? 2 * maxfile : 1024;
+            files = (file_t *) xrealloc( files, maxfile * sizeof( file_t ) );
+        }
+        files[nfile].fileN = fileN;
+        files[nfile].name  = strcpy( (char *) xrealloc( NULL, strlen( name ) + 1 ), name );
+        nfile++;
+    }
+    fclose( fp );
+    if ( nfile ) qsort( files, nfile, sizeof( file_t ), cmp_files );
+    return 0;
+}
+
+
+const char *file_name( unsigned long fileN ) {
+    file_t  key, *f;
+
+    key.fileN = fileN;
+    f = nfile ? (file_t *) bsearch( &key, files, nfile, sizeof( file_t ), cmp_files ) : NULL;
+    return f ? f->name : NULL;
+}
+
+
+/*  Merge the segments on each contig into the regions to be read, and find
+ *  where each region starts in its file.
+ */
+
+void make_regions( void ) {
+    size_t     *order, i, j, maxregion;
+    seg_t      *s;
+    region_t   *r;
+    contig_t   *c;
+    point_t    *p;
+    size_t      lo, hi, mid;
+    const char *key, *tab;
+
+    order = (size_t *) xrealloc( NULL, ( nseg ? nseg : 1 ) * sizeof( size_t ) );
+    for ( i = 0; i < nseg; i++ ) order[i] = i;
+    qsort( order, nseg, sizeof( size_t ), cmp_segs );
+
+    maxregion = 0;
+    r = NULL;
+    for ( i = 0; i < nseg; i++ ) {
+        s = segs + order[i];
+        if ( ! r || ( r->contig != s->contig ) || ( s->lo > r->hi + MERGE_GAP ) ) {
+            if ( nregion >= maxregion ) {
+                maxregion = maxregion ? 2 * maxregion : 1024;
+                regions = (region_t *) xrealloc( regions, maxregion * sizeof( region_t ) );
+            }
+            r = regions + nregion++;
+            memset( r, 0, sizeof( region_t ) );
+            r->contig = s->contig;
+            r->lo     = s->lo;
+            r->hi     = s->hi;
+        }
+        else if ( s->hi > r->hi ) {
+            r->hi = s->hi;
+        }
+        s->region = r - regions;
+    }
+    free( order );
+
+    for ( j = 0; j < nregion; j++ ) {
+        r = regions + j;
+        c = contigs + r->contig;
+        if ( c->geo ) {
+            r->startN = r->lo;
+            r->seek   = c->off + ( r->lo / c->linebases ) * c->linewidth + r->lo % c->linebases;
+        }
+        else if ( c->npts && ( c->pts[0].indexpt <= r->lo ) ) {
+            lo = 0;                         /*  last index point <= r->lo  */
+            hi = c->npts;
+            while ( hi - lo > 1 ) {
+                mid = ( lo + hi ) / 2;
+                if ( c->pts[mid].indexpt <= r->lo ) lo = mid;
+                else                                hi = mid;
+            }
+            p = c->pts + lo;
+            r->startN = p->startN;
+            r->seek   = p->seek;
+        }
+        else if ( ! c->reported ) {
+            key = STR( &keys, r->contig );
+            tab = strchr( key, '\t' );
+            fprintf( stderr, "extract_features: contig %s of %.*s is not in the index\n", tab + 1, (int) ( tab - key ), key );
+            c->reported = 1;
+        }
+    }
+}
+
+
+/*  Read the regions in order of file and offset  */
+
+int read_regions( void ) {
+    size_t        *order, i;
+    region_t      *r;
+    contig_t      *c;
+    const char    *name;
+    int64_t        fileN;
+    bgzf_stream_t  stream, *bgzf;
+    unsigned char  hdr[BGZF_HEADER];
+    int            fd, status;
+
+    order = (size_t *) xrealloc( NULL, ( nregion ? nregion : 1 ) * sizeof( size_t ) );
+    for ( i = 0; i < nregion; i++ ) order[i] = i;
+    qsort( order, nregion, sizeof( size_t ), cmp_regions );
+
+    fd     = -1;
+    fileN  = -1;
+    bgzf   = NULL;
+    status = 0;
+    if ( bgzf_stream_init( &stream, -1, 0 ) ) {
+        fprintf( stderr, "extract_features: out of memory\n" );
+        exit( 1 );
+    }
+    for ( i = 0; i < nregion; i++ ) {
+        r = regions + order[i];
+        c = contigs + r->contig;
+        if ( ! c->geo && ( ! c->npts || ( c->pts[0].indexpt > r->lo ) ) ) continue;
+
+        if ( c->fileN != fileN ) {
+            if ( fd >= 0 ) close( fd );
+            fileN = c->fileN;
+            name  = file_name( (unsigned long) fileN );
+            fd    = name ? open( name, O_RDONLY ) : -1;
+            if ( fd < 0 ) {
+                fprintf( stderr, "extract_features: could not open contigs file %lld (%s)\n",
+                                 (long long) fileN, name ? name : "not in file list" );
+                status = 1;
+            }
+            bgzf = ( fd >= 0 ) && ( pread( fd, hdr, BGZF_HEADER, 0 ) == BGZF_HEADER )
+                               && bgzf_is_bgzf( hdr, BGZF_HEADER ) ? &stream : NULL;
+            stream.fd = fd;
+        }
+        if ( ( fd >= 0 ) && read_region( fd, bgzf, r ) ) {
+            fprintf( stderr, "extract_features: failed to read contigs file %lld\n", (long long) fileN );
+            status = 1;
+        }
+    }
+    if ( fd >= 0 ) close( fd );
+    bgzf_stream_free( &stream );
+    free( order );
+    return status;
+}
+
+
+/*  Read the nucleotides of a region.  With a geometry row, the bytes from
+ *  its first nucleotide to its last are read, and the line ends dropped.
+ *  Otherwise, it is read forward from the index point, to the end of the
+ *  region or of the contig.  bgzf is NULL, unless the file is blocked gzip
+ *  (which has no geometry rows).
+ */
+
+int read_region( int fd, bgzf_stream_t *bgzf, region_t *r ) {
+    contig_t       *c = contigs + r->contig;
+    unsigned char  *buf;
+    uint64_t        want, skip, last, pos, nbyte, size;
+    ssize_t         got;
+    size_t          k, i;
+    int             bol, ch;
+
+    if ( c->geo && ! bgzf ) {
+        if ( r->lo >= c->len ) return 0;
+        last  = ( r->hi < c->len ? r->hi : c->len ) - 1;
+        nbyte = c->off + ( last / c->linebases ) * c->linewidth + last % c->linebases + 1 - r->seek;
+        buf   = (unsigned char *) xrealloc( NULL, nbyte );
+        for ( k = 0; k < nbyte; k += got ) {
+            got = pread( fd, buf + k, nbyte - k, (off_t) ( r->seek + k ) );
+            if ( got <= 0 ) {
+                free( buf );
+                return 1;
+            }
+        }
+        for ( i = k = 0; i < nbyte; i++ ) {
+            if ( ( buf[i] != '\n' ) && ( buf[i] != '\r' ) ) buf[k++] = buf[i];
+        }
+        r->seq  = (char *) buf;
+        r->nseq = k;
+        return 0;
+    }
+
+    want = r->hi - r->lo;
+    skip = r->lo - r->startN;
+    size = 0;
+    buf  = (unsigned char *) xrealloc( NULL, CHUNK );
+    pos  = r->seek;
+    bol  = 0;
+    while ( r->nseq < want ) {
+        got = read_chunk( fd, bgzf, &pos, buf );
+        if ( got < 0 ) {
+            free( buf );
+            return 1;
+        }
+        if ( got == 0 ) break;
+        for ( i = 0; ( i < (size_t) got ) && ( r->nseq < want ); i++ ) {
+            ch = buf[i];
+            if ( bol && ( ch == '>' ) ) {
+                want = r->nseq;         /*  end of the contig  */
+                break;
+            }
+            bol = ( ch == '\n' );
+            if ( isspace( ch ) ) continue;
+            if ( skip ) {
+                skip--;
+                continue;
+            }
+            if ( r->nseq >= size ) {
+                size = size ? 2 * size : CHUNK;
+                if ( size > want ) size = want;
+                r->seq = (char *) xrealloc( r->seq, size );
+            }
+            r->seq[ r->nseq++ ] = ch;
+        }
+    }
+    free( buf );
+    return 0;
+}
+
+
+/*  Read the next CHUNK bytes from *pos, or in a blocked gzip file, the rest
+ *  of the block at virtual seek *pos, and move *pos past them.  Returns the
+ *  number of bytes, 0 at the end of the file, or -1 on error.
+ */
+
+ssize_t read_chunk( int fd, bgzf_stream_t *bgzf, uint64_t *pos, unsigned char *buf ) {
+    uint64_t  coffset;
+    unsigned  uoffset;
+    long      n;
+
+    if ( ! bgzf ) {
+        n = pread( fd, buf, CHUNK, (off_t) *pos );
+        if ( n > 0 ) *pos += n;
+        return n;
+    }
+
+    bgzf->coffset = BGZF_COFFSET( *pos );
+    uoffset       = BGZF_UOFFSET( *pos );
+    do {
+        if ( ( n = bgzf_stream_next( bgzf, (char *) buf, &coffset ) ) <= 0 ) return n;
+        if ( uoffset >= (unsigned long) n ) {   /*  at the end of a block  */
+            uoffset -= n;
+            n = 0;
+        }
+    } while ( ! n );
+
+    n -= uoffset;
+    if ( uoffset ) memmove( buf, buf + uoffset, n );
+    *pos = BGZF_VSEEK( bgzf->coffset, 0 );
+    return n;
+}
+
+
+/*  Write the sequences, in input order  */
+
+void write_items( void ) {
+    item_t  *it;
+    size_t   i, k;
+
+    for ( i = 0; i < nitem; i++ ) {
+        it = items + i;
+        outlen = 0;
+        for ( k = 0; k < it->nseg; k++ ) append_segment( segs + it->first_seg + k );
+        if ( revcomp ) reverse_complement( outbuf, outlen );
+        if ( protein ) translate();
+        fputs( ids + it->id_off, stdout );
+        putchar( '\t' );
+        if ( outlen ) fwrite( outbuf, 1, outlen, stdout );
+        putchar( '\n' );
+    }
+}
+
+
+void append_segment( seg_t *s ) {
+    region_t  *r = regions + s->region;
+    uint64_t   end, n;
+
+    end = r->lo + r->nseq;
+    if ( s->lo >= end ) return;
+    n = ( s->hi < end ? s->hi : end ) - s->lo;
+    if ( outlen + n > outsize ) {
+        outsize = 2 * ( outlen + n ) + 64 * 1024;
+        outbuf = (char *) xrealloc( outbuf, outsize );
+    }
+    memcpy( outbuf + outlen, r->seq + ( s->lo - r->lo ), n );
+    if ( s->minus ) reverse_complement( outbuf + outlen, n );
+    outlen += n;
+}
+
+
+void reverse_complement( char *p, size_t n ) {
+    size_t  a, b;
+    char    t;
+
+    for ( a = 0, b = n; a < b; a++ ) {
+        t = complement[ (unsigned char) p[a] ];
+        p[a] = complement[ (unsigned char) p[--b] ];
+        p[b] = t;
+    }
+}
+
+
+/*  Translate outbuf in place.  A codon with other than ACGTU is X, and an
+ *  incomplete last codon is dropped.
+ */
+
+void translate( void ) {
+    size_t  i, j;
+    int     a, b, c;
+
+    for ( i = j = 0; i + 3 <= outlen; i += 3 ) {
+        a = base_code[ (unsigned char) outbuf[i] ];
+        b = base_code[ (unsigned char) outbuf[i+1] ];
+        c = base_code[ (unsigned char) outbuf[i+2] ];
+        outbuf[j++] = ( ( a | b | c ) < 0 ) ? 'X' : genetic_code[ 16 * a + 4 * b + c ];
+    }
+    if ( fix_start && j && ( ( outbuf[0] == 'L' ) || ( outbuf[0] == 'V' ) ) ) outbuf[0] = 'M';
+    outlen = j;
+}
+
+
+void init_tables( void ) {
+    static const char *pairs = "ATTAUACGGCRYYRKMMKBVVBDHHDSSWWNN";
+    int  b, i;
+
+    for ( b = 0; b < 256; b++ ) {
+        complement[b] = b;
+        base_code[b]  = -1;
+    }
+    for ( i = 0; pairs[i]; i += 2 ) {
+        complement[ (unsigned char) pairs[i] ]        = pairs[i+1];
+        complement[ (unsigned char) pairs[i] | 0x20 ] = pairs[i+1] | 0x20;
+    }
+    for ( i = 0; i < 5; i++ ) {
+        base_code[ (unsigned char) "TCAGU"[i] ]        = i & 3;
+        base_code[ (unsigned char) "TCAGU"[i] | 0x20 ] = i & 3;
+    }
+}
+
+
+/*  The number of a string, adding it if add is set.  Returns tab->n if it
+ *  is not there and not added.
+ */
+
+uint32_t intern( strtab_t *tab, const char *s, int len, int add ) {
+    uint32_t h, i, j, *slot, nslot;
+
+    if ( tab->nslot ) {
+        for ( h = hash_str( s, len ) & ( tab->nslot - 1 ); tab->slot[h]; h = ( h + 1 ) & ( tab->nslot - 1 ) ) {
+            i = tab->slot[h] - 1;
+            if ( ( strncmp( STR( tab, i ), s, len ) == 0 ) && ( STR( tab, i )[len] == '\0' ) ) return i;
+        }
+    }
+    if ( ! add ) return tab->n;
+
+    if ( 2 * ( tab->n + 1 ) > tab->nslot ) {
+        nslot = tab->nslot ? 2 * tab->nslot : 1024;
+        slot = (uint32_t *) xrealloc( NULL, nslot * sizeof( uint32_t ) );
+        memset( slot, 0, nslot * sizeof( uint32_t ) );
+        for ( i = 0; i < tab->n; i++ ) {
+            for ( j = hash_str( STR( tab, i ), strlen( STR( tab, i ) ) ) & ( nslot - 1 ); slot[j]; j = ( j + 1 ) & ( nslot - 1 ) ) ;
+            slot[j] = i + 1;
+        }
+        if ( tab->slot ) free( tab->slot );
+        tab->slot  = slot;
+        tab->nslot = nslot;
+    }
+    if ( tab->n >= tab->max ) {
+        tab->max = tab->max ? 2 * tab->max : 1024;
+        tab->off = (size_t *) xrealloc( tab->off, tab->max * sizeof( size_t ) );
+    }
+    if ( tab->text_len + len + 1 > tab->text_size ) {
+        tab->text_size = 2 * ( tab->text_len + len + 1 ) + 64 * 1024;
+        tab->text = (char *) xrealloc( tab->text, tab->text_size );
+    }
+    memcpy( tab->text + tab->text_len, s, len );
+    tab->text[tab->text_len + len] = '\0';
+    tab->off[tab->n] = tab->text_len;
+    tab->text_len += len + 1;
+
+    for ( h = hash_str( s, len ) & ( tab->nslot - 1 ); tab->slot[h]; h = ( h + 1 ) & ( tab->nslot - 1 ) ) ;
+    tab->slot[h] = tab->n + 1;
+    return tab->n++;
+}
+
+
+/*  FNV-1a  */
+
+uint32_t hash_str( const char *s, int len ) {
+    uint32_t h = 2166136261u;
+    int      i;
+
+    for ( i = 0; i < len; i++ ) h = ( h ^ (unsigned char) s[i] ) * 16777619u;
+    return h;
+}
+
+
+int cmp_segs( const void *a, const void *b ) {
+    const seg_t *x = segs + *(const size_t *) a;
+    const seg_t *y = segs + *(const size_t *) b;
+
+    if ( x->contig != y->contig ) return x->contig < y->contig ? -1 : 1;
+    if ( x->lo     != y->lo     ) return x->lo     < y->lo     ? -1 : 1;
+    return 0;
+}
+
+
+int cmp_regions( const void *a, const void *b ) {
+    const region_t *x = regions + *(const size_t *) a;
+    const region_t *y = regions + *(const size_t *) b;
+    int64_t         fx = contigs[x->contig].fileN;
+    int64_t         fy = contigs[y->contig].fileN;
+
+    if ( fx != fy ) return fx < fy ? -1 : 1;
+    if ( x->seek != y->seek ) return x->seek < y->seek ? -1 : 1;
+    return 0;
+}
+
+
+int cmp_points( const void *a, const void *b ) {
+    const point_t *x = (const point_t *) a;
+    const point_t *y = (const point_t *) b;
+
+    if ( x->indexpt != y->indexpt ) return x->indexpt < y->indexpt ? -1 : 1;
+    return 0;
+}
+
+
+int cmp_files( const void *a, const void *b ) {
+    const file_t *x = (const file_t *) a;
+    const file_t *y = (const file_t *) b;
+
+    if ( x->fileN != y->fileN ) return x->fileN < y->fileN ? -1 : 1;
+    return 0;
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "extract_features: out of memory\n" );
+        exit( 1 );
+    }
+    return ptr;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ -r ] [ -p [ -s ] ]  file_list  ContigIndex  < Locations  > Sequences\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog
+           );
+    exit( 0 );
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  get_dna_2bit.c
+ *
+ *  Usage:  get_dna_2bit  2BitFile  Contig  Start  Length  [ Strand ]
+ *  or      get_dna_2bit  2BitFile  < regions
+ *  or      get_dna_2bit  -l  2BitFile   (to list the contigs and their lengths)
+ *  or      get_dna_2bit  -v   (to return version number on standard output)
+ *
+ *  Write the sequence of a region of a contig from a 2-bit contig file
+ *  (see contig_2bit.h), as written by index_contig_files -2.  Start is 1
+ *  based, and with Strand "-" the sequence is reverse complemented.  The
+ *  region ends at the end of the contig.  Without a region on the command
+ *  line, regions are read from standard input as lines of form:
+ *
+ *      Contig \t Start \t Length [ \t Strand ] \n
+ *
+ *  and the sequence of each is written as a line (empty if there is no
+ *  such contig).
+ *
+ *  Compile with:  cc -O get_dna_2bit.c contig_2bit.c -o get_dna_2bit
+ */
+
+#define  VERSION  "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contig_2bit.h"
+
+#define  INPLEN  ( 64*1024)     /* longest region line */
+
+int   get_region( c2b_file_t *f, const char *contig, const char *start,
+                  const char *len, const char *strand );
+void *xrealloc( void *ptr, size_t n );
+void  usage( char *prog );
+
+char   *seqbuf = NULL;
+size_t  seqsize = 0;
+
+
+int main( int argc, char **argv ) {
+    c2b_file_t  *f;
+    const char  *name;
+    char         line[INPLEN], *field[4], *p;
+    size_t       len;
+    uint64_t     i, nbase;
+    int          nf, status;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    if ( ( argc == 3 ) && ( strcmp( argv[1], "-l" ) == 0 ) ) {
+        if ( ! ( f = c2b_open( argv[2] ) ) ) {
+            fprintf( stderr, "get_dna_2bit: could not open %s\n", argv[2] );
+            return 1;
+        }
+        for ( i = 0; i < c2b_ncontig( f ); i++ ) {
+            name = c2b_name( f, i, &len, &nbase );
+            fwrite( name, 1, len, stdout );
+            printf( "\t%llu\n", (unsigned long long) nbase );
+        }
+        c2b_close( f );
+        return 0;
+    }
+
+    if ( ( argc != 2 ) && ( argc != 5 ) && ( argc != 6 ) ) usage( argv[0] );
+
+    if ( ! ( f = c2b_open( argv[1] ) ) ) {
+        fprintf( stderr, "get_dna_2bit: could not open %s\n", argv[1] );
+        return 1;
+    }
+
+    status = 0;
+    if ( argc > 2 ) {
+        if ( get_region( f, argv[2], argv[3], argv[4], ( argc == 6 ) ? argv[5] : "+" ) < 0 ) {
+            fprintf( stderr, "get_dna_2bit: no contig %s in %s\n", argv[2], argv[1] );
+            status = 1;
+        }
+    }
+    else {
+        while ( fgets( line, INPLEN, stdin ) ) {
+            if ( ( p = strchr( line, '\n' ) ) ) *p = '\0';
+            nf = 0;
+            field[ nf++ ] = line;
+            for ( p = line; *p && nf < 4; p++ ) {
+                if ( *p == '\t' ) {
+                    *p = '\0';
+                    field[ nf++ ] = p + 1;
+                }
+            }
+            if ( nf < 3 ) {
+                putchar( '\n' );
+                continue;
+            }
+            (void) get_region( f, field[0], field[1], field[2], ( nf == 4 ) ? field[3] : "+" );
+        }
+    }
+
+    c2b_close( f );
+    if ( fflush( stdout ) || ferror( stdout ) ) {
+        fprintf( stderr, "get_dna_2bit: error writing output\n" );
+        return 1;
+    }
+    return status;
+}
+
+
+/*  Write a region as a line.  Returns -1 if there is no such contig.  */
+
+int get_region( c2b_file_t *f, const char *contig, const char *start,
+                const char *len, const char *strand
+              ) {
+    long long  s, n;
+    int64_t    got;
+
+    s = atoll( start );
+    n = atoll( len );
+    if ( n < 0 ) n = 0;
+    if ( (size_t) n + 1 > seqsize ) {
+        seqsize = (size_t) n + 1;
+        seqbuf  = (char *) xrealloc( seqbuf, seqsize );
+    }
+    got = c2b_get_dna( f, contig, ( s < 1 ) ? 1 : (uint64_t) s, (uint64_t) n,
+                       ( strand[0] == '-' ) ? '-' : '+', seqbuf );
+    if ( got > 0 ) fwrite( seqbuf, 1, (size_t) got, stdout );
+    putchar( '\n' );
+    return ( got < 0 ) ? -1 : 0;
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "get_dna_2bit: out of memory\n" );
+        exit( 1 );
+    }
+    return ptr;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  2BitFile  Contig  Start  Length  [ Strand ]\n"
+             "or     %s  2BitFile  < regions\n"
+             "or     %s  -l  2BitFile\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog, prog, prog
+           );
+    exit( 0 );
+}
@@ -18,7 +18,7 @@
 
 /*  index_contig_files.c
  *
- *  Usage:  index_contig_files [ index_interval ] < file_list  > seeks_and_lengths
+ *  Usage:  index_contig_files [ -j nthreads ] [ -2 FileName ] [ -g ] [ -c FileName [ -w window ] ] [ -l ] [ -s ] [ index_interval ] < file_list  > seeks_and_lengths
  *  or      index_contig_files -v   (to return version number on standard output)
  *
  *  contigs_file_list contains one or more lines of form:
@@ -37,28 +37,98 @@
  *
  *      OrgID \t ContigId \t ContigLength \t CheckSum \t MD5 CheckSUm\n
  *
+ *  With -g, a contig whose sequence lines all hold the same number of
+ *  nucleotides (but the last, which may hold fewer), with no other white
+ *  space, and all end with the same line terminator, gets a geometry
+ *  record in place of its seek records (but the seek of nucleotide 0):
+ *
+ *      OrgID \t ContigId \t ContigLength \t FileNumber \t Offset \t LineBases \t LineWidth \n
+ *
+ *  as in a samtools faidx index.  The seek of nucleotide n (0 based) is
+ *  then Offset + ( n / LineBases ) * LineWidth + n % LineBases.  Contigs
+ *  with irregular lines get seek records every index_interval, as before.
+ *
+ *  With -j, the files are indexed on nthreads threads (0 is one per online
+ *  processor).  The records of each file are collected, and written in the
+ *  order of the file list, so the output is the same as on one thread.
+ *
+ *  With -2, the sequence of the contigs of each organism is also written
+ *  2-bit packed (see contig_2bit.h) to FileName in the directory of the
+ *  organism's first contigs file, for reading regions with get_dna_2bit or
+ *  Contig2Bit.pm.  FileName must not include a directory.
+ *
+ *  With -c, the base composition of the contigs of each organism in
+ *  windows of window bases (default 1000, at most 65535) is written (see
+ *  contig_comp.h) to FileName in the same directory, for
+ *  ContigComposition.pm and load_contig_composition.
+ *
+ *  With -l, only the length records are written, as for checking the
+ *  files against the stored checksums (verify_contigs).
+ *
+ *  With -s, each genome (a run of lines of the file list with the same
+ *  OrgID) ends with a summary record, with an empty ContigId:
+ *
+ *      OrgID \t \t NContigs \t TotalNucs \t CheckSum \t GenomeMD5 \t NDups \t DupIds \n
+ *
+ *  The first of contigs with the same id is counted, as in index_contigs.
+ *  CheckSum is the xor of their CheckSums, GenomeMD5 is the MD5 of their
+ *  ContigId \t ContigLength \t MD5 \n lines sorted by id (the genome's
+ *  SIGNATURE file), and DupIds are the ids that were repeated, separated
+ *  by spaces.
+ *
+ *  A contigs file compressed to blocked gzip (see bgzf.h; sims_bgzf will
+ *  do it) is recognized and decompressed a block at a time.  Its seeks are
+ *  virtual seeks (the file offset of the compressed block times 65536,
+ *  plus the offset in the uncompressed block), which extract_features and
+ *  ContigSeeks.pm resolve.  Its contigs get no geometry records, as the
+ *  seek of a nucleotide cannot be computed from the line lengths.
+ *
  *  Compile with:
  *
- *      cc -O index_contig_files.c md5.c -o index_contig_files
+ *      cc -O index_contig_files.c contig_2bit.c contig_comp.c job_pool.c bgzf.c md5.c -o index_contig_files -lpthread -lz
  *
  *  Version History:
  *
  *      1.01: Added MD5 checksum, requiring md5.o.
+ *      1.02: Sequence lines are indexed in spans, with the checksums
+ *            computed a word or a block at a time.  Output is unchanged.
+ *      1.03: Added -j nthreads.
+ *      1.04: Added -2 FileName, requiring contig_2bit.o.
+ *      1.05: Added -g.
+ *      1.06: Added -c FileName and -w window, requiring contig_comp.o.
+ *      1.07: Added -l.
+ *      1.08: Index blocked gzip files, requiring bgzf.o.
+ *      1.09: Added -s.
  */
 
-#define  VERSION  "1.01"
+#define  VERSION  "1.09"
 
 /*  These include files are appropriate for Machintosh OS X  */
 
 #include <stdio.h>
 #include <ctype.h>   /*  isspace() */
 #include <stdlib.h>  /*  exit()    */
+#include <string.h>  /*  memchr()  */
 #include <fcntl.h>   /*  O_RDONLY  */
 #include <unistd.h>  /*  read(), close() */
 
 
 #include <stdint.h>  /* int32_t  */
 
+#include "contig_2bit.h"
+#include "contig_comp.h"
+#include "bgzf.h"
+#include "job_pool.h"
+
+/*  SSE2 is used to test and lower case sequence, unless compiled with
+ *  -DNO_SIMD
+ */
+
+#if ! defined( NO_SIMD ) && ( defined( __SSE2__ ) || defined( _M_X64 ) )
+#  define  USE_SSE2 1
+#  include <emmintrin.h>
+#endif
+
 /* From the MD5 code */
 
 #include "EXTERN.h"
@@ -87,7 +157,9 @@ extern char* base64_16(const unsigned char* from, char* to);
 #define  BUFLEN    (256*1024)
 #define  INPLEN    ( 64*1024)
 #define  IDLEN     ( 16*1024)
+#define  MD5LEN    ( 64*1024)   /* lower cased sequence staged for MD5, a multiple of 64 */
 #define  DFLT_INDEX_INTERVAL  10000
+#define  DFLT_COMP_WINDOW      1000
 
 #define  isnuc(c)  isnuc_array[ c ]
 
@@ -178,26 +250,203 @@ static unsigned long crctab[] = {
 };
 
 
+/*  Buffers of a thread that indexes files  */
+
+typedef struct {
+    unsigned char  buffer[BUFLEN];
+    char           idbuf[IDLEN+1];
+    unsigned char  md5buf[MD5LEN];
+    int            md5len;
+    c2b_contig_t   pack;        /* contig being packed for -2 */
+    comp_contig_t  comp;        /* contig being counted for -c */
+    outbuf_t       seeks;       /* seek records of the contig, for -g */
+} reader_t;
+
+/*  One line of the file list; its seek, length and error records are
+ *  collected in out and err.
+ */
+
+typedef struct {
+    char      *org_id;
+    char      *file_num;
+    char      *file_name;
+    outbuf_t   out;
+    outbuf_t   err;
+    outbuf_t   tb;          /* packed contigs, for -2 */
+    outbuf_t   cb;          /* contig composition, for -c */
+    outbuf_t   sb;          /* id, length, crc and md5 of contigs, for -s */
+} job_t;
+
+/*  The files indexed on the job pool  */
+
+typedef struct {
+    job_t            *jobs;
+    int               index_interval;
+} job_list_t;
+
 /*  Function prototypes:  */
 
 typedef uint32_t crc_value_t;
 
-void report_len( char * org, char * id, unsigned long seqlen, crc_value_t crc, MD5_CTX * );
+/*  The state of the contig being indexed  */
+
+typedef struct {
+    char          *org_id;
+    char          *file_num;
+    long           index_interval;
+    long           index_point;     /* next sequence milestone to report */
+    unsigned long  seqlen;
+    crc_value_t    crc;
+    MD5_CTX        ctx;
+    int            nerror;
+    reader_t      *rd;
+    outbuf_t      *out;
+    outbuf_t      *err;
+    c2b_contig_t  *pack;            /* NULL, unless writing 2-bit files */
+    outbuf_t      *tb;
+    comp_contig_t *comp;            /* NULL, unless writing composition */
+    outbuf_t      *cb;
+    outbuf_t      *sb;              /* NULL, unless writing genome summaries */
+    outbuf_t      *seeks;           /* out, or rd->seeks with -g */
+    bgzf_stream_t *bgzf;            /* NULL, unless the file is blocked gzip */
+    long long      fill_seek;       /* seek of the first byte in the buffer */
+    long long      next_seek;       /* file offset after it, if not bgzf */
+    long long      line_seek;       /* file offset of the current line */
+    unsigned long  line_start;      /* seqlen at the start of the line */
+    int            line_open;
+    int            line_cr;         /* line ended by \r so far */
+    int            geo_ok;          /* lines are regular so far */
+    int            geo_done;        /* a short line was seen: no more bases */
+    long           geo_bases;       /* nucleotides per line */
+    int            geo_term;        /* line terminator width */
+    long long      geo_offset;      /* file offset of nucleotide 0 */
+} contig_t;
+
+void report_len( contig_t *ctg );
+
+void report_seeks( contig_t *ctg );
+
+void geo_reset( contig_t *ctg );
+
+void geo_line_start( contig_t *ctg, long long seek );
+
+void geo_line_end( contig_t *ctg, int has_nl );
+
+int  index_job( job_t *job, reader_t *rd, int index_interval );
+
+int  index_one ( contig_t *ctg, int fd );
+
+int  fill_buffer( contig_t *ctg, int fd );
+
+void index_span( contig_t *ctg, const unsigned char *p, int n, long long seek );
+
+int  nuc_run( const unsigned char *p, int n );
+
+int  index_files( job_t *jobs, int njob, int nthreads, int index_interval );
+
+void *begin_index( void *arg );
+
+int  run_index( void *arg, void *state, int i );
+
+void write_index( void *arg, int i );
+
+void end_index( void *arg, void *state );
 
-int  index_one ( char * org_id, char * file_num, int fd, int index_interval );
+int  split_line( char *line, char **org_id, char **file_num, char **file_name );
+
+reader_t *new_reader( void );
+
+void free_reader( reader_t *rd );
+
+void pack_bases( contig_t *ctg, const unsigned char *p, int n );
+
+void add_2bit_record( contig_t *ctg );
+
+void write_2bit( job_t *job );
+
+void finish_2bit( void );
+
+char *side_path( job_t *job, const char *name );
+
+void count_bases( contig_t *ctg, const unsigned char *p, int n );
+
+void add_comp_record( contig_t *ctg );
+
+void write_comp( job_t *job );
+
+void finish_comp( void );
+
+void summary_org( job_t *job );
+
+void add_summary( job_t *job );
+
+void finish_summary( void );
+
+int  cmp_summary( const void *a, const void *b );
+
+void init_crc( void );
+
+crc_value_t crc_update( crc_value_t crc, const unsigned char *p, int n );
+
+void md5_stage( reader_t *rd, MD5_CTX *ctx, const unsigned char *p, int n );
+
+void md5_flush( reader_t *rd, MD5_CTX *ctx );
+
+void *xrealloc( void *ptr, size_t n );
 
 void usage(char *prog);
 
 
 char           inpbuf[INPLEN];
-unsigned char  buffer[BUFLEN];
-char           idbuf[IDLEN+1];
+
+/*  With -2, the 2-bit file name, and the file of the current genome  */
+
+char          *twobit_name   = NULL;
+char          *twobit_org    = NULL;
+c2b_writer_t  *twobit_writer = NULL;
+
+/*  With -c, the composition file name, and the file of the current genome  */
+
+char          *comp_name     = NULL;
+char          *comp_org      = NULL;
+comp_writer_t *composition_writer = NULL;
+int            comp_window   = DFLT_COMP_WINDOW;
+
+/*  With -g, record the line geometry of regular contigs  */
+
+int            geometry      = 0;
+
+/*  With -l, write only the length records  */
+
+int            lengths_only  = 0;
+
+/*  With -s, the contigs of the current genome, for its summary record  */
+
+typedef struct {
+    char          *id;
+    unsigned long  len;
+    unsigned long  crc;
+    char           md5[33];
+    size_t         order;
+} sum_contig_t;
+
+int            summary       = 0;
+char          *sum_org       = NULL;
+sum_contig_t  *sum_contigs   = NULL;
+size_t         sum_n = 0, sum_max = 0;
+
+/*  crc_slice[k][b] is the crc of byte b followed by k zero bytes, which
+ *  lets crc_update() take 8 bytes per step.  crc_slice[0] is crctab.
+ */
+
+crc_value_t    crc_slice[8][256];
 
 
 int main ( int argc, char **argv ) {
-    int    infile, index_interval;
-    char  *bptr, *org_id, *file_num, *file_name;
-    unsigned int  c;
+    int       index_interval, nthreads, njob, maxjob;
+    char     *org_id, *file_num, *file_name;
+    job_t    *jobs, job;
+    reader_t *rd;
 
     /* -v flag returns version */
 
@@ -209,6 +458,42 @@ int main ( int argc, char **argv ) {
         return 0;
     }
 
+    nthreads = 1;
+    while ( ( argc >= 2 ) && ( argv[1][0] == '-' ) ) {
+        if ( ( argc < 3 ) && strcmp( argv[1], "-g" ) && strcmp( argv[1], "-l" ) && strcmp( argv[1], "-s" ) ) usage( argv[0] );
+        if ( strcmp( argv[1], "-j" ) == 0 ) {
+            if ( sscanf( argv[2], "%d", &nthreads ) != 1 || nthreads < 0 ) usage( argv[0] );
+            if ( nthreads == 0 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+            if ( nthreads < 1 ) nthreads = 1;
+        }
+        else if ( strcmp( argv[1], "-2" ) == 0 ) {
+            if ( ! argv[2][0] || strchr( argv[2], '/' ) ) usage( argv[0] );
+            twobit_name = argv[2];
+        }
+        else if ( strcmp( argv[1], "-c" ) == 0 ) {
+            if ( ! argv[2][0] || strchr( argv[2], '/' ) ) usage( argv[0] );
+            comp_name = argv[2];
+        }
+        else if ( strcmp( argv[1], "-w" ) == 0 ) {
+            if ( sscanf( argv[2], "%d", &comp_window ) != 1 ) usage( argv[0] );
+            if ( comp_window < 1 || comp_window > COMP_MAX_WINDOW ) {
+                fprintf( stderr, "window (%d) must be 1 to %d\n", comp_window, COMP_MAX_WINDOW );
+                usage( argv[0] );
+            }
+        }
+        else if ( strcmp( argv[1], "-g" ) == 0 || strcmp( argv[1], "-l" ) == 0 || strcmp( argv[1], "-s" ) == 0 ) {
+            if      ( argv[1][1] == 'g' ) geometry     = 1;
+            else if ( argv[1][1] == 'l' ) lengths_only = 1;
+            else                          summary      = 1;
+            argc--;
+            argv++;
+            continue;
+        }
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+
     if ( ( argc == 2 ) && ( sscanf( argv[1], "%d", &index_interval ) == 1 ) ) {
         if ( index_interval < 100 ) {
             fprintf( stderr, "index_interval (%d) must be >= 100\n", index_interval );
@@ -222,77 +507,252 @@ int main ( int argc, char **argv ) {
         usage( argv[0] );
     }
 
-    org_id = inpbuf;
+    init_crc();
+
+    /*  On one thread, each file is indexed as it is read from the list,
+     *  and its records are written as they are found.
+     */
+
+    if ( nthreads == 1 ) {
+        rd = new_reader();
+        memset( &job, 0, sizeof( job ) );
+        job.out.fp = stdout;
+        job.err.fp = stderr;
+        while ( fgets( inpbuf, INPLEN,  stdin ) ) {
+            if ( split_line( inpbuf, &job.org_id, &job.file_num, &job.file_name ) ) continue;
+            summary_org( &job );
+            (void) index_job( &job, rd, index_interval );
+            out_flush( &job.out );
+            out_flush( &job.err );
+            write_2bit( &job );
+            write_comp( &job );
+            add_summary( &job );
+        }
+        finish_2bit();
+        finish_comp();
+        finish_summary();
+        free( job.out.data );
+        free( job.err.data );
+        free( job.tb.data );
+        free( job.cb.data );
+        free( job.sb.data );
+        free_reader( rd );
+        return 0;
+    }
+
+    /*  Otherwise, the list is read, and the files are indexed on a pool
+     *  of threads, with the records of each file written in list order.
+     */
+
+    jobs   = NULL;
+    njob   = 0;
+    maxjob = 0;
     while ( fgets( inpbuf, INPLEN,  stdin ) ) {
-	bptr = inpbuf;
+        if ( split_line( inpbuf, &org_id, &file_num, &file_name ) ) continue;
+        if ( njob >= maxjob ) {
+            maxjob = maxjob ? 2 * maxjob : 1024;
+            jobs = (job_t *) xrealloc( jobs, maxjob * sizeof( job_t ) );
+        }
+        memset( jobs + njob, 0, sizeof( job_t ) );
+        jobs[njob].org_id    = strdup( org_id );
+        jobs[njob].file_num  = strdup( file_num );
+        jobs[njob].file_name = strdup( file_name );
+        if ( ! jobs[njob].org_id || ! jobs[njob].file_num || ! jobs[njob].file_name ) {
+            fprintf( stderr, "index_contig_files: out of memory\n" );
+            exit( 1 );
+        }
+        njob++;
+    }
+
+    return index_files( jobs, njob, nthreads, index_interval );
+}
 
-	/*  Find the end of the organism id */
 
-	while ( ( c = *bptr ) && ( c != '\t' ) ) bptr++;
-	if ( ! c ) continue;
-	*bptr++ = '\0';   /* convert tab to end-of-string */
-	file_num = bptr;  /* next character is start of file number */
+/*  Split a line of the file list in place.  Returns nonzero if it does
+ *  not have three fields.
+ */
 
-	/*  Find the end of the file number */
+int split_line( char *line, char **org_id, char **file_num, char **file_name ) {
+    char          *bptr;
+    unsigned int   c;
 
-	while ( ( c = *bptr ) && ( c != '\t' ) ) bptr++;
-	if ( ! c ) continue;
-	*bptr++ = '\0';    /* convert tab to end-of-string */
-	file_name = bptr;  /* next character is start of file name */
+    bptr = line;
+    *org_id = line;
 
-	/*  Find the end of the file name (strip the newline) */
+    /*  Find the end of the organism id */
 
-	while ( ( c = *bptr ) && ( c != '\n' ) && ( c != '\r' ) ) bptr++;
-	*bptr++ = '\0';    /* convert newline to end-of-string */
+    while ( ( c = *bptr ) && ( c != '\t' ) ) bptr++;
+    if ( ! c ) return 1;
+    *bptr++ = '\0';    /* convert tab to end-of-string */
+    *file_num = bptr;  /* next character is start of file number */
 
-	/*  Open the file and pass the descriptor pointer to the reader */
+    /*  Find the end of the file number */
 
-	if ( ( infile = open( file_name, O_RDONLY, 0 ) ) < 0 ) {
-	    fprintf( stderr, "Failed to open contigs file: %s\n", file_name );
-	    continue;
-	}
-	(void) index_one( org_id, file_num, infile, index_interval );
-	(void) close( infile );
-    }
+    while ( ( c = *bptr ) && ( c != '\t' ) ) bptr++;
+    if ( ! c ) return 1;
+    *bptr++ = '\0';     /* convert tab to end-of-string */
+    *file_name = bptr;  /* next character is start of file name */
+
+    /*  Find the end of the file name (strip the newline) */
+
+    while ( ( c = *bptr ) && ( c != '\n' ) && ( c != '\r' ) ) bptr++;
+    *bptr = '\0';       /* convert newline to end-of-string */
+
+    return 0;
+}
+
+
+/*  Index the files on a pool of threads, writing the output of each file
+ *  in list order.
+ */
+
+int index_files( job_t *jobs, int njob, int nthreads, int index_interval ) {
+    jp_jobs_t   pool;
+    job_list_t  list;
+
+    if ( ! njob ) return 0;
+
+    list.jobs           = jobs;
+    list.index_interval = index_interval;
+    pool.njob  = njob;
+    pool.arg   = &list;
+    pool.begin = begin_index;
+    pool.run   = run_index;
+    pool.write = write_index;
+    pool.end   = end_index;
+    (void) jp_run( &pool, nthreads );
+
+    finish_2bit();
+    finish_comp();
+    finish_summary();
+
+    free( jobs );
+    fflush( stdout );
+    return ferror( stdout ) ? 1 : 0;
+}
+
+
+void *begin_index( void *arg ) {
+    (void) arg;
+    return new_reader();
+}
+
+
+int run_index( void *arg, void *state, int i ) {
+    job_list_t  *list = (job_list_t *) arg;
 
+    (void) index_job( list->jobs + i, (reader_t *) state, list->index_interval );
     return 0;
 }
 
 
-int index_one ( char * org_id, char * file_num, int infile, int index_interval ) {
-    unsigned char  *bptr;
-    /* Maintain an unsigned char version of the current input char, for passing to MD5Update */
-    char   chr;
+void write_index( void *arg, int i ) {
+    job_t  *job = ( (job_list_t *) arg )->jobs + i;
+
+    summary_org( job );
+    if ( job->out.len ) fwrite( job->out.data, 1, job->out.len, stdout );
+    if ( job->err.len ) fwrite( job->err.data, 1, job->err.len, stderr );
+    write_2bit( job );
+    write_comp( job );
+    add_summary( job );
+    free( job->out.data );
+    free( job->err.data );
+    free( job->tb.data );
+    free( job->cb.data );
+    free( job->sb.data );
+    free( job->org_id );
+    free( job->file_num );
+    free( job->file_name );
+}
+
+
+void end_index( void *arg, void *state ) {
+    (void) arg;
+    free_reader( (reader_t *) state );
+}
+
+
+/*  Open the file of a job and pass the descriptor to the reader  */
+
+int index_job( job_t *job, reader_t *rd, int index_interval ) {
+    contig_t       ctg;
+    bgzf_stream_t  stream;
+    unsigned char  hdr[BGZF_HEADER];
+    int            infile, status;
+
+    if ( ( infile = open( job->file_name, O_RDONLY, 0 ) ) < 0 ) {
+        out_printf( &job->err, "Failed to open contigs file: %s\n", job->file_name );
+        return -1;
+    }
+
+    ctg.bgzf = NULL;
+    if (    ( pread( infile, hdr, BGZF_HEADER, 0 ) == BGZF_HEADER )
+         && bgzf_is_bgzf( hdr, BGZF_HEADER )
+       ) {
+        if ( bgzf_stream_init( &stream, infile, 0 ) ) {
+            fprintf( stderr, "Out of memory\n" );
+            exit( 1 );
+        }
+        ctg.bgzf = &stream;
+    }
+
+    ctg.org_id         = job->org_id;
+    ctg.file_num       = job->file_num;
+    ctg.index_interval = index_interval;
+    ctg.rd             = rd;
+    ctg.out            = &job->out;
+    ctg.err            = &job->err;
+    ctg.pack           = twobit_name ? &rd->pack : NULL;
+    ctg.tb             = &job->tb;
+    ctg.comp           = comp_name ? &rd->comp : NULL;
+    ctg.cb             = &job->cb;
+    ctg.sb             = summary ? &job->sb : NULL;
+    ctg.seeks          = geometry ? &rd->seeks : &job->out;
+    status = index_one( &ctg, infile );
+    if ( ctg.bgzf ) {
+        if ( status < 0 ) out_printf( &job->err, "Bad blocked gzip contigs file: %s\n", job->file_name );
+        bgzf_stream_free( &stream );
+    }
+    (void) close( infile );
+    return status;
+}
+
+
+int index_one ( contig_t *ctg, int infile ) {
+    unsigned char  *buffer = ctg->rd->buffer;
+    char           *idbuf  = ctg->rd->idbuf;
+    unsigned char  *bptr, *nl;
     unsigned long   c;
-    unsigned long   seqlen;
-    crc_value_t     crc;
-    MD5_CTX	    ctx;
-    long long       seek;
-    int             idlen, ntogo, nfills, index_point, nerror;
+    int             idlen, ntogo, n;
 
     idbuf[0] = '\0';  /* initialize to empty string */
-    index_point = 0;
     bptr   = buffer;
     ntogo  = 0;
-    nfills = 0;
-    seqlen = 0;
-    nerror = 0;
-    crc    = 0;
-    MD5Init(&ctx);
+    ctg->fill_seek = 0;
+    ctg->next_seek = 0;
+
+    ctg->index_point = 0;
+    ctg->seqlen      = 0;
+    ctg->crc         = 0;
+    ctg->nerror      = 0;
+    ctg->rd->md5len  = 0;
+    MD5Init(&ctg->ctx);
+    if ( ctg->pack ) c2b_contig_reset( ctg->pack );
+    if ( ctg->comp ) comp_contig_reset( ctg->comp );
+    geo_reset( ctg );
 
     /* Next line in file */
 
     while ( 1 ) {
         if ( ntogo <= 0 ) {
-            ntogo = read( infile, (void *) buffer, (size_t) BUFLEN );
+            ntogo = fill_buffer( ctg, infile );
             if ( ntogo <= 0 ) {
-                report_len( org_id, idbuf, seqlen, crc, &ctx );
+                report_len( ctg );
                 return ntogo;
             }
-            nfills++; bptr= buffer;
+            bptr = buffer;
         }
         c = *bptr++; ntogo--;
-	chr = tolower(c);
 
         /* could be > or sequence */
 
@@ -300,141 +760,315 @@ int index_one ( char * org_id, char * file_num, int infile, int index_interval )
 
             /*  Is there a length to report?  */
 
-            report_len( org_id, idbuf, seqlen, crc, &ctx );
-            seqlen = 0;
-	    MD5Init(&ctx);
-            crc = 0;
+            report_len( ctg );
+            ctg->seqlen = 0;
+	    MD5Init(&ctg->ctx);
+            ctg->crc = 0;
+            geo_reset( ctg );
 
             /*  Make a copy of the new id  */
 
             idlen = 0;
 	    if ( ntogo <= 0 ) {
-		ntogo = read( infile, (void *) buffer, (size_t) BUFLEN );
+		ntogo = fill_buffer( ctg, infile );
 		if ( ntogo <= 0 ) {
-		    report_len( org_id, idbuf, seqlen, crc, &ctx );
+		    report_len( ctg );
 		    return ntogo;
 		}
-		nfills++; bptr = buffer;
+		bptr = buffer;
 	    }
 	    c = *bptr++; ntogo--;
-	    chr = tolower(c);
             while ( ( ! isspace(c) ) && ( idlen < IDLEN ) ) {
                 idbuf[ idlen++ ] = c;
 		if ( ntogo <= 0 ) {
-		    ntogo = read( infile, (void *) buffer, (size_t) BUFLEN );
+		    ntogo = fill_buffer( ctg, infile );
 		    if ( ntogo <= 0 ) {
-		        report_len( org_id, idbuf, seqlen, crc, &ctx );
+		        report_len( ctg );
 		        return ntogo;
 		    }
-		    nfills++; bptr = buffer;
+		    bptr = buffer;
 		}
 		c = *bptr++; ntogo--;
-		chr = tolower(c);
             }
             idbuf[ idlen ] = '\0';
 
             /*  report truncated id  */
 
             if ( ! isspace(c) ) {
-                fprintf( stderr, "For organism %s, contig id truncated to %d characters:\n", org_id, (int) IDLEN );
-                fprintf( stderr, ">%s\n", idbuf );
+                out_printf( ctg->err, "For organism %s, contig id truncated to %d characters:\n", ctg->org_id, (int) IDLEN );
+                out_printf( ctg->err, ">%s\n", idbuf );
             }
 
             /*  Flush the rest of the input line  */
 
             while ( c != '\n' ) {
 		if ( ntogo <= 0 ) {
-		    ntogo = read( infile, (void *) buffer, (size_t) BUFLEN );
+		    ntogo = fill_buffer( ctg, infile );
 		    if ( ntogo <= 0 ) {
-		        report_len( org_id, idbuf, seqlen, crc, &ctx );
+		        report_len( ctg );
 		        return ntogo;
 		    }
-		    nfills++; bptr = buffer;
+		    bptr = buffer;
 		}
 		c = *bptr++; ntogo--;
-		chr = tolower(c);
             }
 
-            index_point = 0;  /*  next sequence milestone to report  */
+            ctg->index_point = 0;  /*  next sequence milestone to report  */
         }
 
-        /*  Not an id line, so it's data:  */
+        /*  Not an id line, so it's data.  Back up to its first character,
+         *  and index it in spans that end at the newline or at the end of
+         *  the buffer.
+         */
 
         else {
-            while ( c != '\n' ) {
-                if ( isnuc( c ) ) {
+            bptr--; ntogo++;
+            geo_line_start( ctg, ctg->fill_seek + ( bptr - buffer ) );
+            while ( 1 ) {
+                nl = (unsigned char *) memchr( bptr, '\n', (size_t) ntogo );
+                n  = nl ? nl - bptr : ntogo;
+                index_span( ctg, bptr, n, ctg->fill_seek + ( bptr - buffer ) );
+                bptr += n; ntogo -= n;
+                if ( nl ) {
+                    bptr++; ntogo--;   /*  the newline  */
+                    geo_line_end( ctg, 1 );
+                    break;
+                }
+
+		ntogo = fill_buffer( ctg, infile );
+		if ( ntogo <= 0 ) {
+		    report_len( ctg );
+		    return ntogo;
+		}
+		bptr = buffer;
+            }
+        }
+    }
 
-                    /*  If we are at the next index point, record the seek location  */
+    return( 0 );   /*  never get here  */
+}
 
-                    if ( ( seqlen >= index_point ) && idbuf[0] ) {
-                        seek = ( nfills - 1 ) * (long long) BUFLEN
-                             + ( bptr - buffer - 1 );
-                        printf( "%s\t%s\t%d\t%d\t%s\t%lld\n", org_id, idbuf,
-                                 index_point, index_point, file_num, seek
-                              );
-                        index_point += index_interval;
-                    }
-                    seqlen++;
-                    crc = (crc << 8) ^ crctab[ (crc >> 24) ^ c ];
-		    MD5Update(&ctx, (const U8 *) &chr, 1);
-                }
 
-                /*  All non-nucleotides should be white space */
+/*  Read the next buffer of the file, or with blocked gzip, the next block
+ *  (which is at most BGZF_MAXBLOCK bytes), and set the seek of its start.
+ *  Returns the number of bytes read, 0 at the end of the file, or -1 on
+ *  error.
+ */
+
+int fill_buffer( contig_t *ctg, int infile ) {
+    uint64_t  coffset;
+    long      n;
+
+    if ( ctg->bgzf ) {
+        n = bgzf_stream_next( ctg->bgzf, (char *) ctg->rd->buffer, &coffset );
+        if ( n > 0 ) ctg->fill_seek = (long long) BGZF_VSEEK( coffset, 0 );
+        return (int) n;
+    }
+
+    n = read( infile, (void *) ctg->rd->buffer, (size_t) BUFLEN );
+    if ( n > 0 ) {
+        ctg->fill_seek  = ctg->next_seek;
+        ctg->next_seek += n;
+    }
+    return (int) n;
+}
 
-                else if ( ! isspace( c ) ) {
 
-                    /*  Current perl code counts illegal characters as nucleotides;
-                     *  so (for now) we do the same
-                     */
+/*  Index n characters of a sequence line, the first of which is at file
+ *  offset seek.  Nucleotides are taken a run at a time: the seeks of any
+ *  index points in the run are reported, and its characters are added to
+ *  the crc and (lower cased) to the MD5.  Anything else that is not white
+ *  space is counted as a nucleotide, as the perl code does, and reported.
+ */
 
-                    if ( ( seqlen >= index_point ) && idbuf[0] ) {
-                        seek = ( nfills - 1 ) * (long long) BUFLEN
-                             + ( bptr - buffer - 1 );
-                        printf( "%s\t%s\t%d\t%d\t%s\t%lld\n", org_id, idbuf,
-                                index_point, index_point, file_num, seek
+void index_span( contig_t *ctg, const unsigned char *p, int n, long long seek ) {
+    const char    *idbuf = ctg->rd->idbuf;
+    reader_t      *rd    = ctg->rd;
+    unsigned long  c;
+    int            i, run;
+
+    i = 0;
+    while ( i < n ) {
+        if ( ctg->line_cr ) ctg->geo_ok = 0;   /*  \r inside a line  */
+        if ( ( run = nuc_run( p + i, n - i ) ) > 0 ) {
+            if ( idbuf[0] && ! lengths_only ) {
+                while ( ctg->seqlen + run > (unsigned long) ctg->index_point ) {
+                    out_printf( ctg->seeks, "%s\t%s\t%ld\t%ld\t%s\t%lld\n", ctg->org_id, idbuf,
+                                ctg->index_point, ctg->index_point, ctg->file_num,
+                                seek + i + ( ctg->index_point - (long) ctg->seqlen )
                               );
-                        index_point += index_interval;
-                    }
-                    seqlen++;
-                    crc = (crc << 8) ^ crctab[ (crc >> 24) ^ c ];
-		    MD5Update(&ctx, (const U8 *) &chr, 1);
-
-                    /*  But let's add an error message: */
-
-                    if ( nerror++ <= MAXERROR ) {
-                        if ( nerror <= MAXERROR ) {
-                            fprintf( stderr, "Invalid nucleotide (%ld) in %s contig %s\n",
-                                              c, org_id, idbuf
-                                   );
-                        }
-                        else {
-                            fprintf( stderr, "Etc.\n");
-                        }
-                    }
+                    ctg->index_point += ctg->index_interval;
                 }
+            }
+            ctg->seqlen += run;
+            ctg->crc = crc_update( ctg->crc, p + i, run );
+            md5_stage( rd, &ctg->ctx, p + i, run );
+            if ( ctg->pack && idbuf[0] ) pack_bases( ctg, p + i, run );
+            if ( ctg->comp && idbuf[0] ) count_bases( ctg, p + i, run );
+            i += run;
+            if ( i >= n ) break;
+        }
+
+        c = p[ i++ ];
+        if ( isspace( c ) ) {
+            if ( ( c == '\r' ) && ( i == n ) ) ctg->line_cr = 1;
+            else                               ctg->geo_ok  = 0;
+            continue;
+        }
 
-                /*  Next character  */
+        /*  Current perl code counts illegal characters as nucleotides;
+         *  so (for now) we do the same
+         */
 
-		if ( ntogo <= 0 ) {
-		    ntogo = read( infile, (void *) buffer, (size_t) BUFLEN );
-		    if ( ntogo <= 0 ) {
-		        report_len( org_id, idbuf, seqlen, crc, &ctx );
-		        return ntogo;
-		    }
-		    nfills++; bptr = buffer;
-		}
-		c = *bptr++; ntogo--;
-		chr = tolower(c);
+        if ( ( ctg->seqlen >= (unsigned long) ctg->index_point ) && idbuf[0] && ! lengths_only ) {
+            out_printf( ctg->seeks, "%s\t%s\t%ld\t%ld\t%s\t%lld\n", ctg->org_id, idbuf,
+                        ctg->index_point, ctg->index_point, ctg->file_num, seek + i - 1
+                      );
+            ctg->index_point += ctg->index_interval;
+        }
+        ctg->seqlen++;
+        ctg->crc = (ctg->crc << 8) ^ crctab[ (ctg->crc >> 24) ^ c ];
+        rd->md5buf[ rd->md5len++ ] = tolower(c);
+        if ( rd->md5len == MD5LEN ) md5_flush( rd, &ctg->ctx );
+        if ( ctg->pack && idbuf[0] ) pack_bases( ctg, p + i - 1, 1 );
+        if ( ctg->comp && idbuf[0] ) count_bases( ctg, p + i - 1, 1 );
+
+        /*  But let's add an error message: */
+
+        if ( ctg->nerror++ <= MAXERROR ) {
+            if ( ctg->nerror <= MAXERROR ) {
+                out_printf( ctg->err, "Invalid nucleotide (%ld) in %s contig %s\n",
+                                      c, ctg->org_id, idbuf
+                          );
+            }
+            else {
+                out_printf( ctg->err, "Etc.\n");
             }
         }
     }
+}
 
-    return( 0 );   /*  never get here  */
+
+/*  The length of the run of nucleotides at the start of p.  Blocks of 16
+ *  that are all A, C, G, T or N (either case) are tested together.
+ */
+
+int nuc_run( const unsigned char *p, int n ) {
+    int  i = 0;
+
+#ifdef USE_SSE2
+    const __m128i  lc = _mm_set1_epi8( 0x20 );
+    const __m128i  a  = _mm_set1_epi8( 'a' );
+    const __m128i  cc = _mm_set1_epi8( 'c' );
+    const __m128i  g  = _mm_set1_epi8( 'g' );
+    const __m128i  t  = _mm_set1_epi8( 't' );
+    const __m128i  nn = _mm_set1_epi8( 'n' );
+    __m128i        v, m;
+
+    while ( 1 ) {
+        while ( n - i >= 16 ) {
+            v = _mm_or_si128( _mm_loadu_si128( (const __m128i *) ( p + i ) ), lc );
+            m = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, a ), _mm_cmpeq_epi8( v, cc ) ),
+                              _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( v, g ), _mm_cmpeq_epi8( v, t ) ),
+                                            _mm_cmpeq_epi8( v, nn ) ) );
+            if ( _mm_movemask_epi8( m ) != 0xFFFF ) break;
+            i += 16;
+        }
+
+        /*  Other nucleotides are tested one at a time, up to the next
+         *  block boundary
+         */
+
+        if ( i >= n || ! isnuc( p[i] ) ) return i;
+        do { i++; } while ( ( i & 15 ) && ( i < n ) && isnuc( p[i] ) );
+        if ( i >= n || ! isnuc( p[i] ) ) return i;
+    }
+#else
+    while ( ( i < n ) && isnuc( p[i] ) ) i++;
+    return i;
+#endif
+}
+
+
+/*============================================================================
+ *  Checksums
+ *==========================================================================*/
+
+void init_crc( void ) {
+    crc_value_t  v;
+    int          b, k;
+
+    for ( b = 0; b < 256; b++ ) {
+        v = crc_slice[0][b] = crctab[b];
+        for ( k = 1; k < 8; k++ ) {
+            v = crc_slice[k][b] = ( v << 8 ) ^ crctab[ v >> 24 ];
+        }
+    }
+}
+
+
+/*  The crc of n more bytes, 8 at a time  */
+
+crc_value_t crc_update( crc_value_t crc, const unsigned char *p, int n ) {
+    while ( n >= 8 ) {
+        crc ^= ( (crc_value_t) p[0] << 24 ) | ( (crc_value_t) p[1] << 16 )
+             | ( (crc_value_t) p[2] <<  8 ) |   (crc_value_t) p[3];
+        crc  = crc_slice[7][ crc >> 24 ]          ^ crc_slice[6][ ( crc >> 16 ) & 0xFF ]
+             ^ crc_slice[5][ ( crc >> 8 ) & 0xFF ] ^ crc_slice[4][ crc & 0xFF ]
+             ^ crc_slice[3][ p[4] ] ^ crc_slice[2][ p[5] ]
+             ^ crc_slice[1][ p[6] ] ^ crc_slice[0][ p[7] ];
+        p += 8;
+        n -= 8;
+    }
+    while ( n-- > 0 ) crc = ( crc << 8 ) ^ crc_slice[0][ ( crc >> 24 ) ^ *p++ ];
+    return crc;
+}
+
+
+/*  Copy nucleotides, lower cased, to the MD5 buffer, which is passed to
+ *  MD5Update() whenever it is full.  Every character of a nucleotide
+ *  span is a letter, so lower casing is setting the 0x20 bit.
+ */
+
+void md5_stage( reader_t *rd, MD5_CTX *ctx, const unsigned char *p, int n ) {
+    unsigned char  *q;
+    int             k, i;
+
+    while ( n > 0 ) {
+        k = MD5LEN - rd->md5len;
+        if ( k > n ) k = n;
+        q = rd->md5buf + rd->md5len;
+        i = 0;
+#ifdef USE_SSE2
+        for ( ; i + 16 <= k; i += 16 ) {
+            _mm_storeu_si128( (__m128i *) ( q + i ),
+                              _mm_or_si128( _mm_loadu_si128( (const __m128i *) ( p + i ) ),
+                                            _mm_set1_epi8( 0x20 ) ) );
+        }
+#endif
+        for ( ; i < k; i++ ) q[i] = p[i] | 0x20;
+        rd->md5len += k;
+        p += k;
+        n -= k;
+        if ( rd->md5len == MD5LEN ) md5_flush( rd, ctx );
+    }
 }
 
 
-void report_len( char * org, char * id, unsigned long seqlen, crc_value_t crc, MD5_CTX *ctx ) {
-    if ( seqlen && id && id[0] ) {
+void md5_flush( reader_t *rd, MD5_CTX *ctx ) {
+    if ( rd->md5len ) MD5Update( ctx, (const U8 *) rd->md5buf, (STRLEN) rd->md5len );
+    rd->md5len = 0;
+}
+
+
+void report_len( contig_t *ctg ) {
+    const char   *id = ctg->rd->idbuf;
+    crc_value_t   crc = ctg->crc;
+
+    md5_flush( ctg->rd, &ctg->ctx );
+    if ( ctg->line_open ) geo_line_end( ctg, 0 );
+    if ( geometry && ! lengths_only ) report_seeks( ctg );
+    if ( ctg->seqlen && id[0] ) {
 
 	unsigned char digest[16];
 	char result[33];
@@ -442,7 +1076,7 @@ void report_len( char * org, char * id, unsigned long seqlen, crc_value_t crc, M
         /*  Finish the crc calculation with length bytes, ...  */
 
         crc_value_t n;
-        n = seqlen;
+        n = ctg->seqlen;
         while (n != 0) {
             crc = (crc << 8) ^ crctab[ (crc >> 24) ^ (n & 0xFF) ];
             n >>= 8;
@@ -450,16 +1084,432 @@ void report_len( char * org, char * id, unsigned long seqlen, crc_value_t crc, M
 
         /*  ... and bitwise complement  */
 
-	MD5Final(digest, ctx);
+	MD5Final(digest, &ctg->ctx);
 	hex_16(digest, result);
-        printf( "%s\t%s\t%lu\t%u\t%s\n", org, id, seqlen, ~crc, result  );
+        out_printf( ctg->out, "%s\t%s\t%lu\t%u\t%s\n", ctg->org_id, id, ctg->seqlen, ~crc, result  );
+        if ( ctg->sb ) out_printf( ctg->sb, "%s\t%lu\t%u\t%s\n", id, ctg->seqlen, ~crc, result );
+
+        if ( ctg->pack ) add_2bit_record( ctg );
+        if ( ctg->comp ) add_comp_record( ctg );
+    }
+    if ( ctg->pack ) c2b_contig_reset( ctg->pack );
+    if ( ctg->comp ) comp_contig_reset( ctg->comp );
+}
+
+
+/*============================================================================
+ *  Line geometry
+ *==========================================================================*/
+
+/*  With -g, the seek records of a contig are held until its end.  If its
+ *  lines were regular, they are replaced by the seek of nucleotide 0 and
+ *  a geometry record.
+ */
+
+void report_seeks( contig_t *ctg ) {
+    const char  *id = ctg->rd->idbuf;
+    outbuf_t    *seeks = ctg->seeks;
+
+    if ( ctg->seqlen && id[0] && ctg->geo_ok && ctg->geo_bases ) {
+        out_printf( ctg->out, "%s\t%s\t%ld\t%ld\t%s\t%lld\n", ctg->org_id, id,
+                    0L, 0L, ctg->file_num, ctg->geo_offset
+                  );
+        out_printf( ctg->out, "%s\t%s\t%lu\t%s\t%lld\t%ld\t%ld\n", ctg->org_id, id,
+                    ctg->seqlen, ctg->file_num, ctg->geo_offset,
+                    ctg->geo_bases, ctg->geo_bases + ctg->geo_term
+                  );
+    }
+    else if ( seeks->len ) {
+        out_reserve( ctg->out, seeks->len );
+        memcpy( ctg->out->data + ctg->out->len, seeks->data, seeks->len );
+        ctg->out->len += seeks->len;
+    }
+    seeks->len = 0;
+}
+
+
+void geo_reset( contig_t *ctg ) {
+    ctg->line_open = 0;
+    ctg->line_cr   = 0;
+    ctg->geo_ok    = ! ctg->bgzf;
+    ctg->geo_done  = 0;
+    ctg->geo_bases = 0;
+    ctg->geo_term  = 0;
+}
+
+
+void geo_line_start( contig_t *ctg, long long seek ) {
+    ctg->line_seek  = seek;
+    ctg->line_start = ctg->seqlen;
+    ctg->line_open  = 1;
+    ctg->line_cr    = 0;
+}
+
+
+/*  A line of n nucleotides is regular if n is the line length, or less
+ *  on the last line with nucleotides (blank lines may follow it).  The
+ *  line at the end of the file need not have a terminator.
+ */
+
+void geo_line_end( contig_t *ctg, int has_nl ) {
+    long  n = (long) ( ctg->seqlen - ctg->line_start );
+    int   term = ctg->line_cr + has_nl;
+
+    ctg->line_open = 0;
+    if ( ! ctg->geo_ok ) return;
+
+    if ( n == 0 ) {
+        ctg->geo_done = 1;
+    }
+    else if ( ctg->geo_done ) {
+        ctg->geo_ok = 0;
+    }
+    else if ( ctg->geo_bases == 0 ) {
+        ctg->geo_bases  = n;
+        ctg->geo_term   = has_nl ? term : ctg->line_cr + 1;
+        ctg->geo_offset = ctg->line_seek;
+    }
+    else if ( has_nl && ( term != ctg->geo_term ) ) {
+        ctg->geo_ok = 0;
+    }
+    else if ( n < ctg->geo_bases ) {
+        ctg->geo_done = 1;
+    }
+    else if ( n > ctg->geo_bases ) {
+        ctg->geo_ok = 0;
+    }
+}
+
+
+/*============================================================================
+ *  2-bit contig files
+ *==========================================================================*/
+
+void pack_bases( contig_t *ctg, const unsigned char *p, int n ) {
+    if ( c2b_contig_add( ctg->pack, p, (size_t) n ) ) {
+        fprintf( stderr, "index_contig_files: out of memory\n" );
+        exit( 1 );
+    }
+}
+
+
+/*  A packed contig is added to the buffer of its job as:
+ *
+ *      uint64 name_len, uint64 rec_len, name (padded to 8), record
+ *
+ *  for the main thread to write to the file of the genome.
+ */
+
+void add_2bit_record( contig_t *ctg ) {
+    const char  *id = ctg->rd->idbuf;
+    uint64_t     len[2];
+    size_t       name_pad;
+
+    len[0] = strlen( id );
+    len[1] = c2b_record_size( ctg->pack );
+    name_pad = ( len[0] + 7 ) & ~(size_t) 7;
+    out_reserve( ctg->tb, sizeof( len ) + name_pad + len[1] );
+    memcpy( ctg->tb->data + ctg->tb->len, len, sizeof( len ) );
+    memset( ctg->tb->data + ctg->tb->len + sizeof( len ), 0, name_pad );
+    memcpy( ctg->tb->data + ctg->tb->len + sizeof( len ), id, len[0] );
+    c2b_record( ctg->pack, (unsigned char *) ctg->tb->data + ctg->tb->len + sizeof( len ) + name_pad );
+    ctg->tb->len += sizeof( len ) + name_pad + len[1];
+}
+
+
+/*  Write the packed contigs of a job to the 2-bit file of its genome, in
+ *  the directory of its contigs file.  The files of a genome must be
+ *  together in the list; a new genome finishes the file of the last one.
+ */
+
+void write_2bit( job_t *job ) {
+    const char  *p, *end;
+    uint64_t     len[2];
+    char        *path;
+
+    if ( ! twobit_name ) return;
+
+    if ( ! twobit_org || strcmp( twobit_org, job->org_id ) ) {
+        finish_2bit();
+        twobit_org = strdup( job->org_id );
+        path = side_path( job, twobit_name );
+        if ( ! ( twobit_writer = c2b_writer( path ) ) ) {
+            fprintf( stderr, "index_contig_files: could not write %s\n", path );
+        }
+        free( path );
+    }
+
+    if ( twobit_writer ) {
+        p   = job->tb.data;
+        end = p + job->tb.len;
+        while ( p < end ) {
+            memcpy( len, p, sizeof( len ) );
+            p += sizeof( len );
+            (void) c2b_write_record( twobit_writer, p, len[0],
+                                     (const unsigned char *) p + ( ( len[0] + 7 ) & ~(uint64_t) 7 ), len[1] );
+            p += ( ( len[0] + 7 ) & ~(uint64_t) 7 ) + len[1];
+        }
+    }
+    job->tb.len = 0;
+}
+
+
+void finish_2bit( void ) {
+    if ( twobit_writer && c2b_writer_finish( twobit_writer ) ) {
+        fprintf( stderr, "index_contig_files: could not write the 2-bit file of %s\n", twobit_org );
+    }
+    twobit_writer = NULL;
+    free( twobit_org );
+    twobit_org = NULL;
+}
+
+
+/*  The path of a file of the genome of a job, in the directory of its
+ *  contigs file
+ */
+
+char *side_path( job_t *job, const char *name ) {
+    const char  *slash;
+    char        *path;
+    size_t       dlen;
+
+    slash = strrchr( job->file_name, '/' );
+    dlen  = slash ? (size_t) ( slash - job->file_name ) + 1 : 0;
+    path  = (char *) xrealloc( NULL, dlen + strlen( name ) + 1 );
+    memcpy( path, job->file_name, dlen );
+    strcpy( path + dlen, name );
+    return path;
+}
+
+
+/*============================================================================
+ *  Composition files
+ *==========================================================================*/
+
+void count_bases( contig_t *ctg, const unsigned char *p, int n ) {
+    if ( comp_contig_add( ctg->comp, p, (size_t) n ) ) {
+        fprintf( stderr, "index_contig_files: out of memory\n" );
+        exit( 1 );
+    }
+}
+
+
+/*  Composition records are added to the buffer of the job in the same form
+ *  as packed contigs, for write_comp().
+ */
+
+void add_comp_record( contig_t *ctg ) {
+    const char  *id = ctg->rd->idbuf;
+    uint64_t     len[2];
+    size_t       name_pad;
+
+    len[0] = strlen( id );
+    len[1] = comp_record_size( ctg->comp );
+    name_pad = ( len[0] + 7 ) & ~(size_t) 7;
+    out_reserve( ctg->cb, sizeof( len ) + name_pad + len[1] );
+    memcpy( ctg->cb->data + ctg->cb->len, len, sizeof( len ) );
+    memset( ctg->cb->data + ctg->cb->len + sizeof( len ), 0, name_pad );
+    memcpy( ctg->cb->data + ctg->cb->len + sizeof( len ), id, len[0] );
+    comp_record( ctg->comp, (unsigned char *) ctg->cb->data + ctg->cb->len + sizeof( len ) + name_pad );
+    ctg->cb->len += sizeof( len ) + name_pad + len[1];
+}
+
+
+void write_comp( job_t *job ) {
+    const char  *p, *end;
+    uint64_t     len[2];
+    char        *path;
+
+    if ( ! comp_name ) return;
+
+    if ( ! comp_org || strcmp( comp_org, job->org_id ) ) {
+        finish_comp();
+        comp_org = strdup( job->org_id );
+        path = side_path( job, comp_name );
+        if ( ! ( composition_writer = comp_writer( path, (uint32_t) comp_window ) ) ) {
+            fprintf( stderr, "index_contig_files: could not write %s\n", path );
+        }
+        free( path );
+    }
+
+    if ( composition_writer ) {
+        p   = job->cb.data;
+        end = p + job->cb.len;
+        while ( p < end ) {
+            memcpy( len, p, sizeof( len ) );
+            p += sizeof( len );
+            (void) comp_write_record( composition_writer, p, len[0],
+                                      (const unsigned char *) p + ( ( len[0] + 7 ) & ~(uint64_t) 7 ), len[1] );
+            p += ( ( len[0] + 7 ) & ~(uint64_t) 7 ) + len[1];
+        }
+    }
+    job->cb.len = 0;
+}
+
+
+void finish_comp( void ) {
+    if ( composition_writer && comp_writer_finish( composition_writer ) ) {
+        fprintf( stderr, "index_contig_files: could not write the composition file of %s\n", comp_org );
+    }
+    composition_writer = NULL;
+    free( comp_org );
+    comp_org = NULL;
+}
+
+
+/*============================================================================
+ *  Genome summaries
+ *==========================================================================*/
+
+/*  Before the records of a job are written, finish the summary of the
+ *  last genome if the job starts another.
+ */
+
+void summary_org( job_t *job ) {
+    if ( ! summary ) return;
+    if ( sum_org && strcmp( sum_org, job->org_id ) ) finish_summary();
+    if ( ! sum_org && ! ( sum_org = strdup( job->org_id ) ) ) {
+        fprintf( stderr, "index_contig_files: out of memory\n" );
+        exit( 1 );
+    }
+}
+
+
+/*  Add the contigs of a job (lines of Id \t Length \t Crc \t MD5) to those
+ *  of its genome.
+ */
+
+void add_summary( job_t *job ) {
+    sum_contig_t  *c;
+    char          *p, *end, *nl, *f[4];
+    int            i;
+
+    if ( ! summary ) return;
+
+    p   = job->sb.data;
+    end = p + job->sb.len;
+    for ( ; p < end; p = nl + 1 ) {
+        nl = (char *) memchr( p, '\n', (size_t) ( end - p ) );
+        *nl = '\0';
+        f[0] = p;
+        for ( i = 1; i < 4; i++ ) {
+            f[i] = strchr( f[i-1], '\t' );
+            *f[i]++ = '\0';
+        }
+        if ( sum_n >= sum_max ) {
+            sum_max = sum_max ? 2 * sum_max : 1024;
+            sum_contigs = (sum_contig_t *) xrealloc( sum_contigs, sum_max * sizeof( sum_contig_t ) );
+        }
+        c = sum_contigs + sum_n;
+        c->id    = (char *) xrealloc( NULL, strlen( f[0] ) + 1 );
+        strcpy( c->id, f[0] );
+        c->len   = strtoul( f[1], NULL, 10 );
+        c->crc   = strtoul( f[2], NULL, 10 );
+        strncpy( c->md5, f[3], 32 );
+        c->md5[32] = '\0';
+        c->order = sum_n++;
+    }
+    job->sb.len = 0;
+}
+
+
+/*  Write the summary record of the current genome.  The contigs are sorted
+ *  by id (and input order), so the first of each id is counted, and the
+ *  lines of the genome MD5 are in the order of the SIGNATURE file.
+ */
+
+void finish_summary( void ) {
+    MD5_CTX             ctx;
+    unsigned char       digest[16];
+    char                result[33];
+    unsigned long long  total;
+    unsigned long       ncontig, ndup;
+    crc_value_t         cksum;
+    outbuf_t            dups, line;
+    size_t              i;
+
+    if ( ! sum_org ) return;
+
+    qsort( sum_contigs, sum_n, sizeof( sum_contig_t ), cmp_summary );
+
+    memset( &dups, 0, sizeof( dups ) );
+    memset( &line, 0, sizeof( line ) );
+    MD5Init( &ctx );
+    total   = 0;
+    ncontig = 0;
+    ndup    = 0;
+    cksum   = 0;
+    for ( i = 0; i < sum_n; i++ ) {
+        if ( i && ( strcmp( sum_contigs[i].id, sum_contigs[i-1].id ) == 0 ) ) {
+            if ( ( i < 2 ) || strcmp( sum_contigs[i].id, sum_contigs[i-2].id ) ) {   /* first repeat */
+                out_printf( &dups, "%s%s", ndup ? " " : "", sum_contigs[i].id );
+                ndup++;
+            }
+            continue;
+        }
+        ncontig++;
+        total += sum_contigs[i].len;
+        cksum ^= (crc_value_t) sum_contigs[i].crc;
+        line.len = 0;
+        out_printf( &line, "%s\t%lu\t%s\n", sum_contigs[i].id, sum_contigs[i].len, sum_contigs[i].md5 );
+        MD5Update( &ctx, (U8 *) line.data, (STRLEN) line.len );
+    }
+    MD5Final( digest, &ctx );
+    hex_16( digest, result );
+
+    if ( ncontig ) {
+        printf( "%s\t\t%lu\t%llu\t%u\t%s\t%lu\t%s\n", sum_org, ncontig, total,
+                (unsigned) cksum, result, ndup, dups.len ? dups.data : "" );
+    }
+
+    for ( i = 0; i < sum_n; i++ ) free( sum_contigs[i].id );
+    sum_n = 0;
+    free( dups.data );
+    free( line.data );
+    free( sum_org );
+    sum_org = NULL;
+}
+
+
+int cmp_summary( const void *a, const void *b ) {
+    const sum_contig_t *x = (const sum_contig_t *) a;
+    const sum_contig_t *y = (const sum_contig_t *) b;
+    int                 c;
+
+    if ( ( c = strcmp( x->id, y->id ) ) ) return c;
+    return ( x->order < y->order ) ? -1 : ( x->order > y->order );
+}
+
+
+reader_t *new_reader( void ) {
+    reader_t *rd = (reader_t *) xrealloc( NULL, sizeof( reader_t ) );
+    c2b_contig_init( &rd->pack );
+    comp_contig_init( &rd->comp, (uint32_t) comp_window );
+    memset( &rd->seeks, 0, sizeof( rd->seeks ) );
+    return rd;
+}
+
+
+void free_reader( reader_t *rd ) {
+    c2b_contig_free( &rd->pack );
+    comp_contig_free( &rd->comp );
+    free( rd->seeks.data );
+    free( rd );
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "index_contig_files: out of memory\n" );
+        exit( 1 );
     }
+    return ptr;
 }
 
 
 void usage(char *prog) {
     fprintf( stderr,
-             "Usage:  %s [ index_interval ] < file_list  > seeks_and_lengths\n"
+             "Usage:  %s [ -j nthreads ] [ -2 FileName ] [ -g ] [ -c FileName [ -w window ] ] [ -l ] [ -s ] [ index_interval ] < file_list  > seeks_and_lengths\n"
              "or      %s -v   (to return version number on standard output)\n",
              prog, prog
            );
@@ -21,6 +21,7 @@ use strict;
 use FIG;
 use Carp;
 use Tracer;
+use BGZF;
 
 my $have_md5;
 eval {
@@ -70,6 +71,7 @@ my $temp_dir =  $FIG_Config::temp;
 my $seekfile = "$temp_dir/tmp1.$$";
 my $lenfile  = "$temp_dir/tmp2.$$";
 my $md5file  = "$temp_dir/tmp3.$$";
+my $geomfile = "$temp_dir/tmp4.$$";
 
 my $index_interval = 10000;
 
@@ -95,6 +97,22 @@ my ($mode, @genomes) = FIG::parse_genome_args(@ARGV);
 #  understand.
 #
 #  Version 1.01 requires receiving the md5 checksum from the C program.
+#  Later versions write the same records, so any version >= 1.01 will do.
+#  Version 1.03 can index the files on a thread per processor (-j 0), with
+#  the records still written in the order of the file list.  Version 1.04
+#  can also write the sequence of each genome 2-bit packed (-2 contigs.2bit),
+#  for Contig2Bit.pm; this is done if $FIG_Config::contig_2bit is set.
+#  Version 1.05 records the line geometry of contigs with regular lines
+#  (-g), which go into contig_geometry, with only the seek of nucleotide 0
+#  in contig_seeks.  This is done only if $FIG_Config::contig_geometry is
+#  set, as readers that know only contig_seeks (FIG dna_seq) would then
+#  read from the start of each contig.  Version 1.06 writes the base composition of each
+#  genome's contigs in 1 kb windows to its composition file (-c), which
+#  load_contig_composition loads into contig_composition.  Version 1.08
+#  also indexes contigs files compressed to blocked gzip, with virtual
+#  seeks; the perl below skips them.  Version 1.09 ends each genome with a
+#  summary record (-s) of its contig count, nucleotides, checksum and
+#  signature MD5, which go into COUNTS, VERSION and MD5SUM as they are.
 #
 
 my ( $v, $contigfilelist );
@@ -105,7 +123,7 @@ if (      open INDEX_FILES_PIPE, "index_contig_files -v |"
      and  $v = <INDEX_FILES_PIPE>
      and  close INDEX_FILES_PIPE
      and  chomp $v
-     and  $v eq "1.01"
+     and  $v >= 1.01
    ) {
 
     #
@@ -146,6 +164,7 @@ if (      open INDEX_FILES_PIPE, "index_contig_files -v |"
 open( SEEKS,   ">$seekfile" ) || die "Could not open $seekfile";
 open( LENGTHS, ">$lenfile"  ) || die "Could not open $lenfile";
 open( MD5S, ">$md5file"  ) || die "Could not open $md5file";
+open( GEOMS, ">$geomfile" ) || die "Could not open $geomfile";
 print STDERR "Writing to $seekfile, $lenfile, and $md5file\n";
 
 my $inputpipe;
@@ -155,8 +174,13 @@ my $inputpipe;
 #  fail, but we can still fall back to perl on a failure to open the pipe.)
 #
 
+my $jopt = ( $v >= 1.03 ) ? "-j 0 " : "";
+$jopt .= "-2 contigs.2bit " if $v >= 1.04 && $FIG_Config::contig_2bit;
+$jopt .= "-g " if $v >= 1.05 && $FIG_Config::contig_geometry;
+$jopt .= "-c composition " if $v >= 1.06;
+$jopt .= "-s " if $v >= 1.09;
 if (     $contigfilelist
-     and $inputpipe = "index_contig_files $index_interval < $contigfilelist |"
+     and $inputpipe = "index_contig_files $jopt$index_interval < $contigfilelist |"
      and open( INPIPE, $inputpipe )
    ) {
 	Trace("Harvesting with index_contig_files.") if T(2);
@@ -186,6 +210,20 @@ if (     $contigfilelist
 	    @contig_md5 = ();
 	}
 
+	#  A summary record ends the genome; it replaces our own counts.
+
+	if ( @parts == 8 )
+	{
+	    my ( $n, $ttl, $sum, $gmd5 ) = @parts[ 2 .. 5 ];
+	    if ( ( $n > 0 ) && ( $ttl > 0 ) )
+	    {
+		report_counts( $genome, "$orgroot/$genome", $n, $ttl, $sum, \@contig_md5, $gmd5 );
+	    }
+	    $ncontig = $ttlnuc = $cksum = 0;
+	    @contig_md5 = ();
+	    next;
+	}
+
 	#  Process the new data:
 
 	$id = $parts[1];
@@ -199,6 +237,10 @@ if (     $contigfilelist
 	{
 	    print SEEKS $_;
 	}
+	elsif ( @parts == 7 )
+	{
+	    print GEOMS $_;
+	}
 	elsif ( @parts == 5 )
 	{
 	    $_ =~ s/\t[^\t]+\t[^\n\t]+$//;
@@ -258,7 +300,11 @@ else {
 		#
 		#  Process one contigs file
 		#
-		if ( ( -s "$genomedir/$file" ) && open( FASTA, "<$genomedir/$file" ) )
+		if ( is_bgzf_file( "$genomedir/$file" ) )
+		{
+		    print STDERR "WARNING: $genomedir/$file is blocked gzip, which needs index_contig_files; skipped\n";
+		}
+		elsif ( ( -s "$genomedir/$file" ) && open( FASTA, "<$genomedir/$file" ) )
 		{
 		    my $fileno = $fig->file2N( "$genomedir/$file" );
 		    $_ = <FASTA>;
@@ -335,6 +381,7 @@ else {
 close( SEEKS );
 close( LENGTHS );
 close( MD5S );
+close( GEOMS );
 
 #
 #  Load the database contig_seeks table: -------------------------------------
@@ -373,6 +420,48 @@ if ( @ARGV == 0 )
     $dbf->vacuum_it( "contig_seeks" );
 }
 
+#
+#  Load the database contig_geometry table: ----------------------------------
+#
+#  Contigs with regular lines, with the offset of nucleotide 0, and the
+#  nucleotides and bytes per line (as in a faidx index).  The seek of
+#  nucleotide n is  seek + int( n / linebases ) * linewidth + n % linebases.
+#
+
+if ( @ARGV == 0 )
+{
+    $dbf->drop_table(   tbl  => "contig_geometry" );
+    $dbf->create_table( tbl  => "contig_geometry",
+			flds => "genome varchar(16), "
+			      . "contig varchar(96), "
+			      . "len BIGINT, "
+			      . "fileno INTEGER, "
+			      . "seek BIGINT, "
+			      . "linebases INTEGER, "
+			      . "linewidth INTEGER"
+			);
+}
+else
+{
+    foreach $genome ( @genomes )
+    {
+	eval { $dbf->SQL("DELETE FROM contig_geometry WHERE ( genome = \'$genome\' )") };
+    }
+}
+
+$dbf->load_table( tbl  => "contig_geometry", file => "$geomfile" );
+unlink( "$geomfile" );
+
+if ( @ARGV == 0 )
+{
+    $dbf->create_index( idx  => "contig_geometry_ix",
+			tbl  => "contig_geometry",
+			type => "btree",
+			flds => "genome,contig" );
+
+    $dbf->vacuum_it( "contig_geometry" );
+}
+
 #
 #  Load the database contig_lengths table: -----------------------------------
 #
@@ -471,8 +560,14 @@ sub find_cksum {
     $cksum;
 }
 
+sub is_bgzf_file {
+    my ( $file ) = @_;
+    my $fh;
+    return open( $fh, "<$file" ) && BGZF::is_bgzf( $fh );
+}
+
 sub report_counts {
-    my ( $genome, $genomedir, $ncontig, $ttlnuc, $cksum, $contig_md5 ) = @_;
+    my ( $genome, $genomedir, $ncontig, $ttlnuc, $cksum, $contig_md5, $genome_md5 ) = @_;
 
     my $countfile = "$genomedir/COUNTS";
     if ( open( COUNTS, ">$countfile" ) )
@@ -504,7 +599,7 @@ sub report_counts {
     if (ref($contig_md5) eq "ARRAY")
     {
 	my $dig;
-	if ($have_md5)
+	if ($have_md5 && ! $genome_md5)
 	{
 	    $dig = new Digest::MD5;
 	}
@@ -520,9 +615,9 @@ sub report_counts {
 		print SIG $txt;
 	    }
 
-	    if ($dig)
+	    if ($dig || $genome_md5)
 	    {
-		my $hex = $dig->hexdigest;
+		my $hex = $genome_md5 || $dig->hexdigest;
 		
 		my $md5file = "$genomedir/MD5SUM";
 		if (open(MD5, ">$md5file"))
@@ -18,9 +18,29 @@
 
 
 #
-#  Usage: index_sims [--table tablename] [--dir sims-dir] [ File1 File2 ... ]
+#  Usage: index_sims [--table tablename] [--dir sims-dir] [--threads n] [--binary-index file] [--checkpoints file] [--subject-index file] [ File1 File2 ... ]
 #
-#  If available, it uses the program index_sims_file
+#  If available, it uses the program index_sims_file.  Version 1.01 and later
+#  index the whole list of files in one run, on --threads worker threads
+#  (default is one per processor).  With version 1.04 and later,
+#  --binary-index also writes the seeks of the files indexed to a binary
+#  seek index (see SimsSeekIndex.pm).  The index is written whole, so it is
+#  only written when the whole sims directory is indexed.  With version 1.07 and later,
+#  --subject-index writes a binary index of the same form, giving the seek
+#  and length of every line, by subject id (the second column); it too is
+#  only written when the whole sims directory is indexed.
+#
+#  With version 1.06 and later, index_sims_file keeps a checkpoint of each
+#  file (default $FIG_Config::data/<tablename>.checkpoints).  A file that
+#  has only had sims appended since it was last indexed is indexed from the
+#  start of its last run of lines, and only its seeks from that point on are
+#  replaced.  Indexing the whole sims directory starts new checkpoints.
+#
+#  With version 1.08 and later, each row of the table also gets a summary
+#  of the query's sims in the run: the number of hits, the best (lowest)
+#  psc and best (highest) bit score, and the seek of the line with the best
+#  psc.  The columns are added when the whole sims directory is indexed; a
+#  table without them is loaded as before.
 #
 
 use strict;
@@ -30,12 +50,16 @@ use Tracer;
 use Getopt::Long;
 use File::Path qw(make_path);
 
-my $usage =  "Usage: $0 [--dbname database-name] [--table tablename] [--dir sims-dir] [ File1 File2 ... ]";
+my $usage =  "Usage: $0 [--dbname database-name] [--table tablename] [--dir sims-dir] [--threads n] [--binary-index file] [--checkpoints file] [--subject-index file] [ File1 File2 ... ]";
 
 my $sims_db;
 my $sims_dir;
 my $new_sims_dir;
 my $seeks_table  = "sim_seeks";
+my $threads = 0;
+my $binary_index;
+my $checkpoints;
+my $subject_index;
 my $help = 0;
 
 my( $sim_file, @sim_files );
@@ -43,6 +67,10 @@ my( $sim_file, @sim_files );
 my $rc = GetOptions("dir=s" => \$sims_dir,
 		    "table=s" => \$seeks_table,
 		    "dbname=s" => \$sims_db,
+		    "threads=i" => \$threads,
+		    "binary-index=s" => \$binary_index,
+		    "checkpoints=s" => \$checkpoints,
+		    "subject-index=s" => \$subject_index,
 		    "help" => \$help);
 
 $rc or die "$usage\n";
@@ -78,6 +106,32 @@ if ($sims_dir eq '')
 print "Indexing sims_dir=$sims_dir new=$new_sims_dir seeks=$seeks_table\n";
 print "Files: @ARGV\n";
 
+my ( $v, $contigfilelist );
+
+#
+#  See if we can find the C program to do the indexing
+#
+
+my $use_prog = 0;
+my $use_list = 0;
+my $use_binary = 0;
+my $use_checkpoints = 0;
+my $use_subjects = 0;
+my $use_summary = 0;
+if (      open VERSION_PIPE, "index_sims_file -v |"
+     and  $v = <VERSION_PIPE>
+     and  close VERSION_PIPE
+     and  chomp $v
+     and  $v >= 1
+   ) {
+    $use_prog = 1;
+    $use_list = ( $v >= 1.01 );
+    $use_binary = ( $v >= 1.04 );
+    $use_checkpoints = ( $v >= 1.06 );
+    $use_subjects = ( $v >= 1.07 );
+    $use_summary = ( $v >= 1.08 );
+}
+
 #
 #  Build the list of files to be indexed:
 #
@@ -98,36 +152,116 @@ if ( @ARGV == 0 ) {
     # We always do this so a SEED with no sims files will
     # initialize properly.
     #
+    my $pscType = ( $dbf->{_dbms} eq 'mysql' ) ? "real" : "float8";
     $dbf->drop_table(   tbl  => $seeks_table );
     $dbf->create_table( tbl  => $seeks_table,
 		       flds => "id varchar(64), "
 		       . "fileN INTEGER, "
-		       . "seek INTEGER, "
+		       . "seek BIGINT, "
 		       . "len INTEGER"
+		       . ( $use_summary ? ", nhits INTEGER, "
+			                . "best_psc $pscType, "
+			                . "best_bsc real, "
+			                . "best_seek BIGINT"
+			                : "" )
 		      );
 } else {
     @sim_files = @ARGV;
+
+    #
+    #  Only add summary fields to a table that has the columns for them:
+    #
+    $use_summary &&= grep { lc( $_->[0] ) eq 'nhits' } $dbf->table_columns( $seeks_table );
 }
 
-my ( $v, $contigfilelist );
+if ( $binary_index && ! $use_binary ) {
+    Trace("index_sims_file version 1.04 or later is needed for --binary-index; not writing $binary_index") if T(0);
+    $binary_index = undef;
+}
 
 #
-#  See if we can find the C program to do the indexing
+#  The binary index is rewritten from the files indexed in this run, so
+#  indexing only some files would drop the seeks of all of the others.
 #
+if ( $binary_index && @ARGV > 0 ) {
+    Trace("--binary-index is only written when the whole sims directory is indexed; not writing $binary_index") if T(0);
+    $binary_index = undef;
+}
 
-my $use_prog = 0;
-if (      open VERSION_PIPE, "index_sims_file -v |"
-     and  $v = <VERSION_PIPE>
-     and  close VERSION_PIPE
-     and  chomp $v
-     and  $v eq "1.00"
-   ) {
-    $use_prog = 1;
+if ( $subject_index && ! $use_subjects ) {
+    Trace("index_sims_file version 1.07 or later is needed for --subject-index; not writing $subject_index") if T(0);
+    $subject_index = undef;
+}
+
+#
+#  Likewise the subject index, which would only get the subjects of the
+#  files (or the tails of files, from their checkpoints) indexed in this run.
+#
+if ( $subject_index && @ARGV > 0 ) {
+    Trace("--subject-index is only written when the whole sims directory is indexed; not writing $subject_index") if T(0);
+    $subject_index = undef;
 }
 
 my $nfiles = @sim_files;
 my $n = 0;
 
+#
+#  With a list capable index_sims_file, index all of the files in one run
+#  and load the seeks with a single load_table:
+#
+if ( $use_list ) {
+    my $simfilelist = "$seeks_file.list";
+    my @fileNs;
+    open( FILELIST, ">$simfilelist" ) || Confess("Could not open $simfilelist");
+    foreach $sim_file ( @sim_files ) {
+	my $fileN = $fig->file2N( $sim_file );
+	next unless $fileN;
+	push @fileNs, $fileN;
+	print FILELIST "$fileN\t$sim_file\n" if -s $sim_file;
+    }
+    close( FILELIST );
+
+    my $jopt = $threads > 0 ? "-j $threads" : "";
+    $jopt .= " -b $binary_index" if $binary_index;
+    $jopt .= " -r $subject_index" if $subject_index;
+    $jopt .= " -s" if $use_summary;
+    if ( $use_checkpoints ) {
+	$checkpoints ||= "$FIG_Config::data/$seeks_table.checkpoints";
+	unlink( $checkpoints ) if @ARGV == 0;
+	$jopt .= " -c $checkpoints";
+    }
+    Trace("   Indexing $nfiles sims files with index_sims_file $jopt") if T(2);
+    if ( system( "index_sims_file $jopt < $simfilelist > $seeks_file" ) == 0 ) {
+	if ( @ARGV > 0 ) {
+	    #
+	    #  A file indexed from its checkpoint only replaces the seeks
+	    #  from where indexing started.
+	    #
+	    my %start;
+	    if ( $use_checkpoints && open( CHECKPOINTS, "<$checkpoints" ) ) {
+		while ( defined( $_ = <CHECKPOINTS> ) ) {
+		    my ( $fileN, undef, $start ) = split /\t/;
+		    $start{ $fileN } = $start;
+		}
+		close( CHECKPOINTS );
+	    }
+	    foreach my $fileN ( @fileNs ) {
+		my $start = $start{ $fileN } || 0;
+		if ( $start > 0 ) {
+		    $dbf->SQL("DELETE FROM $seeks_table WHERE ( fileN = $fileN ) AND ( seek >= $start )");
+		} else {
+		    $dbf->SQL("DELETE FROM $seeks_table WHERE ( fileN = $fileN )");
+		}
+	    }
+	}
+	$dbf->load_table( tbl => $seeks_table, file => $seeks_file );
+	@sim_files = ();
+    } else {
+	Trace("   index_sims_file failed on file list; indexing files one at a time") if T(1);
+    }
+    unlink( $simfilelist );
+}
+
 #
 #  For each file, find the seeks and load them into the database:
 #
@@ -148,7 +282,8 @@ foreach $sim_file ( @sim_files ) {
 			close(SEEK_FH);
 		} else {
 			( $use_prog &&
-			 ( system( "index_sims_file  $fileN < $sim_file > $seeks_file" ) == 0 )
+			 ( system( "index_sims_file " . ( $use_summary ? "-s " : " " )
+			         . "$fileN < $sim_file > $seeks_file" ) == 0 )
 			)
 			|| index_sims_file( $sim_file, $fileN, $seeks_file )
 			|| Confess("ERROR: index_sims failed on sim file $sim_file");
@@ -184,7 +319,7 @@ Trace("Sim index processing complete.") if T(2);
 
 sub index_sims_file {
     my( $file, $fileN, $seeks_file ) = @_;
-    my( $line, $offset, $curr, $nxt_offset, $ln );
+    my( $line, $offset, $curr, $nxt_offset, $ln, $summary );
 
     open( SIMS,  "<$file" ) || return 0;
     open( SEEKS, ">$seeks_file") || ( close( SIMS ) && return 0 );
@@ -193,12 +328,27 @@ sub index_sims_file {
     $line = <SIMS>;
     while ( defined( $line ) && ( $line =~ /^(\S+)/ ) ) {
 		$curr = $1;
+		my ( $nhits, $best_psc, $best_bsc, $best_seek ) = ( 0 );
 		while ( $line && ( $line =~ /^(\S+)/ ) && ( $1 eq $curr ) ) {
+			if ( $use_summary ) {
+				my ( $psc, $bsc ) = ( split /\s+/, $line )[10, 11];
+				if ( defined( $bsc ) ) {
+					$nhits++;
+					if ( ! defined( $best_psc ) || $psc < $best_psc ) {
+						$best_psc  = $psc;
+						$best_seek = tell( SIMS ) - length( $line );
+					}
+					$best_bsc = $bsc if ! defined( $best_bsc ) || $bsc > $best_bsc;
+				}
+			}
 			$nxt_offset = tell SIMS;
 			$line = <SIMS>;
 		}
 		$ln = $nxt_offset - $offset;
-		print SEEKS "$curr\t$fileN\t$offset\t$ln\n";
+		$summary = ! $use_summary ? ""
+		         : $nhits ? "\t$nhits\t$best_psc\t$best_bsc\t$best_seek"
+		         : "\t0\t\\N\t\\N\t\\N";
+		print SEEKS "$curr\t$fileN\t$offset\t$ln$summary\n";
 		$offset = $nxt_offset;
     }
 
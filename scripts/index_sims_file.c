@@ -15,53 +15,330 @@
  * http://www.theseed.org/LICENSE.TXT.
  */
 
-
 /*  index_sims_file.c
  *
- *  Usage:  index_sims_file  SimsFileNumber  < SimsFile  > SimSeeks
+ *  Usage:  index_sims_file  [ options ]  SimsFileNumber  < SimsFile  > SimSeeks
+ *  or      index_sims_file  [ options ]  < file_list  > SimSeeks
  *  or      index_sims_file -v   (to return version number on standard output)
  *
+ *  Options:  -j nthreads  -b SeekIndex  -c Checkpoints  -r SubjectIndex  -s
+ *
  *  Read a sims file from standard in and
  *  write a line with four fields to stdout:
  *
  *     SeqID \t FileNumber \t Seek \t Length
  *
- *  Compile with:  cc -O index_sims_file.c -o index_sims_file
+ *  Without a file number on the command line, standard in is a list of
+ *  sims files, one or more lines of form:
+ *
+ *     FileNumber \t FileName \n
+ *
+ *  The files are indexed on nthreads worker threads (default, or 0, is the
+ *  number of online processors).  The seek records are written in the
+ *  order of the file list, and within each file in the order of the file,
+ *  so the output is identical to running the single file form on each file
+ *  in turn.
+ *
+ *  With more than one thread, a sims file of at least 2 * CHUNKLEN bytes
+ *  (including a single file given on standard in) is memory mapped and cut
+ *  into chunks that end at newlines.  Each chunk is scanned on its own, and
+ *  a run of lines for one id that crosses a chunk boundary is joined back
+ *  together as the chunks are written, so the output is unchanged.
+ *
+ *  With -b, the seeks are also written to SeekIndex as a memory mappable,
+ *  sorted binary index (see sims_seek_index.h), which can be searched with
+ *  sims_seek_lookup or SimsSeekIndex.pm instead of the sim_seeks table.
+ *
+ *  With -s, each seek record has four more fields, summarizing the run:
+ *
+ *     SeqID \t FileNumber \t Seek \t Length \t NHits \t BestPsc \t BestBsc \t BestSeek
+ *
+ *  NHits is the number of lines with a psc (field 11) and a bsc (field 12),
+ *  BestPsc the lowest psc, BestBsc the highest bsc, and BestSeek the seek of
+ *  the first line with the lowest psc.  The psc and bsc are copied as they
+ *  are written in the file.  Without any such lines, the last three are \N
+ *  (SQL null).
+ *
+ *  With -r, every line with a second field (the subject id) is also entered
+ *  in SubjectIndex, a binary index of the same form as SeekIndex, in which
+ *  the id is the subject id, and the seek and length are those of the line.
+ *  The entries of a subject are in order of file number and seek.  Like -b,
+ *  it indexes only the data that are scanned on this run.
+ *
+ *  With -c, a checkpoint of each file indexed is kept in the Checkpoints
+ *  file, as lines of tab separated fields:
+ *
+ *     FileNumber  FileName  Start  End  LastSeek  TailHash  LastID
+ *
+ *  Start is where indexing began on this run, End the number of bytes
+ *  indexed, and LastSeek and LastID the start and id of the last run of
+ *  lines.  TailHash is a hash of the (up to) TAILLEN bytes before End.
+ *  When a file has a checkpoint with the same file name, is at least End
+ *  bytes long, still has the same tail hash, and still has LastID at
+ *  LastSeek, only the data from LastSeek on is indexed: the last run is
+ *  indexed again, with any lines that were appended to it, followed by the
+ *  new runs.  A loader should replace the seeks of the file at or after
+ *  Start (which is 0 when the whole file was indexed).  Checkpoints of
+ *  files that are not indexed are kept.  Blocked gzip files are always
+ *  indexed in full, and are not checkpointed.
+ *
+ *  A sims file compressed to blocked gzip (see bgzf.h and sims_bgzf) is
+ *  recognized and decompressed as it is read.  Its seeks are then virtual
+ *  seeks (the file offset of the compressed block times 65536, plus the
+ *  offset in the uncompressed block), and lengths are uncompressed lengths.
+ *  A compressed file is read by one thread.
+ *
+ *  Lines are skipped with vector (AVX2 or SSE2) searches for the end of the
+ *  first field and for the newline, and a first field is compared with the
+ *  current id 16 bytes at a time.  Compile with -DNO_SIMD for the scalar
+ *  versions.
+ *
+ *  Compile with:  cc -O index_sims_file.c sims_seek_index.c job_pool.c bgzf.c -o index_sims_file -lpthread -lz
+ *
+ *  Version History:
+ *
+ *      1.01: Added file list mode with a pool of indexing threads.
+ *      1.02: Added chunked indexing of large files.
+ *      1.03: Added vector line and id scanning.
+ *      1.04: Added binary seek index output (-b).
+ *      1.05: Added blocked gzip sims files, indexed with virtual seeks.
+ *      1.06: Added checkpoints for indexing appended data (-c).
+ *      1.07: Added the subject index (-r).
+ *      1.08: Added summary fields (-s).
  */
 
-#define  VERSION  "1.00"
+#define  VERSION  "1.08"
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <stdio.h>
 #include <ctype.h>   /*  isspace()  */
 #include <stdlib.h>  /*  exit()     */
 #include <string.h>
+#include <fcntl.h>   /*  O_RDONLY   */
 #include <unistd.h>  /*  ssize_t read( int fd, void * buf, size_t buflen ); */
                      /*  int close( int fd );  */
-/* int open( char * name, int mode, int perms ); */  /*  acts like it is implicit  */
-#include <sys/types.h>
+#include <pthread.h>
+
+#include "sims_seek_index.h"
+#include "job_pool.h"
+#include "bgzf.h"
+
+#if ( defined(__x86_64__) || defined(__SSE2__) ) && ! defined(NO_SIMD)
+#define  USE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) && defined(__x86_64__)
+#define  USE_AVX2
+#include <immintrin.h>
+#endif
+#endif
 
 /* 263.110u 147.320s 22:04.81 with 128 kB buffer */
 /* 279.630u 151.410s 21:21.02 with 256 kB buffer */
 /* 295.940u 154.350s 21:21.30 with 512 kB buffer */
+/*
+ * Version 1.03, 1 GB of generated sims in the page cache, one thread
+ * (user, system, elapsed seconds; 1.00 / 1.03 -DNO_SIMD / 1.03 AVX2):
+ *
+ *   128 kB buffer:  1.44u 0.16s 1.62  /  0.54u 0.26s 0.81  /  0.47u 0.20s 0.67
+ *   256 kB buffer:  1.41u 0.13s 1.57  /  0.61u 0.24s 0.87  /  0.49u 0.21s 0.71
+ *   512 kB buffer:  1.26u 0.14s 1.41  /  0.44u 0.17s 0.62  /  0.41u 0.17s 0.59
+ */
 #define BUFLEN  (256*1024)  /* read buffer length */
 #define IDLEN   (    1024)  /* maximum id length  */
+#define MAXRPT  (      64)  /* ids of this length or longer are not reported */
+#define INPLEN  ( 16*1024)  /* file list line length */
+#define SSIMEM  (1024*1024*1024) /* memory for sorting the binary index */
+#define TAILLEN (    4096)  /* bytes of the file end hashed in a checkpoint */
+#define POSTLEN ( 256*1024)  /* subject entries held by a scan before adding them */
+#define NUMLEN  (      64)  /* longest psc or bsc that is read */
+
+#ifndef CHUNKLEN
+#define CHUNKLEN (64*1024*1024)  /* target bytes per chunk of a large file */
+#endif
 
 typedef unsigned long long u_long_long;
 
-void report_last_seek( char * id, char * filenum, u_long_long seek0, u_long_long seek );
-void report_seek( char * id, char * filenum, u_long_long seek0, u_long_long seek );
-void usage( char *prog );
+/*  A run of lines with the same query id, from seek0 up to seek.  */
 
-char buffer[BUFLEN];
-char idbuf[IDLEN+1];
+typedef struct {
+    char        id[IDLEN+1];
+    int         idlen;
+    u_long_long seek0;
+    u_long_long seek;
+    int         nhits;         /* summary of the run (-s) */
+    double      best_psc;
+    double      best_bsc;
+    u_long_long best_seek;
+    char        best_psc_text[NUMLEN+1];  /* the fields, as written */
+    char        best_bsc_text[NUMLEN+1];
+} run_t;
 
-int main (int argc, char **argv) {
-    char   *filenum, *iptr, *bptr;
-    char    c;
+/*  Start of each block of a blocked gzip file, for converting seeks in the
+ *  uncompressed data to virtual seeks.
+ */
 
-    u_long_long seek0, seek, nfills;
-    int ntogo;
+typedef struct {
+    u_long_long  useek;        /* seek in the uncompressed data */
+    u_long_long  cseek;        /* file offset of the compressed block */
+} block_t;
+
+typedef struct {
+    block_t     *block;
+    int          n;
+    int          size;
+} block_map_t;
+
+/*  The state of the scan of one sims file or chunk.  Because the state is
+ *  carried across calls, lines may be split across read buffers at any point.
+ *  When scanning a chunk, the first run is held in head rather than reported,
+ *  since it might continue a run from the previous chunk.
+ */
+
+typedef struct {
+    run_t       run;           /* the current run of lines */
+    char        fld[IDLEN+1];  /* first field of the line being read */
+    int         fldlen;
+    int         infield;       /* still reading the first field of the line */
+    int         haveid;        /* there is a current run */
+    u_long_long line0;         /* seek to the current line */
+    run_t      *head;          /* where to hold the first run, or NULL */
+    int         havehead;
+    const char *filenum;
+    outbuf_t   *out;
+    block_map_t *blocks;       /* blocked gzip file, or NULL */
+    int         subjects;      /* enter subjects in the subject index */
+    int         fields;        /* read fields after the first */
+    int         want;          /* last field that is needed */
+    int         fstate;        /* 1 at the end of field fno, 2 in field fno */
+    int         fno;
+    int         done;          /* fields 2, 11 and 12 complete (bits 0 - 2) */
+    char        sfld[IDLEN+1]; /* second field of the line being read */
+    int         slen;          /* -1 if too long */
+    char        num[2][NUMLEN+1];  /* psc and bsc */
+    int         numlen[2];
+    char       *post;          /* subject entries waiting to be added */
+    size_t      postlen;
+    size_t      postsize;
+} scan_t;
+
+/*  A subject entry waiting in scan_t.post, followed by the id  */
+
+typedef struct {
+    u_long_long  seek;
+    unsigned     len;
+    int          idlen;
+} post_t;
+
+/*  A checkpoint line from a previous run  */
+
+typedef struct {
+    char        *filenum;
+    char        *filename;
+    char        *id;
+    u_long_long  start;
+    u_long_long  end;
+    u_long_long  seek0;
+    u_long_long  hash;
+    int          used;         /* replaced by a file indexed on this run */
+} ckpt_t;
+
+typedef struct {
+    char        *filenum;
+    char        *filename;     /* NULL for standard input */
+    char        *map;          /* memory mapped file, if it is chunked */
+    u_long_long  size;
+    u_long_long  start;        /* seek at which indexing starts */
+    u_long_long  end;          /* bytes indexed */
+    int          bgzf;         /* blocked gzip file */
+    int          havelast;     /* the last run of the file, for -c */
+    run_t        last;
+} sims_file_t;
+
+typedef struct {
+    sims_file_t *file;
+    int          chunk;        /* chunk number, or -1 to read the file */
+    int          last;         /* last chunk of the file */
+    u_long_long  start;        /* chunk limits in the file */
+    u_long_long  end;
+    outbuf_t     out;
+    int          havehead;     /* first run of chunk ended in the chunk */
+    int          havetail;     /* a run was open at the end of the chunk */
+    run_t        head;
+    run_t        tail;
+} job_t;
+
+/*  The jobs of the files, and the state of writing them in order  */
+
+typedef struct {
+    job_t       *jobs;
+    int          njob;
+    int          maxjob;
+    outbuf_t     out;          /* standard output */
+    run_t       *carry;        /* run open at the end of the last chunk written */
+    int          havecarry;
+} job_list_t;
+
+void  scan_init( scan_t *s, const char *filenum, outbuf_t *out, u_long_long seek, run_t *head );
+int   scan_bytes( scan_t *s, const char *buf, size_t n, u_long_long base );
+u_long_long scan_finish( scan_t *s, u_long_long seek );
+void  end_run( scan_t *s, u_long_long seek );
+void  report_run( outbuf_t *out, const char *filenum, run_t *run );
+int   index_fd( int fd, sims_file_t *file, outbuf_t *out );
+int   scan_bgzf( scan_t *s, int fd, char *buffer, size_t n, u_long_long *seek );
+void  virtual_run( block_map_t *blocks, run_t *run );
+u_long_long virtual_seek( block_map_t *blocks, u_long_long seek );
+int   scan_fields( scan_t *s, const char **bptr, const char *bend );
+void  line_fields( scan_t *s, const char *p, const char *nl );
+int   line_seps( const char *p, const char *end, const char **sep, int nsep );
+void  end_field( scan_t *s );
+void  end_line( scan_t *s, u_long_long line0, u_long_long end );
+void  merge_summary( run_t *run, const run_t *prev );
+double get_score( const char *p );
+void  add_post( scan_t *s, u_long_long seek, u_long_long len );
+void  flush_posts( scan_t *s );
+void  scan_free( scan_t *s );
+int   cmp_ckpt( const void *a, const void *b );
+ckpt_t *read_checkpoints( const char *path, int *nckpt );
+void  resume_files( sims_file_t *files, int nfile, ckpt_t *ckpts, int nckpt );
+int   write_checkpoints( const char *path, sims_file_t *files, int nfile, ckpt_t *ckpts, int nckpt );
+int   tail_hash( sims_file_t *file, u_long_long end, u_long_long *hash );
+int   open_sims( sims_file_t *file );
+int   index_chunk( job_t *job );
+int   read_file_list( FILE *fp, sims_file_t **files );
+int   index_files( sims_file_t *files, int nfile, int nthreads );
+int   add_jobs( job_list_t *list, sims_file_t *file, int nthreads );
+int   run_job( void *arg, void *state, int i );
+void  output_job( void *arg, int i );
+void  write_job( job_t *job, run_t *carry, int *havecarry, outbuf_t *out );
+void  index_rows( const char *data, size_t len );
+void *xrealloc( void *ptr, size_t n );
+void  usage( char *prog );
+
+void  init_scanner( void );
+int   same_bytes( const char *a, const char *b, int n );
+const char *find_nl_scalar( const char *p, const char *end );
+const char *find_ctl_scalar( const char *p, const char *end );
+
+/*  Search for the next newline, and for the next byte <= ' ' (which is
+ *  where the first field might end).  Set by init_scanner().
+ */
+
+const char *(* find_nl)( const char *p, const char *end )  = find_nl_scalar;
+const char *(* find_ctl)( const char *p, const char *end ) = find_ctl_scalar;
+
+ssi_builder_t *seek_index = NULL;   /* binary index being built (-b) */
+ssi_builder_t *subject_index = NULL;   /* subject index being built (-r) */
+pthread_mutex_t subject_lock = PTHREAD_MUTEX_INITIALIZER;
+int            summary = 0;         /* write summary fields (-s) */
+
+
+int main (int argc, char **argv) {
+    sims_file_t  *files, stdin_file;
+    ckpt_t       *ckpts;
+    char         *index_file, *ckpt_file, *subject_file;
+    int           nthreads, nfile, nckpt, status;
 
     /* -v flag returns version */
 
@@ -73,122 +350,1343 @@ int main (int argc, char **argv) {
         return 0;
     }
 
-    if (argc != 2) usage(argv[0]);
-    filenum = argv[1];
+    init_scanner();
 
-    idbuf[0] = '\0';  /* initialize to empty string */
+    /* -j nthreads, -b SeekIndex, -c Checkpoints, -r SubjectIndex, -s */
 
-    /* Filling the buffer before starting helps simplify loop */
+    nthreads     = 0;
+    index_file   = NULL;
+    ckpt_file    = NULL;
+    subject_file = NULL;
+    while ( ( argc >= 2 ) && ( argv[1][0] == '-' ) ) {
+        if ( strcmp( argv[1], "-s" ) == 0 ) {
+            summary = 1;
+            argc--;
+            argv++;
+            continue;
+        }
+        if ( argc < 3 ) usage( argv[0] );
+        if ( strcmp( argv[1], "-j" ) == 0 ) {
+            if ( sscanf( argv[2], "%d", &nthreads ) != 1 || nthreads < 0 ) usage( argv[0] );
+            if ( nthreads == 0 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+            if ( nthreads < 1 ) nthreads = 1;
+        }
+        else if ( strcmp( argv[1], "-b" ) == 0 ) {
+            index_file = argv[2];
+        }
+        else if ( strcmp( argv[1], "-c" ) == 0 ) {
+            ckpt_file = argv[2];
+        }
+        else if ( strcmp( argv[1], "-r" ) == 0 ) {
+            subject_file = argv[2];
+        }
+        else {
+            usage( argv[0] );
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if ( ( argc > 2 ) || ( ( argc == 2 ) && ( argv[1][0] == '-' ) ) ) usage( argv[0] );
+
+    if ( index_file && ! ( seek_index = ssi_builder( index_file, SSIMEM ) ) ) {
+        fprintf( stderr, "index_sims_file: could not start seek index %s\n", index_file );
+        return 1;
+    }
+    if ( subject_file ) {
+        if ( ! ( subject_index = ssi_builder( subject_file, SSIMEM ) ) ) {
+            fprintf( stderr, "index_sims_file: could not start subject index %s\n", subject_file );
+            return 1;
+        }
+        ssi_order_by_seek( subject_index );
+    }
+
+    /* List of sims files on stdin */
+
+    if ( argc == 1 ) {
+        if ( nthreads < 1 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+        if ( nthreads < 1 ) nthreads = 1;
+        nfile = read_file_list( stdin, &files );
+    }
+
+    /* Single sims file on stdin */
+
+    else {
+        memset( &stdin_file, 0, sizeof( stdin_file ) );
+        stdin_file.filenum = argv[1];
+        files = &stdin_file;
+        nfile = 1;
+        if ( nthreads < 1 ) nthreads = 1;
+    }
 
-    ntogo = read( 0, buffer, BUFLEN );
-    if ( ntogo <= 0 ) {
-	fprintf( stderr, "%s: Empty sims file or read error\n", argv[0] );
-	exit( 0 );
+    ckpts = NULL;
+    nckpt = 0;
+    if ( ckpt_file ) {
+        ckpts = read_checkpoints( ckpt_file, &nckpt );
+        resume_files( files, nfile, ckpts, nckpt );
     }
-    nfills = 1;
-    bptr   = buffer;
-    seek0  = 0;
 
-    /* Read the input, line-by-line */
+    status = index_files( files, nfile, nthreads );
+
+    if ( ckpt_file && ! status && write_checkpoints( ckpt_file, files, nfile, ckpts, nckpt ) ) {
+        fprintf( stderr, "index_sims_file: failed to write checkpoints %s\n", ckpt_file );
+        status = 1;
+    }
+
+    if ( seek_index && ssi_finish( seek_index ) ) {
+        fprintf( stderr, "index_sims_file: failed to write seek index %s\n", index_file );
+        status = 1;
+    }
+    if ( subject_index && ssi_finish( subject_index ) ) {
+        fprintf( stderr, "index_sims_file: failed to write subject index %s\n", subject_file );
+        status = 1;
+    }
+
+    return status;
+}
+
+
+/*  Read the list of files to be indexed.  */
+
+int read_file_list( FILE *fp, sims_file_t **files ) {
+    char         inpbuf[INPLEN];
+    char        *bptr, *file_num, *file_name;
+    sims_file_t *file;
+    int          nfile, maxfile, c;
+
+    *files = NULL;
+    nfile = maxfile = 0;
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+	bptr = inpbuf;
+	file_num = bptr;
+
+	/*  Find the end of the file number */
+
+	while ( ( c = *bptr ) && ( c != '\t' ) ) bptr++;
+	if ( ! c ) continue;
+	*bptr++ = '\0';    /* convert tab to end-of-string */
+	file_name = bptr;  /* next character is start of file name */
+
+	/*  Find the end of the file name (strip the newline) */
+
+	while ( ( c = *bptr ) && ( c != '\n' ) && ( c != '\r' ) ) bptr++;
+	*bptr = '\0';
+
+        if ( nfile >= maxfile ) {
+            maxfile = maxfile ? 2 * maxfile : 1024;
+            *files = (sims_file_t *) xrealloc( *files, maxfile * sizeof( sims_file_t ) );
+        }
+        file = *files + nfile++;
+        memset( file, 0, sizeof( sims_file_t ) );
+        file->filenum  = strdup( file_num );
+        file->filename = strdup( file_name );
+    }
+
+    return nfile;
+}
+
+
+/*  Read a checkpoint file.  Returns the checkpoints, sorted by file
+ *  number, or NULL if there are none.
+ */
+
+int cmp_ckpt( const void *a, const void *b ) {
+    return strcmp( ((const ckpt_t *) a)->filenum, ((const ckpt_t *) b)->filenum );
+}
+
+ckpt_t *read_checkpoints( const char *path, int *nckpt ) {
+    FILE    *fp;
+    ckpt_t  *ckpts, *c;
+    char     inpbuf[INPLEN];
+    char    *fld[7], *bptr;
+    int      maxckpt, nf;
+
+    *nckpt = 0;
+    if ( ! ( fp = fopen( path, "r" ) ) ) return NULL;
+
+    ckpts   = NULL;
+    maxckpt = 0;
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+        fld[0] = inpbuf;
+        for ( nf = 1, bptr = inpbuf; *bptr && ( *bptr != '\n' ) && ( *bptr != '\r' ); bptr++ ) {
+            if ( ( *bptr == '\t' ) && ( nf < 7 ) ) {
+                *bptr = '\0';
+                fld[nf++] = bptr + 1;
+            }
+        }
+        *bptr = '\0';
+        if ( nf < 7 ) continue;
+
+        if ( *nckpt >= maxckpt ) {
+            maxckpt = maxckpt ? 2 * maxckpt : 1024;
+            ckpts = (ckpt_t *) xrealloc( ckpts, maxckpt * sizeof( ckpt_t ) );
+        }
+        c = ckpts + (*nckpt)++;
+        c->filenum  = strdup( fld[0] );
+        c->filename = strdup( fld[1] );
+        c->start    = strtoull( fld[2], NULL, 10 );
+        c->end      = strtoull( fld[3], NULL, 10 );
+        c->seek0    = strtoull( fld[4], NULL, 10 );
+        c->hash     = strtoull( fld[5], NULL, 16 );
+        c->id       = strdup( fld[6] );
+        c->used     = 0;
+    }
+    fclose( fp );
+
+    if ( *nckpt ) qsort( ckpts, *nckpt, sizeof( ckpt_t ), cmp_ckpt );
+    return ckpts;
+}
+
+
+/*  Set the start of each file that has a valid checkpoint to the start of
+ *  its last indexed run.
+ */
+
+void resume_files( sims_file_t *files, int nfile, ckpt_t *ckpts, int nckpt ) {
+    sims_file_t *file;
+    ckpt_t       key, *c;
+    struct stat  st;
+    u_long_long  hash;
+    char         idbuf[IDLEN+2];
+    int          i, fd, idlen;
+
+    for ( i = 0; i < nfile; i++ ) {
+        file = files + i;
+        key.filenum = file->filenum;
+        if ( ! nckpt || ! ( c = (ckpt_t *) bsearch( &key, ckpts, nckpt, sizeof( ckpt_t ), cmp_ckpt ) ) ) continue;
+        c->used = 1;
+        if ( strcmp( c->filename, file->filename ? file->filename : "-" ) ) continue;
+        if ( ( c->seek0 > c->end ) || ( ( fd = open_sims( file ) ) < 0 ) ) continue;
+
+        idlen = strlen( c->id );
+        if ( ( fstat( fd, &st ) == 0 ) && S_ISREG( st.st_mode )
+                                       && ( (u_long_long) st.st_size >= c->end )
+                                       && ( tail_hash( file, c->end, &hash ) == 0 )
+                                       && ( hash == c->hash )
+                                       && ( ( idlen == 0 ) || (
+                                            ( idlen <= IDLEN )
+                                         && ( pread( fd, idbuf, idlen + 1, (off_t) c->seek0 ) == idlen + 1 )
+                                         && ! memcmp( idbuf, c->id, idlen )
+                                         && isspace( (unsigned char) idbuf[idlen] ) ) )
+           ) {
+            file->start = c->seek0;
+        }
+        if ( file->filename ) close( fd );
+    }
+}
+
+
+/*  Write the checkpoints of the files indexed, and keep those of other
+ *  files.  The new file replaces the old one when it is complete.
+ */
+
+int write_checkpoints( const char *path, sims_file_t *files, int nfile, ckpt_t *ckpts, int nckpt ) {
+    FILE        *fp;
+    sims_file_t *file;
+    char        *newpath;
+    u_long_long  hash;
+    int          i;
+
+    newpath = (char *) xrealloc( NULL, strlen( path ) + 5 );
+    sprintf( newpath, "%s.new", path );
+    if ( ! ( fp = fopen( newpath, "w" ) ) ) {
+        free( newpath );
+        return 1;
+    }
+
+    for ( i = 0; i < nckpt; i++ ) {
+        if ( ckpts[i].used ) continue;
+        fprintf( fp, "%s\t%s\t%llu\t%llu\t%llu\t%016llx\t%s\n",
+                     ckpts[i].filenum, ckpts[i].filename, ckpts[i].start, ckpts[i].end,
+                     ckpts[i].seek0, ckpts[i].hash, ckpts[i].id );
+    }
+
+    for ( i = 0; i < nfile; i++ ) {
+        file = files + i;
+        if ( file->bgzf || tail_hash( file, file->end, &hash ) ) continue;
+        fprintf( fp, "%s\t%s\t%llu\t%llu\t%llu\t%016llx\t%s\n",
+                     file->filenum, file->filename ? file->filename : "-",
+                     file->start, file->end,
+                     file->havelast ? file->last.seek0 : 0, hash,
+                     file->havelast ? file->last.id : "" );
+    }
+
+    if ( fclose( fp ) || rename( newpath, path ) ) {
+        unlink( newpath );
+        free( newpath );
+        return 1;
+    }
+    free( newpath );
+    return 0;
+}
+
+
+/*  FNV-1a hash of the (up to) TAILLEN bytes before end.  Returns 0 on
+ *  success.
+ */
+
+int tail_hash( sims_file_t *file, u_long_long end, u_long_long *hash ) {
+    unsigned char buf[TAILLEN];
+    u_long_long   h = 14695981039346656037ULL;
+    size_t        n, i;
+    int           fd, status;
+
+    if ( ( fd = open_sims( file ) ) < 0 ) return 1;
+    n = ( end < TAILLEN ) ? (size_t) end : TAILLEN;
+    status = ( n && ( pread( fd, buf, n, (off_t) ( end - n ) ) != (ssize_t) n ) );
+    if ( file->filename ) close( fd );
+    if ( status ) return 1;
+
+    for ( i = 0; i < n; i++ ) h = ( h ^ buf[i] ) * 1099511628211ULL;
+    *hash = h;
+    return 0;
+}
+
+
+/*  A descriptor for reading a sims file at any seek (0 for stdin, which
+ *  must then be a regular file), or -1.
+ */
+
+int open_sims( sims_file_t *file ) {
+    struct stat st;
+
+    if ( file->filename ) return open( file->filename, O_RDONLY, 0 );
+    return ( ( fstat( 0, &st ) == 0 ) && S_ISREG( st.st_mode ) ) ? 0 : -1;
+}
+
+
+/*  Index the files on a pool of threads, writing the seeks of each job in
+ *  list order, and joining runs that cross chunk boundaries.
+ */
+
+int index_files( sims_file_t *files, int nfile, int nthreads ) {
+    jp_jobs_t   pool;
+    job_list_t  list;
+    int         status, i;
+
+    memset( &list, 0, sizeof( list ) );
+    for ( i = 0; i < nfile; i++ ) {
+        if ( add_jobs( &list, files + i, nthreads ) ) return 1;
+    }
+    if ( ! list.njob ) return 0;
+
+    list.out.fp      = stdout;
+    list.out.flushed = seek_index ? index_rows : NULL;
+    list.carry       = (run_t *) xrealloc( NULL, sizeof( run_t ) );
+
+    pool.njob  = list.njob;
+    pool.arg   = &list;
+    pool.begin = NULL;
+    pool.run   = run_job;
+    pool.write = output_job;
+    pool.end   = NULL;
+    status = jp_run( &pool, nthreads );
+    out_flush( &list.out );
+
+    free( list.carry );
+    free( list.out.data );
+    free( list.jobs );
+    fflush( stdout );
+    return ( status || ferror( stdout ) ) ? 1 : 0;
+}
+
+
+/*  Add the jobs for one file.  A large file is mapped and cut into chunks
+ *  at newlines; anything else is read by a single job.
+ */
+
+int add_jobs( job_list_t *list, sims_file_t *file, int nthreads ) {
+    struct stat  st;
+    job_t       *job;
+    char        *nl;
+    u_long_long  start, end;
+    int          fd, nchunk, chunk;
+
+    fd = -1;
+    nchunk = 1;
+    if ( nthreads > 1 ) {
+        fd = file->filename ? open( file->filename, O_RDONLY, 0 ) : 0;
+        if ( ( fd >= 0 ) && ( fstat( fd, &st ) == 0 ) && S_ISREG( st.st_mode )
+                         && ( st.st_size >= 2 * (off_t) CHUNKLEN + (off_t) file->start )
+                         && ( lseek( fd, 0, SEEK_CUR ) == 0 )
+           ) {
+            file->size = st.st_size;
+            file->map  = (char *) mmap( NULL, file->size, PROT_READ, MAP_SHARED, fd, 0 );
+            if ( file->map == (char *) MAP_FAILED ) file->map = NULL;
+            else if ( bgzf_is_bgzf( (unsigned char *) file->map, file->size ) ) {
+                munmap( file->map, file->size );    /*  compressed; not chunked  */
+                file->map = NULL;
+            }
+            else nchunk = (int) ( ( file->size - file->start ) / CHUNKLEN );
+        }
+        if ( file->filename && ( fd >= 0 ) ) close( fd );
+    }
+
+    start = file->start;
+    for ( chunk = 0; chunk < nchunk; chunk++ ) {
+        if ( list->njob >= list->maxjob ) {
+            list->maxjob = list->maxjob ? 2 * list->maxjob : 1024;
+            list->jobs = (job_t *) xrealloc( list->jobs, list->maxjob * sizeof( job_t ) );
+        }
+        job = list->jobs + list->njob++;
+        memset( job, 0, sizeof( job_t ) );
+        job->file = file;
+        if ( ! file->map ) {
+            job->chunk = -1;
+            job->last  = 1;
+            return 0;
+        }
+
+        /*  Move the end of the chunk to just past a newline  */
+
+        end = ( chunk == nchunk - 1 ) ? file->size
+                                      : file->start + ( ( file->size - file->start ) * ( chunk + 1 ) ) / nchunk;
+        if ( end < start ) end = start;
+        if ( end < file->size ) {
+            nl = memchr( file->map + end, '\n', file->size - end );
+            end = nl ? (u_long_long) ( nl - file->map ) + 1 : file->size;
+        }
+
+        job->chunk = chunk;
+        job->start = start;
+        job->end   = end;
+        job->last  = ( end >= file->size );
+        if ( job->last ) break;
+        start = end;
+    }
+
+    return 0;
+}
+
+
+/*  Index a job on a worker thread.  Returns nonzero if a file could not
+ *  be indexed.
+ */
+
+int run_job( void *arg, void *state, int i ) {
+    job_t  *job = ( (job_list_t *) arg )->jobs + i;
+    int     fd, failed;
+
+    (void) state;
+
+    /*  An empty file is only reported; a file that cannot be opened or
+     *  read fails the run, so that its seeks are not taken as complete.
+     */
+
+    failed = 0;
+    if ( job->chunk >= 0 ) {
+        failed = index_chunk( job );
+    }
+    else if ( ! job->file->filename ) {
+        switch ( index_fd( 0, job->file, &(job->out) ) ) {
+        case -1:
+            fprintf( stderr, "index_sims_file: Empty sims file\n" );
+            break;
+        case 1:
+            fprintf( stderr, "index_sims_file: Read error in sims file\n" );
+            failed = 1;
+            break;
+        }
+    }
+    else if ( ( fd = open( job->file->filename, O_RDONLY, 0 ) ) < 0 ) {
+        fprintf( stderr, "Failed to open sims file: %s\n", job->file->filename );
+        failed = 1;
+    }
+    else {
+        switch ( index_fd( fd, job->file, &(job->out) ) ) {
+        case -1:
+            fprintf( stderr, "Empty sims file: %s\n", job->file->filename );
+            break;
+        case 1:
+            fprintf( stderr, "Read error in sims file: %s\n", job->file->filename );
+            failed = 1;
+            break;
+        }
+        (void) close( fd );
+    }
+
+    return failed;
+}
+
+
+/*  Write a job on the calling thread, and unmap its file after the last
+ *  chunk.
+ */
+
+void output_job( void *arg, int i ) {
+    job_list_t  *list = (job_list_t *) arg;
+    job_t       *job  = list->jobs + i;
+
+    write_job( job, list->carry, &(list->havecarry), &(list->out) );
+    free( job->out.data );
+    job->out.data = NULL;
+
+    if ( job->last && job->file->map ) {
+        munmap( job->file->map, job->file->size );
+        job->file->map = NULL;
+    }
+}
+
+
+/*  Index one file descriptor, from file->start, writing the seek records
+ *  to out.  Returns 0 on success, -1 if the file is empty, and 1 if
+ *  indexing stopped on a read error or an error in the file.
+ */
+
+int index_fd( int fd, sims_file_t *file, outbuf_t *out ) {
+    const char  *filenum = file->filenum;
+    scan_t      *s;
+    char        *buffer;
+    ssize_t      ntogo;
+    u_long_long  seek;
+    int          status;
+
+    if ( file->start && ( lseek( fd, (off_t) file->start, SEEK_SET ) != (off_t) file->start ) ) {
+        file->start = 0;
+    }
+
+    s      = (scan_t *) xrealloc( NULL, sizeof( scan_t ) );
+    buffer = (char *) xrealloc( NULL, BUFLEN );
+    scan_init( s, filenum, out, file->start, NULL );
+
+    seek   = file->start;
+    status = -1;
+    while ( ( ntogo = read( fd, buffer, BUFLEN ) ) > 0 ) {
+        if ( ( status < 0 ) && bgzf_is_bgzf( (unsigned char *) buffer, (size_t) ntogo ) ) {
+            status = scan_bgzf( s, fd, buffer, (size_t) ntogo, &seek );
+            break;
+        }
+        status = 0;
+        if ( scan_bytes( s, buffer, (size_t) ntogo, seek ) ) {
+            status = 1;
+            break;
+        }
+        seek += ntogo;
+    }
+    if ( ntogo < 0 ) status = 1;
+    file->end = seek;
+    if ( ! status ) {
+        seek = scan_finish( s, seek );
+        if ( s->haveid ) {
+            file->last     = s->run;
+            file->havelast = 1;
+            if ( s->blocks ) virtual_run( s->blocks, &(s->run) );
+            report_run( out, filenum, &(s->run) );
+        }
+    }
+
+    if ( s->blocks ) file->bgzf = 1;
+    scan_free( s );
+    free( buffer );
+    return status;
+}
+
+
+/*  Scan a blocked gzip file, of which the first n bytes are in buffer
+ *  (BUFLEN bytes).  Each block is decompressed and scanned, and its start
+ *  is recorded in s->blocks.  *seek is the uncompressed length scanned.
+ */
+
+int scan_bgzf( scan_t *s, int fd, char *buffer, size_t n, u_long_long *seek ) {
+    block_map_t *blocks;
+    char        *data;
+    u_long_long  cseek;
+    size_t       pos;
+    ssize_t      got;
+    long         bsize, ulen;
+    int          status = 0;
+
+    blocks = (block_map_t *) xrealloc( NULL, sizeof( block_map_t ) );
+    memset( blocks, 0, sizeof( block_map_t ) );
+    s->blocks = blocks;
+    data  = (char *) xrealloc( NULL, BGZF_MAXBLOCK );
+    cseek = 0;      /*  file offset of buffer[0]  */
+    pos   = 0;
 
     while ( 1 ) {
 
-	/* Seek for beginning of this line: */
+        /*  Get a whole block into the buffer  */
 
-	seek = BUFLEN * ( nfills - 1 ) + ( bptr - buffer );
+        bsize = bgzf_block_size( (unsigned char *) buffer + pos, n - pos );
+        if ( ( bsize < 0 ) || ( (size_t) bsize > n - pos ) ) {
+            memmove( buffer, buffer + pos, n - pos );
+            cseek += pos;
+            n     -= pos;
+            pos    = 0;
+            while ( ( n < BUFLEN ) && ( ( got = read( fd, buffer + n, BUFLEN - n ) ) > 0 ) ) n += got;
+            if ( ! n ) break;
+            bsize = bgzf_block_size( (unsigned char *) buffer, n );
+            if ( ( bsize < 0 ) || ( (size_t) bsize > n ) ) {
+                fprintf( stderr, "Bad or truncated blocked gzip sims file at %llu\n", cseek );
+                status = 1;
+                break;
+            }
+        }
 
-        /*  Check for same id */
+        if ( ( ulen = bgzf_inflate_block( (unsigned char *) buffer + pos, bsize, data ) ) < 0 ) {
+            fprintf( stderr, "Bad blocked gzip block at %llu\n", cseek + pos );
+            status = 1;
+            break;
+        }
 
-        iptr = idbuf;
-        while ( 1 ) {
-	    if ( ntogo <= 0 ) {
-		ntogo = read( 0, buffer, BUFLEN );
-		if ( ntogo <= 0 ) {
-		    /*  This is the point for normal termination (run out */
-		    /*  of input when trying to read next identifier).    */
-		    /*  This should happen when ( iptr == idbuf ), ...    */
+        if ( ulen ) {
+            if ( blocks->n >= blocks->size ) {
+                blocks->size = blocks->size ? 2 * blocks->size : 1024;
+                blocks->block = (block_t *) xrealloc( blocks->block, blocks->size * sizeof( block_t ) );
+            }
+            blocks->block[ blocks->n ].useek = *seek;
+            blocks->block[ blocks->n ].cseek = cseek + pos;
+            blocks->n++;
 
-		    if ( iptr != idbuf ) {
-			fprintf( stderr, "End of sims file inside identifier\n" );
-		    }
-		    report_last_seek( idbuf, filenum, seek0, seek );
-		}
-		nfills++; bptr = buffer;
-	    }
-	    if ( *bptr != *iptr ) break;
-	    bptr++; ntogo--;
-	    iptr++;
-	}
+            if ( scan_bytes( s, data, (size_t) ulen, *seek ) ) {
+                status = 1;
+                break;
+            }
+            *seek += ulen;
+        }
+        pos += bsize;
+    }
+
+    free( data );
+    return status;
+}
 
-        /* Either we have reached string terminators, or this is a new id */
 
-	c = *bptr++; ntogo--;
-        if ( ( ! isspace( (int) c ) ) || ( *iptr != '\0' ) ) {
+/*  Convert the seeks of a run in uncompressed data to a virtual seek and
+ *  the end of the run at that plus its uncompressed length.
+ */
+
+void virtual_run( block_map_t *blocks, run_t *run ) {
+    u_long_long len = run->seek - run->seek0;
 
-            /* New id.  If there is a previous similarity, record it */
+    run->seek0 = virtual_seek( blocks, run->seek0 );
+    run->seek  = run->seek0 + len;
+    if ( run->nhits ) run->best_seek = virtual_seek( blocks, run->best_seek );
+}
 
-	    report_seek( idbuf, filenum, seek0, seek );
-	    seek0 = seek;
 
-            /* Copy the new id; starting from first difference */
+u_long_long virtual_seek( block_map_t *blocks, u_long_long seek ) {
+    int lo, hi, mid;
 
-	    while ( ! isspace( (int) c ) ) {
-                if ( ( iptr - idbuf ) > IDLEN ) {
-                    *iptr = '\0';
+    if ( ! blocks->n ) return seek;
+    lo = 0;
+    hi = blocks->n;
+    while ( hi - lo > 1 ) {
+        mid = ( lo + hi ) / 2;
+        if ( blocks->block[mid].useek <= seek ) lo = mid;
+        else hi = mid;
+    }
+    return BGZF_VSEEK( blocks->block[lo].cseek, seek - blocks->block[lo].useek );
+}
+
+
+/*  Index one chunk of a mapped file.  The first run (if it ends in the
+ *  chunk) and the run open at the end of the chunk are left in the job
+ *  for write_job.  Returns nonzero if indexing stopped on an error.
+ */
+
+int index_chunk( job_t *job ) {
+    scan_t      *s;
+    sims_file_t *file = job->file;
+    int          status = 0;
+
+    s = (scan_t *) xrealloc( NULL, sizeof( scan_t ) );
+    scan_init( s, file->filenum, &(job->out), job->start, &(job->head) );
+
+    (void) madvise( file->map + ( job->start & ~(u_long_long) 4095 ),
+                    job->end - ( job->start & ~(u_long_long) 4095 ),
+                    MADV_SEQUENTIAL );
+
+    if ( scan_bytes( s, file->map + job->start, job->end - job->start, job->start ) ) {
+        fprintf( stderr, "Indexing of %s stopped at chunk %d\n",
+                         file->filename ? file->filename : "stdin", job->chunk );
+        status = 1;
+    }
+    else {
+        (void) scan_finish( s, job->end );
+        job->havetail = s->haveid;
+        if ( s->haveid ) job->tail = s->run;
+    }
+    job->havehead = s->havehead;
+
+    scan_free( s );
+    return status;
+}
+
+
+/*  Write the records of a completed job.  carry is the run that was open
+ *  at the end of the previous chunk of the same file.
+ */
+
+void write_job( job_t *job, run_t *carry, int *havecarry, outbuf_t *out ) {
+    const char  *filenum = job->file->filenum;
+    sims_file_t *file = job->file;
+    run_t       *first;
+
+    if ( job->chunk < 0 ) {
+        if ( job->out.len ) {
+            out_reserve( out, job->out.len );
+            memcpy( out->data + out->len, job->out.data, job->out.len );
+            out->len += job->out.len;
+        }
+        return;
+    }
+
+    /*  The first run of the chunk, which is either closed in the chunk
+     *  (head) or is still open at the end (tail).
+     */
+
+    first = job->havehead ? &(job->head) : job->havetail ? &(job->tail) : NULL;
+
+    if ( job->last ) {
+        file->end = job->end;
+        if ( *havecarry ) {
+            file->last     = *carry;
+            file->havelast = 1;
+        }
+    }
+
+    if ( *havecarry && first && ( first->idlen == carry->idlen )
+                    && ! memcmp( first->id, carry->id, carry->idlen )
+       ) {
+        first->seek0 = carry->seek0;   /*  continues the previous run  */
+        merge_summary( first, carry );
+    }
+    else if ( *havecarry ) {
+        report_run( out, filenum, carry );
+    }
+    *havecarry = 0;
+
+    if ( job->havehead ) {
+        report_run( out, filenum, &(job->head) );
+        if ( job->out.len ) {
+            out_reserve( out, job->out.len );
+            memcpy( out->data + out->len, job->out.data, job->out.len );
+            out->len += job->out.len;
+        }
+    }
+
+    if ( job->havetail ) {
+        if ( job->last ) {
+            file->last     = job->tail;
+            file->havelast = 1;
+            report_run( out, filenum, &(job->tail) );
+        }
+        else {
+            *carry = job->tail;
+            *havecarry = 1;
+        }
+    }
+}
+
+
+void scan_init( scan_t *s, const char *filenum, outbuf_t *out, u_long_long seek, run_t *head ) {
+    s->run.idlen = 0;
+    s->run.seek0 = seek;
+    s->fldlen    = 0;
+    s->infield   = 1;
+    s->haveid    = 0;
+    s->line0     = seek;
+    s->head      = head;
+    s->havehead  = 0;
+    s->filenum   = filenum;
+    s->out       = out;
+    s->blocks    = NULL;
+    s->subjects  = ( subject_index != NULL );
+    s->want      = summary ? 12 : s->subjects ? 2 : 0;
+    s->fields    = ( s->want > 0 );
+    s->fstate    = 0;
+    s->fno       = 0;
+    s->done      = 0;
+    s->slen      = 0;
+    s->numlen[0] = s->numlen[1] = 0;
+    s->run.nhits = 0;
+    s->post      = NULL;
+    s->postlen   = 0;
+    s->postsize  = 0;
+}
+
+
+/*  Add the waiting subject entries to the index, and free the scan.  */
+
+void scan_free( scan_t *s ) {
+    if ( s->postlen ) flush_posts( s );
+    if ( s->blocks ) {
+        free( s->blocks->block );
+        free( s->blocks );
+    }
+    free( s->post );
+    free( s );
+}
+
+
+/*  Scan n bytes of the file, starting at file seek base.  Each time the
+ *  first field of a line differs from the current id, the run of lines
+ *  with the previous id is ended.
+ */
+
+int scan_bytes( scan_t *s, const char *buf, size_t n, u_long_long base ) {
+    const char *bptr, *bend, *fend;
+    int         len;
+
+    bptr = buf;
+    bend = buf + n;
+    while ( bptr < bend ) {
+        if ( s->infield ) {
+
+            /*  Usual case: the line starts with the current id  */
+
+            len = s->run.idlen;
+            if ( ( ! s->fldlen ) && s->haveid && ( bend - bptr > len )
+                                 && isspace( (unsigned char) bptr[len] )
+                                 && same_bytes( bptr, s->run.id, len )
+               ) {
+                bptr += len;
+                s->infield = 0;
+                s->fstate  = s->fields;
+                s->fno     = 1;
+            }
+            else {
+
+                /*  Copy the first field, which might continue from the
+                 *  last buffer.
+                 */
+
+                fend = bptr;
+                while ( ( fend = find_ctl( fend, bend ) ) && ! isspace( (unsigned char) *fend ) ) fend++;
+                if ( ! fend ) fend = bend;
+
+                len = fend - bptr;
+                if ( s->fldlen + len > IDLEN ) {
+                    len = IDLEN - s->fldlen;
+                    memcpy( s->fld + s->fldlen, bptr, len );
+                    s->fld[ IDLEN ] = '\0';
                     fprintf( stderr, "Identifier at seek of %llu is > %d bytes\n%s\n",
-                             seek, IDLEN, idbuf );
-                    exit( 0 );
+                             s->line0, IDLEN, s->fld );
+                    return 1;
                 }
-		*iptr++ = c;
-		if ( ntogo <= 0 ) {
-		    ntogo = read( 0, buffer, BUFLEN );
-		    if ( ntogo <= 0 ) report_last_seek( idbuf, filenum, seek0, seek );
-		    nfills++; bptr = buffer;
-		}
-		c = *bptr++; ntogo--;
-	    }
-
-            *iptr = '\0';  /* Terminate id string */
-        }
-
-        /*  Flush the rest of the input line  */
-
-        while ( c != '\n' ) {
-	    if ( ntogo <= 0 ) {
-		ntogo = read( 0, buffer, BUFLEN );
-		if ( ntogo <= 0 ) {
-		    /*  Possibly a missing newline character.  We should */
-		    /*  check count of fields, but this might change     */
-		    seek = BUFLEN * ( nfills - 1 ) + ( bptr - buffer );
-		    report_last_seek( idbuf, filenum, seek0, seek );
-		}
-		nfills++; bptr = buffer;
-	    }
-	    c = *bptr++; ntogo--;
-	}
+                memcpy( s->fld + s->fldlen, bptr, len );
+                s->fldlen += len;
+                bptr = fend;
+                if ( bptr >= bend ) break;
+
+                /* End of first field.  Is this a new id? */
+
+                if ( ( ! s->haveid ) || ( s->fldlen != s->run.idlen )
+                                     || ! same_bytes( s->fld, s->run.id, s->fldlen )
+                   ) {
+                    if ( s->haveid ) end_run( s, s->line0 );
+                    memcpy( s->run.id, s->fld, s->fldlen );
+                    s->run.idlen = s->fldlen;
+                    s->run.id[ s->run.idlen ] = '\0';
+                    s->run.seek0 = s->line0;
+                    s->run.nhits = 0;
+                    s->haveid    = 1;
+                }
+                s->infield = 0;
+                s->fstate  = s->fields;
+                s->fno     = 1;
+            }
+        }
+
+        /*  Flush the rest of the input line (the field terminator might
+         *  be the newline).
+         */
+
+        fend = NULL;
+        if ( s->fstate ) {
+            if ( ( s->fstate == 1 ) && ( fend = find_nl( bptr, bend ) ) ) {
+                line_fields( s, bptr, fend );   /*  the rest of the line is here  */
+            }
+            else if ( scan_fields( s, &bptr, bend ) ) break;
+        }
+        if ( ! fend && ! ( fend = find_nl( bptr, bend ) ) ) break;
+        bptr = fend + 1;
+        if ( s->fields ) end_line( s, s->line0, base + ( bptr - buf ) );
+        s->line0   = base + ( bptr - buf );
+        s->infield = 1;
+        s->fldlen  = 0;
     }
-    exit( 0 );
+    return 0;
 }
 
 
-void report_last_seek( char * id, char * filenum, u_long_long seek0, u_long_long seek ) {
-    report_seek( id, filenum, seek0, seek );
-    exit( 0 );
+/*  Read the fields after the first (which might continue from the last
+ *  buffer), keeping the subject id (field 2) and psc and bsc (fields 11 and
+ *  12) as needed.  Returns 1 if the end of the buffer is reached first.
+ */
+
+int scan_fields( scan_t *s, const char **bptr, const char *bend ) {
+    const char *p = *bptr, *fend;
+    char       *f;
+    int        *flen, len, max;
+
+    while ( 1 ) {
+        if ( s->fstate == 1 ) {           /*  step over the end of field fno  */
+            if ( p >= bend ) break;
+            if ( *p == '\n' ) {
+                s->fstate = 0;
+                break;
+            }
+            p++;
+            s->fno++;
+            s->fstate = 2;
+        }
+
+        fend = p;
+        while ( ( fend = find_ctl( fend, bend ) ) && ! isspace( (unsigned char) *fend ) ) fend++;
+        if ( ! fend ) fend = bend;
+
+        f = NULL;
+        if      ( s->fno ==  2 && s->subjects ) { f = s->sfld;   flen = &( s->slen );      max = IDLEN;  }
+        else if ( s->fno == 11 && summary )     { f = s->num[0]; flen = &( s->numlen[0] ); max = NUMLEN; }
+        else if ( s->fno == 12 && summary )     { f = s->num[1]; flen = &( s->numlen[1] ); max = NUMLEN; }
+        if ( f && ( *flen >= 0 ) ) {
+            len = fend - p;
+            if ( *flen + len > max ) *flen = -1;
+            else {
+                memcpy( f + *flen, p, len );
+                *flen += len;
+            }
+        }
+
+        p = fend;
+        if ( p >= bend ) break;
+        end_field( s );
+        s->fstate = ( s->fno < s->want ) ? 1 : 0;
+        if ( ! s->fstate ) break;
+    }
+
+    *bptr = p;
+    return ( p >= bend ) && s->fstate;
+}
+
+
+/*  The same as scan_fields(), for the usual case of a line that is all in
+ *  the buffer: p is the end of the first field, and nl the newline.  The
+ *  field separators are found in one pass.
+ */
+
+void line_fields( scan_t *s, const char *p, const char *nl ) {
+    const char *sep[12], *f, *fend;
+    char       *to;
+    int         nsep, fno, len, max, *flen;
+
+    nsep = line_seps( p, nl, sep, s->want );
+
+    /*  Field fno runs from sep[fno-2] + 1 to sep[fno-1], or to nl  */
+
+    for ( fno = 2; fno <= s->want && fno - 2 < nsep; fno++ ) {
+        if      ( fno ==  2 && s->subjects ) { to = s->sfld;   flen = &( s->slen );      max = IDLEN;  }
+        else if ( fno == 11 && summary )     { to = s->num[0]; flen = &( s->numlen[0] ); max = NUMLEN; }
+        else if ( fno == 12 && summary )     { to = s->num[1]; flen = &( s->numlen[1] ); max = NUMLEN; }
+        else continue;
+
+        f    = sep[fno-2] + 1;
+        fend = ( fno - 1 < nsep ) ? sep[fno-1] : nl;
+        len  = fend - f;
+        if ( len > max ) *flen = -1;
+        else {
+            memcpy( to, f, len );
+            *flen = len;
+        }
+        s->fno = fno;
+        end_field( s );
+    }
+    s->fstate = 0;
+}
+
+
+/*  Find up to nsep whitespace bytes from p to end (which is where the
+ *  fields of a line end).  Returns the number found.
+ */
+
+int line_seps( const char *p, const char *end, const char **sep, int nsep ) {
+    int n = 0;
+
+#ifdef USE_SSE2
+    const __m128i sp = _mm_set1_epi8( ' ' );
+    __m128i       x;
+    int           mask, i;
+
+    for ( ; p + 16 <= end; p += 16 ) {
+        x = _mm_loadu_si128( (const __m128i *) p );
+        mask = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_min_epu8( x, sp ), x ) );
+        while ( mask ) {
+            i = __builtin_ctz( mask );
+            if ( isspace( (unsigned char) p[i] ) ) {
+                sep[n++] = p + i;
+                if ( n >= nsep ) return n;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for ( ; p < end; p++ ) {
+        if ( ( (unsigned char) *p <= ' ' ) && isspace( (unsigned char) *p ) ) {
+            sep[n++] = p;
+            if ( n >= nsep ) return n;
+        }
+    }
+    return n;
+}
+
+
+void end_field( scan_t *s ) {
+    if      ( s->fno ==  2 ) s->done |= 1;
+    else if ( s->fno == 11 ) s->done |= 2;
+    else if ( s->fno == 12 ) s->done |= 4;
+}
+
+
+/*  The end of a line, from line0 up to end: queue its subject entry, and
+ *  add it to the summary of the run.
+ */
+
+void end_line( scan_t *s, u_long_long line0, u_long_long end ) {
+    run_t  *run = &( s->run );
+    double  psc, bsc;
+
+    if ( ( s->done & 1 ) && ( s->slen > 0 ) ) add_post( s, line0, end - line0 );
+
+    if ( ( ( s->done & 6 ) == 6 ) && ( s->numlen[0] > 0 ) && ( s->numlen[1] > 0 ) ) {
+        s->num[0][ s->numlen[0] ] = '\0';
+        s->num[1][ s->numlen[1] ] = '\0';
+        psc = get_score( s->num[0] );
+        bsc = get_score( s->num[1] );
+        if ( ! run->nhits || ( psc < run->best_psc ) ) {
+            run->best_psc  = psc;
+            run->best_seek = line0;
+            memcpy( run->best_psc_text, s->num[0], s->numlen[0] + 1 );
+        }
+        if ( ! run->nhits || ( bsc > run->best_bsc ) ) {
+            run->best_bsc = bsc;
+            memcpy( run->best_bsc_text, s->num[1], s->numlen[1] + 1 );
+        }
+        run->nhits++;
+    }
+
+    s->done      = 0;
+    s->slen      = 0;
+    s->numlen[0] = s->numlen[1] = 0;
+}
+
+
+/*  Convert a psc or bsc.  strtod() takes most of the time of -s, mostly
+ *  on exponents like 1e-150, so the usual forms are converted here, and
+ *  anything else is left to strtod().
+ */
+
+double get_score( const char *p ) {
+    static const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char  *p0 = p;
+    u_long_long  m = 0;
+    double       v;
+    int          neg = 0, ndig = 0, exp = 0, eneg = 0, e = 0;
+
+    if ( *p == '-' ) { neg = 1; p++; }
+    for ( ; ( *p >= '0' ) && ( *p <= '9' ); p++, ndig++ ) m = 10 * m + ( *p - '0' );
+    if ( *p == '.' ) {
+        for ( p++; ( *p >= '0' ) && ( *p <= '9' ); p++, ndig++, exp-- ) m = 10 * m + ( *p - '0' );
+    }
+    if ( ( *p == 'e' ) || ( *p == 'E' ) ) {
+        p++;
+        if ( *p == '-' ) { eneg = 1; p++; }
+        else if ( *p == '+' ) p++;
+        if ( ( *p < '0' ) || ( *p > '9' ) ) return strtod( p0, NULL );
+        for ( ; ( *p >= '0' ) && ( *p <= '9' ) && ( e < 10000 ); p++ ) e = 10 * e + ( *p - '0' );
+        exp += eneg ? -e : e;
+    }
+    if ( *p || ( ndig == 0 ) || ( ndig > 18 ) ) return strtod( p0, NULL );
+
+    v = (double) m;
+    if ( exp < 0 ) {
+        while ( exp < -22 ) { v /= 1e22; exp += 22; }
+        v /= pow10[-exp];
+    }
+    else {
+        while ( exp > 22 ) { v *= 1e22; exp -= 22; }
+        v *= pow10[exp];
+    }
+    return neg ? -v : v;
+}
+
+
+/*  Add the summary of prev, the earlier part of a run, to run.  */
+
+void merge_summary( run_t *run, const run_t *prev ) {
+    if ( ! prev->nhits ) return;
+    if ( ! run->nhits || ( prev->best_psc <= run->best_psc ) ) {
+        run->best_psc  = prev->best_psc;
+        run->best_seek = prev->best_seek;
+        strcpy( run->best_psc_text, prev->best_psc_text );
+    }
+    if ( ! run->nhits || ( prev->best_bsc > run->best_bsc ) ) {
+        run->best_bsc = prev->best_bsc;
+        strcpy( run->best_bsc_text, prev->best_bsc_text );
+    }
+    run->nhits += prev->nhits;
+}
+
+
+/*  Queue a subject entry for the line at seek.  */
+
+void add_post( scan_t *s, u_long_long seek, u_long_long len ) {
+    post_t post;
+    size_t need = sizeof( post_t ) + ( ( s->slen + 7 ) & ~7 );
+
+    if ( ! s->filenum[0] ) return;
+    if ( s->postlen + need > s->postsize ) {
+        if ( s->postlen >= POSTLEN ) flush_posts( s );
+        if ( s->postlen + need > s->postsize ) {
+            s->postsize = s->postsize ? 2 * s->postsize : POSTLEN + sizeof( post_t ) + IDLEN + 8;
+            s->post = (char *) xrealloc( s->post, s->postsize );
+        }
+    }
+    post.seek  = seek;
+    post.len   = (unsigned) len;
+    post.idlen = s->slen;
+    memcpy( s->post + s->postlen, &post, sizeof( post_t ) );
+    memcpy( s->post + s->postlen + sizeof( post_t ), s->sfld, s->slen );
+    s->postlen += need;
+}
+
+
+/*  Add the queued subject entries to the subject index.  Seeks in a blocked
+ *  gzip file are converted to virtual seeks.
+ */
+
+void flush_posts( scan_t *s ) {
+    post_t       post;
+    size_t       p;
+    unsigned     fileN = (unsigned) strtoul( s->filenum, NULL, 10 );
+    u_long_long  seek;
+
+    pthread_mutex_lock( &subject_lock );
+    for ( p = 0; p < s->postlen; p += sizeof( post_t ) + ( ( post.idlen + 7 ) & ~7 ) ) {
+        memcpy( &post, s->post + p, sizeof( post_t ) );
+        seek = s->blocks ? virtual_seek( s->blocks, post.seek ) : post.seek;
+        if ( ssi_add( subject_index, s->post + p + sizeof( post_t ), post.idlen, fileN, seek, post.len ) ) {
+            fprintf( stderr, "index_sims_file: failed to add to subject index\n" );
+            exit( 1 );
+        }
+    }
+    pthread_mutex_unlock( &subject_lock );
+    s->postlen = 0;
+}
+
+
+/*  End of data at seek.  A final line without a complete identifier is
+ *  not part of the last run.  Returns the end of the open run, which is
+ *  left in s->run.
+ */
+
+u_long_long scan_finish( scan_t *s, u_long_long seek ) {
+    if ( s->infield ) {
+        if ( s->fldlen ) fprintf( stderr, "End of sims file inside identifier\n" );
+        seek = s->line0;
+    }
+    else if ( s->fields ) {
+        if ( s->fstate == 2 ) end_field( s );       /*  last line has no newline  */
+        end_line( s, s->line0, seek );
+    }
+    s->run.seek = seek;
+    return seek;
+}
+
+
+void end_run( scan_t *s, u_long_long seek ) {
+    s->run.seek = seek;
+    if ( s->head && ! s->havehead ) {
+        *(s->head) = s->run;
+        s->havehead = 1;
+    }
+    else {
+        if ( s->blocks ) virtual_run( s->blocks, &(s->run) );
+        report_run( s->out, s->filenum, &(s->run) );
+    }
+}
+
+
+void report_run( outbuf_t *out, const char *filenum, run_t *run ) {
+    if ( run->idlen && run->idlen < MAXRPT && filenum[0] && ( run->seek > run->seek0 ) ) {
+        out_reserve( out, run->idlen + strlen( filenum ) + 2 * NUMLEN + 160 );
+        out->len += sprintf( out->data + out->len, "%s\t%s\t%llu\t%llu",
+                             run->id, filenum, run->seek0, run->seek - run->seek0 );
+        if ( ! summary ) {
+            out->data[ out->len++ ] = '\n';
+        }
+        else if ( run->nhits ) {
+            out->len += sprintf( out->data + out->len, "\t%d\t%s\t%s\t%llu\n",
+                                 run->nhits, run->best_psc_text, run->best_bsc_text, run->best_seek );
+        }
+        else {
+            out->len += sprintf( out->data + out->len, "\t0\t\\N\t\\N\t\\N\n" );
+        }
+    }
+}
+
+
+/*  Add seek records, as written to stdout, to the binary index  */
+
+void index_rows( const char *data, size_t len ) {
+    const char *end, *id, *f;
+    char       *next;
+    uint32_t    fileN, n;
+    uint64_t    seek;
+
+    end = data + len;
+    while ( data < end ) {
+        id = data;
+        f  = memchr( id, '\t', end - id );
+        fileN = (uint32_t) strtoul( f + 1, &next, 10 );
+        seek  = strtoull( next + 1, &next, 10 );
+        n     = (uint32_t) strtoul( next + 1, &next, 10 );
+        if ( ssi_add( seek_index, id, f - id, fileN, seek, n ) ) {
+            fprintf( stderr, "index_sims_file: failed to add to seek index\n" );
+            exit( 1 );
+        }
+        data = (const char *) memchr( next, '\n', end - next ) + 1;   /*  past any summary  */
+    }
+}
+
+
+/*============================================================================
+ *  Line scanning.  Vector loads never extend past end.
+ *==========================================================================*/
+
+const char *find_nl_scalar( const char *p, const char *end ) {
+    return (const char *) memchr( p, '\n', end - p );
+}
+
+
+const char *find_ctl_scalar( const char *p, const char *end ) {
+    while ( p < end ) {
+        if ( (unsigned char) *p <= ' ' ) return p;
+        p++;
+    }
+    return NULL;
+}
+
+
+#ifdef USE_SSE2
+
+const char *find_nl_sse2( const char *p, const char *end ) {
+    const __m128i nl = _mm_set1_epi8( '\n' );
+    int           mask;
+
+    for ( ; p + 16 <= end; p += 16 ) {
+        mask = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *) p ), nl ) );
+        if ( mask ) return p + __builtin_ctz( mask );
+    }
+    return find_nl_scalar( p, end );
+}
+
+
+/*  x <= ' ' (unsigned) is min( x, ' ' ) == x  */
+
+const char *find_ctl_sse2( const char *p, const char *end ) {
+    const __m128i sp = _mm_set1_epi8( ' ' );
+    __m128i       x;
+    int           mask;
+
+    for ( ; p + 16 <= end; p += 16 ) {
+        x = _mm_loadu_si128( (const __m128i *) p );
+        mask = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_min_epu8( x, sp ), x ) );
+        if ( mask ) return p + __builtin_ctz( mask );
+    }
+    return find_ctl_scalar( p, end );
+}
+
+#endif
+
+
+#ifdef USE_AVX2
+
+__attribute__((target("avx2")))
+const char *find_nl_avx2( const char *p, const char *end ) {
+    const __m256i nl = _mm256_set1_epi8( '\n' );
+    unsigned      mask;
+
+    for ( ; p + 32 <= end; p += 32 ) {
+        mask = (unsigned) _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i *) p ), nl ) );
+        if ( mask ) break;
+    }
+    _mm256_zeroupper();    /*  -O does not add this, and SSE code after it crawls  */
+    return ( p + 32 <= end ) ? p + __builtin_ctz( mask ) : find_nl_sse2( p, end );
+}
+
+
+__attribute__((target("avx2")))
+const char *find_ctl_avx2( const char *p, const char *end ) {
+    const __m256i sp = _mm256_set1_epi8( ' ' );
+    __m256i       x;
+    unsigned      mask;
+
+    for ( ; p + 32 <= end; p += 32 ) {
+        x = _mm256_loadu_si256( (const __m256i *) p );
+        mask = (unsigned) _mm256_movemask_epi8( _mm256_cmpeq_epi8( _mm256_min_epu8( x, sp ), x ) );
+        if ( mask ) break;
+    }
+    _mm256_zeroupper();
+    return ( p + 32 <= end ) ? p + __builtin_ctz( mask ) : find_ctl_sse2( p, end );
+}
+
+#endif
+
+
+void init_scanner( void ) {
+#ifdef USE_SSE2
+    find_nl  = find_nl_sse2;
+    find_ctl = find_ctl_sse2;
+#endif
+#ifdef USE_AVX2
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) ) {
+        find_nl  = find_nl_avx2;
+        find_ctl = find_ctl_avx2;
+    }
+#endif
+}
+
+
+/*  Compare n bytes, 16 at a time  */
+
+int same_bytes( const char *a, const char *b, int n ) {
+#ifdef USE_SSE2
+    for ( ; n >= 16; a += 16, b += 16, n -= 16 ) {
+        if ( _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *) a ),
+                                                _mm_loadu_si128( (const __m128i *) b )
+                                              ) ) != 0xFFFF
+           ) return 0;
+    }
+#endif
+    return ! memcmp( a, b, n );
 }
 
 
-void report_seek( char * id, char * filenum, u_long_long seek0, u_long_long seek ) {
-    if ( id && id[0] && strlen(id) < 64 && filenum && filenum[0] && ( seek > seek0 ) ) {
-        printf("%s\t%s\t%llu\t%llu\n", id, filenum, seek0, seek-seek0);
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "index_sims_file: out of memory\n" );
+        exit( 1 );
     }
+    return ptr;
 }
 
 
 void usage( char * prog ) {
     fprintf( stderr,
-             "Usage: %s  SimsFileNumber  < SimsFile  > SimSeeks\n"
-             "or     %s  -v    (writes the version to stdout)\n",
-             prog, prog
+             "Usage: %s  [ options ]  SimsFileNumber  < SimsFile  > SimSeeks\n"
+             "or     %s  [ options ]  < file_list  > SimSeeks\n"
+             "or     %s  -v    (writes the version to stdout)\n"
+             "Options:  -j nthreads     index on nthreads threads (0 = number of processors)\n"
+             "          -b SeekIndex    also write a binary seek index\n"
+             "          -c Checkpoints  index only data appended since the checkpoints\n"
+             "          -r SubjectIndex write a binary index of lines by subject id\n"
+             "          -s              add summary fields to the seek records\n",
+             prog, prog, prog
            );
     exit( 0 );
 }
@@ -2,21 +2,23 @@
  *
  *  compile with
  *
- *     cc -O3 -o index_translation_files index_translation_files.c
+ *     cc -O3 -o index_translation_files index_translation_files.c translation_reader.c bgzf.c md5.c -lz
  *
+ *  (translation_reader.c and md5.c need the perl CORE include directory.)
  *
- *  Usage: index_translation_files  max_ids  max_id_len  [cksum_suffix_len (D=64)] \
+ *  Usage: index_translation_files  [ -m md5_file ]  max_ids  max_id_len  [cksum_suffix_len (D=64)] \
  *                 < file_list > seek_size_and_cksum_info
  *  or     index_translation_files -v  > version_number
  *
  *
  *  file_list contains one or more lines of form:
  *
- *      FileNum \t FileName [ \t IDPrefix ]
+ *      FileNum \t FileName [ \t IDPrefix [ \t GenomeID ] ]
  *
  *      FileNum    FIG file index number
  *      FileName  Name of the file to be indexed (should be absolute path)
  *      IDPrefix  If given, ids in the file will be checked for the prefix
+ *      GenomeID  If given, with -m, the MD5s of the file are written
  *
  *
  *  Seek records are of form:
@@ -31,6 +33,24 @@
  *      Cksum      cksum of toupper( non-space sequence char )
  *      SuffixCk   cksum of last suffix_len toupper( non-space sequence char )
  *
+ *  A translations file compressed to blocked gzip (see bgzf.h) is read a
+ *  block at a time.  StartSeek is then a virtual seek (the file offset of
+ *  the compressed block times 65536, plus the offset in the uncompressed
+ *  block), and DataBytes counts uncompressed bytes, so the sequence is
+ *  read with bgzf_read_at() (or BGZF.pm).
+ *
+ *  With -m, the sequences of files with a GenomeID also get MD5 records,
+ *  written to md5_file, for protein_sequence_MD5:
+ *
+ *      SeqId \t GenomeID \t MD5
+ *
+ *      MD5        hex MD5 of toupper( non-space sequence char ), as in the
+ *                 perl of index_translations_MD5 (and compute_translation_MD5)
+ *
+ *  These are computed in the same pass as the cksums.  As in the perl, a
+ *  sequence of fewer than 5 residues gets no MD5, and the last MD5 of a
+ *  duplicated id is kept.
+ *
  *  Version 1.00.
  *
  *  Version 2.00:
@@ -43,48 +63,50 @@
  *  Version 2.01:
  *     Include cksum.c and simplehash.c in this file to simplify the make.
  *
- *  Thoughts for the future:
- *     Get avg_id_len from the command line
- *     Dynamically increasing key storage would not be hard
- *     Dynamically increasing number of enties is a pain
- *          ( Since file name is known, we could autorecover using
- *            "grep '^>' filename | wc -l" to get a new max, or do
- *            our own within the program.)
+ *  Version 2.02:
+ *     Index blocked gzip files, with virtual seeks.  Requires bgzf.c.
+ *
+ *  Version 2.03:
+ *     Add -m md5_file, and GenomeID to the file list.  Requires md5.c.
+ *
+ *  Version 2.04:
+ *     Keys are kept in chunks that are added as needed, and the hash is
+ *     open addressed, with the hash value of each key cached in its slot,
+ *     and doubles as it fills.  max_ids is only the most ids allocated at
+ *     the start; no number or length of ids ends the program.
+ *
+ *  Version 2.05:
+ *     Read the files with translation_reader.c, which is shared with
+ *     compute_translation_MD5, so the two read ids and make MD5s alike.
+ *     As before, bytes above 127 are white space and a NUL ends a line
+ *     (TR_ASCII), so the seeks, lengths and cksums are unchanged.
  */
 
 #include <stdio.h>
 #include <stdlib.h>    /*  exit() */
 #include <fcntl.h>     /*  O_RDONLY -- actually in <sys/fcntl.h> */
-#include <unistd.h>    /*  ssize_t read( int fd, void *buf, size_t buflen ); */
+#include <unistd.h>    /*  close() */
 #include <string.h>    /*  for strcmp() and strncmp() */
 
-#define  VERSION      "2.01"  /*  Program version number  */
+#include "translation_reader.h"
+
+#define  VERSION      "2.05"  /*  Program version number  */
 #define  MINLEN          11   /*  Minimum sequence length indexed */
 #define  SHOWSHORT        0   /*  Report identifiers skipped due to MINLEN?  */
 #define  SHOWDUPS         1   /*  Report duplicated ids (off might be best) */
 #define  SUFFIXLEN       64   /*  Number of residues in a "suffix cksum" */
 #define  SUFBUFLEN     1024   /*  Bytes in suffix buffer (power of 2) */
 #define  SUFBUFMSK (SUFBUFLEN-1) /*  Mask to get offset into suffix buffer */
-#define  KEYSPACE        32   /*  Average bytes per key, including '\0'  */
+#define  KEYCHUNK  (64*1024)  /*  Bytes in a chunk of key text  */
+#define  INITKEYS      1024   /*  Most ids allocated at the start  */
 #define  MAXERROR         5   /*  Number of bad residues to report  */
-#define  N_BAR_OK         4   /*  Number of vertical bars allowed in an id */
 
-#define  BUFLEN   (128*1024)  /*  Read buffer length for translation files */
 #define  INPLEN   (  4*1024)  /*  Buffer length for translation_file_list  */
 
 /*
  *  Some structures:
  */
 
-/*  From simplehash.h  */
-
-typedef struct {
-    size_t     size;
-    unsigned   (* fnc)(void * key);
-    int        (* cmp)(void * key1, void * key2);
-    void    ** hash;
-} hashdata;
-
 /*  From cksum.h  */
 
 typedef struct { unsigned  crc; unsigned  len; } cksum_t;
@@ -99,20 +121,49 @@ typedef struct
     int        slen;      /* sequence length w/o white space */
     int        cksum;     /* cksum of uppercase sequence (coerced to int) */
     int        sufcksum;  /* cksum of last suffix_len residues of sequence */
+    int        md5ok;     /* is there an MD5? */
+    unsigned char md5[16];   /* MD5 of uppercase sequence, with -m */
 } indexdata;
 
 
+/*
+ *  Key text is kept in chunks, so keys never move as more are added.  The
+ *  chunks are reused by the next file.
+ */
+
+typedef struct keychunk
+{
+    struct keychunk *next;
+    size_t           size;    /* bytes of text */
+    size_t           used;
+    char             text[1];
+} keychunk;
+
+/*
+ *  A hash slot holds the index of the indexdata struct plus one (zero is
+ *  empty), and the hash value of its key, so that most probes do not need
+ *  to look at the key.
+ */
+
+typedef struct
+{
+    unsigned    hash;
+    int         index;
+} hashslot;
+
+
 typedef struct
 {
     int         nkey;
-    int         maxkey;
+    int         maxkey;   /* indexdata structs allocated */
+    int         initkey;  /* indexdata structs allocated at the start */
     int         maxkeylen;
     int         suffixlen;
-    size_t      keyspace; /* size of text area (32 * maxkey) */
-    char       *keys;     /* text storage area */
-    char       *nxtkey;   /* pointer to next free byte */
+    keychunk   *keys;     /* first chunk of key text */
+    keychunk   *curkeys;  /* chunk being filled */
     indexdata  *data;     /* array to data storage structures */
-    hashdata   *hash;
+    hashslot   *slots;
+    size_t      nslot;    /* a power of 2, at least twice nkey */
 } globaldata;
 
 
@@ -120,16 +171,6 @@ typedef struct
  *  Function prototypes:
  */
 
-/*  From simplehash.h  */
-
-hashdata * newhash( size_t maxkeys,
-                    unsigned (* fnc)( void * key ),
-                    int (* cmp)( void * key1, void * key2 )
-                  );
-void       clearhash( hashdata * hd );
-void     * add2hash( hashdata * hd, void * key );
-void       freehash( hashdata * hd );
-
 /*  From cksum.h  */
 
 cksum_t  *new_cksum( void );
@@ -146,23 +187,41 @@ globaldata  *initialize( int maxids, int maxidlen, int suffixlen );
 
 globaldata  *reset( globaldata *gd );
 
-unsigned  my_hash_value( void *datum );
+unsigned  key_hash( const char *key );
 
 unsigned  str_cksum( char * str );
 
-int  my_cmp_func( void *datum1, void *datum2 );
+char  *key_space( globaldata *gd );
+
+indexdata  *add_key( globaldata *gd, char *key, char *keyend );
+
+int  grow_hash( globaldata *gd );
 
-int index_a_file ( int inpfd, char *prefix, globaldata *gd, char *prog );
+int index_a_file ( tr_file_t *tf, char *prefix, globaldata *gd );
 
 void  record_info( indexdata *datum, long long seek, int bytes,
                    int slen, unsigned crc, char *suffix, int suflen
                  );
 
-int  report_info( globaldata *gd, int filenum, FILE * fp );
+int  report_info( globaldata *gd, tr_file_t *tf, int filenum, FILE * fp,
+                  char *gid, FILE * md5fp );
 
 void  usage( char *prog );
 
 
+/*  The file being indexed  */
+
+static tr_file_t trf;
+
+/*  MD5 of the sequence being indexed, with -m  */
+
+static tr_md5_t *md5s;
+
+/*  Set when memory cannot be had for the file being indexed  */
+
+static int nomem;
+
+
 /*  CRC table is from cksum.h  */
 
 static unsigned crctab[] = {
@@ -285,11 +344,12 @@ uc[256] = {
 int main ( int argc, char **argv )
 {
     char        inpbuf[ INPLEN ];  /* read buffer for files to be processed */
-    char       *bptr, *prefix, *filename;
+    char       *bptr, *prefix, *filename, *gid, *md5name, *prog;
+    FILE       *md5fp;
     globaldata *gd;
     int         maxids, maxidlen, suflen;
     int         filenum, inpfd;
-    int         c, nf, indexed;
+    int         c, nf, indexed, status;
 
 
     /*
@@ -302,13 +362,27 @@ int main ( int argc, char **argv )
 	return 0;
     }
 
+    /*
+     *  -m md5_file asks for the MD5s:
+     */
+
+    prog    = argv[0];
+    md5name = NULL;
+    md5fp   = NULL;
+    if ( ( argc > 2 ) && ( strcmp( argv[1], "-m" ) == 0 ) )
+    {
+	md5name = argv[2];
+	argc -= 2;
+	argv += 2;
+    }
+
     /*
      *  Otherwise read max_ids and max_id_len:
      */
 
     if ( ( argc < 3 ) || ( ( maxids   = atoi( argv[1] ) ) < 1 )
                       || ( ( maxidlen = atoi( argv[2] ) ) < 1 )
-       ) usage( argv[0] );
+       ) usage( prog );
 
     /*
      *  Read suffix_len, or set it to default (64):
@@ -333,11 +407,25 @@ int main ( int argc, char **argv )
 	return 1;
     }
 
+    if ( md5name )
+    {
+	if ( ! ( md5fp = fopen( md5name, "w" ) ) )
+	{
+	    fprintf( stderr, "Failed to open MD5 file: %s\n", md5name );
+	    return 1;
+	}
+	if ( ! ( md5s = tr_md5_new( TR_ASCII ) ) )
+	{
+	    fprintf( stderr, "Failed to initialize memory and/or hash\n" );
+	    return 1;
+	}
+    }
+
     /*
      *  Read the list of files to be processed from stdin
      */
 
-    indexed = nf = 0;
+    indexed = nf = status = 0;
     while ( fgets( inpbuf, INPLEN,  stdin ) )
     {
 	/*
@@ -369,9 +457,21 @@ int main ( int argc, char **argv )
 	if ( c ) { while ( ( c = *bptr ) && ( c >= ' ' ) ) bptr++; }
 	*bptr++ = '\0';           /* convert terminator to end-of-string */
 
+	/*
+	 *  Likewise the genome ID, if the prefix ended with a tab.
+	 */
+
+	gid = bptr - 1;           /* the '\0' just written */
+	if ( c == '\t' )
+	{
+	    gid = bptr;
+	    while ( ( c = *bptr ) && ( c >= ' ' ) ) bptr++;
+	    *bptr = '\0';
+	}
+
 	#ifdef DEBUG
-	    fprintf( stderr, "filenum = %d, filename = %s, prefix = %s\n",
-	             filenum, filename, prefix
+	    fprintf( stderr, "filenum = %d, filename = %s, prefix = %s, gid = %s\n",
+	             filenum, filename, prefix, gid
 	           );
 	#endif
 
@@ -387,22 +487,49 @@ int main ( int argc, char **argv )
 	           );
 	    continue;
 	}
-	(void) index_a_file( inpfd, prefix, gd, argv[0] );
+	if (    tr_open( &trf, inpfd, TR_ASCII ) || ( index_a_file( &trf, prefix, gd ) < 0 )
+	     || nomem || ( trf.status == TR_NOMEM )
+	   )
+	{
+	    fprintf( stderr, "ERROR: Failed to allocate memory for %s\n", filename );
+	    (void) close( inpfd );
+	    tr_close( &trf );
+	    status = 1;
+	    continue;
+	}
 	(void) close( inpfd );
-	indexed += report_info( gd, filenum, stdout );
+	if ( trf.status == TR_BADREAD )
+	{
+	    fprintf( stderr,
+	             trf.bgzf ? "ERROR: Bad blocked gzip block in translations file: %s\n"
+	                      : "ERROR: Failed to read translations file: %s\n",
+	             filename
+	           );
+	}
+	indexed += report_info( gd, &trf, filenum, stdout, gid, md5fp );
+	tr_close( &trf );
 	nf++;
     }
 
     fprintf( stderr, "%s indexed %d sequences in %d files\n\n",
-                     argv[0], indexed, nf
+                     prog, indexed, nf
            );
 
-    return 0;
+    if ( md5fp && fclose( md5fp ) )
+    {
+	fprintf( stderr, "Failed to write MD5 file: %s\n", md5name );
+	return 1;
+    }
+
+    return status;
 }  /* main */
 
 
 /*============================================================================
  *  initialize
+ *
+ *  At most INITKEYS ids are allocated at the start; everything grows as
+ *  needed.
  *==========================================================================*/
 
 globaldata * initialize( int maxids, int maxidlen, int suffixlen )
@@ -417,41 +544,21 @@ globaldata * initialize( int maxids, int maxidlen, int suffixlen )
     }
 
     gd->nkey       = 0;
-    gd->maxkey     = maxids;
+    gd->initkey    = ( maxids < INITKEYS ) ? maxids : INITKEYS;
+    gd->maxkey     = gd->initkey;
     gd->maxkeylen  = maxidlen;
     gd->suffixlen  = suffixlen;
-
-    /*
-     *  There might be merit in allocating space by max key len,
-     *  but that could get huge.  Another alternative would be
-     *  to make the average length a command line arg.
-     */
-
-    gd->keyspace = KEYSPACE * maxids;
-    gd->keys = (char *) malloc( sizeof( char ) * gd->keyspace );
-    if ( ! gd->keys )
-    {
-	free( gd );
-	return (globaldata *) 0;
-    }
-    gd->nxtkey = gd->keys;
-
-    gd->data = (indexdata *) malloc( sizeof( indexdata ) * maxids );
-    if ( ! gd->data )
-    {
-	free( gd->keys );
-	free( gd );
-	return (globaldata *) 0;
-    }
-
-    gd->hash = newhash( maxids,
-	                (unsigned (*)(void *) )my_hash_value,
-	                (int (*)(void *, void *))my_cmp_func
-	              );
-    if ( ! gd->hash )
+    gd->keys       = NULL;
+    gd->curkeys    = NULL;
+
+    gd->data = (indexdata *) malloc( sizeof( indexdata ) * gd->maxkey );
+    gd->nslot = 16;
+    while ( gd->nslot < 2 * (size_t) gd->maxkey ) gd->nslot *= 2;
+    gd->slots = (hashslot *) calloc( gd->nslot, sizeof( hashslot ) );
+    if ( ! gd->data || ! gd->slots )
     {
 	free( gd->data );
-	free( gd->keys );
+	free( gd->slots );
 	free( gd );
 	return (globaldata *) 0;
     }
@@ -462,101 +569,209 @@ globaldata * initialize( int maxids, int maxidlen, int suffixlen )
 
 /*============================================================================
  *  reset
+ *
+ *  Empty the keys and the hash for the next file.  After a big file, the
+ *  hash goes back to its starting size, so that clearing it stays cheap.
  *==========================================================================*/
 
 globaldata *reset( globaldata *gd )
 {
-    gd->nkey   = 0;
-    gd->nxtkey = gd->keys;
-    clearhash( gd->hash );
+    keychunk *kc;
+    size_t    nslot;
+
+    for ( kc = gd->keys; kc; kc = kc->next ) kc->used = 0;
+    gd->curkeys = gd->keys;
+    gd->nkey    = 0;
+
+    nslot = 16;
+    while ( nslot < 2 * (size_t) gd->initkey ) nslot *= 2;
+    if ( gd->nslot > nslot )
+    {
+	hashslot *slots = (hashslot *) calloc( nslot, sizeof( hashslot ) );
+	if ( slots )
+	{
+	    free( gd->slots );
+	    gd->slots = slots;
+	    gd->nslot = nslot;
+	    return gd;
+	}
+    }
+    memset( gd->slots, 0, gd->nslot * sizeof( hashslot ) );
+
     return gd;
 }  /* reset */
 
 
 /*============================================================================
- *  my_hash_value
+ *  key_hash
+ *
+ *  FNV-1a hash of a key.
  *==========================================================================*/
 
-unsigned my_hash_value( void *datum )
+unsigned key_hash( const char *key )
 {
-    return str_cksum( ((indexdata *)datum)->key );
-}  /* my_hash_value */
+    unsigned  h = 2166136261u;
+
+    while ( *key ) h = ( h ^ (unsigned char) *key++ ) * 16777619u;
+    return h;
+}  /* key_hash */
 
 
 /*============================================================================
- *  my_cmp_func
+ *  key_space
+ *
+ *  Space for the text of a key of up to maxkeylen characters (and the
+ *  '\0') at the end of the key chunks.  Nothing is reserved until add_key
+ *  keeps the key.  Returns NULL if no memory is available.
  *==========================================================================*/
 
-int my_cmp_func( void *datum1, void *datum2 )
+char *key_space( globaldata *gd )
 {
-    return strcmp( ((indexdata *)datum1)->key, ((indexdata *)datum2)->key );
-}  /* my_cmp_func */
+    keychunk *kc;
+    size_t    need, size;
 
+    need = gd->maxkeylen + 1;
+    kc   = gd->curkeys;
+    if ( kc && ( kc->used + need <= kc->size ) ) return kc->text + kc->used;
+
+    /*
+     *  Move on to the next chunk, left from an earlier file, or a new one.
+     */
+
+    if ( kc && kc->next )
+    {
+	gd->curkeys = kc = kc->next;
+	kc->used = 0;
+	return kc->text;
+    }
+
+    size = ( need > KEYCHUNK ) ? need : KEYCHUNK;
+    if ( ! ( kc = (keychunk *) malloc( sizeof( keychunk ) + size ) ) )
+    {
+	nomem = 1;
+	return NULL;
+    }
+    kc->next = NULL;
+    kc->size = size;
+    kc->used = 0;
+    if ( gd->curkeys ) gd->curkeys->next = kc;
+    else               gd->keys = kc;
+    gd->curkeys = kc;
+
+    return kc->text;
+}  /* key_space */
 
 
 /*============================================================================
- *  These 2 chunks of code are repeated, and they clutter the flow of the
- *  subroutine below.  They have been brought out as macros with many required
- *  side effects.  Most of the arguments MUST be simple variables.  They are
- *  functionally very similar, but the first does not record a sequence
- *  before returning to the caller.  The second tries to record the current
- *  sequence, then returns.  These macros are the only normal return points
- *  from the subroutine (yes I know just how ugly that is).  They are invoked
- *  for every character fetch.  If a buffer fill fails (most likely due to
- *  EOF), they return.  (They could be written as macro functions, but that
- *  would even be uglier.)
- *============================================================================
+ *  add_key
  *
- *  GET_CHAR_OR_RETURN( c, bptr, bufend, buffer, BUFLEN, inpfd, nfill )
+ *  Find the indexdata struct of a key, read into the space from key_space
+ *  (keyend is one past its '\0').  A new key keeps its text, and gets the
+ *  next indexdata struct, with key pointing to it; otherwise the struct of
+ *  the earlier copy is returned.  Returns NULL if no memory is available.
+ *==========================================================================*/
+
+indexdata *add_key( globaldata *gd, char *key, char *keyend )
+{
+    hashslot   *slot;
+    indexdata  *datum;
+    unsigned    h;
+    size_t      mask, i;
+
+    h    = key_hash( key );
+    mask = gd->nslot - 1;
+    for ( i = h & mask; ( slot = gd->slots + i )->index; i = ( i + 1 ) & mask )
+    {
+	if ( ( slot->hash == h )
+	  && ( strcmp( gd->data[ slot->index - 1 ].key, key ) == 0 )
+	   ) return gd->data + ( slot->index - 1 );
+    }
+
+    /*
+     *  New key.  Make room for it in the data and the hash.
+     */
+
+    if ( gd->nkey >= gd->maxkey )
+    {
+	indexdata *data;
+	data = (indexdata *) realloc( gd->data, 2 * sizeof( indexdata ) * gd->maxkey );
+	if ( ! data ) { nomem = 1; return NULL; }
+	gd->data    = data;
+	gd->maxkey *= 2;
+    }
+    if ( 2 * (size_t) ( gd->nkey + 1 ) > gd->nslot )
+    {
+	if ( grow_hash( gd ) ) return NULL;
+	mask = gd->nslot - 1;
+	for ( i = h & mask; gd->slots[ i ].index; i = ( i + 1 ) & mask ) ;
+	slot = gd->slots + i;
+    }
+
+    datum = gd->data + gd->nkey;
+    datum->key  = key;
+    slot->hash  = h;
+    slot->index = ++gd->nkey;
+    gd->curkeys->used = keyend - gd->curkeys->text;
+
+    return datum;
+}  /* add_key */
+
+
+/*============================================================================
+ *  grow_hash
  *
- *  GET_CHAR_OR_RECORD( c, bptr, bufend, buffer, BUFLEN, inpfd, nfill,
- *                      haveid, slen, seek0, crc, suffix, suflen, datum
- *                    )
+ *  Double the hash slots, placing the keys with their cached hash values.
+ *  Returns nonzero if no memory is available.
  *==========================================================================*/
 
-#define GET_CHAR_OR_RETURN(c, ptr, end, buf, blen, fd, nf)            \
-    if ( ptr >= end )                                                 \
-    {                                                                 \
-	if ( ( end = buf + read(fd, buf, blen) ) <= buf ) return 0;   \
-	nf++; ptr = buf;                                              \
-    }                                                                 \
-    c = *ptr++;
-
-
-#define GET_CHAR_OR_RECORD(c, ptr, end, buf, blen, fd, nf, id, slen, s0, crc, suf, suflen, datum)  \
-    if ( ptr >= end )                                                 \
-    {                                                                 \
-        if ( ( end = buf + read(fd, buf, blen) ) <= buf )             \
-	{   long long seek;                                           \
-	    if ( ! id ) return 0;                                     \
-	    seek = (nf-1) * (long long)blen + (ptr-buf);              \
-	    record_info( datum, s0, (int)(seek-s0),                   \
-	                 slen, crc, suf, suflen );                    \
-	    return 0;                                                 \
-	}                                                             \
-	nf++; ptr = buf;                                              \
-    }                                                                 \
-    c = *ptr++;
+int grow_hash( globaldata *gd )
+{
+    hashslot  *slots, *slot;
+    size_t     nslot, mask, i, j;
+
+    nslot = 2 * gd->nslot;
+    if ( ! ( slots = (hashslot *) calloc( nslot, sizeof( hashslot ) ) ) )
+    {
+	nomem = 1;
+	return 1;
+    }
+
+    mask = nslot - 1;
+    for ( j = 0; j < gd->nslot; j++ )
+    {
+	slot = gd->slots + j;
+	if ( ! slot->index ) continue;
+	for ( i = slot->hash & mask; slots[ i ].index; i = ( i + 1 ) & mask ) ;
+	slots[ i ] = *slot;
+    }
+
+    free( gd->slots );
+    gd->slots = slots;
+    gd->nslot = nslot;
+
+    return 0;
+}  /* grow_hash */
+
 
 
 /*============================================================================
  *  index_a_file
+ *
+ *  The records are found by translation_reader; here the residues of each
+ *  are checked and summed.
  *==========================================================================*/
 
-int index_a_file ( int inpfd, char *prefix, globaldata *gd, char *prog )
+int index_a_file ( tr_file_t *tf, char *prefix, globaldata *gd )
 {
-    int         nkey, maxkey, maxkeylen, suflen;
-    hashdata   *hash;
-    indexdata  *data, *datum, *hashdatum;
-    char       *keys, *nxtkey, *endkeys;
+    int         maxkeylen, suflen;
+    indexdata  *datum;
     int         preflen;
-    char       *key, *keyptr, *keyerr;
-    char        buffer[ BUFLEN ];         /* read buffer   */
-    char       *bptr, *bufend;
+    char       *key;
     char        suffix[ SUFBUFLEN ];      /* sequence suffix buffer */
-    long long   seek, seek0;
-    int         nfill;
-    int         haveid, bars, slen, nerror;
+    const unsigned char *data, *dptr, *dend;
+    long long   seek0;
+    long        n;
+    int         keylen, truncated, slen, nerror;
     int         c;
     unsigned    crc;
 
@@ -564,34 +779,15 @@ int index_a_file ( int inpfd, char *prefix, globaldata *gd, char *prog )
      *  If there were previous files, reset the data structures:
      */
 
-    if ( gd->nkey ) reset( gd );
+    reset( gd );
+    nomem = 0;
 
     /*
      *  Initialize for this file:
      */
 
-    nkey      = gd->nkey;
-    maxkey    = gd->maxkey;
     maxkeylen = gd->maxkeylen;
     suflen    = gd->suffixlen;
-    hash      = gd->hash;
-    data      = gd->data;
-    keys      = gd->keys;
-    nxtkey    = gd->nxtkey;
-    endkeys   = keys + gd->keyspace - 1;  /* keep space for '\0' */
-
-    bptr      = buffer;  /* current read position in read buffer */
-    bufend    = buffer;  /* one past end of valid buffer data */
-    nfill     = 0;       /* track seek by number of buffer fills */
-    slen      = 0;       /* non-white sequence characters */
-    nerror    = 0;       /* number of reported bad characters in sequence */
-    seek0     = 0;       /* beginning of current sequence entry */
-    crc       = 0;
-    haveid    = 0;       /* we need state info on valid id */
-
-    key       = keys;    /* just to make compiler -Wall happy */
-    datum     = data;    /* just to make compiler -Wall happy */
-    datum->slen = 0;     /* ditto */
 
     /*
      *  Measure the length of the required id prefix:
@@ -606,205 +802,99 @@ int index_a_file ( int inpfd, char *prefix, globaldata *gd, char *prog )
     }
 
     /*
-     *  Process the file line-by-line
+     *  Process the file record-by-record.  The end of the file is the
+     *  normal termination.
      */
 
     while ( 1 )
     {
 	/*
-	 *  Failure to get a character here is the normal termination
-	 *  (end-of-file after a newline).
+	 *  Read the id and find out if it is new.  Only if it is new will
+	 *  the key text be kept.  If it is reusing an old key, the data
+	 *  structure pointer will be moved to the old copy found by
+	 *  add_key.
 	 */
 
-	GET_CHAR_OR_RECORD( c, bptr, bufend, buffer, BUFLEN, inpfd, nfill,
-	                    haveid, slen, seek0, crc, suffix, suflen, datum
-	                  );
+	if ( ! ( key = key_space( gd ) ) ) return -1;
+	if ( ( keylen = tr_next_id( tf, key, maxkeylen, &truncated ) ) < 0 ) return 0;
+
+	if ( truncated )
+	{
+	    fprintf( stderr,
+	             "WARNING: Truncating id to %d characters: %s\n",
+	             maxkeylen, key
+	           );
+	}
 
 	/*
-	 *  Got a character.  Is this an identifier line or sequence data?
+	 *  Is the ID valid?  Is it non-null?  Does it match the prefix?
+	 *  If not, go to the next record.
 	 */
 
-	if ( c == '>' )
+	if ( ! *key )
 	{
-	    /*
-	     *  New identifier line.  Is there a previous sequence to record?
-	     */
-
-	    if ( haveid )
-	    {   /*  In the seek calculation, the -1 is for the > just read  */
-		seek = ( nfill-1 ) * (long long)BUFLEN + ( bptr-buffer ) - 1;
-		record_info( datum, seek0, (int)(seek-seek0),
-		             slen, crc, suffix, suflen );
-	    }
-
-	    /*
-	     *  Flush white space up to id (should not be any, but...)
-	     */
-
-	    GET_CHAR_OR_RETURN(c, bptr, bufend, buffer, BUFLEN, inpfd, nfill);
-
-	    while ( ( c <= ' ') && ( c != '\n' ) && c )
+	    fprintf( stderr, "WARNING:  Null sequence identifier skipped.\n" );
+	    if ( gd->nkey > 0 )
 	    {
-		GET_CHAR_OR_RETURN(c, bptr, bufend, buffer, BUFLEN, inpfd, nfill);
+		datum = gd->data + gd->nkey - 1;  /*  Last added datum  */
+		fprintf( stderr, "   Previous entry was:  %s\n", datum->key );
 	    }
+	    continue;
+	}
+	else if ( preflen && strncmp( key, prefix, preflen ) )
+	{
+	    fprintf( stderr,
+	             "WARNING:  Skipping sequence id \"%s\", \n"
+	             "          which does not match prefix \"%s\".\n",
+	             key, prefix
+	           );
+	    continue;
+	}
 
-	    /*
-	     *  Is there space for another entry?
-	     */
-
-	    if ( nkey >= maxkey )
-	    {
-		fprintf( stderr, "ERROR: Maximum number of ids (%d) reached.\n", maxkey );
-		if ( nkey < 1 ) exit(3);      /*  Severe error  */
-		datum = data + nkey - 1;      /*  Last added key  */
-		fprintf( stderr, "   Last entry processed was:\n   %s\n", datum->key );
-		exit(3);
-	    }
-
-	    /*
-	     *  Read the id and find out if it is new.  Only if it is new will
-	     *  the values of nkey and nxtkey be increased.  If it is reusing
-	     *  an old key, the data structure pointer will be moved to the old
-	     *  copy found by add2hash.
-	     */
-
-	    keyptr = key = nxtkey;     /* pointer to next free key */
-	    keyerr = key + maxkeylen;  /* if keyptr reaches here, key is long */
-	    if ( keyerr > endkeys ) keyerr = endkeys;  /* end of buffer */
-	    bars = N_BAR_OK;           /* number of | allowed in id  */
-
-	    while ( c > ' ' )          /*  poorman's "is not space" */
-	    {
-		if ( keyptr >= keyerr )
-		{
-		    /*
-		     *  Sequence ID is too long.
-		     */
-
-		    if ( keyptr >= endkeys )
-		    {
-			fprintf( stderr,
-			         "ERROR: Program ran out of space for keys.  Increase the value of KEYPSPACE\n"
-			         "       (currently %d), or use a larger value of max_ids (curently %d).\n",
-			         KEYSPACE, gd->maxkey
-			       );
-			if ( nkey < 1 ) exit(2);     /*  Severe error  */
-			datum = data + nkey - 1;     /*  Last added datum  */
-			fprintf( stderr, "   Last entry processed was:  %s\n",
-			                     datum->key
-			       );
-			exit(2);
-		    }
-		    else
-		    {
-			*keyptr = '\0';
-			fprintf( stderr,
-			         "WARNING: Truncating id to %d characters: %s\n",
-			         maxkeylen, key
-			       );
-		    }
-		    break;
-		}
-
-		/*
-		 *  Following the perl, break id at second vertical bar
-		 */
-
-		if ( ( c == '|' ) && ( bars-- <= 0 ) ) break;
-
-		/*
-		 *  So much for testing.  Save the character and get another.
-		 */
-
-		*keyptr++ = c;
-		GET_CHAR_OR_RETURN(c, bptr, bufend, buffer, BUFLEN, inpfd, nfill);
-	    }
-
-	    /*
-	     *  Terminate the key and flush the rest of the input line.
-	     */
-
-	    *keyptr++ = '\0';
-
-	    while ( ( c != '\n' ) && c )
-	    {
-		GET_CHAR_OR_RETURN(c, bptr, bufend, buffer, BUFLEN, inpfd, nfill);
-	    }
-
-	    /*
-	     *  Is the ID valid?  Is it non-null?  Does it match the prefix?
-	     *  If not, set haveid to zero and go to next line.
-	     */
-
-	    if ( ! *key )
-	    {
-		fprintf( stderr, "WARNING:  Null sequence identifier skipped.\n" );
-		if ( nkey > 0 )
-		{
-		    datum = data + nkey - 1;     /*  Last added datum  */
-		    fprintf( stderr, "   Previous entry was:  %s\n", datum->key );
-		}
-		haveid = 0;
-		continue;
-	    }
-	    else if ( preflen && strncmp( key, prefix, preflen ) )
-	    {
-		fprintf( stderr,
-		         "WARNING:  Skipping sequence id \"%s\", \n"
-		         "          which does not match prefix \"%s\".\n",
-		         key, prefix
-		       );
-		haveid = 0;
-		continue;
-	    }
-	    haveid = 1;
-
-	    /*
-	     *  Key is okay.  Link it into the next available indexdata struct.
-	     *  Add it to the hash (or get a pointer to the preexisting copy).
-	     */
+	/*
+	 *  Key is okay.  Add it to the hash, linked to the next available
+	 *  indexdata struct (or get a pointer to the preexisting copy).
+	 */
 
-	    datum = data + nkey;
-	    datum->key = key;
-
-	    hashdatum = (indexdata *) add2hash( hash, (void *) datum );
-	    if ( hashdatum == datum )
-	    {                          /*  New key:  */
-		gd->nkey   = ++nkey;   /*     reserve the indexdata struct */
-		gd->nxtkey = nxtkey = keyptr; /* reserve the key text area */
-		datum->slen = 0;      /*     mark as having no valid data yet */
-		#if DEBUG > 1
-		    fprintf( stderr, "New key (%d) = %s\n", nkey, key );
-		#endif
-	    }
-	    else
-	    {                         /*  Key was already present:  */
-		datum = hashdatum;    /*  use the existing indexdata struct */
-		#if DEBUG > 1
-		    fprintf( stderr, "Repeat key (%d) = %s\n", (int)(datum-data+1), key );
-		#endif
-	    }
+	if ( ! ( datum = add_key( gd, key, key + keylen + 1 ) ) ) return -1;
+	if ( datum->key == key )
+	{                          /*  New key:  */
+	    datum->slen = 0;      /*     mark as having no valid data yet */
+	    datum->md5ok = 0;
+	    #if DEBUG > 1
+		fprintf( stderr, "New key (%d) = %s\n", gd->nkey, key );
+	    #endif
+	}
+	else
+	{                         /*  Key was already present:  */
+	    key = datum->key;     /*  the text kept with the struct */
+	    #if DEBUG > 1
+		fprintf( stderr, "Repeat key (%d) = %s\n", (int)(datum-gd->data+1), key );
+	    #endif
+	}
 
-	    /*
-	     *  bptr is at start of sequence data; move seek0 to coincide.
-	     *  Reset other important values.
-	     */
+	/*
+	 *  The reader is at the start of the sequence data; move seek0 to
+	 *  coincide.  Reset other important values.
+	 */
 
-	    seek0  = ( nfill - 1 ) * (long long)BUFLEN + ( bptr - buffer );
-	    slen   = 0;
-	    crc    = 0;
-	    nerror = 0;
-	}
+	seek0  = tr_seek( tf );
+	slen   = 0;
+	crc    = 0;
+	nerror = 0;
+	if ( md5s ) tr_md5_begin( md5s );
 
 	/*
-	 *  Wow!  That was all for an id line.  If we have a valid sequence id,
-	 *  here's what we do with a data line.
+	 *  Here's what we do with the data lines.
 	 */
 
-	else if ( haveid )
+	while ( ( n = tr_next_seq( tf, &data ) ) > 0 )
 	{
-	    while ( ( c != '\n' ) && c )
+	    for ( dptr = data, dend = data + n; dptr < dend; dptr++ )
 	    {
+		c = *dptr;
+		if ( c > 127 ) continue;  /* white space, as with TR_ASCII */
+
 		/*
 		 *  Is it a valid amino acid character?  If so, record it.
 		 */
@@ -850,24 +940,17 @@ int index_a_file ( int inpfd, char *prefix, globaldata *gd, char *prog )
 		    suffix[ slen & SUFBUFMSK ] = c;  /* last SUFBUFLEN chars */
 		    slen++;
 		}
-
-		GET_CHAR_OR_RECORD( c, bptr, bufend, buffer, BUFLEN, inpfd, nfill,
-		                    haveid, slen, seek0, crc, suffix, suflen, datum
-		                  );
 	    }
-	}
 
-	/*
-	 *  If we do not have an id, we should still flush the line
-	 */
+	    /*
+	     *  The MD5 takes every nonwhite char (even *), uppercase.
+	     */
 
-	else
-	{
-	    while ( ( c != '\n' ) && c )
-	    {
-		GET_CHAR_OR_RETURN(c, bptr, bufend, buffer, BUFLEN, inpfd, nfill);
-	    }
+	    if ( md5s ) tr_md5_add( md5s, data, n );
 	}
+
+	record_info( datum, seek0, (int)( tr_seek( tf ) - seek0 ),
+	             slen, crc, suffix, suflen );
     }
 
     /*
@@ -893,6 +976,13 @@ void record_info( indexdata *datum, long long seek, int bytes,
     int   i0, i;
 
     if ( ! datum || ! datum->key || ! *(datum->key) || ! suffix ) return;
+
+    /*
+     *  The MD5 has its own minimum length, so it comes first.
+     */
+
+    if ( md5s && tr_md5_end( md5s, datum->md5 ) ) datum->md5ok = 1;
+
     if ( slen < MINLEN )
     {
 	#if SHOWSHORT
@@ -958,19 +1048,27 @@ void record_info( indexdata *datum, long long seek, int bytes,
  *  SeqId \t FileNum \t StartSeek \t DataBytes \t SeqLen \t Cksum \t SuffixCk
  *==========================================================================*/
 
-int report_info( globaldata *gd, int filenum, FILE * fp )
+int report_info( globaldata *gd, tr_file_t *tf, int filenum, FILE * fp,
+                 char *gid, FILE * md5fp )
 {
     indexdata *datum;
+    char       hex[33];
     int        i, n;
 
     if ( ! gd || ! gd->nkey ) return 0;
+    if ( ! gid || ! *gid ) md5fp = NULL;
 
     n = 0;
     for ( i = 0; i < gd->nkey; i++ ) {
 	datum = gd->data + i;
+	if ( md5fp && datum->md5ok )
+	{
+	    tr_md5_hex( datum->md5, hex );
+	    fprintf( md5fp, "%s\t%s\t%s\n", datum->key, gid, hex );
+	}
 	if ( ! datum->slen ) continue;
 	fprintf( fp, "%s\t%d\t%lld\t%d\t%d\t%d\t%d\n",
-	             datum->key, filenum, datum->seqseek, datum->seqbytes,
+	             datum->key, filenum, tr_virtual_seek( tf, datum->seqseek ), datum->seqbytes,
 	             datum->slen, datum->cksum, datum->sufcksum
 	       );
 	n++;
@@ -980,15 +1078,11 @@ int report_info( globaldata *gd, int filenum, FILE * fp )
 }  /* report_info */
 
 
-/*============================================================================
- *  usage
- *==========================================================================*/
-
 void usage( char *prog )
 {
     fprintf( stderr,
              "\n"
-             "Usage: %s  max_ids  max_id_len  [cksum_suffix_len (D=64)] \\\n"
+             "Usage: %s  [ -m md5_file ]  max_ids  max_id_len  [cksum_suffix_len (D=64)] \\\n"
              "               < file_list > seek_size_and_cksum_info\n"
              "or     %s -v  > version_number\n"
              "\n",
@@ -1159,103 +1253,3 @@ unsigned str_cksum( char * str ) {
 
     return ~crc;
 }
-
-
-/*============================================================================
- *=====================  Source code from simplehash.c  ======================
- *==========================================================================*/
-
-hashdata * newhash( size_t maxkeys,
-                    unsigned (* fnc)( void * key ),
-                    int (* cmp)( void * key1, void * key2 )
-                  ) {
-    hashdata * hd;
-
-    if ( ! maxkeys || ! cmp ) return (hashdata *) 0;
-    hd = (hashdata *) malloc( sizeof( hashdata ) );
-    if ( ! hd ) return (hashdata *) 0;
-    hd->size = ( 5 * maxkeys ) / 4;
-    hd->hash = (void **) malloc( sizeof( void * ) * hd->size );
-    if ( ! hd->hash ) {
-        free( hd );
-        return (hashdata *) 0;
-    }
-    hd->fnc = fnc;
-    hd->cmp = cmp;
-    (void) clearhash( hd );
-    return hd;
-}
-
-
-void clearhash( hashdata * hd ) {
-    int    i;
-    void **hp;
-
-    if ( ! hd || ! hd->hash ) return;
-    hp = hd->hash;
-    for ( i = 0; i < hd->size; i++ ) *hp++ = (void *) 0;
-    return;
-}
-
-
-/*  add2hash:  adds a key pointer to the hash, returning the pointer it
- *        or:  returns the pointer to the equal key already in the hash
- *
- *  If the keys are in a list with keyspace bytes per key, then the index is
- *
- *     ( key - keys ) / keyspace
- *
- *  A bit ugly, but the hash need not know about the structure of the data.
- *  (If the key is the first element of a structure, then the pointer is also
- *  a pointer to the structure.  But unless the size of the structures are
- *  known at compile time, this is also ugly.)
- *
- *  Note that in the seed, most keys will only occur once, so the emphasis
- *  should be on efficiently adding new entries.
- */
-
-void * add2hash( hashdata * hd, void * key ) {
-    int        i, i0;
-    size_t     size;
-    void    ** hp;
-    unsigned   (* fnc)( void * );
-    int        (* cmp)( void *, void * );
-
-    if ( ! hd || ! hd->hash
-              || ! ( size = hd->size )
-              || ! ( fnc  = hd->fnc )
-              || ! ( cmp  = hd->cmp )
-       ) {
-        fprintf( stderr, "Error: add2hash called with null hash\n");
-        exit( 1 );
-    }
-    if ( ! key ) {
-        fprintf( stderr, "Error: add2hash called with null key\n");
-        exit( 1 );
-    }
-
-    i = i0 = fnc( key ) % size;
-    hp = hd->hash + i;
-    while (1) {
-        if      ( ! *hp )             { *hp = key; break; }  /* empty slot */
-        else if ( ! cmp( *hp, key ) ) {            break; }  /* matching key */
-
-        if ( ++i >= hd->size ) { hp = hd->hash; i = 0; }  /* wrap back to zero */
-        else                   { hp++;                 }  /* simple increment */
-
-        if ( i == i0 ) {                  /* ouch; full circuit is a full table */
-            fprintf( stderr, "Table overflow in add2hash (size = %u)\n", (unsigned) size );
-            exit( 1 );
-        }
-    }
-
-    return *hp;
-}
-
-
-void freehash( hashdata * hd ) {
-    if ( hd ) {
-       if ( hd->hash ) free( hd->hash );
-       free( hd );
-    }
-}
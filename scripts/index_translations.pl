@@ -28,6 +28,7 @@
 
 use FIG;
 use Tracer;
+use BGZF;
 
 my $fig = new FIG;
 
@@ -38,6 +39,7 @@ my $fig_nr_file = "$FIG_Config::global/nr";
 my $fig_org_dir = "$FIG_Config::organisms";
 my $fig_tmp_dir = "$FIG_Config::temp";
 my $seeks_file  = "$fig_tmp_dir/translations_seeks.$$";
+my $MD5_file    = "$fig_tmp_dir/translations_MD5.$$";
 
 my $nr_flag = ( @ARGV && $ARGV[0] eq '-n' ) ? shift : '';
 
@@ -97,9 +99,14 @@ if ( @ARGV == 0 ) {
 #  works, then we will assume that this program can be called and given a
 #  list of protein sequence files to index.
 #
+#  Version 2.03 also writes the MD5s of the genome translations (-m), for
+#  protein_sequence_MD5, in the same pass; the genome id is the 4th field of
+#  the file list (after an empty id prefix).  Otherwise index_translations_MD5
+#  does them.
+#
 Trace("Checking translation method.") if T(2);
 
-my ( $v, $protfilelist );
+my ( $v, $protfilelist, $md5_opt );
 if (      open  VERSION_PIPE, "$FIG_Config::bin/index_translation_files -v |"
      and  $v = <VERSION_PIPE>
      and  close VERSION_PIPE
@@ -113,9 +120,13 @@ if (      open  VERSION_PIPE, "$FIG_Config::bin/index_translation_files -v |"
     $protfilelist = "$fig_tmp_dir/translations_file_list.$$";
     Open(\*FILELIST, ">$protfilelist");
 
-    my ( $file, $fileno );
+    $md5_opt = ( $v >= 2.03 ) ? "-m $MD5_file " : "";
+
+    my ( $file, $fileno, $gid );
     foreach $file ( @to_process ) {
-        if ( $fileno = $fig->file2N( $file ) ) { print FILELIST "$fileno\t$file\n" }
+        next unless $fileno = $fig->file2N( $file );
+        $gid = $md5_opt && ( $file =~ m{^\Q$fig_org_dir\E/([^/]+)/Features/peg/fasta$} ) ? $1 : '';
+        print FILELIST $gid ? "$fileno\t$file\t\t$gid\n" : "$fileno\t$file\n";
     }
     close( FILELIST );
 }
@@ -126,16 +137,16 @@ if (      open  VERSION_PIPE, "$FIG_Config::bin/index_translation_files -v |"
 #
 #  Find the protein seeks, saving them in $seeks_file.
 #
-#    index_translation_files max_ids  max_id_len [cksum_suffix_len (D=64)] < file_list > seek_size_and_cksum_info
+#    index_translation_files [-m md5_file] max_ids  max_id_len [cksum_suffix_len (D=64)] < file_list > seek_size_and_cksum_info
 #
 Trace("Indexing files.") if T(2);
 
-my $max_id_per_file  = 50_000_000;  # Allocates id memory & hash slots
+my $max_id_per_file  = 50_000_000;  # Ids allocated at the start (grows as needed)
 my $max_id_len       =      64;  # Truncates and continues with log to STDERR
 my $cksum_suffix_len =      64;  # Locate same protein suffix
 
 if (   $protfilelist
-   and system( "$FIG_Config::bin/index_translation_files $max_id_per_file $max_id_len $cksum_suffix_len < $protfilelist > $seeks_file" ) == 0
+   and system( "$FIG_Config::bin/index_translation_files $md5_opt$max_id_per_file $max_id_len $cksum_suffix_len < $protfilelist > $seeks_file" ) == 0
    )
 {
     unlink( $protfilelist );
@@ -146,6 +157,7 @@ else
     #  If that failed, do it with perl subroutine (without checksums)
     #
     if ( $protfilelist && -e $protfilelist ) { unlink( $protfilelist ) }
+    $md5_opt = '';
 
     index_translation_files( $fig, $seeks_file, @to_process );
 }
@@ -162,7 +174,7 @@ if ($mode eq 'some')
 # $table, $flds, $xflds, $fileName, $genomes
 
 $fig->reload_table( $mode, "protein_sequence_seeks",
-                    "id varchar(64), fileno INTEGER, seek INTEGER, len INTEGER, "
+                    "id varchar(64), fileno INTEGER, seek BIGINT, len INTEGER, "
                         . "slen INTEGER, cksum INTEGER, sufcksum INTEGER",
 	       {     trans_id_ix => "id",
 		     trans_cksum_ix => "cksum",
@@ -171,12 +183,37 @@ $fig->reload_table( $mode, "protein_sequence_seeks",
                         $seeks_file, \@fileNumbers, 'fileno');
 unlink( $seeks_file );
 
+#  Add MD5 index for each indexed genome, from the MD5s written with the
+#  seeks, or else with index_translations_MD5
+
+if ( $md5_opt )
+{
+    my @gids = ();
+    if ( $mode eq 'some' )
+    {
+        @gids = grep { -s "$fig_org_dir/$_/Features/peg/fasta" } @ARGV;
+    }
+
+    $fig->reload_table( $mode,
+                        'protein_sequence_MD5',
+                        'id varchar(32), gid varchar(16), md5 char(32)',
+                        { trans_md5_id_ix  => 'id',
+                          trans_md5_gid_ix => 'gid',
+                          trans_md5_ix     => 'md5'
+                        },
+                        $MD5_file,      # file to load
+                        \@gids, 'gid'   # items to delete
+                      );
+    unlink( $MD5_file );
+}
+
 undef $fig;
 Trace("Translation indexing complete.") if T(2);
 
-#  Add MD5 index for each indexed genome
-
-system( "index_translations_MD5" . ( @ARGV ? join( ' ', '', @ARGV ) : '' ) );
+if ( ! $md5_opt )
+{
+    system( "index_translations_MD5" . ( @ARGV ? join( ' ', '', @ARGV ) : '' ) );
+}
 
 exit;
 
@@ -218,7 +255,9 @@ sub index_translation_files {
         #  This requires opening a separate pipe for each input file (so that
         #  sort does not need to handle the concatenation of all the input).
         #
-        if ( open( TRANS, "<$file" ) ) {
+        if ( is_bgzf_file( $file ) ) {
+            print STDERR "*** $file is blocked gzip, which needs index_translation_files - ignoring its translations\n";
+        } elsif ( open( TRANS, "<$file" ) ) {
             open( SEEKS, "| $rev_cmd | sort -su -k 1,1 >> $seeks_file" ) || die "aborted";
             $fileno = $fig->file2N( $file );
             $seek1 = tell TRANS;
@@ -267,4 +306,11 @@ sub index_translation_files {
 }
 
 
+sub is_bgzf_file {
+    my ( $file ) = @_;
+    my $fh;
+    return open( $fh, "<$file" ) && BGZF::is_bgzf( $fh );
+}
+
+
 1;
@@ -91,9 +91,10 @@ if (      open  VERSION_PIPE, "compute_translation_MD5 -v |"
 #  It is now time to try to do the indexing.  If that works, then we stick
 #  with this route.  Otherwise we can still fall back to doing it in perl.
 #
-#  Find the protein seeks, saving them in $MD5_file.
+#  Find the protein seeks, saving them in $MD5_file.  The files are done on
+#  a thread per processor (-j 0).
 #
-#    compute_translation_MD5  max_ids  max_id_len  < file_list > id_and_MD5_info
+#    compute_translation_MD5  -j 0  max_ids  max_id_len  < file_list > id_and_MD5_info
 #
 Trace("Indexing files.") if T(2);
 
@@ -101,7 +102,7 @@ my $max_id_per_file = 9000000;  # Allocates id memory & hash slots
 my $max_id_len      =      64;  # Truncates and continues with log to STDERR
 
 if (   $protfilelist
-   and system( "compute_translation_MD5 $max_id_per_file $max_id_len < $protfilelist > $MD5_file" ) == 0
+   and system( "compute_translation_MD5 -j 0 $max_id_per_file $max_id_len < $protfilelist > $MD5_file" ) == 0
    )
 {
     unlink( $protfilelist );
@@ -171,7 +172,7 @@ sub MD5_translation_files {
         while ( ( @entry = gjoseqlib::read_next_fasta_seq( $file ) ) && $entry[0] )
         {
             next if length( $entry[2] ) < 5;
-            $MD5_value{ $entry[0] } = Digest::MD5::md5_hex( uc $entry[2] );
+            $MD5_value{ $entry[0] } = [ $gid, Digest::MD5::md5_hex( uc $entry[2] ) ];
             $nfound++;
         }
         if ( $nfound < 1 )
@@ -183,7 +184,7 @@ sub MD5_translation_files {
     my $total;
     foreach ( sort keys %MD5_value )
     {
-        print MD5 "$_\t$gid\t$MD5_value{$_}\n";
+        print MD5 join( "\t", $_, @{ $MD5_value{$_} } ), "\n";
         $total++;
     }
     close MD5;
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2003-2008 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  job_pool.c
+ *
+ *  Output buffers, and an ordered pool of threads.  See job_pool.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include "job_pool.h"
+
+typedef struct {
+    const jp_jobs_t  *jobs;
+    char             *done;       /* jobs that are complete */
+    int               next_job;   /* next job to be handed to a worker */
+    int               next_out;   /* next job to be written */
+    int               window;     /* maximum jobs ahead of next_out */
+    int               status;     /* set if a job failed */
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+} pool_t;
+
+/*  A worker thread  */
+
+typedef struct {
+    pool_t           *pool;
+    void             *state;
+} worker_t;
+
+static void  *jp_worker( void *arg );
+static int    jp_serial( const jp_jobs_t *jobs );
+
+
+/*==========================================================================
+ *  Output buffers
+ *==========================================================================*/
+
+void out_printf( outbuf_t *out, const char *fmt, ... ) {
+    va_list  ap;
+    int      n;
+
+    out_reserve( out, 256 );
+    va_start( ap, fmt );
+    n = vsnprintf( out->data + out->len, out->size - out->len, fmt, ap );
+    va_end( ap );
+    if ( n < 0 ) return;
+    if ( (size_t) n >= out->size - out->len ) {
+        out_reserve( out, n + 1 );
+        va_start( ap, fmt );
+        n = vsnprintf( out->data + out->len, out->size - out->len, fmt, ap );
+        va_end( ap );
+    }
+    out->len += n;
+}
+
+
+/*  The buffers cannot report an error to the writer, so running out of
+ *  memory ends the program.
+ */
+
+void out_reserve( outbuf_t *out, size_t n ) {
+    char  *data;
+
+    if ( out->len + n <= out->size ) return;
+    if ( out->fp && out->len ) {
+        out_flush( out );
+        if ( n <= out->size ) return;
+    }
+    out->size = out->size ? 2 * out->size : JP_OUTLEN;
+    while ( out->size < out->len + n ) out->size *= 2;
+    if ( ! ( data = (char *) realloc( out->data, out->size ) ) ) {
+        fprintf( stderr, "Out of memory for an output buffer of %lu bytes\n", (unsigned long) out->size );
+        exit( 1 );
+    }
+    out->data = data;
+}
+
+
+void out_flush( outbuf_t *out ) {
+    if ( out->fp && out->len ) {
+        fwrite( out->data, 1, out->len, out->fp );
+        if ( out->flushed ) out->flushed( out->data, out->len );
+    }
+    out->len = 0;
+}
+
+
+/*==========================================================================
+ *  The pool
+ *==========================================================================*/
+
+int jp_run( const jp_jobs_t *jobs, int nthreads ) {
+    pool_t     pool;
+    pthread_t *threads;
+    worker_t  *workers;
+    int        nstarted, i;
+
+    if ( jobs->njob <= 0 ) return 0;
+    if ( nthreads > jobs->njob ) nthreads = jobs->njob;
+    if ( nthreads < 1 ) nthreads = 1;
+
+    pool.jobs     = jobs;
+    pool.next_job = 0;
+    pool.next_out = 0;
+    pool.window   = JP_WINDOW * nthreads;
+    pool.status   = 0;
+    pool.done     = (char *) calloc( jobs->njob, 1 );
+    threads       = (pthread_t *) malloc( nthreads * sizeof( pthread_t ) );
+    workers       = (worker_t *) malloc( nthreads * sizeof( worker_t ) );
+    if ( ! pool.done || ! threads || ! workers ) {
+        free( pool.done );
+        free( threads );
+        free( workers );
+        return jp_serial( jobs );
+    }
+    pthread_mutex_init( &pool.lock, NULL );
+    pthread_cond_init( &pool.cond, NULL );
+
+    /*  The state of each worker is made here, one at a time  */
+
+    for ( i = 0; i < nthreads; i++ ) {
+        workers[i].pool  = &pool;
+        workers[i].state = jobs->begin ? jobs->begin( jobs->arg ) : NULL;
+    }
+
+    for ( nstarted = 0; nstarted < nthreads; nstarted++ ) {
+        if ( pthread_create( threads + nstarted, NULL, jp_worker, workers + nstarted ) ) break;
+    }
+    if ( ! nstarted ) {
+        for ( i = 0; i < nthreads; i++ ) {
+            if ( jobs->end ) jobs->end( jobs->arg, workers[i].state );
+        }
+        free( pool.done );
+        free( threads );
+        free( workers );
+        pthread_mutex_destroy( &pool.lock );
+        pthread_cond_destroy( &pool.cond );
+        return jp_serial( jobs );
+    }
+
+    /*  Write each job as soon as it is done; the workers wait for
+     *  next_out to move when they are a window ahead of it.
+     */
+
+    for ( i = 0; i < jobs->njob; i++ ) {
+        pthread_mutex_lock( &pool.lock );
+        while ( ! pool.done[i] ) pthread_cond_wait( &pool.cond, &pool.lock );
+        pthread_mutex_unlock( &pool.lock );
+
+        jobs->write( jobs->arg, i );
+
+        pthread_mutex_lock( &pool.lock );
+        pool.next_out++;
+        pthread_cond_broadcast( &pool.cond );
+        pthread_mutex_unlock( &pool.lock );
+    }
+
+    for ( i = 0; i < nstarted; i++ ) pthread_join( threads[i], NULL );
+    for ( i = 0; i < nthreads; i++ ) {
+        if ( jobs->end ) jobs->end( jobs->arg, workers[i].state );
+    }
+    pthread_mutex_destroy( &pool.lock );
+    pthread_cond_destroy( &pool.cond );
+    free( pool.done );
+    free( threads );
+    free( workers );
+
+    return pool.status;
+}
+
+
+static void *jp_worker( void *arg ) {
+    pool_t           *pool  = ( (worker_t *) arg )->pool;
+    void             *state = ( (worker_t *) arg )->state;
+    const jp_jobs_t  *jobs  = pool->jobs;
+    int               job, failed;
+
+    while ( 1 ) {
+        pthread_mutex_lock( &pool->lock );
+        while ( ( pool->next_job < jobs->njob )
+             && ( pool->next_job >= pool->next_out + pool->window )
+              ) pthread_cond_wait( &pool->cond, &pool->lock );
+        if ( pool->next_job >= jobs->njob ) {
+            pthread_mutex_unlock( &pool->lock );
+            break;
+        }
+        job = pool->next_job++;
+        pthread_mutex_unlock( &pool->lock );
+
+        failed = jobs->run( jobs->arg, state, job );
+
+        pthread_mutex_lock( &pool->lock );
+        if ( failed ) pool->status = 1;
+        pool->done[job] = 1;
+        pthread_cond_broadcast( &pool->cond );
+        pthread_mutex_unlock( &pool->lock );
+    }
+
+    return NULL;
+}
+
+
+/*  Run and write the jobs one at a time, on the calling thread  */
+
+static int jp_serial( const jp_jobs_t *jobs ) {
+    void  *state;
+    int    status, i;
+
+    state  = jobs->begin ? jobs->begin( jobs->arg ) : NULL;
+    status = 0;
+    for ( i = 0; i < jobs->njob; i++ ) {
+        if ( jobs->run( jobs->arg, state, i ) ) status = 1;
+        jobs->write( jobs->arg, i );
+    }
+    if ( jobs->end ) jobs->end( jobs->arg, state );
+
+    return status;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2003-2008 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  job_pool.h
+ *
+ *  Output buffers, and a pool of threads that runs a list of jobs (such as
+ *  the files of a file list) and writes out the result of each in list
+ *  order.
+ *
+ *  Each job collects its records in output buffers of its own.  The
+ *  calling thread writes a job as soon as it, and all of the jobs before
+ *  it, are complete, so the output is the same as running the jobs one at
+ *  a time.  No more than JP_WINDOW jobs per thread are started ahead of
+ *  the next one to be written, which bounds the output held in memory.
+ *
+ *  Link with -lpthread.
+ */
+
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define  JP_OUTLEN   ( 64*1024)   /*  initial output buffer size  */
+#define  JP_WINDOW   (       4)   /*  jobs in progress per thread  */
+
+/*  An output buffer.  With a file pointer, the buffer is written out
+ *  whenever it fills; otherwise it grows until it is written by the owner.
+ *  If flushed is set, it is also given each block of data that is written
+ *  to fp.  Zeroed is empty.
+ */
+
+typedef struct {
+    char   *data;
+    size_t  len;
+    size_t  size;
+    FILE   *fp;
+    void  (*flushed)( const char *data, size_t len );
+} outbuf_t;
+
+void  out_printf( outbuf_t *out, const char *fmt, ... );
+
+/*  Make room for n more bytes at data + len  */
+
+void  out_reserve( outbuf_t *out, size_t n );
+
+/*  Write the buffer to fp (if any), and empty it  */
+
+void  out_flush( outbuf_t *out );
+
+/*  The jobs of a pool.  Each function is given arg.  begin() and end()
+ *  make and free the state of a worker thread, and may be NULL; they are
+ *  called on the calling thread, before the workers start and after they
+ *  end, so they need not be thread safe.  run() runs job number job on a
+ *  worker, and returns nonzero if it failed.  write() writes out job
+ *  number job on the calling thread, in order.
+ */
+
+typedef struct {
+    int     njob;
+    void   *arg;
+    void *(*begin)( void *arg );
+    int   (*run)( void *arg, void *state, int job );
+    void  (*write)( void *arg, int job );
+    void  (*end)( void *arg, void *state );
+} jp_jobs_t;
+
+/*  Run the jobs on up to nthreads threads (on the calling thread alone if
+ *  none can be started).  Returns nonzero if any job failed.
+ */
+
+int   jp_run( const jp_jobs_t *jobs, int nthreads );
+
+#endif
@@ -0,0 +1,70 @@
+# -*- perl -*-
+#
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+# 
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License. 
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+#
+
+
+use strict;
+use FIG;
+use ContigComposition;
+my $fig = new FIG;
+
+use Tracer;
+if ($ENV{'VERBOSE'}) { TSetup("3 FIG DBKernel","TEXT") }
+
+#
+# usage: load_contig_composition [G1 G2 G3 ... ]
+#
+# Load the contig_composition table from the composition file in each
+# genome directory, written by index_contig_files -c (see index_contigs).
+# A row is the base counts of one window of a contig:
+#
+#     genome, contig, startN (0 based), len, nA, nC, nG, nT, nN, nOther
+#
+
+Trace("Preparing to load contig composition.") if T(2);
+my ($mode, @genomes) = FIG::parse_genome_args(@ARGV);
+my $temp_dir = "$FIG_Config::temp";
+my $organisms_dir = "$FIG_Config::organisms";
+my $loadfile = "$temp_dir/tmpcomp$$";
+
+Open(\*COMP, ">$loadfile");
+foreach my $genome (@genomes)
+{
+    my $file = "$organisms_dir/$genome/composition";
+    next unless -s $file;
+    my $comp = ContigComposition->new($file);
+    if (! $comp)
+    {
+	print STDERR "WARNING: Could not open $file\n";
+	next;
+    }
+    Trace("Loading $file") if T(4);
+    foreach my $contig ($comp->contigs)
+    {
+	print COMP map { join("\t", $genome, $contig, @$_) . "\n" } $comp->windows($contig);
+    }
+    $comp->close();
+}
+close(COMP);
+
+$fig->reload_table($mode, 'contig_composition',
+		   "genome varchar(16), contig varchar(96), startN BIGINT, len INTEGER, " .
+		   "nA INTEGER, nC INTEGER, nG INTEGER, nT INTEGER, nN INTEGER, nOther INTEGER",
+		   { contig_composition_ix => "genome, contig, startN" },
+		   $loadfile, \@genomes);
+unlink($loadfile);
+Trace("Contig composition loaded.") if T(2);
@@ -28,16 +28,28 @@ my $fig = new FIG;
 
 use DBrtns;
 
-my $usage = "usage: load_sims [-clear] SimsDir";
+my $usage = "usage: load_sims [-clear] [-store CondensedSimsStore] SimsDir";
 
 my $dir;
 
 my $drop_tables = 0;
+my $store;
 
-if ($ARGV[0] eq '-clear')
+while (@ARGV and $ARGV[0] =~ /^-/)
 {
-    $drop_tables = 1;
-    shift @ARGV;
+    my $opt = shift @ARGV;
+    if ($opt eq '-clear')
+    {
+	$drop_tables = 1;
+    }
+    elsif ($opt eq '-store')
+    {
+	($store = shift @ARGV) || die $usage;
+    }
+    else
+    {
+	die $usage;
+    }
 }
 
 ($dir = shift @ARGV)
@@ -80,6 +92,38 @@ if ($drop_tables)
 
 my $tmp_file = "$FIG_Config::temp/load_sim_tmp.$$";
 
+#
+# If we have condense_sims, map the pegs of known genomes with it, using
+# the genome numbers of map_peg_to_ids; the lines it cannot map are left
+# for map_peg_to_ids.
+#
+
+my $map_file = "$FIG_Config::temp/load_sim_genomes.$$";
+my $left_file = "$FIG_Config::temp/load_sim_left.$$";
+my $use_prog = 0;
+my $v;
+if (open(VERSION_PIPE, "condense_sims -v |") and $v = <VERSION_PIPE> and close(VERSION_PIPE) and $v >= 1)
+{
+    open(MAP, ">$map_file") or die "Cannot open $map_file for writing: $!\n";
+    for my $genome ($fig->genomes)
+    {
+	my($g) = $fig->map_peg_to_ids("fig|$genome.peg.1");
+	print MAP "$genome\t$g\n" if defined($g);
+    }
+    close(MAP);
+    $use_prog = 1;
+}
+
+#
+# With -store, the rows loaded are also built into a columnar store of
+# the condensed sims (see csims_store.h), for scans by csims_query.
+#
+
+if ($store)
+{
+    open(STORE, "| csims_build $store") or die "Cannot run csims_build: $!\n";
+}
+
 foreach my $file (@files)
 {
     my $load_file = $file;
@@ -93,7 +137,30 @@ foreach my $file (@files)
 	open(S, "<$file") or die "Cannot open $file: $!\n";
 	$_ = <S>;
 
-	if (/^fig/)
+	if (/^fig/ && $use_prog)
+	{
+	    close(S);
+	    print "Mapping $file with condense_sims\n";
+	    system("condense_sims -l $left_file $map_file $file > $tmp_file") == 0
+		or die "condense_sims failed on $file\n";
+
+	    if (-s $left_file)
+	    {
+		open(S, "<$left_file") or die "Cannot open $left_file: $!\n";
+		open(TMP, ">>$tmp_file") or die "Cannot open $tmp_file for writing: $!\n";
+		while (<S>)
+		{
+		    chomp;
+		    my($p1, $p2, @rest) = split(/\t/);
+		    print TMP join("\t", $fig->map_peg_to_ids($p1), $fig->map_peg_to_ids($p2), @rest), "\n";
+		}
+		close(TMP);
+		close(S);
+	    }
+
+	    $load_file = $tmp_file;
+	}
+	elsif (/^fig/)
 	{
 	    print "Mapping $file\n";
 
@@ -117,9 +184,26 @@ foreach my $file (@files)
 	
 	$dbf->load_table( tbl => "condensed_sims",
 			  file => $load_file );
+
+	if ($store)
+	{
+	    open(L, "<$load_file") or die "Cannot open $load_file: $!\n";
+	    while (<L>)
+	    {
+		print STORE $_;
+	    }
+	    close(L);
+	}
     }
 }
 
+if ($store)
+{
+    close(STORE) or die "csims_build failed building $store\n";
+}
+
+unlink($tmp_file, $map_file, $left_file);
+
 if ($drop_tables)
 {
     print "Creating index\n";
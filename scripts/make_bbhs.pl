@@ -0,0 +1,153 @@
+# -*- perl -*-
+#
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+#
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License.
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+#
+
+
+#
+#  Usage: make_bbhs [--table tablename] [--dir sims-dir] [--bbh-dir dir] [--threads n] [--max-psc psc] [--seek-index file] [--subject-index file] [ Genome1 Genome2 ... ]
+#
+#  Compute the bidirectional best hits from the sims, with the program
+#  compute_bbhs, and write them to $FIG_Config::global/BBHs/<genome> (or
+#  --bbh-dir), where load_bbhs and load_bbhs_btree load them.
+#
+#  The sims are read through the seeks of the sim_seeks table (or --table),
+#  or of a binary seek index (--seek-index, see SimsSeekIndex.pm).  With
+#  genomes on the command line, only the BBHs involving them are computed
+#  and replaced, as after their sims have changed; the files of genomes that
+#  have no BBHs with them are not touched.  A subject index
+#  (--subject-index, from index_sims --subject-index) lets the hits into the
+#  genomes be found without reading all of the sims.
+#
+
+use strict;
+use FIG;
+use Tracer;
+use Getopt::Long;
+
+my $usage = "Usage: $0 [--dbname database-name] [--table tablename] [--dir sims-dir] [--bbh-dir dir] [--threads n] [--max-psc psc] [--seek-index file] [--subject-index file] [ Genome1 Genome2 ... ]";
+
+my $sims_db;
+my $sims_dir;
+my $new_sims_dir;
+my $bbh_dir = "$FIG_Config::global/BBHs";
+my $seeks_table = "sim_seeks";
+my $threads = 0;
+my $max_psc;
+my $seek_index;
+my $subject_index;
+my $help = 0;
+
+my $rc = GetOptions("dir=s" => \$sims_dir,
+		    "bbh-dir=s" => \$bbh_dir,
+		    "table=s" => \$seeks_table,
+		    "dbname=s" => \$sims_db,
+		    "threads=i" => \$threads,
+		    "max-psc=f" => \$max_psc,
+		    "seek-index=s" => \$seek_index,
+		    "subject-index=s" => \$subject_index,
+		    "help" => \$help);
+
+$rc or die "$usage\n";
+
+if ($help)
+{
+    print "$usage\n";
+    exit 0;
+}
+
+if ($sims_db)
+{
+    $FIG_Config::db = $sims_db;
+}
+
+my $fig = new FIG;
+
+if ($sims_dir eq '')
+{
+    $sims_dir     = "$FIG_Config::data/Sims";
+    $new_sims_dir = "$FIG_Config::data/NewSims";
+}
+
+my $v;
+(      open VERSION_PIPE, "compute_bbhs -v |"
+   and $v = <VERSION_PIPE>
+   and close VERSION_PIPE
+   and chomp $v
+   and $v >= 1
+) || Confess("compute_bbhs was not found");
+
+#
+#  The sims files, by number, as for index_sims_file:
+#
+
+my @sim_files;
+for my $dir ( $sims_dir, $new_sims_dir ) {
+    next unless $dir and -d $dir;
+    opendir( SIMSDIR, $dir ) || Confess("Could not open sims directory $dir");
+    push @sim_files, map { "$dir/$_" } grep { $_ !~ /^\./ } readdir( SIMSDIR );
+    closedir( SIMSDIR );
+}
+
+my $simfilelist = "$FIG_Config::temp/make_bbhs_files.$$";
+open( FILELIST, ">$simfilelist" ) || Confess("Could not open $simfilelist");
+foreach my $sim_file ( @sim_files ) {
+    my $fileN = $fig->file2N( $sim_file );
+    print FILELIST "$fileN\t$sim_file\n" if $fileN and -s $sim_file;
+}
+close( FILELIST );
+
+#
+#  The seeks, from the seek index or the database:
+#
+
+my $seeks_file;
+my $opts = $threads > 0 ? "-j $threads" : "";
+$opts .= " -p $max_psc" if defined $max_psc;
+$opts .= " -o $bbh_dir";
+my @genomes = grep { /^\d+\.\d+$/ } @ARGV;
+$opts .= join( "", map { " -g $_" } @genomes );
+if ( $seek_index ) {
+    $opts .= " -b $seek_index";
+} else {
+    $seeks_file = "$FIG_Config::temp/make_bbhs_seeks.$$";
+    Trace("Reading $seeks_table.") if T(2);
+    open( SEEKS, ">$seeks_file" ) || Confess("Could not open $seeks_file");
+    #
+    #  With a subject index, only the seeks of the genomes' own pegs are used.
+    #
+    my $where = "";
+    if ( @genomes && $subject_index ) {
+	$where = " WHERE " . join( " OR ", map { "id LIKE 'fig|$_.peg.%'" } @genomes );
+    }
+    my $sth = $fig->db_handle->prepare_command("SELECT id, fileN, seek, len FROM $seeks_table$where");
+    $sth->execute() || Confess("Could not read $seeks_table");
+    while ( my $row = $sth->fetchrow_arrayref ) {
+	print SEEKS join( "\t", @$row ), "\n";
+    }
+    close( SEEKS );
+}
+$opts .= " -r $subject_index" if $subject_index && @genomes;
+
+-d $bbh_dir || mkdir( $bbh_dir, 0777 ) || Confess("Could not make $bbh_dir");
+
+Trace("Computing BBHs with compute_bbhs $opts") if T(2);
+my $status = system( "compute_bbhs $opts $simfilelist" . ( $seeks_file ? " < $seeks_file" : "" ) );
+unlink( $simfilelist );
+unlink( $seeks_file ) if $seeks_file;
+$status == 0 || Confess("compute_bbhs failed");
+
+Trace("BBHs written to $bbh_dir.") if T(2);
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ * 
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License. 
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_bgzf.c
+ *
+ *  Usage:  sims_bgzf  [ -l level ]  < SimsFile  > SimsFile.bgz
+ *  or      sims_bgzf  -v   (to return version number on standard output)
+ *
+ *  Compress a sims file to blocked gzip (BGZF, see bgzf.h), at zlib
+ *  compression level 1 - 9 (default 6).  index_sims_file indexes the
+ *  compressed file with virtual seeks, which sims_filter (and anything else
+ *  using sims_reader) reads one 64 kB block at a time.  The file can still
+ *  be read with gzip -dc.
+ *
+ *  Compile with:  cc -O sims_bgzf.c bgzf.c -o sims_bgzf -lz
+ */
+
+#define  VERSION  "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bgzf.h"
+
+void  usage( char *prog );
+
+
+int main( int argc, char **argv ) {
+    int level = 6;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    if ( ( argc == 3 ) && ( strcmp( argv[1], "-l" ) == 0 ) ) {
+        level = atoi( argv[2] );
+        if ( ( level < 1 ) || ( level > 9 ) ) usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( argc != 1 ) usage( argv[0] );
+
+    if ( bgzf_compress( stdin, stdout, level ) || fflush( stdout ) ) {
+        fprintf( stderr, "sims_bgzf: compression failed\n" );
+        return 1;
+    }
+    return 0;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ -l level ]  < SimsFile  > SimsFile.bgz\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog
+           );
+    exit( 0 );
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ * 
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License. 
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_filter.c
+ *
+ *  Usage:  sims_filter  [ -p max_psc ] [ -i min_iden ] [ -m max_hits ]  file_list  < SimSeeks  > Sims
+ *  or      sims_filter  -v   (to return version number on standard output)
+ *
+ *  Read blocks of sims and write the lines that pass the cutoffs.  Each
+ *  line of standard in is a seek, either as written by index_sims_file and
+ *  sims_seek_lookup:
+ *
+ *     SeqID \t FileNumber \t Seek \t Length
+ *
+ *  or without the id:
+ *
+ *     FileNumber \t Seek \t Length
+ *
+ *  file_list gives the sims file of each file number, as lines of form:
+ *
+ *     FileNumber \t FileName \n
+ *
+ *  A line is written if its psc is at most max_psc, and its iden at least
+ *  min_iden; at most max_hits lines are written from each block.
+ *
+ *  Compile with:  cc -O sims_filter.c sims_reader.c bgzf.c -o sims_filter -lz
+ */
+
+#define  VERSION  "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sims_reader.h"
+
+#define  INPLEN  ( 16*1024)
+
+void  usage( char *prog );
+
+
+int main( int argc, char **argv ) {
+    sims_reader_t  *reader;
+    sims_set_t      set;
+    sims_cutoff_t   cut = SIMS_NO_CUTOFF;
+    char            inpbuf[INPLEN], *bptr, *fld[4];
+    unsigned long   fileN, len;
+    unsigned long long seek;
+    size_t          i;
+    int             nf, status = 0;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    while ( ( argc >= 3 ) && ( argv[1][0] == '-' ) ) {
+        if      ( strcmp( argv[1], "-p" ) == 0 ) cut.max_psc  = atof( argv[2] );
+        else if ( strcmp( argv[1], "-i" ) == 0 ) cut.min_iden = atof( argv[2] );
+        else if ( strcmp( argv[1], "-m" ) == 0 ) cut.max_hits = atol( argv[2] );
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( argc != 2 ) usage( argv[0] );
+
+    if ( ! ( reader = sims_reader_new() ) || sims_reader_read_list( reader, argv[1] ) ) {
+        fprintf( stderr, "sims_filter: could not read file list %s\n", argv[1] );
+        return 1;
+    }
+    sims_set_init( &set );
+
+    while ( fgets( inpbuf, INPLEN, stdin ) ) {
+        fld[0] = inpbuf;
+        for ( nf = 1, bptr = inpbuf; *bptr && ( *bptr != '\n' ); bptr++ ) {
+            if ( *bptr == '\t' ) {
+                if ( nf == 4 ) break;
+                fld[nf++] = bptr + 1;
+            }
+        }
+        if ( nf < 3 ) continue;
+        fileN = strtoul( fld[nf-3], NULL, 10 );
+        seek  = strtoull( fld[nf-2], NULL, 10 );
+        len   = strtoul( fld[nf-1], NULL, 10 );
+
+        sims_set_clear( &set );
+        if ( sims_read( reader, (uint32_t) fileN, seek, (uint32_t) len, &cut, &set ) < 0 ) {
+            fprintf( stderr, "sims_filter: could not read %lu bytes at %llu of file %lu\n",
+                             len, seek, fileN );
+            status = 1;
+            continue;
+        }
+        for ( i = 0; i < set.n; i++ ) {
+            fputs( SIMS_LINE( &set, i ), stdout );
+            putchar( '\n' );
+        }
+    }
+
+    sims_set_free( &set );
+    sims_reader_free( reader );
+    return ( status || ferror( stdout ) ) ? 1 : 0;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ -p max_psc ] [ -i min_iden ] [ -m max_hits ]  file_list  < SimSeeks  > Sims\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog
+           );
+    exit( 0 );
+}
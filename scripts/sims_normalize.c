@@ -0,0 +1,702 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_normalize.c
+ *
+ *  Usage:  sims_normalize  [ options ]  [ SimsFile ]  > SortedSims
+ *  or      sims_normalize  -v   (to return version number on standard output)
+ *
+ *  Options:  -j nthreads  -m megabytes  -t tmpdir  -o SortedSims
+ *            -n FileNumber  -k SimSeeks  -b SeekIndex
+ *
+ *  Sort a sims file (default standard in) so that all of the lines of each
+ *  query id (the first field) are together, ordered by psc (field 11, lowest
+ *  first), then by bsc (field 12, highest first), then in the order of the
+ *  input.  Lines without a psc and bsc go after the scored lines of their id.
+ *  index_sims_file then finds exactly one run of lines per id, so all of the
+ *  sims of an id are one sequential read.
+ *
+ *  The input is read in chunks of about megabytes / ( 2 * nthreads ) (default
+ *  1024 MB, and one thread per online processor, as is -j 0), which are cut at newlines,
+ *  parsed and sorted on the worker threads, and written to unlinked
+ *  temporary files in tmpdir (default the directory of SortedSims, or
+ *  $TMPDIR, or /tmp).  The sorted runs are then merged.  Input that fits in
+ *  one chunk is sorted in memory without temporary files.  At most MAXRUNS
+ *  runs are kept; when there are that many, they are merged into one.
+ *
+ *  The sorted output is indexed as it is written: with -k, the seeks are
+ *  written to SimSeeks in the form of index_sims_file,
+ *
+ *     SeqID \t FileNumber \t Seek \t Length
+ *
+ *  and with -b, to a binary seek index (see sims_seek_index.h).  Both need
+ *  the FileNumber of the sorted file (-n).  Lines with an empty first field
+ *  are sorted to the start of the output.  They, and ids of MAXID or more
+ *  bytes, are not indexed, as in index_sims_file.
+ *
+ *  With -o, the output is written to a temporary file beside SortedSims,
+ *  which is renamed to SortedSims when it is complete, so SortedSims can be
+ *  the input file.
+ *
+ *  Compile with:  cc -O sims_normalize.c sims_seek_index.c -o sims_normalize -lpthread -lm
+ */
+
+#define  VERSION  "1.00"
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>    /*  HUGE_VAL  */
+#include <fcntl.h>   /*  O_RDONLY  */
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sims_seek_index.h"
+
+#define  MINCHUNK  (   1024*1024)       /* smallest chunk read */
+#define  MAXRUNS   (         256)       /* sorted runs before they are merged */
+#define  RUNBUF    (    256*1024)       /* stdio buffer of a run file */
+#define  OUTBUF    (   1024*1024)       /* stdio buffer of the output */
+#define  SSIMEM    ( 256*1024*1024)     /* memory for the binary index */
+#define  MAXID     (          64)       /* ids this long are not indexed (sim_seeks.id is varchar(64)) */
+
+typedef unsigned long long u_long_long;
+
+/*  A line of a chunk, with its sort key  */
+
+typedef struct {
+    uint64_t     key;       /* first 8 bytes of the id, big endian */
+    const char  *line;
+    uint32_t     len;       /* including the newline */
+    uint32_t     idlen;
+    double       psc;
+    double       bsc;
+    size_t       n;         /* line number in the chunk */
+} rec_t;
+
+/*  A line in a run file is a run_hdr_t followed by the line  */
+
+typedef struct {
+    uint32_t     len;
+    uint32_t     idlen;
+    double       psc;
+    double       bsc;
+} run_hdr_t;
+
+/*  A chunk of input, sorted on a worker thread  */
+
+typedef struct {
+    char        *data;
+    size_t       len;
+    size_t       size;
+    rec_t       *recs;
+    size_t       nrec;
+    size_t       maxrec;
+    FILE        *run;       /* the sorted run */
+    int          status;
+    int          busy;
+    pthread_t    thread;
+} chunk_t;
+
+/*  A run being merged  */
+
+typedef struct {
+    FILE        *fp;
+    run_hdr_t    hdr;
+    char        *line;
+    size_t       size;
+} run_in_t;
+
+/*  Where sorted lines go: a run file, or the output, which is indexed  */
+
+typedef struct {
+    FILE        *fp;
+    int          final;
+    u_long_long  offset;    /* bytes written */
+    char        *id;        /* id of the current run of lines */
+    uint32_t     idlen;
+    size_t       idsize;
+    u_long_long  seek;      /* where the current run started */
+} sink_t;
+
+int   read_runs( int fd, sink_t *out, size_t chunklen, int nthreads );
+int   fill_chunk( int fd, chunk_t *c, char **carry, size_t *ncarry, size_t chunklen, int *eof );
+void *sort_worker( void *arg );
+void  sort_chunk( chunk_t *c );
+void  parse_line( rec_t *r, const char *p, const char *nl );
+int   cmp_recs( const void *a, const void *b );
+int   cmp_keys( const char *id1, uint32_t len1, double psc1, double bsc1,
+                const char *id2, uint32_t len2, double psc2, double bsc2 );
+int   write_chunk( chunk_t *c, sink_t *sink );
+int   add_run( FILE *fp );
+int   merge_runs( FILE **fps, int n, sink_t *sink );
+int   read_rec( run_in_t *r );
+int   run_before( run_in_t *runs, int a, int b );
+void  sift_down( run_in_t *runs, int *heap, int n, int i );
+int   emit( sink_t *sink, const run_hdr_t *hdr, const char *line );
+int   end_id( sink_t *sink );
+FILE *temp_run( void );
+void *xrealloc( void *ptr, size_t n );
+void  usage( char *prog );
+
+char          *tmpdir = NULL;
+char          *filenum = NULL;
+uint32_t       fileN = 0;
+FILE          *seeks = NULL;            /* seeks of the output (-k) */
+ssi_builder_t *seek_index = NULL;       /* binary index of the output (-b) */
+
+FILE          *runs[MAXRUNS];           /* sorted runs, in input order */
+int            nrun = 0;
+
+
+int main( int argc, char **argv ) {
+    char     *out_file, *seeks_file, *index_file, *tmp_out, *slash;
+    size_t    megabytes, chunklen;
+    sink_t    out;
+    int       nthreads, fd, status;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    nthreads   = 0;
+    megabytes  = 1024;
+    out_file   = NULL;
+    seeks_file = NULL;
+    index_file = NULL;
+    while ( ( argc >= 3 ) && ( argv[1][0] == '-' ) && argv[1][1] ) {
+        if ( strcmp( argv[1], "-j" ) == 0 ) {
+            if ( sscanf( argv[2], "%d", &nthreads ) != 1 || nthreads < 0 ) usage( argv[0] );
+            if ( nthreads == 0 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+            if ( nthreads < 1 ) nthreads = 1;
+        }
+        else if ( strcmp( argv[1], "-m" ) == 0 ) {
+            if ( ( megabytes = (size_t) atol( argv[2] ) ) < 1 ) usage( argv[0] );
+        }
+        else if ( strcmp( argv[1], "-t" ) == 0 ) tmpdir     = argv[2];
+        else if ( strcmp( argv[1], "-o" ) == 0 ) out_file   = argv[2];
+        else if ( strcmp( argv[1], "-n" ) == 0 ) filenum    = argv[2];
+        else if ( strcmp( argv[1], "-k" ) == 0 ) seeks_file = argv[2];
+        else if ( strcmp( argv[1], "-b" ) == 0 ) index_file = argv[2];
+        else usage( argv[0] );
+        argc -= 2;
+        argv += 2;
+    }
+    if ( ( argc > 2 ) || ( ( argc == 2 ) && ( argv[1][0] == '-' ) ) ) usage( argv[0] );
+    if ( ( seeks_file || index_file ) && ! filenum ) usage( argv[0] );
+    if ( filenum ) fileN = (uint32_t) strtoul( filenum, NULL, 10 );
+
+    if ( nthreads < 1 ) nthreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+    if ( nthreads < 1 ) nthreads = 1;
+    chunklen = megabytes * 1024 * 1024 / ( 2 * nthreads );
+    if ( chunklen < MINCHUNK ) chunklen = MINCHUNK;
+
+    /* The output, in a temporary file beside out_file if there is one */
+
+    memset( &out, 0, sizeof( out ) );
+    out.final = 1;
+    tmp_out = NULL;
+    if ( out_file ) {
+        tmp_out = (char *) xrealloc( NULL, strlen( out_file ) + 16 );
+        sprintf( tmp_out, "%s.tmp.XXXXXX", out_file );
+        if ( ( fd = mkstemp( tmp_out ) ) < 0 || ! ( out.fp = fdopen( fd, "w" ) ) ) {
+            fprintf( stderr, "sims_normalize: could not write %s\n", out_file );
+            return 1;
+        }
+        if ( ! tmpdir ) {
+            tmpdir = strdup( out_file );
+            if ( ( slash = strrchr( tmpdir, '/' ) ) ) *slash = '\0';
+            else strcpy( tmpdir, "." );
+        }
+    }
+    else out.fp = stdout;
+    setvbuf( out.fp, NULL, _IOFBF, OUTBUF );
+    if ( ! tmpdir && ! ( tmpdir = getenv( "TMPDIR" ) ) ) tmpdir = "/tmp";
+
+    if ( argc == 2 ) {
+        if ( ( fd = open( argv[1], O_RDONLY ) ) < 0 ) {
+            fprintf( stderr, "sims_normalize: could not open %s\n", argv[1] );
+            return 1;
+        }
+    }
+    else fd = 0;
+
+    if ( seeks_file && ! ( seeks = fopen( seeks_file, "w" ) ) ) {
+        fprintf( stderr, "sims_normalize: could not write %s\n", seeks_file );
+        return 1;
+    }
+    if ( index_file && ! ( seek_index = ssi_builder( index_file, SSIMEM ) ) ) {
+        fprintf( stderr, "sims_normalize: could not start seek index %s\n", index_file );
+        return 1;
+    }
+
+    status = read_runs( fd, &out, chunklen, nthreads );
+    if ( ! status && nrun ) status = merge_runs( runs, nrun, &out );
+    if ( ! status ) status = end_id( &out );
+
+    if ( fflush( out.fp ) || ferror( out.fp ) ) status = 1;
+    if ( out_file ) {
+        if ( fclose( out.fp ) ) status = 1;
+        if ( status || rename( tmp_out, out_file ) ) {
+            unlink( tmp_out );
+            status = 1;
+        }
+    }
+    if ( status ) fprintf( stderr, "sims_normalize: failed to sort the sims\n" );
+
+    if ( seeks && ( fclose( seeks ) || status ) ) {
+        if ( ! status ) fprintf( stderr, "sims_normalize: failed to write %s\n", seeks_file );
+        status = 1;
+    }
+    if ( seek_index && ( ssi_finish( seek_index ) || status ) ) {
+        if ( ! status ) fprintf( stderr, "sims_normalize: failed to write seek index %s\n", index_file );
+        status = 1;
+    }
+
+    return status;
+}
+
+
+/*  Read the input in chunks, and sort them into runs on the worker threads.
+ *  The chunks are handed to the threads in turn, so when a thread is joined
+ *  its run is the next one in input order.  If the whole input is one chunk,
+ *  it is sorted here and written straight to out.  Returns 0 on success.
+ */
+
+int read_runs( int fd, sink_t *out, size_t chunklen, int nthreads ) {
+    chunk_t *chunks, *c;
+    char    *carry;
+    size_t   ncarry;
+    int      eof, k, i, status;
+
+    chunks = (chunk_t *) xrealloc( NULL, nthreads * sizeof( chunk_t ) );
+    memset( chunks, 0, nthreads * sizeof( chunk_t ) );
+    carry  = NULL;
+    ncarry = 0;
+    eof    = 0;
+    status = 0;
+
+    for ( k = 0; ! eof && ! status; k++ ) {
+        c = chunks + ( k % nthreads );
+        if ( c->busy ) {
+            pthread_join( c->thread, NULL );
+            c->busy = 0;
+            if ( ( status = c->status ) || ( status = add_run( c->run ) ) ) break;
+        }
+
+        if ( fill_chunk( fd, c, &carry, &ncarry, chunklen, &eof ) ) { status = 1; break; }
+        if ( ! c->len ) break;
+
+        if ( ( k == 0 ) && eof ) {
+            sort_chunk( c );
+            status = write_chunk( c, out );
+            break;
+        }
+
+        if ( pthread_create( &( c->thread ), NULL, sort_worker, c ) ) {
+            sort_worker( c );
+            if ( ( status = c->status ) || ( status = add_run( c->run ) ) ) break;
+        }
+        else c->busy = 1;
+    }
+
+    /* The rest of the threads, in order */
+
+    for ( i = 0; i < nthreads; i++ ) {
+        c = chunks + ( ( k + i ) % nthreads );
+        if ( ! c->busy ) continue;
+        pthread_join( c->thread, NULL );
+        c->busy = 0;
+        if ( ! status && ! ( status = c->status ) ) status = add_run( c->run );
+        else if ( c->run ) fclose( c->run );
+    }
+
+    for ( i = 0; i < nthreads; i++ ) {
+        if ( chunks[i].data ) free( chunks[i].data );
+        if ( chunks[i].recs ) free( chunks[i].recs );
+    }
+    free( chunks );
+    if ( carry ) free( carry );
+    return status;
+}
+
+
+/*  Fill a chunk with the partial line left from the last one, and whole
+ *  lines of input up to chunklen bytes (more if a line is longer).  The
+ *  partial line at the end is moved to carry.  A last line without a
+ *  newline is given one.  Returns 0 on success.
+ */
+
+int fill_chunk( int fd, chunk_t *c, char **carry, size_t *ncarry, size_t chunklen, int *eof ) {
+    ssize_t  n;
+    size_t   len;
+
+    if ( c->size < chunklen + 1 ) {
+        c->size = chunklen + 1;
+        c->data = (char *) xrealloc( c->data, c->size );
+    }
+    if ( *ncarry ) memcpy( c->data, *carry, *ncarry );
+    c->len  = *ncarry;
+    *ncarry = 0;
+
+    while ( 1 ) {
+        while ( ! *eof && ( c->len < c->size - 1 ) ) {
+            n = read( fd, c->data + c->len, c->size - 1 - c->len );
+            if ( n < 0 ) return 1;
+            if ( n == 0 ) *eof = 1;
+            c->len += n;
+        }
+        if ( *eof ) {
+            if ( c->len && ( c->data[c->len-1] != '\n' ) ) c->data[c->len++] = '\n';
+            return 0;
+        }
+        for ( len = c->len; ( len > 0 ) && ( c->data[len-1] != '\n' ); len-- ) ;
+        if ( len ) break;
+
+        /* A line longer than the chunk */
+
+        c->size *= 2;
+        c->data = (char *) xrealloc( c->data, c->size );
+    }
+
+    *ncarry = c->len - len;
+    *carry  = (char *) xrealloc( *carry, *ncarry + 1 );
+    memcpy( *carry, c->data + len, *ncarry );
+    c->len = len;
+    return 0;
+}
+
+
+void *sort_worker( void *arg ) {
+    chunk_t *c = (chunk_t *) arg;
+    sink_t   sink;
+
+    sort_chunk( c );
+    memset( &sink, 0, sizeof( sink ) );
+    if ( ! ( c->run = sink.fp = temp_run() ) ) {
+        c->status = 1;
+        return NULL;
+    }
+    c->status = write_chunk( c, &sink );
+    return NULL;
+}
+
+
+/*  Find the lines of a chunk, and sort them.  */
+
+void sort_chunk( chunk_t *c ) {
+    const char *p, *end, *nl;
+
+    c->nrec = 0;
+    end = c->data + c->len;
+    for ( p = c->data; p < end; p = nl + 1 ) {
+        nl = (const char *) memchr( p, '\n', end - p );
+        if ( c->nrec >= c->maxrec ) {
+            c->maxrec = c->maxrec ? 2 * c->maxrec : c->len / 64 + 1024;
+            c->recs = (rec_t *) xrealloc( c->recs, c->maxrec * sizeof( rec_t ) );
+        }
+        parse_line( c->recs + c->nrec, p, nl );
+        c->recs[c->nrec].n = c->nrec;
+        c->nrec++;
+    }
+
+    qsort( c->recs, c->nrec, sizeof( rec_t ), cmp_recs );
+}
+
+
+/*  The id, key, psc and bsc of the line from p to the newline at nl  */
+
+void parse_line( rec_t *r, const char *p, const char *nl ) {
+    const char *f;
+    char       *e;
+    uint32_t    i;
+    int         n;
+
+    r->line = p;
+    r->len  = nl + 1 - p;
+    for ( i = 0; ( p + i < nl ) && ( p[i] != '\t' ) && ( p[i] != ' ' ) && ( p[i] != '\r' ); i++ ) ;
+    r->idlen = i;
+
+    r->key = 0;
+    for ( i = 0; i < 8; i++ ) {
+        r->key <<= 8;
+        if ( i < r->idlen ) r->key |= (unsigned char) p[i];
+    }
+
+    /* Fields 11 and 12 */
+
+    r->psc = HUGE_VAL;
+    r->bsc = -HUGE_VAL;
+    for ( f = p, n = 1; n < 11; n++ ) {
+        if ( ! ( f = (const char *) memchr( f, '\t', nl - f ) ) ) return;
+        f++;
+    }
+    r->psc = strtod( f, &e );
+    if ( ( e == f ) || ( *e != '\t' ) ) {
+        r->psc = HUGE_VAL;
+        return;
+    }
+    f = e + 1;
+    r->bsc = strtod( f, &e );
+    if ( ( e == f ) || ( ( *e != '\t' ) && ( *e != '\n' ) && ( *e != '\r' ) ) ) {
+        r->psc = HUGE_VAL;
+        r->bsc = -HUGE_VAL;
+    }
+}
+
+
+int cmp_recs( const void *a, const void *b ) {
+    const rec_t *r1 = (const rec_t *) a;
+    const rec_t *r2 = (const rec_t *) b;
+    int          c;
+
+    if ( r1->key != r2->key ) return ( r1->key < r2->key ) ? -1 : 1;
+    if ( ( c = cmp_keys( r1->line, r1->idlen, r1->psc, r1->bsc,
+                         r2->line, r2->idlen, r2->psc, r2->bsc ) ) ) return c;
+    return ( r1->n < r2->n ) ? -1 : ( r1->n > r2->n );
+}
+
+
+/*  Order by id, then psc, then (highest first) bsc  */
+
+int cmp_keys( const char *id1, uint32_t len1, double psc1, double bsc1,
+              const char *id2, uint32_t len2, double psc2, double bsc2 ) {
+    int c;
+
+    if ( ( c = memcmp( id1, id2, ( len1 < len2 ) ? len1 : len2 ) ) ) return c;
+    if ( len1 != len2 ) return ( len1 < len2 ) ? -1 : 1;
+    if ( psc1 != psc2 ) return ( psc1 < psc2 ) ? -1 : 1;
+    if ( bsc1 != bsc2 ) return ( bsc1 > bsc2 ) ? -1 : 1;
+    return 0;
+}
+
+
+/*  Write the sorted lines of a chunk to a sink  */
+
+int write_chunk( chunk_t *c, sink_t *sink ) {
+    run_hdr_t  hdr;
+    rec_t     *r;
+    size_t     i;
+
+    for ( i = 0; i < c->nrec; i++ ) {
+        r = c->recs + i;
+        hdr.len   = r->len;
+        hdr.idlen = r->idlen;
+        hdr.psc   = r->psc;
+        hdr.bsc   = r->bsc;
+        if ( emit( sink, &hdr, r->line ) ) return 1;
+    }
+    return sink->final ? 0 : ( fflush( sink->fp ) || ferror( sink->fp ) );
+}
+
+
+/*  Keep a sorted run.  When there are MAXRUNS, they are merged into one.  */
+
+int add_run( FILE *fp ) {
+    sink_t sink;
+    int    status;
+
+    runs[nrun++] = fp;
+    if ( nrun < MAXRUNS ) return 0;
+
+    memset( &sink, 0, sizeof( sink ) );
+    if ( ! ( sink.fp = temp_run() ) ) return 1;
+    status = merge_runs( runs, nrun, &sink );
+    if ( fflush( sink.fp ) || ferror( sink.fp ) ) status = 1;
+    runs[0] = sink.fp;
+    nrun = 1;
+    return status;
+}
+
+
+/*  Merge n sorted runs into a sink, and close them.  Lines that sort the
+ *  same are taken from the earliest run, which keeps the input order.
+ */
+
+int merge_runs( FILE **fps, int n, sink_t *sink ) {
+    run_in_t *in;
+    int      *heap, nheap, i, status;
+
+    in   = (run_in_t *) xrealloc( NULL, n * sizeof( run_in_t ) );
+    heap = (int *) xrealloc( NULL, n * sizeof( int ) );
+    memset( in, 0, n * sizeof( run_in_t ) );
+    nheap  = 0;
+    status = 0;
+    for ( i = 0; i < n; i++ ) {
+        in[i].fp = fps[i];
+        rewind( in[i].fp );
+        if ( ( status = read_rec( in + i ) ) < 0 ) break;
+        if ( status ) heap[nheap++] = i;
+        status = 0;
+    }
+    for ( i = nheap / 2 - 1; ( i >= 0 ) && ! status; i-- ) sift_down( in, heap, nheap, i );
+
+    while ( nheap && ! status ) {
+        i = heap[0];
+        if ( emit( sink, &( in[i].hdr ), in[i].line ) ) { status = 1; break; }
+        switch ( read_rec( in + i ) ) {
+            case 1:  break;
+            case 0:  heap[0] = heap[--nheap]; break;
+            default: status = 1;
+        }
+        if ( nheap ) sift_down( in, heap, nheap, 0 );
+    }
+
+    for ( i = 0; i < n; i++ ) {
+        fclose( in[i].fp );
+        if ( in[i].line ) free( in[i].line );
+    }
+    free( in );
+    free( heap );
+    return status;
+}
+
+
+/*  The next line of a run: 1 if read, 0 at the end, -1 on an error  */
+
+int read_rec( run_in_t *r ) {
+    size_t n;
+
+    if ( ( n = fread( &( r->hdr ), sizeof( run_hdr_t ), 1, r->fp ) ) != 1 ) {
+        return ferror( r->fp ) ? -1 : 0;
+    }
+    if ( r->hdr.len > r->size ) {
+        r->size = r->hdr.len + 256;
+        r->line = (char *) xrealloc( r->line, r->size );
+    }
+    return ( fread( r->line, 1, r->hdr.len, r->fp ) == r->hdr.len ) ? 1 : -1;
+}
+
+
+int run_before( run_in_t *runs, int a, int b ) {
+    int c = cmp_keys( runs[a].line, runs[a].hdr.idlen, runs[a].hdr.psc, runs[a].hdr.bsc,
+                      runs[b].line, runs[b].hdr.idlen, runs[b].hdr.psc, runs[b].hdr.bsc );
+    return c ? ( c < 0 ) : ( a < b );
+}
+
+
+void sift_down( run_in_t *runs, int *heap, int n, int i ) {
+    int c, t;
+
+    while ( ( c = 2 * i + 1 ) < n ) {
+        if ( ( c + 1 < n ) && run_before( runs, heap[c+1], heap[c] ) ) c++;
+        if ( ! run_before( runs, heap[c], heap[i] ) ) break;
+        t = heap[c]; heap[c] = heap[i]; heap[i] = t;
+        i = c;
+    }
+}
+
+
+/*  Write a line to a run file, or to the output, where the runs of lines
+ *  with the same id are indexed.  Returns 0 on success.
+ */
+
+int emit( sink_t *sink, const run_hdr_t *hdr, const char *line ) {
+    if ( ! sink->final ) {
+        return ( fwrite( hdr, sizeof( run_hdr_t ), 1, sink->fp ) != 1 )
+            || ( fwrite( line, 1, hdr->len, sink->fp ) != hdr->len );
+    }
+
+    if ( ( hdr->idlen != sink->idlen ) || memcmp( line, sink->id, hdr->idlen ) ) {
+        if ( end_id( sink ) ) return 1;
+        if ( hdr->idlen > sink->idsize ) {
+            sink->idsize = hdr->idlen + 64;
+            sink->id = (char *) xrealloc( sink->id, sink->idsize );
+        }
+        memcpy( sink->id, line, hdr->idlen );
+        sink->idlen = hdr->idlen;
+        sink->seek  = sink->offset;
+    }
+
+    if ( fwrite( line, 1, hdr->len, sink->fp ) != hdr->len ) return 1;
+    sink->offset += hdr->len;
+    return 0;
+}
+
+
+/*  Index the run of lines of the current id  */
+
+int end_id( sink_t *sink ) {
+    u_long_long len;
+
+    if ( ! sink->idlen || ( sink->idlen >= MAXID ) ) {
+        sink->idlen = 0;
+        return 0;
+    }
+    len = sink->offset - sink->seek;
+    if ( seeks ) {
+        fwrite( sink->id, 1, sink->idlen, seeks );
+        fprintf( seeks, "\t%s\t%llu\t%llu\n", filenum, sink->seek, len );
+    }
+    if ( seek_index && ssi_add( seek_index, sink->id, sink->idlen, fileN, sink->seek, (uint32_t) len ) ) {
+        fprintf( stderr, "sims_normalize: failed to add %.*s to the seek index\n", (int) sink->idlen, sink->id );
+        return 1;
+    }
+    sink->idlen = 0;
+    return 0;
+}
+
+
+/*  An unlinked temporary file in tmpdir  */
+
+FILE *temp_run( void ) {
+    char   *name;
+    FILE   *fp;
+    int     fd;
+
+    name = (char *) xrealloc( NULL, strlen( tmpdir ) + 32 );
+    sprintf( name, "%s/sims_normalize.XXXXXX", tmpdir );
+    fd = mkstemp( name );
+    if ( fd >= 0 ) unlink( name );
+    else fprintf( stderr, "sims_normalize: could not make a temporary file in %s\n", tmpdir );
+    free( name );
+    if ( fd < 0 ) return NULL;
+    if ( ! ( fp = fdopen( fd, "w+" ) ) ) close( fd );
+    else setvbuf( fp, NULL, _IOFBF, RUNBUF );
+    return fp;
+}
+
+
+void *xrealloc( void *ptr, size_t n ) {
+    if ( ! ( ptr = realloc( ptr, n ) ) ) {
+        fprintf( stderr, "sims_normalize: out of memory\n" );
+        exit( 1 );
+    }
+    return ptr;
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  [ options ]  [ SimsFile ]  > SortedSims\n"
+             "or     %s  -v    (writes the version to stdout)\n"
+             "\n"
+             "Options:\n"
+             "    -j nthreads      sort on nthreads threads (0 or D = number of processors)\n"
+             "    -m megabytes     memory for sorting (D = 1024)\n"
+             "    -t tmpdir        directory for sorted runs\n"
+             "    -o SortedSims    write SortedSims (which may be the input) instead of stdout\n"
+             "    -n FileNumber    file number of the output, for -k and -b\n"
+             "    -k SimSeeks      write the seeks of the output to SimSeeks\n"
+             "    -b SeekIndex     write the seeks of the output to a binary seek index\n",
+             prog, prog
+           );
+    exit( 0 );
+}
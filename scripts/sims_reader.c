@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ * 
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License. 
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_reader.c
+ *
+ *  Read and parse blocks of sims.  See sims_reader.h.
+ *
+ *  The fields of a line are found first, so that psc and iden can be
+ *  checked before anything else is converted or copied.
+ *
+ *  A sims file compressed to blocked gzip is recognized when it is opened,
+ *  and its seeks are taken to be virtual seeks (see bgzf.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sims_reader.h"
+#include "bgzf.h"
+
+#define  NFIELD   14        /*  fields that are parsed  */
+#define  NUMLEN   64        /*  longest number that is converted  */
+#define  INPLEN   ( 16*1024)
+
+typedef struct {
+    char  *path;
+    int    fd;              /*  -1 until opened  */
+    int    bgzf;            /*  blocked gzip file  */
+} sims_file_t;
+
+struct sims_reader {
+    sims_file_t *files;     /*  indexed by file number  */
+    uint32_t     nfiles;
+    char        *buf;
+    size_t       bufsize;
+};
+
+static int     set_reserve( sims_set_t *set, size_t nhit, size_t ntext );
+static double  get_double( const char *p, const char *end );
+static int32_t get_int( const char *p, const char *end );
+
+
+/*==========================================================================
+ *  Reader
+ *==========================================================================*/
+
+sims_reader_t *sims_reader_new( void ) {
+    return (sims_reader_t *) calloc( 1, sizeof( sims_reader_t ) );
+}
+
+
+int sims_reader_add_file( sims_reader_t *r, uint32_t fileN, const char *path ) {
+    sims_file_t *files;
+    uint32_t     n;
+
+    if ( fileN >= r->nfiles ) {
+        n = ( fileN < 1024 ) ? 1024 : 2 * fileN;
+        if ( ! ( files = (sims_file_t *) realloc( r->files, n * sizeof( sims_file_t ) ) ) ) return -1;
+        memset( files + r->nfiles, 0, ( n - r->nfiles ) * sizeof( sims_file_t ) );
+        r->files  = files;
+        r->nfiles = n;
+    }
+
+    if ( r->files[fileN].path ) {
+        if ( r->files[fileN].fd >= 0 ) close( r->files[fileN].fd );
+        free( r->files[fileN].path );
+    }
+    if ( ! ( r->files[fileN].path = strdup( path ) ) ) return -1;
+    r->files[fileN].fd = -1;
+    return 0;
+}
+
+
+/*  Read a list of "FileNumber \t FileName" lines, as given to index_sims_file  */
+
+int sims_reader_read_list( sims_reader_t *r, const char *list ) {
+    FILE *fp;
+    char  inpbuf[INPLEN], *bptr, *name;
+    long  fileN;
+    int   status = 0;
+
+    if ( ! ( fp = fopen( list, "r" ) ) ) return -1;
+    while ( fgets( inpbuf, INPLEN, fp ) ) {
+        fileN = strtol( inpbuf, &bptr, 10 );
+        if ( ( bptr == inpbuf ) || ( *bptr != '\t' ) || ( fileN < 1 ) ) continue;
+        name = bptr + 1;
+        for ( bptr = name; *bptr && ( *bptr != '\n' ) && ( *bptr != '\r' ); bptr++ ) ;
+        *bptr = '\0';
+        if ( *name && sims_reader_add_file( r, (uint32_t) fileN, name ) ) status = -1;
+    }
+    fclose( fp );
+    return status;
+}
+
+
+void sims_reader_free( sims_reader_t *r ) {
+    uint32_t i;
+
+    if ( ! r ) return;
+    for ( i = 0; i < r->nfiles; i++ ) {
+        if ( ! r->files[i].path ) continue;
+        if ( r->files[i].fd >= 0 ) close( r->files[i].fd );
+        free( r->files[i].path );
+    }
+    free( r->files );
+    free( r->buf );
+    free( r );
+}
+
+
+long sims_read( sims_reader_t *r, uint32_t fileN, uint64_t seek, uint32_t len,
+                const sims_cutoff_t *cut, sims_set_t *set ) {
+    sims_file_t   *f;
+    unsigned char  hdr[BGZF_HEADER];
+    ssize_t        got;
+    size_t         done;
+
+    if ( ( fileN >= r->nfiles ) || ! r->files[fileN].path ) return -1;
+    f = r->files + fileN;
+    if ( f->fd < 0 ) {
+        if ( ( f->fd = open( f->path, O_RDONLY ) ) < 0 ) return -1;
+        got = pread( f->fd, hdr, BGZF_HEADER, 0 );
+        f->bgzf = ( got > 0 ) && bgzf_is_bgzf( hdr, (size_t) got );
+    }
+
+    if ( len + 1 > r->bufsize ) {
+        char *buf = (char *) realloc( r->buf, len + 1 );
+        if ( ! buf ) return -1;
+        r->buf     = buf;
+        r->bufsize = len + 1;
+    }
+
+    if ( f->bgzf ) {
+        if ( bgzf_read_at( f->fd, seek, r->buf, len ) ) return -1;
+    }
+    else {
+        for ( done = 0; done < len; done += got ) {
+            got = pread( f->fd, r->buf + done, len - done, (off_t) ( seek + done ) );
+            if ( got <= 0 ) return -1;
+        }
+    }
+
+    return sims_parse( r->buf, len, cut, set );
+}
+
+
+/*==========================================================================
+ *  Parser
+ *==========================================================================*/
+
+long sims_parse( const char *data, size_t len, const sims_cutoff_t *cut, sims_set_t *set ) {
+    static const sims_cutoff_t no_cutoff = SIMS_NO_CUTOFF;
+    const char *end, *line, *eol, *p, *f[NFIELD+1];
+    size_t      i, linelen;
+    double      psc, iden;
+    long        added = 0;
+    int         nf;
+
+    if ( ! cut ) cut = &no_cutoff;
+    end = data + len;
+
+    for ( line = data; line < end; line = eol + 1 ) {
+        if ( cut->max_hits && ( added >= cut->max_hits ) ) break;
+
+        if ( ! ( eol = (const char *) memchr( line, '\n', end - line ) ) ) eol = end;
+        linelen = eol - line;
+        if ( linelen && ( line[linelen-1] == '\r' ) ) linelen--;
+
+        /*  f[k] is the start of field k, f[nf] is one past the end of the last  */
+
+        f[0] = line;
+        nf   = 1;
+        for ( p = line; ( nf < NFIELD ) && ( p = (const char *) memchr( p, '\t', line + linelen - p ) ); ) {
+            f[nf++] = ++p;
+        }
+        if ( nf < 12 ) {
+            if ( linelen ) set->bad++;
+            continue;
+        }
+        if ( nf < NFIELD ) {
+            f[nf] = line + linelen + 1;
+        }
+        else {
+            p = (const char *) memchr( f[NFIELD-1], '\t', line + linelen - f[NFIELD-1] );
+            f[NFIELD] = ( p ? p : line + linelen ) + 1;
+        }
+
+        psc  = get_double( f[10], f[11] - 1 );
+        iden = get_double( f[2],  f[3]  - 1 );
+        if ( ( psc > cut->max_psc ) || ( iden < cut->min_iden ) ) continue;
+
+        if ( set_reserve( set, 1, linelen + 1 ) ) return -1;
+        i = set->n++;
+
+        set->line[i] = set->text_len;
+        memcpy( set->text + set->text_len, line, linelen );
+        set->text[ set->text_len + linelen ] = '\0';
+
+        set->id1_len[i]    = (uint32_t) ( f[1] - f[0] - 1 );
+        set->id2[i]        = set->text_len + ( f[1] - line );
+        set->id2_len[i]    = (uint32_t) ( f[2] - f[1] - 1 );
+        set->text_len     += linelen + 1;
+
+        set->iden[i]       = (float) iden;
+        set->ali_len[i]    = get_int( f[3], f[4] - 1 );
+        set->mismatches[i] = get_int( f[4], f[5] - 1 );
+        set->gaps[i]       = get_int( f[5], f[6] - 1 );
+        set->b1[i]         = get_int( f[6], f[7] - 1 );
+        set->e1[i]         = get_int( f[7], f[8] - 1 );
+        set->b2[i]         = get_int( f[8], f[9] - 1 );
+        set->e2[i]         = get_int( f[9], f[10] - 1 );
+        set->psc[i]        = psc;
+        set->bsc[i]        = (float) get_double( f[11], f[12] - 1 );
+        set->ln1[i]        = ( nf > 12 ) ? get_int( f[12], f[13] - 1 ) : 0;
+        set->ln2[i]        = ( nf > 13 ) ? get_int( f[13], f[14] - 1 ) : 0;
+        added++;
+    }
+
+    return added;
+}
+
+
+/*==========================================================================
+ *  Sets of hits
+ *==========================================================================*/
+
+void sims_set_init( sims_set_t *set ) {
+    memset( set, 0, sizeof( *set ) );
+}
+
+
+void sims_set_clear( sims_set_t *set ) {
+    set->n        = 0;
+    set->text_len = 0;
+    set->bad      = 0;
+}
+
+
+void sims_set_free( sims_set_t *set ) {
+    free( set->line );
+    free( set->id1_len );
+    free( set->id2 );
+    free( set->id2_len );
+    free( set->iden );
+    free( set->ali_len );
+    free( set->mismatches );
+    free( set->gaps );
+    free( set->b1 );
+    free( set->e1 );
+    free( set->b2 );
+    free( set->e2 );
+    free( set->psc );
+    free( set->bsc );
+    free( set->ln1 );
+    free( set->ln2 );
+    free( set->text );
+    sims_set_init( set );
+}
+
+
+#define  GROW( field )  if ( ! ( p = realloc( set->field, n * sizeof( *set->field ) ) ) ) return -1; \
+                        set->field = p
+
+static int set_reserve( sims_set_t *set, size_t nhit, size_t ntext ) {
+    void   *p;
+    size_t  n;
+
+    if ( set->n + nhit > set->size ) {
+        n = ( set->size < 256 ) ? 256 : 2 * set->size;
+        if ( n < set->n + nhit ) n = set->n + nhit;
+        GROW( line );
+        GROW( id1_len );
+        GROW( id2 );
+        GROW( id2_len );
+        GROW( iden );
+        GROW( ali_len );
+        GROW( mismatches );
+        GROW( gaps );
+        GROW( b1 );
+        GROW( e1 );
+        GROW( b2 );
+        GROW( e2 );
+        GROW( psc );
+        GROW( bsc );
+        GROW( ln1 );
+        GROW( ln2 );
+        set->size = n;
+    }
+
+    if ( set->text_len + ntext > set->text_size ) {
+        n = ( set->text_size < 65536 ) ? 65536 : 2 * set->text_size;
+        if ( n < set->text_len + ntext ) n = set->text_len + ntext;
+        if ( ! ( p = realloc( set->text, n ) ) ) return -1;
+        set->text      = (char *) p;
+        set->text_size = n;
+    }
+
+    return 0;
+}
+
+
+/*==========================================================================
+ *  Numbers.  A field is not NUL terminated, so it is copied before strtod().
+ *==========================================================================*/
+
+static double get_double( const char *p, const char *end ) {
+    char  num[NUMLEN];
+    int   n = end - p;
+
+    if ( n <= 0 ) return 0.0;
+    if ( n >= NUMLEN ) n = NUMLEN - 1;
+    memcpy( num, p, n );
+    num[n] = '\0';
+    return strtod( num, NULL );
+}
+
+
+static int32_t get_int( const char *p, const char *end ) {
+    int32_t  v = 0;
+    int      neg = 0;
+
+    if ( ( p < end ) && ( *p == '-' ) ) { neg = 1; p++; }
+    for ( ; ( p < end ) && ( *p >= '0' ) && ( *p <= '9' ); p++ ) v = 10 * v + ( *p - '0' );
+    return neg ? -v : v;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ * 
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License. 
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_reader.h
+ *
+ *  Read blocks of sims, given as (fileN, seek, len) from the sim_seeks table
+ *  or a sims seek index, and parse the lines into columns, keeping only the
+ *  hits that pass the cutoffs.
+ *
+ *  A sims line has tab separated fields:
+ *
+ *      id1 id2 iden ali_len mismatches gaps b1 e1 b2 e2 psc bsc [ ln1 ln2 ... ]
+ *
+ *  Lines with fewer than 12 fields are skipped (and counted as bad).  The
+ *  surviving lines are kept, with the newline replaced by a NUL, in the text
+ *  of the set; id1 and id2 point into them.
+ */
+
+#ifndef SIMS_READER_H
+#define SIMS_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*  Cutoffs: a hit is kept if psc <= max_psc and iden >= min_iden.  At most
+ *  max_hits hits are kept from each block (0 is no limit).
+ */
+
+typedef struct {
+    double  max_psc;
+    double  min_iden;
+    long    max_hits;
+} sims_cutoff_t;
+
+#define  SIMS_NO_CUTOFF  { 1.0e300, 0.0, 0 }
+
+/*  Parsed hits, as parallel arrays  */
+
+typedef struct {
+    size_t    n;            /*  hits in the set  */
+    size_t    size;         /*  allocated hits  */
+    size_t   *line;         /*  offset of the line in text  */
+    uint32_t *id1_len;
+    size_t   *id2;          /*  offset of id2 in text  */
+    uint32_t *id2_len;
+    float    *iden;
+    int32_t  *ali_len;
+    int32_t  *mismatches;
+    int32_t  *gaps;
+    int32_t  *b1, *e1;
+    int32_t  *b2, *e2;
+    double   *psc;
+    float    *bsc;
+    int32_t  *ln1, *ln2;    /*  0 if not in the line  */
+    char     *text;         /*  the kept lines  */
+    size_t    text_len;
+    size_t    text_size;
+    long      bad;          /*  lines that could not be parsed  */
+} sims_set_t;
+
+#define  SIMS_LINE( set, i )  ( (set)->text + (set)->line[i] )
+#define  SIMS_ID1( set, i )   ( (set)->text + (set)->line[i] )
+#define  SIMS_ID2( set, i )   ( (set)->text + (set)->id2[i] )
+
+typedef struct sims_reader sims_reader_t;
+
+/*  A reader maps file numbers to sims files; files are opened as needed,
+ *  and stay open until the reader is closed.
+ */
+
+sims_reader_t *sims_reader_new( void );
+int            sims_reader_add_file( sims_reader_t *r, uint32_t fileN, const char *path );
+int            sims_reader_read_list( sims_reader_t *r, const char *list );
+void           sims_reader_free( sims_reader_t *r );
+
+/*  Append the hits of one block that pass the cutoffs to set.  Returns the
+ *  number of hits added, or -1 if the block could not be read.
+ */
+
+long           sims_read( sims_reader_t *r, uint32_t fileN, uint64_t seek, uint32_t len,
+                          const sims_cutoff_t *cut, sims_set_t *set );
+
+/*  Parse the lines of a block that is already in memory.  */
+
+long           sims_parse( const char *data, size_t len,
+                           const sims_cutoff_t *cut, sims_set_t *set );
+
+void           sims_set_init( sims_set_t *set );
+void           sims_set_clear( sims_set_t *set );
+void           sims_set_free( sims_set_t *set );
+
+#endif
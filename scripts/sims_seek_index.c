@@ -0,0 +1,697 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_seek_index.c
+ *
+ *  Reader and builder for the binary sims seek index described in
+ *  sims_seek_index.h.  There is no main(); link with the program:
+ *
+ *      cc -O index_sims_file.c sims_seek_index.c -o index_sims_file -lpthread
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sims_seek_index.h"
+
+struct ssi_index {
+    unsigned char       *map;
+    size_t               size;
+    const ssi_header_t  *hdr;
+    const uint64_t      *blocks;
+    const unsigned char *pool;
+    const uint64_t      *first;
+    const ssi_entry_t   *entries;
+
+    /*  Cursor for sequential ssi_get() calls  */
+
+    uint64_t             cur_i;
+    const unsigned char *cur_p;
+    char                 cur_id[SSI_IDLEN+1];
+    int                  cur_len;
+};
+
+/*  In memory records of the builder are kept in an arena, in this form,
+ *  with the id following and padded to 8 bytes.
+ */
+
+typedef struct {
+    uint64_t  seek;
+    uint32_t  fileN;
+    uint32_t  len;
+    uint16_t  idlen;
+} ssi_rec_t;
+
+#define  REC_ID(r)    ( (char *) (r) + sizeof( ssi_rec_t ) )
+#define  REC_SIZE(n)  ( ( sizeof( ssi_rec_t ) + (n) + 7 ) & ~(size_t) 7 )
+
+/*  Sorted output is passed to the writer, which builds the sections in
+ *  temporary files.
+ */
+
+typedef struct {
+    FILE      *pool;
+    FILE      *first;
+    FILE      *entry;
+    uint64_t   nid;
+    uint64_t   nentry;
+    uint64_t   nblock;
+    uint64_t   pool_len;
+    uint64_t  *blocks;
+    size_t     maxblock;
+    char       prev[SSI_IDLEN+1];
+    int        prevlen;
+    int        error;
+} ssi_writer_t;
+
+/*  A sorted run spilled to a temporary file, and its current record  */
+
+typedef struct {
+    FILE      *fp;
+    ssi_rec_t  rec;
+    char       id[SSI_IDLEN+1];
+} ssi_run_t;
+
+struct ssi_builder {
+    char       *path;
+    size_t      memlimit;
+    char       *arena;
+    size_t      alen;
+    size_t      asize;
+    size_t     *recs;       /*  offsets of the records in the arena  */
+    ssi_rec_t **sorted;     /*  the records, in sorted order  */
+    size_t      nrec;
+    size_t      maxrec;
+    int         by_seek;    /*  order entries of an id by ( fileN, seek )  */
+    ssi_run_t  *runs;
+    int         nrun;
+    int         error;
+};
+
+static int    cmp_id( const char *a, int alen, const char *b, int blen );
+static const unsigned char *get_varint( const unsigned char *p, uint64_t *v );
+static int    put_varint( FILE *fp, uint64_t v );
+static FILE  *temp_file( const char *path );
+static int    sort_recs( ssi_builder_t *b );
+static int    spill_run( ssi_builder_t *b );
+static int    read_run( ssi_run_t *run );
+static int    merge_runs( ssi_builder_t *b, ssi_writer_t *w );
+static int    writer_init( ssi_writer_t *w, const char *path );
+static void   writer_add( ssi_writer_t *w, const char *id, int idlen, const ssi_rec_t *rec );
+static int    writer_finish( ssi_writer_t *w, const char *path );
+static int    copy_file( FILE *from, FILE *to, uint64_t pad );
+
+
+/*============================================================================
+ *  Reading
+ *==========================================================================*/
+
+ssi_index_t *ssi_open( const char *path ) {
+    ssi_index_t        *ssi;
+    const ssi_header_t *hdr;
+    struct stat         st;
+    int                 fd;
+
+    if ( ( fd = open( path, O_RDONLY, 0 ) ) < 0 ) return NULL;
+    if ( ( fstat( fd, &st ) != 0 ) || ( st.st_size < (off_t) sizeof( ssi_header_t ) ) ) {
+        close( fd );
+        return NULL;
+    }
+    if ( ! ( ssi = (ssi_index_t *) calloc( 1, sizeof( ssi_index_t ) ) ) ) {
+        close( fd );
+        return NULL;
+    }
+    ssi->size = st.st_size;
+    ssi->map  = (unsigned char *) mmap( NULL, ssi->size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( ssi->map == (unsigned char *) MAP_FAILED ) {
+        free( ssi );
+        return NULL;
+    }
+
+    hdr = ssi->hdr = (const ssi_header_t *) ssi->map;
+    if ( memcmp( hdr->magic, SSI_MAGIC, 8 ) || ( hdr->version != SSI_VERSION )
+                                            || ( hdr->block < 1 )
+                                            || ( hdr->entry_off + hdr->nentry * sizeof( ssi_entry_t ) > ssi->size )
+       ) {
+        fprintf( stderr, "%s is not a sims seek index\n", path );
+        ssi_close( ssi );
+        return NULL;
+    }
+
+    ssi->blocks  = (const uint64_t *)    ( ssi->map + hdr->block_off );
+    ssi->pool    = (const unsigned char *) ssi->map + hdr->pool_off;
+    ssi->first   = (const uint64_t *)    ( ssi->map + hdr->first_off );
+    ssi->entries = (const ssi_entry_t *) ( ssi->map + hdr->entry_off );
+    ssi->cur_i   = hdr->nid;    /*  no cursor  */
+
+    return ssi;
+}
+
+
+void ssi_close( ssi_index_t *ssi ) {
+    if ( ! ssi ) return;
+    if ( ssi->map ) munmap( ssi->map, ssi->size );
+    free( ssi );
+}
+
+
+uint64_t ssi_nid( ssi_index_t *ssi ) {
+    return ssi ? ssi->hdr->nid : 0;
+}
+
+
+long ssi_lookup( ssi_index_t *ssi, const char *id, const ssi_entry_t **entries ) {
+    const unsigned char *p;
+    char      buf[SSI_IDLEN+1];
+    uint64_t  lo, hi, mid, b, i, n, shared, rest, len;
+    int       idlen, c;
+
+    *entries = NULL;
+    if ( ! ssi || ! ssi->hdr->nid ) return 0;
+    idlen = strlen( id );
+
+    /*  Last block with a first id <= id  */
+
+    lo = 0;
+    hi = ssi->hdr->nblock;
+    while ( hi - lo > 1 ) {
+        mid = ( lo + hi ) / 2;
+        p = get_varint( ssi->pool + ssi->blocks[mid], &len );
+        if ( cmp_id( (const char *) p, (int) len, id, idlen ) <= 0 ) lo = mid;
+        else hi = mid;
+    }
+    b = lo;
+
+    /*  Decode the block  */
+
+    p = ssi->pool + ssi->blocks[b];
+    n = ssi->hdr->nid - b * ssi->hdr->block;
+    if ( n > ssi->hdr->block ) n = ssi->hdr->block;
+    len = 0;
+    for ( i = 0; i < n; i++ ) {
+        if ( i ) p = get_varint( p, &shared );
+        else     shared = 0;
+        p = get_varint( p, &rest );
+        if ( shared + rest > SSI_IDLEN ) return 0;
+        memcpy( buf + shared, p, rest );
+        p  += rest;
+        len = shared + rest;
+        c = cmp_id( buf, (int) len, id, idlen );
+        if ( c == 0 ) {
+            i += b * ssi->hdr->block;
+            *entries = ssi->entries + ssi->first[i];
+            return (long) ( ssi->first[i+1] - ssi->first[i] );
+        }
+        if ( c > 0 ) break;
+    }
+
+    return 0;
+}
+
+
+long ssi_get( ssi_index_t *ssi, uint64_t i, char *idbuf, const ssi_entry_t **entries ) {
+    uint64_t  shared, rest;
+
+    *entries = NULL;
+    if ( ! ssi || ( i >= ssi->hdr->nid ) ) return 0;
+
+    /*  Start from the beginning of the block unless this is the next id  */
+
+    if ( ( i != ssi->cur_i + 1 ) || ( i % ssi->hdr->block == 0 ) ) {
+        ssi->cur_i   = i - i % ssi->hdr->block;
+        ssi->cur_p   = get_varint( ssi->pool + ssi->blocks[ ssi->cur_i / ssi->hdr->block ], &rest );
+        memcpy( ssi->cur_id, ssi->cur_p, rest );
+        ssi->cur_p  += rest;
+        ssi->cur_len = (int) rest;
+    }
+    while ( ssi->cur_i < i ) {
+        ssi->cur_p = get_varint( ssi->cur_p, &shared );
+        ssi->cur_p = get_varint( ssi->cur_p, &rest );
+        memcpy( ssi->cur_id + shared, ssi->cur_p, rest );
+        ssi->cur_p  += rest;
+        ssi->cur_len = (int) ( shared + rest );
+        ssi->cur_i++;
+    }
+
+    memcpy( idbuf, ssi->cur_id, ssi->cur_len );
+    idbuf[ ssi->cur_len ] = '\0';
+    *entries = ssi->entries + ssi->first[i];
+    return (long) ( ssi->first[i+1] - ssi->first[i] );
+}
+
+
+/*============================================================================
+ *  Building
+ *==========================================================================*/
+
+ssi_builder_t *ssi_builder( const char *path, size_t memlimit ) {
+    ssi_builder_t *b;
+
+    if ( ! ( b = (ssi_builder_t *) calloc( 1, sizeof( ssi_builder_t ) ) ) ) return NULL;
+    if ( ! ( b->path = strdup( path ) ) ) {
+        free( b );
+        return NULL;
+    }
+    b->memlimit = memlimit ? memlimit : (size_t) 1 << 30;
+    return b;
+}
+
+
+void ssi_order_by_seek( ssi_builder_t *b ) {
+    if ( b ) b->by_seek = 1;
+}
+
+
+int ssi_add( ssi_builder_t *b, const char *id, int idlen,
+             uint32_t fileN, uint64_t seek, uint32_t len
+           ) {
+    ssi_rec_t *rec;
+    size_t     need;
+
+    if ( ! b || b->error ) return -1;
+    if ( idlen > SSI_IDLEN ) idlen = SSI_IDLEN;
+
+    need = REC_SIZE( idlen );
+    if ( b->alen + need > b->asize ) {
+        if ( b->nrec && ( b->alen + need > b->memlimit ) ) {
+            if ( spill_run( b ) ) return -1;
+        }
+        if ( b->alen + need > b->asize ) {
+            size_t size = b->asize ? 2 * b->asize : (size_t) 1 << 20;
+            while ( size < b->alen + need ) size *= 2;
+            if ( ! ( b->arena = (char *) realloc( b->arena, size ) ) ) {
+                b->error = 1;
+                return -1;
+            }
+            b->asize = size;
+        }
+    }
+    if ( b->nrec >= b->maxrec ) {
+        b->maxrec = b->maxrec ? 2 * b->maxrec : 65536;
+        if ( ! ( b->recs   = (size_t *)     realloc( b->recs,   b->maxrec * sizeof( size_t ) ) )
+          || ! ( b->sorted = (ssi_rec_t **) realloc( b->sorted, b->maxrec * sizeof( ssi_rec_t * ) ) )
+           ) {
+            b->error = 1;
+            return -1;
+        }
+    }
+
+    rec = (ssi_rec_t *) ( b->arena + b->alen );
+    rec->seek  = seek;
+    rec->fileN = fileN;
+    rec->len   = len;
+    rec->idlen = (uint16_t) idlen;
+    memcpy( REC_ID( rec ), id, idlen );
+    b->recs[ b->nrec++ ] = b->alen;
+    b->alen += need;
+
+    return 0;
+}
+
+
+int ssi_finish( ssi_builder_t *b ) {
+    ssi_writer_t  w;
+    ssi_rec_t    *rec;
+    size_t        i;
+    int           status, r;
+
+    if ( ! b ) return -1;
+    status = b->error ? -1 : 0;
+
+    if ( ! status && writer_init( &w, b->path ) ) status = -1;
+    if ( ! status ) {
+        if ( b->nrun ) {
+            if ( b->nrec && spill_run( b ) ) status = -1;
+            if ( ! status && merge_runs( b, &w ) ) status = -1;
+        }
+        else {
+            sort_recs( b );
+            for ( i = 0; i < b->nrec; i++ ) {
+                rec = b->sorted[i];
+                writer_add( &w, REC_ID( rec ), rec->idlen, rec );
+            }
+        }
+        if ( writer_finish( &w, b->path ) ) status = -1;
+    }
+
+    for ( r = 0; r < b->nrun; r++ ) if ( b->runs[r].fp ) fclose( b->runs[r].fp );
+    free( b->runs );
+    free( b->recs );
+    free( b->sorted );
+    free( b->arena );
+    free( b->path );
+    free( b );
+    return status;
+}
+
+
+/*  Records are sorted through pointers into the arena, so the order added
+ *  is the order of the pointers.
+ */
+
+static int cmp_recs( const void *a, const void *b ) {
+    const ssi_rec_t *ra = *(ssi_rec_t * const *) a;
+    const ssi_rec_t *rb = *(ssi_rec_t * const *) b;
+    int              c;
+
+    c = cmp_id( REC_ID( ra ), ra->idlen, REC_ID( rb ), rb->idlen );
+    if ( c ) return c;
+    return ( ra < rb ) ? -1 : ( ra > rb );   /*  keep the order added  */
+}
+
+
+static int cmp_recs_seek( const void *a, const void *b ) {
+    const ssi_rec_t *ra = *(ssi_rec_t * const *) a;
+    const ssi_rec_t *rb = *(ssi_rec_t * const *) b;
+    int              c;
+
+    c = cmp_id( REC_ID( ra ), ra->idlen, REC_ID( rb ), rb->idlen );
+    if ( c ) return c;
+    if ( ra->fileN != rb->fileN ) return ( ra->fileN < rb->fileN ) ? -1 : 1;
+    if ( ra->seek  != rb->seek  ) return ( ra->seek  < rb->seek  ) ? -1 : 1;
+    return ( ra < rb ) ? -1 : ( ra > rb );
+}
+
+
+static int sort_recs( ssi_builder_t *b ) {
+    size_t i;
+
+    for ( i = 0; i < b->nrec; i++ ) b->sorted[i] = (ssi_rec_t *) ( b->arena + b->recs[i] );
+    qsort( b->sorted, b->nrec, sizeof( ssi_rec_t * ), b->by_seek ? cmp_recs_seek : cmp_recs );
+    return 0;
+}
+
+
+static int spill_run( ssi_builder_t *b ) {
+    ssi_run_t *run;
+    ssi_rec_t *rec;
+    size_t     i;
+
+    if ( ! ( b->runs = (ssi_run_t *) realloc( b->runs, ( b->nrun + 1 ) * sizeof( ssi_run_t ) ) ) ) {
+        b->error = 1;
+        return -1;
+    }
+    run = b->runs + b->nrun++;
+    if ( ! ( run->fp = temp_file( b->path ) ) ) {
+        b->error = 1;
+        return -1;
+    }
+
+    sort_recs( b );
+    for ( i = 0; i < b->nrec; i++ ) {
+        rec = b->sorted[i];
+        if ( ( fwrite( rec, sizeof( ssi_rec_t ), 1, run->fp ) != 1 )
+          || ( fwrite( REC_ID( rec ), 1, rec->idlen, run->fp ) != rec->idlen )
+           ) {
+            b->error = 1;
+            return -1;
+        }
+    }
+    if ( fflush( run->fp ) || fseeko( run->fp, 0, SEEK_SET ) ) {
+        b->error = 1;
+        return -1;
+    }
+
+    b->nrec = 0;
+    b->alen = 0;
+    return 0;
+}
+
+
+/*  Read the next record of a run.  Returns 0 at the end.  */
+
+static int read_run( ssi_run_t *run ) {
+    if ( fread( &(run->rec), sizeof( ssi_rec_t ), 1, run->fp ) != 1 ) return 0;
+    if ( ( run->rec.idlen > SSI_IDLEN )
+      || ( fread( run->id, 1, run->rec.idlen, run->fp ) != run->rec.idlen )
+       ) return 0;
+    return 1;
+}
+
+
+/*  k-way merge of the runs through a heap.  Equal ids come from the
+ *  earlier run first, which keeps the order added (or, ordering by seek,
+ *  after comparing fileN and seek).
+ */
+
+static int run_before( ssi_run_t *runs, int a, int b, int by_seek ) {
+    int c = cmp_id( runs[a].id, runs[a].rec.idlen, runs[b].id, runs[b].rec.idlen );
+    if ( c ) return c < 0;
+    if ( by_seek ) {
+        if ( runs[a].rec.fileN != runs[b].rec.fileN ) return runs[a].rec.fileN < runs[b].rec.fileN;
+        if ( runs[a].rec.seek  != runs[b].rec.seek  ) return runs[a].rec.seek  < runs[b].rec.seek;
+    }
+    return a < b;
+}
+
+
+static int merge_runs( ssi_builder_t *b, ssi_writer_t *w ) {
+    ssi_run_t *runs = b->runs;
+    int       *heap, n, i, child, top;
+
+    if ( ! ( heap = (int *) malloc( b->nrun * sizeof( int ) ) ) ) return -1;
+    n = 0;
+    for ( i = 0; i < b->nrun; i++ ) {
+        if ( ! read_run( runs + i ) ) continue;
+        child = n++;
+        while ( child && run_before( runs, i, heap[ ( child - 1 ) / 2 ], b->by_seek ) ) {
+            heap[child] = heap[ ( child - 1 ) / 2 ];
+            child = ( child - 1 ) / 2;
+        }
+        heap[child] = i;
+    }
+
+    while ( n ) {
+        top = heap[0];
+        writer_add( w, runs[top].id, runs[top].rec.idlen, &(runs[top].rec) );
+        if ( ! read_run( runs + top ) ) top = heap[ --n ];
+
+        /*  Sift top down from the root  */
+
+        i = 0;
+        while ( ( child = 2 * i + 1 ) < n ) {
+            if ( ( child + 1 < n ) && run_before( runs, heap[child+1], heap[child], b->by_seek ) ) child++;
+            if ( ! run_before( runs, heap[child], top, b->by_seek ) ) break;
+            heap[i] = heap[child];
+            i = child;
+        }
+        if ( n ) heap[i] = top;
+    }
+
+    free( heap );
+    return w->error ? -1 : 0;
+}
+
+
+/*============================================================================
+ *  Writing sorted entries
+ *==========================================================================*/
+
+static int writer_init( ssi_writer_t *w, const char *path ) {
+    memset( w, 0, sizeof( ssi_writer_t ) );
+    w->pool  = temp_file( path );
+    w->first = temp_file( path );
+    w->entry = temp_file( path );
+    if ( ! w->pool || ! w->first || ! w->entry ) {
+        if ( w->pool  ) fclose( w->pool );
+        if ( w->first ) fclose( w->first );
+        if ( w->entry ) fclose( w->entry );
+        return -1;
+    }
+    return 0;
+}
+
+
+static void writer_add( ssi_writer_t *w, const char *id, int idlen, const ssi_rec_t *rec ) {
+    ssi_entry_t  entry;
+    uint64_t     first;
+    int          shared;
+
+    if ( ( ! w->nid ) || cmp_id( id, idlen, w->prev, w->prevlen ) ) {
+
+        /*  New id: front code it, and record its first entry  */
+
+        shared = 0;
+        if ( w->nid % SSI_BLOCK == 0 ) {
+            if ( w->nblock + 1 >= w->maxblock ) {
+                w->maxblock = w->maxblock ? 2 * w->maxblock : 4096;
+                if ( ! ( w->blocks = (uint64_t *) realloc( w->blocks, w->maxblock * sizeof( uint64_t ) ) ) ) {
+                    w->error = 1;
+                    return;
+                }
+            }
+            w->blocks[ w->nblock++ ] = w->pool_len;
+        }
+        else {
+            while ( ( shared < idlen ) && ( shared < w->prevlen ) && ( id[shared] == w->prev[shared] ) ) shared++;
+            w->pool_len += put_varint( w->pool, shared );
+        }
+        w->pool_len += put_varint( w->pool, idlen - shared );
+        w->pool_len += fwrite( id + shared, 1, idlen - shared, w->pool );
+        memcpy( w->prev, id, idlen );
+        w->prevlen = idlen;
+
+        first = w->nentry;
+        if ( fwrite( &first, sizeof( first ), 1, w->first ) != 1 ) w->error = 1;
+        w->nid++;
+    }
+
+    entry.fileN = rec->fileN;
+    entry.len   = rec->len;
+    entry.seek  = rec->seek;
+    if ( fwrite( &entry, sizeof( entry ), 1, w->entry ) != 1 ) w->error = 1;
+    w->nentry++;
+}
+
+
+/*  Assemble the sections into a new file, and rename it to path, so that
+ *  readers of an old index are not disturbed.
+ */
+
+static int writer_finish( ssi_writer_t *w, const char *path ) {
+    ssi_header_t  hdr;
+    uint64_t      first;
+    FILE         *out;
+    char         *tmp;
+    int           status;
+
+    status = w->error ? -1 : 0;
+    first = w->nentry;
+    if ( fwrite( &first, sizeof( first ), 1, w->first ) != 1 ) status = -1;
+    if ( ! w->blocks && ! ( w->blocks = (uint64_t *) malloc( sizeof( uint64_t ) ) ) ) status = -1;
+
+    tmp = (char *) malloc( strlen( path ) + 8 );
+    out = NULL;
+    if ( ! status && tmp ) {
+        sprintf( tmp, "%s.new", path );
+        out = fopen( tmp, "w" );
+    }
+
+    if ( out ) {
+        w->blocks[ w->nblock ] = w->pool_len;
+
+        memset( &hdr, 0, sizeof( hdr ) );
+        memcpy( hdr.magic, SSI_MAGIC, 8 );
+        hdr.version   = SSI_VERSION;
+        hdr.block     = SSI_BLOCK;
+        hdr.nid       = w->nid;
+        hdr.nentry    = w->nentry;
+        hdr.nblock    = w->nblock;
+        hdr.block_off = sizeof( hdr );
+        hdr.pool_off  = hdr.block_off + ( w->nblock + 1 ) * sizeof( uint64_t );
+        hdr.first_off = ( hdr.pool_off + w->pool_len + 7 ) & ~(uint64_t) 7;
+        hdr.entry_off = hdr.first_off + ( w->nid + 1 ) * sizeof( uint64_t );
+
+        if ( ( fwrite( &hdr, sizeof( hdr ), 1, out ) != 1 )
+          || ( fwrite( w->blocks, sizeof( uint64_t ), w->nblock + 1, out ) != w->nblock + 1 )
+          || copy_file( w->pool,  out, hdr.first_off - hdr.pool_off - w->pool_len )
+          || copy_file( w->first, out, 0 )
+          || copy_file( w->entry, out, 0 )
+           ) status = -1;
+        if ( fclose( out ) ) status = -1;
+        if ( status || rename( tmp, path ) ) {
+            unlink( tmp );
+            status = -1;
+        }
+    }
+    else {
+        status = -1;
+    }
+
+    fclose( w->pool );
+    fclose( w->first );
+    fclose( w->entry );
+    free( w->blocks );
+    free( tmp );
+    return status;
+}
+
+
+static int copy_file( FILE *from, FILE *to, uint64_t pad ) {
+    char    buf[64*1024];
+    size_t  n;
+
+    if ( fflush( from ) || fseeko( from, 0, SEEK_SET ) ) return -1;
+    while ( ( n = fread( buf, 1, sizeof( buf ), from ) ) > 0 ) {
+        if ( fwrite( buf, 1, n, to ) != n ) return -1;
+    }
+    if ( ferror( from ) ) return -1;
+    while ( pad-- ) putc( 0, to );
+    return 0;
+}
+
+
+/*============================================================================
+ *  Utilities
+ *==========================================================================*/
+
+static int cmp_id( const char *a, int alen, const char *b, int blen ) {
+    int c = memcmp( a, b, ( alen < blen ) ? alen : blen );
+    return c ? c : ( alen - blen );
+}
+
+
+static const unsigned char *get_varint( const unsigned char *p, uint64_t *v ) {
+    uint64_t  x = 0;
+    int       shift = 0;
+
+    while ( *p & 0x80 ) {
+        x |= (uint64_t) ( *p++ & 0x7F ) << shift;
+        shift += 7;
+    }
+    *v = x | ( (uint64_t) *p++ << shift );
+    return p;
+}
+
+
+static int put_varint( FILE *fp, uint64_t v ) {
+    int n = 1;
+
+    while ( v >= 0x80 ) {
+        putc( (int) ( v & 0x7F ) | 0x80, fp );
+        v >>= 7;
+        n++;
+    }
+    putc( (int) v, fp );
+    return n;
+}
+
+
+/*  An unlinked temporary file in the directory of path  */
+
+static FILE *temp_file( const char *path ) {
+    char   *name;
+    FILE   *fp;
+    int     fd;
+
+    if ( ! ( name = (char *) malloc( strlen( path ) + 16 ) ) ) return NULL;
+    sprintf( name, "%s.tmp.XXXXXX", path );
+    fd = mkstemp( name );
+    if ( fd >= 0 ) unlink( name );
+    free( name );
+    if ( fd < 0 ) return NULL;
+    if ( ! ( fp = fdopen( fd, "w+" ) ) ) close( fd );
+    return fp;
+}
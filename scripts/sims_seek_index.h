@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_seek_index.h
+ *
+ *  A memory mapped, sorted index of sims seeks: the same data as the
+ *  sim_seeks table (id, fileN, seek, len), looked up by binary search
+ *  instead of a database query.
+ *
+ *  File layout (integers are little endian):
+ *
+ *      header          ssi_header_t
+ *      block table     nblock+1 uint64 offsets into the string pool
+ *      string pool     ids, front coded in blocks of SSI_BLOCK ids
+ *      first entry     nid+1 uint64, entries of id i are first[i] .. first[i+1]-1
+ *      entries         nentry ssi_entry_t
+ *
+ *  In the string pool, the first id of each block is stored as a varint
+ *  length and the bytes of the id.  Each following id is stored as the
+ *  varint length of the prefix it shares with the id before it, the varint
+ *  length of the rest, and the rest of the bytes.
+ *
+ *  Entries of an id are in the order they were added (for index_sims_file,
+ *  the order of the file list and of the file), or, if the builder was set
+ *  to ssi_order_by_seek(), in order of fileN and seek.
+ */
+
+#ifndef SIMS_SEEK_INDEX_H
+#define SIMS_SEEK_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define  SSI_MAGIC    "FIGSSI01"
+#define  SSI_VERSION  1
+#define  SSI_BLOCK    16        /*  ids per front coded block  */
+#define  SSI_IDLEN    1024      /*  maximum id length  */
+
+typedef struct {
+    char      magic[8];
+    uint32_t  version;
+    uint32_t  block;            /*  ids per front coded block  */
+    uint64_t  nid;
+    uint64_t  nentry;
+    uint64_t  nblock;
+    uint64_t  block_off;        /*  file offsets of the sections  */
+    uint64_t  pool_off;
+    uint64_t  first_off;
+    uint64_t  entry_off;
+} ssi_header_t;
+
+typedef struct {
+    uint32_t  fileN;
+    uint32_t  len;
+    uint64_t  seek;
+} ssi_entry_t;
+
+typedef struct ssi_index   ssi_index_t;
+typedef struct ssi_builder ssi_builder_t;
+
+/*  Reading an index  */
+
+ssi_index_t  *ssi_open( const char *path );
+void          ssi_close( ssi_index_t *ssi );
+uint64_t      ssi_nid( ssi_index_t *ssi );
+
+/*  Find an id.  Returns the number of entries (0 if the id is not in the
+ *  index), and points *entries at the first of them.  The entries are in
+ *  the mapped file, and are valid until ssi_close().
+ */
+
+long          ssi_lookup( ssi_index_t *ssi, const char *id, const ssi_entry_t **entries );
+
+/*  Id number i (0 .. nid-1), copied to idbuf (SSI_IDLEN+1 bytes).  Returns
+ *  the number of entries, as ssi_lookup().  Sequential calls are cheap.
+ */
+
+long          ssi_get( ssi_index_t *ssi, uint64_t i, char *idbuf, const ssi_entry_t **entries );
+
+/*  Building an index.  Entries may be added in any order.  They are sorted
+ *  in memory, spilling sorted runs to temporary files beside the index when
+ *  more than memlimit bytes are held, and merged when the index is written.
+ *  ssi_finish() returns 0 on success, and frees the builder.  A builder is
+ *  not locked; ssi_add() must not be called from more than one thread at a
+ *  time.  Entries added from several threads can be given a repeatable
+ *  order with ssi_order_by_seek(), before the first ssi_add().
+ */
+
+ssi_builder_t *ssi_builder( const char *path, size_t memlimit );
+void           ssi_order_by_seek( ssi_builder_t *b );
+int            ssi_add( ssi_builder_t *b, const char *id, int idlen,
+                        uint32_t fileN, uint64_t seek, uint32_t len );
+int            ssi_finish( ssi_builder_t *b );
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2003-2006 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  sims_seek_lookup.c
+ *
+ *  Usage:  sims_seek_lookup  SeekIndex  [ id ... ]  > SimSeeks
+ *  or      sims_seek_lookup  SeekIndex  < id_list   > SimSeeks
+ *  or      sims_seek_lookup  -d  SeekIndex          > SimSeeks
+ *  or      sims_seek_lookup  -v   (to return version number on standard output)
+ *
+ *  Look up ids in a binary sims seek index (as written by index_sims_file -b),
+ *  and write the seeks in the form of the sim_seeks table:
+ *
+ *     SeqID \t FileNumber \t Seek \t Length
+ *
+ *  With -d, all of the index is written, in id order.
+ *
+ *  Compile with:  cc -O sims_seek_lookup.c sims_seek_index.c -o sims_seek_lookup
+ */
+
+#define  VERSION  "1.00"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sims_seek_index.h"
+
+#define  INPLEN  ( 4*1024)
+
+void  report( const char *id, const ssi_entry_t *entries, long n );
+void  usage( char *prog );
+
+
+int main( int argc, char **argv ) {
+    ssi_index_t        *ssi;
+    const ssi_entry_t  *entries;
+    char                inpbuf[INPLEN], idbuf[SSI_IDLEN+1];
+    char               *bptr;
+    uint64_t            i, nid;
+    long                n;
+    int                 dump, a;
+
+    if ( ( argc == 2 ) && ( strcmp( argv[1], "-v" ) == 0 ) ) {
+        printf( "%s\n", VERSION );
+        return 0;
+    }
+
+    dump = ( argc > 1 ) && ( strcmp( argv[1], "-d" ) == 0 );
+    if ( dump ) { argc--; argv++; }
+    if ( argc < 2 || ( dump && argc != 2 ) ) usage( argv[0] );
+
+    if ( ! ( ssi = ssi_open( argv[1] ) ) ) {
+        fprintf( stderr, "Could not open sims seek index %s\n", argv[1] );
+        return 1;
+    }
+
+    if ( dump ) {
+        nid = ssi_nid( ssi );
+        for ( i = 0; i < nid; i++ ) {
+            n = ssi_get( ssi, i, idbuf, &entries );
+            report( idbuf, entries, n );
+        }
+    }
+    else if ( argc > 2 ) {
+        for ( a = 2; a < argc; a++ ) {
+            n = ssi_lookup( ssi, argv[a], &entries );
+            report( argv[a], entries, n );
+        }
+    }
+    else {
+        while ( fgets( inpbuf, INPLEN, stdin ) ) {
+            for ( bptr = inpbuf; *bptr && *bptr != '\n' && *bptr != '\r' && *bptr != '\t'; bptr++ ) ;
+            *bptr = '\0';
+            if ( ! inpbuf[0] ) continue;
+            n = ssi_lookup( ssi, inpbuf, &entries );
+            report( inpbuf, entries, n );
+        }
+    }
+
+    ssi_close( ssi );
+    return ferror( stdout ) ? 1 : 0;
+}
+
+
+void report( const char *id, const ssi_entry_t *entries, long n ) {
+    long i;
+
+    for ( i = 0; i < n; i++ ) {
+        printf( "%s\t%u\t%llu\t%u\n", id, (unsigned) entries[i].fileN,
+                                      (unsigned long long) entries[i].seek,
+                                      (unsigned) entries[i].len );
+    }
+}
+
+
+void usage( char *prog ) {
+    fprintf( stderr,
+             "Usage: %s  SeekIndex  [ id ... ]  > SimSeeks\n"
+             "or     %s  SeekIndex  < id_list   > SimSeeks\n"
+             "or     %s  -d  SeekIndex          > SimSeeks\n"
+             "or     %s  -v    (writes the version to stdout)\n",
+             prog, prog, prog, prog
+           );
+    exit( 0 );
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2003-2008 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  translation_reader.c
+ *
+ *  Read the records of a translations file.  See translation_reader.h.
+ *
+ *  Characters are unsigned throughout, so bytes above 127 are nonwhite, as
+ *  they are to the perl, unless TR_ASCII is given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "translation_reader.h"
+
+/* From the MD5 code */
+
+#include "EXTERN.h"
+#include "perl.h"
+typedef struct {
+  U32 signature;   /* safer cast in get_md5_ctx() */
+  U32 A, B, C, D;  /* current digest */
+  U32 bytes_low;   /* counts bytes in message */
+  U32 bytes_high;  /* turn it into a 64-bit counter */
+  U8 buffer[128];  /* collect complete 64 byte blocks */
+} MD5_CTX;
+
+extern void MD5Update(MD5_CTX* ctx, const U8* buf, STRLEN len);
+extern void MD5Init(MD5_CTX *ctx);
+extern void MD5Final(U8* digest, MD5_CTX *ctx);
+extern char* hex_16(const unsigned char* from, char* to);
+
+#define  MD5BUFLEN  ( 4*1024)   /*  upper cased residues staged for the MD5  */
+
+struct tr_md5 {
+    MD5_CTX        ctx;
+    unsigned char  buf[MD5BUFLEN];
+    int            nbuf;
+    long           nres;
+    int            ascii;
+};
+
+static int  fill( tr_file_t *tf );
+static unsigned char  *find_eol( const tr_file_t *tf, unsigned char *p, unsigned char *end );
+
+
+/*==========================================================================
+ *  Files
+ *==========================================================================*/
+
+int tr_open( tr_file_t *tf, int fd, int flags ) {
+    unsigned char  hdr[BGZF_HEADER];
+
+    tf->fd       = fd;
+    tf->bgzf     = 0;
+    tf->ascii    = ( flags & TR_ASCII ) != 0;
+    tf->block    = NULL;
+    tf->nblock   = 0;
+    tf->maxblock = 0;
+    tf->bufseek  = 0;
+    tf->ptr      = tf->end = (unsigned char *) tf->buffer;
+    tf->at_line  = 1;
+    tf->eof      = 0;
+    tf->status   = TR_OK;
+
+    if (    ( pread( fd, hdr, BGZF_HEADER, 0 ) == BGZF_HEADER )
+         && bgzf_is_bgzf( hdr, BGZF_HEADER )
+       ) {
+        if ( bgzf_stream_init( &tf->stream, fd, 0 ) ) return 1;
+        tf->bgzf = 1;
+    }
+
+    return 0;
+}
+
+
+void tr_close( tr_file_t *tf ) {
+    if ( tf->bgzf ) bgzf_stream_free( &tf->stream );
+    free( tf->block );
+    tf->bgzf   = 0;
+    tf->block  = NULL;
+    tf->nblock = 0;
+}
+
+
+/*  Read the next buffer, or of a blocked gzip file, the next block.
+ *  Returns the bytes read; 0 at the end of the file or on an error (which
+ *  is left in status).
+ */
+
+static int fill( tr_file_t *tf ) {
+    tr_block_t  *blk;
+    uint64_t     cseek;
+    long         n;
+
+    tf->bufseek += (char *) tf->end - tf->buffer;
+    tf->ptr = tf->end = (unsigned char *) tf->buffer;
+    if ( tf->eof ) return 0;
+
+    if ( ! tf->bgzf ) {
+        n = read( tf->fd, tf->buffer, TR_BUFLEN );
+    }
+    else if ( ( n = bgzf_stream_next( &tf->stream, tf->buffer, &cseek ) ) > 0 ) {
+        if ( tf->nblock >= tf->maxblock ) {
+            int  maxblock = tf->maxblock ? 2 * tf->maxblock : 1024;
+            if ( ! ( blk = (tr_block_t *) realloc( tf->block, maxblock * sizeof( tr_block_t ) ) ) ) {
+                tf->status = TR_NOMEM;
+                tf->eof = 1;
+                return 0;
+            }
+            tf->block    = blk;
+            tf->maxblock = maxblock;
+        }
+        blk = tf->block + tf->nblock++;
+        blk->useek = tf->bufseek;
+        blk->cseek = (long long) cseek;
+    }
+
+    if ( n <= 0 ) {
+        if ( n < 0 ) tf->status = TR_BADREAD;
+        tf->eof = 1;
+        return 0;
+    }
+
+    tf->end = tf->ptr + n;
+    return (int) n;
+}
+
+
+/*  The end of the line at p (its newline, or with TR_ASCII, its newline or
+ *  NUL), or NULL if it is not in the buffer.
+ */
+
+static unsigned char *find_eol( const tr_file_t *tf, unsigned char *p, unsigned char *end ) {
+    if ( ! tf->ascii ) return (unsigned char *) memchr( p, '\n', end - p );
+    for ( ; p < end; p++ ) if ( ( *p == '\n' ) || ! *p ) return p;
+    return NULL;
+}
+
+
+/*  Skip the rest of the current line, or return -1 at the end of the file  */
+
+#define  SKIP_LINE( tf, nl )                                                  \
+    while ( 1 ) {                                                             \
+        if ( ( tf->ptr >= tf->end ) && ! fill( tf ) ) return -1;              \
+        if ( ( nl = find_eol( tf, tf->ptr, tf->end ) ) ) {                    \
+            tf->ptr = nl + 1;                                                 \
+            break;                                                            \
+        }                                                                     \
+        tf->ptr = tf->end;                                                    \
+    }
+
+
+int tr_next_id( tr_file_t *tf, char *id, int max_id_len, int *truncated ) {
+    unsigned char  *nl;
+    unsigned int    c;
+    int             len, bars;
+
+    *truncated = 0;
+
+    /*  Find a line that starts with '>'  */
+
+    while ( 1 ) {
+        if ( ( tf->ptr >= tf->end ) && ! fill( tf ) ) return -1;
+        if ( tf->at_line && ( *tf->ptr == '>' ) ) break;
+        tf->at_line = 0;
+        SKIP_LINE( tf, nl );
+        tf->at_line = 1;
+    }
+    tf->ptr++;
+    tf->at_line = 0;
+
+    /*  White space before the id  */
+
+    while ( 1 ) {
+        if ( ( tf->ptr >= tf->end ) && ! fill( tf ) ) return -1;
+        c = *tf->ptr;
+        if ( ( c > 127 ) && tf->ascii ) c = ' ';
+        if ( ( c > ' ' ) || ( c == '\n' ) || ! c ) break;
+        tf->ptr++;
+    }
+
+    /*  The id ends at white space, or at the fifth vertical bar  */
+
+    len  = 0;
+    bars = TR_N_BAR_OK;
+    while ( 1 ) {
+        if ( ( tf->ptr >= tf->end ) && ! fill( tf ) ) return -1;
+        c = *tf->ptr;
+        if ( ( c > 127 ) && tf->ascii ) c = ' ';
+        if ( ( c <= ' ' ) || ( ( c == '|' ) && ( bars-- <= 0 ) ) ) break;
+        if ( len >= max_id_len ) {
+            *truncated = 1;
+            break;
+        }
+        id[len++] = c;
+        tf->ptr++;
+    }
+    id[len] = '\0';
+
+    SKIP_LINE( tf, nl );
+    tf->at_line = 1;
+
+    return len;
+}
+
+
+long tr_next_seq( tr_file_t *tf, const unsigned char **data ) {
+    unsigned char  *p, *nl;
+
+    if ( ( tf->ptr >= tf->end ) && ! fill( tf ) ) return 0;
+    p = tf->ptr;
+    if ( tf->at_line && ( *p == '>' ) ) return 0;
+
+    /*  Take as many whole lines as there are in the buffer  */
+
+    while ( ( nl = find_eol( tf, tf->ptr, tf->end ) ) ) {
+        tf->ptr = nl + 1;
+        if ( ( tf->ptr >= tf->end ) || ( *tf->ptr == '>' ) ) break;
+    }
+    if ( nl ) {
+        tf->at_line = 1;
+    }
+    else {
+        tf->ptr = tf->end;
+        tf->at_line = 0;
+    }
+
+    *data = p;
+    return tf->ptr - p;
+}
+
+
+long long tr_virtual_seek( const tr_file_t *tf, long long seek ) {
+    int  lo, hi, mid;
+
+    if ( ! tf->bgzf || ! tf->nblock ) return seek;
+    lo = 0;
+    hi = tf->nblock;
+    while ( hi - lo > 1 ) {
+        mid = ( lo + hi ) / 2;
+        if ( tf->block[mid].useek <= seek ) lo = mid;
+        else hi = mid;
+    }
+    return (long long) BGZF_VSEEK( tf->block[lo].cseek, seek - tf->block[lo].useek );
+}
+
+
+/*==========================================================================
+ *  MD5 of a sequence
+ *==========================================================================*/
+
+tr_md5_t *tr_md5_new( int flags ) {
+    tr_md5_t  *m;
+
+    if ( ( m = (tr_md5_t *) calloc( 1, sizeof( tr_md5_t ) ) ) ) m->ascii = ( flags & TR_ASCII ) != 0;
+    return m;
+}
+
+
+void tr_md5_free( tr_md5_t *m ) {
+    free( m );
+}
+
+
+void tr_md5_begin( tr_md5_t *m ) {
+    MD5Init( &m->ctx );
+    m->nbuf = 0;
+    m->nres = 0;
+}
+
+
+void tr_md5_add( tr_md5_t *m, const unsigned char *p, long n ) {
+    const unsigned char  *end = p + n;
+    unsigned int          c;
+
+    for ( ; p < end; p++ ) {
+        if ( ( ( c = *p ) <= ' ' ) || ( ( c > 127 ) && m->ascii ) ) continue;
+        if ( c >= 'a' && c <= 'z' ) c -= 'a' - 'A';
+        m->buf[ m->nbuf++ ] = c;
+        m->nres++;
+        if ( m->nbuf == MD5BUFLEN ) {
+            MD5Update( &m->ctx, m->buf, MD5BUFLEN );
+            m->nbuf = 0;
+        }
+    }
+}
+
+
+int tr_md5_end( tr_md5_t *m, unsigned char digest[16] ) {
+    if ( m->nres < TR_MD5MINLEN ) return 0;
+    if ( m->nbuf ) MD5Update( &m->ctx, m->buf, m->nbuf );
+    MD5Final( digest, &m->ctx );
+    return 1;
+}
+
+
+void tr_md5_hex( const unsigned char digest[16], char *hex ) {
+    hex_16( digest, hex );
+}
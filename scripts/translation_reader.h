@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2003-2008 University of Chicago and Fellowship
+ * for Interpretations of Genomes. All Rights Reserved.
+ *
+ * This file is part of the SEED Toolkit.
+ *
+ * The SEED Toolkit is free software. You can redistribute
+ * it and/or modify it under the terms of the SEED Toolkit
+ * Public License.
+ *
+ * You should have received a copy of the SEED Toolkit Public License
+ * along with this program; if not write to the University of Chicago
+ * at info@ci.uchicago.edu or the Fellowship for Interpretation of
+ * Genomes at veronika@thefig.info or download a copy from
+ * http://www.theseed.org/LICENSE.TXT.
+ */
+
+
+/*  translation_reader.h
+ *
+ *  Read the records of a translations (fasta) file, as index_translation_files
+ *  and compute_translation_MD5 do, following the perl of index_translations:
+ *
+ *    - A record starts with a line beginning with '>'.  Lines before the
+ *      first record are skipped.
+ *    - The id follows the '>' and any white space, and ends at white space
+ *      or at the fifth vertical bar.  A longer id is truncated, and the rest
+ *      of the line is skipped.
+ *    - The sequence is every line up to the next line beginning with '>',
+ *      or the end of the file.
+ *
+ *  A translations file compressed to blocked gzip (see bgzf.h) is read a
+ *  block at a time; the blocks are kept, so that an uncompressed offset can
+ *  be made a virtual seek.
+ *
+ *  The MD5 of a sequence, for protein_sequence_MD5, is the MD5 of its
+ *  nonwhite characters, upper cased.  Sequences of fewer than TR_MD5MINLEN
+ *  residues get none.
+ *
+ *  Bytes above 127 are nonwhite, as they are to the perl.  With TR_ASCII,
+ *  they are white space instead, and a NUL ends a line, as they were read
+ *  by index_translation_files before 2.05 (which kept its seeks).
+ *
+ *  md5.c (which needs the perl CORE include directory) is required.
+ */
+
+#ifndef TRANSLATION_READER_H
+#define TRANSLATION_READER_H
+
+#include "bgzf.h"
+
+#define  TR_BUFLEN     ( 128*1024 )   /*  read buffer, at least BGZF_MAXBLOCK  */
+#define  TR_N_BAR_OK   4              /*  vertical bars allowed in an id  */
+#define  TR_MD5MINLEN  5              /*  shortest sequence given an MD5  */
+
+/*  Flags of tr_open() and tr_md5_new()  */
+
+#define  TR_ASCII      1              /*  bytes above 127 are white, NUL ends a line  */
+
+/*  Status of a file after it is read  */
+
+#define  TR_OK         0
+#define  TR_BADREAD    1              /*  read error, or damaged blocked gzip block  */
+#define  TR_NOMEM      2
+
+typedef struct {
+    long long  useek;                 /*  uncompressed offset of the block  */
+    long long  cseek;                 /*  file offset of the block  */
+} tr_block_t;
+
+typedef struct {
+    int             fd;
+    int             bgzf;             /*  nonzero if the file is blocked gzip  */
+    int             ascii;            /*  TR_ASCII was given  */
+    bgzf_stream_t   stream;
+    tr_block_t     *block;
+    int             nblock;
+    int             maxblock;
+    long long       bufseek;          /*  uncompressed offset of buffer  */
+    unsigned char  *ptr;              /*  next character in buffer  */
+    unsigned char  *end;
+    int             at_line;          /*  is ptr at the start of a line?  */
+    int             eof;
+    int             status;
+    char            buffer[ TR_BUFLEN ];
+} tr_file_t;
+
+/*  Start reading an open file, with flags TR_ASCII or 0.  Returns nonzero
+ *  if memory cannot be had.
+ */
+
+int        tr_open( tr_file_t *tf, int fd, int flags );
+
+/*  Free the blocked gzip state (the file is not closed).  */
+
+void       tr_close( tr_file_t *tf );
+
+/*  Read to the id of the next record, and put it in id, which has room for
+ *  max_id_len characters and a '\0'.  *truncated is set if the id was cut
+ *  to max_id_len.  The file is left at the first line of the sequence.
+ *  Returns the id length (0 for a null id), or -1 at the end of the file.
+ */
+
+int        tr_next_id( tr_file_t *tf, char *id, int max_id_len, int *truncated );
+
+/*  Point *data at the next characters of the sequence of the record (these
+ *  are whole lines, with white space and newlines, except at the end of a
+ *  buffer).  Returns their number, or 0 at the end of the record.
+ */
+
+long       tr_next_seq( tr_file_t *tf, const unsigned char **data );
+
+/*  The uncompressed offset of the next character; after tr_next_seq()
+ *  returns 0, that is the end of the record.
+ */
+
+#define    tr_seek( tf )  ( (tf)->bufseek + ( (char *) (tf)->ptr - (tf)->buffer ) )
+
+/*  A virtual seek for an uncompressed offset of a blocked gzip file, or the
+ *  offset itself in a plain file.
+ */
+
+long long  tr_virtual_seek( const tr_file_t *tf, long long seek );
+
+/*  MD5 of a sequence  */
+
+typedef struct tr_md5 tr_md5_t;
+
+tr_md5_t  *tr_md5_new( int flags );
+void       tr_md5_free( tr_md5_t *m );
+void       tr_md5_begin( tr_md5_t *m );
+void       tr_md5_add( tr_md5_t *m, const unsigned char *p, long n );
+
+/*  Finish the MD5.  Returns 0, and leaves digest alone, if the sequence is
+ *  too short.
+ */
+
+int        tr_md5_end( tr_md5_t *m, unsigned char digest[16] );
+
+/*  Hex of a digest, in 33 characters  */
+
+void       tr_md5_hex( const unsigned char digest[16], char *hex );
+
+#endif
@@ -0,0 +1,223 @@
+# -*- perl -*-
+#
+# Copyright (c) 2003-2006 University of Chicago and Fellowship
+# for Interpretations of Genomes. All Rights Reserved.
+#
+# This file is part of the SEED Toolkit.
+# 
+# The SEED Toolkit is free software. You can redistribute
+# it and/or modify it under the terms of the SEED Toolkit
+# Public License. 
+#
+# You should have received a copy of the SEED Toolkit Public License
+# along with this program; if not write to the University of Chicago
+# at info@ci.uchicago.edu or the Fellowship for Interpretation of
+# Genomes at veronika@thefig.info or download a copy from
+# http://www.theseed.org/LICENSE.TXT.
+#
+
+
+#
+#  Usage: verify_contigs [--threads n] [ G1 G2 G3 ... ]
+#
+#  Check the contigs files of the genomes (all genomes, by default) against
+#  what index_contigs stored for them, without writing to the database.
+#  The files are hashed again by index_contig_files (on n threads; by
+#  default, one per processor) with -l, so that only the length, CRC and MD5
+#  of each contig are computed.  These are compared with the contig_lengths
+#  and contig_md5sums tables, and with the COUNTS and MD5SUM files of each
+#  genome directory.  Each difference is written as a line:
+#
+#      genome_id \t contig_id \t what \t stored \t found \n
+#
+#  where what is one of
+#
+#      length    the contig length differs from contig_lengths
+#      md5       the contig MD5 differs from contig_md5sums
+#      missing   a contig in the database is not in the files
+#      extra     a contig in the files is not in the database
+#
+#  or, with a contig_id of "-", one of the genome totals in COUNTS
+#  (n_contigs, total_nuc or cksum) or the MD5 of the genome's signature
+#  (MD5SUM).  A summary goes to STDERR, and the exit status is 1 if any
+#  genome differs.
+#
+
+use strict;
+use FIG;
+use Tracer;
+use Getopt::Long;
+
+my $have_md5 = eval { require Digest::MD5; 1 };
+
+my $usage = "Usage: $0 [--threads n] [ G1 G2 G3 ... ]";
+
+my $threads = 0;
+my $help = 0;
+
+my $rc = GetOptions("threads=i" => \$threads,
+		    "help" => \$help);
+
+$rc or die "$usage\n";
+
+if ($help)
+{
+    print "$usage\n";
+    exit(0);
+}
+
+my $fig = new FIG;
+my $dbf = $fig->db_handle;
+my $orgroot  = $FIG_Config::organisms;
+my $temp_dir = $FIG_Config::temp;
+
+my ($mode, @genomes) = FIG::parse_genome_args(@ARGV);
+
+#
+#  Version 1.07 of index_contig_files can skip the seek records (-l);
+#  versions 1.03 on can use more than one thread.  Any version from 1.01
+#  gives the MD5 of each contig.
+#
+
+my $v;
+(      open VERSION_PIPE, "index_contig_files -v |"
+   and $v = <VERSION_PIPE>
+   and close VERSION_PIPE
+   and chomp $v
+   and $v >= 1.01
+) || die "index_contig_files version 1.01 or later is required\n";
+
+my $opts = ( $v >= 1.03 ? "-j $threads " : "" ) . ( $v >= 1.07 ? "-l " : "" );
+
+#
+#  The contigs files, as for index_contigs:
+#
+
+my $filelist = "$temp_dir/verify_contig_files.$$";
+open( FILELIST, ">$filelist" ) || die "could not open $filelist";
+foreach my $genome ( @genomes )
+{
+    my $genomedir = "$orgroot/$genome";
+    if ( opendir( GENOMEDIR, $genomedir ) )
+    {
+	foreach my $file ( grep { $_ =~ /^contigs\d*$/ } readdir(GENOMEDIR) )
+	{
+	    my $contigfile = "$genomedir/$file";
+	    print FILELIST "$genome\t0\t$contigfile\n" if -s $contigfile;
+	}
+	closedir( GENOMEDIR );
+    }
+}
+close( FILELIST );
+
+#
+#  The records come grouped by genome, in the order of the list.  Each
+#  genome is checked when its last record has been read.
+#
+
+my ( $nbad, $nchecked ) = ( 0, 0 );
+my %done;
+my $genome = "";
+my %found;
+
+open( INPIPE, "index_contig_files $opts< $filelist |" )
+    || die "could not run index_contig_files";
+while ( defined( $_ = <INPIPE> ) )
+{
+    chomp;
+    my @parts = split /\t/;
+    next unless @parts == 5;
+
+    if ( $parts[0] ne $genome )
+    {
+	check_genome( $genome, \%found ) if $genome;
+	$genome = $parts[0];
+	%found = ();
+    }
+
+    #  As in index_contigs, the first of duplicate ids is the one kept.
+
+    $found{ $parts[1] } ||= [ @parts[2, 3, 4] ];
+}
+check_genome( $genome, \%found ) if $genome;
+close( INPIPE ) || die "index_contig_files failed";
+unlink( $filelist );
+
+#  Genomes with no contigs files:
+
+foreach my $g ( grep { ! $done{ $_ } } @genomes )
+{
+    check_genome( $g, {} );
+}
+
+print STDERR "$nchecked genomes checked, $nbad with differences\n";
+exit( $nbad ? 1 : 0 );
+
+
+#  Only subroutines below:----------------------------------------------------
+
+sub check_genome {
+    my ( $genome, $found ) = @_;
+
+    $done{ $genome } = 1;
+    $nchecked++;
+
+    my %len = map { $_->[0] => $_->[1] }
+	      @{ $dbf->SQL("SELECT contig, len FROM contig_lengths WHERE ( genome = ? )", undef, $genome) };
+    my %md5 = map { $_->[0] => $_->[1] }
+	      @{ $dbf->SQL("SELECT contig, md5 FROM contig_md5sums WHERE ( genome = ? )", undef, $genome) };
+
+    my @diffs;
+    my ( $ncontig, $ttlnuc, $cksum ) = ( 0, 0, 0 );
+    foreach my $id ( sort keys %$found )
+    {
+	my ( $len, $crc, $md5 ) = @{ $found->{ $id } };
+	$ncontig++;
+	$ttlnuc += $len;
+	$cksum  ^= $crc;
+
+	if ( ! exists $len{ $id } && ! exists $md5{ $id } )
+	{
+	    push @diffs, [ $id, "extra", "", $len ];
+	    next;
+	}
+	push @diffs, [ $id, "length", $len{ $id }, $len ] if $len{ $id } != $len;
+	push @diffs, [ $id, "md5",    $md5{ $id }, $md5 ] if $md5{ $id } ne $md5;
+    }
+
+    foreach my $id ( sort grep { ! $found->{ $_ } } keys %{ { %len, %md5 } } )
+    {
+	push @diffs, [ $id, "missing", $len{ $id }, "" ];
+    }
+
+    #  COUNTS is genome, n_contigs, total_nucleotides, cksum (followed by
+    #  "file-based" if the cksum is of the files, rather than of the contigs).
+
+    my $genomedir = "$orgroot/$genome";
+    if ( open( COUNTS, "<$genomedir/COUNTS" ) )
+    {
+	my ( undef, $n, $ttl, $ck, $based ) = split /\t/, scalar <COUNTS>;
+	close( COUNTS );
+	chomp( $ck, $based );
+	push @diffs, [ "-", "n_contigs", $n,   $ncontig ] if $n   != $ncontig;
+	push @diffs, [ "-", "total_nuc", $ttl, $ttlnuc  ] if $ttl != $ttlnuc;
+	push @diffs, [ "-", "cksum",     $ck,  $cksum   ] if ! $based && $ck != $cksum;
+    }
+
+    if ( $have_md5 && %$found && open( MD5SUM, "<$genomedir/MD5SUM" ) )
+    {
+	chomp( my $stored = <MD5SUM> );
+	close( MD5SUM );
+	my $dig = new Digest::MD5;
+	$dig->add( "$_\t$found->{$_}->[0]\t$found->{$_}->[2]\n" ) for sort keys %$found;
+	my $hex = $dig->hexdigest;
+	push @diffs, [ "-", "MD5SUM", $stored, $hex ] if $stored ne $hex;
+    }
+
+    if ( @diffs )
+    {
+	$nbad++;
+	print join( "\t", $genome, @$_ ), "\n" for @diffs;
+    }
+    Trace("$genome: " . @diffs . " differences.") if T(3);
+}